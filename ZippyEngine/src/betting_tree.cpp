@@ -1,6 +1,10 @@
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <memory>
@@ -37,8 +41,11 @@ Node::Node(int id, int street, int player_acting, const shared_ptr<Node> &call_s
     num_bet_succs = bet_succs->size();
     num_succs += num_bet_succs;
   }
+  succs_ = nullptr;
+  owns_succs_ = false;
   if (num_succs > 0) {
-    succs_.reset(new shared_ptr<Node>[num_succs]);
+    succs_ = new shared_ptr<Node>[num_succs];
+    owns_succs_ = true;
     int i = 0;
     if (call_succ) succs_[i++] = call_succ;
     if (fold_succ) succs_[i++] = fold_succ;
@@ -67,8 +74,11 @@ Node::Node(int id, int street, int player_acting, const shared_ptr<Node> &call_s
 
 Node::Node(Node *src) {
   int num_succs = src->NumSuccs();
+  succs_ = nullptr;
+  owns_succs_ = false;
   if (num_succs > 0) {
-    succs_.reset(new shared_ptr<Node>[num_succs]);
+    succs_ = new shared_ptr<Node>[num_succs];
+    owns_succs_ = true;
   }
   for (int s = 0; s < num_succs; ++s) succs_[s] = NULL;
   id_ = src->id_;
@@ -84,8 +94,11 @@ Node::Node(int id, int last_bet_to, int num_succs, unsigned short flags,
   id_ = id;
   last_bet_to_ = last_bet_to;
   num_succs_ = num_succs;
+  succs_ = nullptr;
+  owns_succs_ = false;
   if (num_succs > 0) {
-    succs_.reset(new shared_ptr<Node>[num_succs]);
+    succs_ = new shared_ptr<Node>[num_succs];
+    owns_succs_ = true;
   }
   for (int s = 0; s < num_succs; ++s) succs_[s] = nullptr;
   flags_ = flags;
@@ -93,6 +106,19 @@ Node::Node(int id, int last_bet_to, int num_succs, unsigned short flags,
   num_remaining_ = num_remaining;
 }
 
+void Node::Init(int id, int last_bet_to, int num_succs, unsigned short flags,
+		unsigned char player_acting, unsigned char num_remaining, shared_ptr<Node> *succs) {
+  if (owns_succs_) delete [] succs_;
+  succs_ = succs;
+  owns_succs_ = false;
+  id_ = id;
+  last_bet_to_ = last_bet_to;
+  num_succs_ = num_succs;
+  flags_ = flags;
+  player_acting_ = player_acting;
+  num_remaining_ = num_remaining;
+}
+
 string Node::ActionName(int s) {
   if (s == CallSuccIndex()) {
     return "c";
@@ -459,6 +485,84 @@ shared_ptr<Node> BettingTree::Read(Reader *reader, unordered_map< int, shared_pt
   return node;
 }
 
+// Reads a tree in the flat format.  All the nodes and all the succ pointers are allocated in one
+// go, and succs are resolved by index, so there is no need for the maps used by Read().  Returns
+// false if the file is not in the flat format.
+bool BettingTree::ReadFlat(const char *filename) {
+  int fd = open(filename, O_RDONLY, 0);
+  if (fd == -1) {
+    fprintf(stderr, "Failed to open %s\n", filename);
+    exit(-1);
+  }
+  struct stat stbuf;
+  if (fstat(fd, &stbuf) == -1) {
+    fprintf(stderr, "Couldn't stat %s\n", filename);
+    exit(-1);
+  }
+  size_t size = stbuf.st_size;
+  if (size < sizeof(BettingTreeFileHeader)) {
+    close(fd);
+    return false;
+  }
+  void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    fprintf(stderr, "Failed to mmap %s\n", filename);
+    exit(-1);
+  }
+  const BettingTreeFileHeader *header = (const BettingTreeFileHeader *)mapped;
+  if (header->magic != kBettingTreeFileMagic) {
+    munmap(mapped, size);
+    return false;
+  }
+  if (header->version != kBettingTreeFileVersion) {
+    fprintf(stderr, "%s: unsupported betting tree file version %u\n", filename,
+	    header->version);
+    exit(-1);
+  }
+  unsigned int num_nodes = header->num_nodes;
+  unsigned int num_succs = header->num_succs;
+  size_t expected_size = sizeof(BettingTreeFileHeader) +
+    num_nodes * sizeof(BettingTreeFileNode) + num_succs * sizeof(unsigned int);
+  if (num_nodes == 0 || size != expected_size) {
+    fprintf(stderr, "%s: size %zu; expected %zu\n", filename, size, expected_size);
+    exit(-1);
+  }
+  const BettingTreeFileNode *records = (const BettingTreeFileNode *)(header + 1);
+  const unsigned int *succ_indices = (const unsigned int *)(records + num_nodes);
+
+  flat_nodes_.reset(new Node[num_nodes]);
+  flat_succs_.reset(new shared_ptr<Node>[num_succs]);
+  unsigned long long int first_succ = 0;
+  for (unsigned int i = 0; i < num_nodes; ++i) {
+    const BettingTreeFileNode &r = records[i];
+    if (first_succ + r.num_succs > num_succs) {
+      fprintf(stderr, "%s: node %u has OOB succs\n", filename, i);
+      exit(-1);
+    }
+    flat_nodes_[i].Init(r.id, r.last_bet_to, r.num_succs, r.flags, r.player_acting,
+			r.num_remaining, flat_succs_.get() + first_succ);
+    first_succ += r.num_succs;
+    if (r.num_succs == 0) ++num_terminals_;
+  }
+  if (first_succ != num_succs) {
+    fprintf(stderr, "%s: expected %u succs; found %llu\n", filename, num_succs, first_succ);
+    exit(-1);
+  }
+  for (unsigned int j = 0; j < num_succs; ++j) {
+    unsigned int n = succ_indices[j];
+    if (n >= num_nodes) {
+      fprintf(stderr, "%s: OOB succ index %u\n", filename, n);
+      exit(-1);
+    }
+    // Non-owning pointers; flat_nodes_ owns the nodes.
+    flat_succs_[j] = shared_ptr<Node>(shared_ptr<Node>(), &flat_nodes_[n]);
+  }
+  root_ = shared_ptr<Node>(shared_ptr<Node>(), &flat_nodes_[0]);
+  munmap(mapped, size);
+  return true;
+}
+
 // Maintain a map from ids to shared pointers to nodes.
 void BettingTree::Initialize(int target_player, const BettingAbstraction &ba) {
   char buf[500];
@@ -471,16 +575,19 @@ void BettingTree::Initialize(int target_player, const BettingAbstraction &ba) {
 	    Game::GameName().c_str(), Game::NumPlayers(),
 	    ba.BettingAbstractionName().c_str());
   }
-  Reader reader(buf);
   initial_street_ = ba.InitialStreet();
   root_ = nullptr;
   num_terminals_ = 0;
   int max_street = Game::MaxStreet();
   int num_players = Game::NumPlayers();
-  int num_maps = (max_street + 1) * num_players;
-  unique_ptr<unordered_map< int, shared_ptr<Node> > []>
-    maps(new unordered_map< int, shared_ptr<Node> > [num_maps]);
-  root_ = Read(&reader, maps.get());
+  if (! ReadFlat(buf)) {
+    // Old format
+    Reader reader(buf);
+    int num_maps = (max_street + 1) * num_players;
+    unique_ptr<unordered_map< int, shared_ptr<Node> > []>
+      maps(new unordered_map< int, shared_ptr<Node> > [num_maps]);
+    root_ = Read(&reader, maps.get());
+  }
   FillTerminalArray();
   num_nonterminals_.reset(new int[num_players * (max_street + 1)]);
   CountNumNonterminals(this, num_nonterminals_.get());
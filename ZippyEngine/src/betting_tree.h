@@ -20,7 +20,16 @@ public:
   Node(Node *node);
   Node(int id, int last_bet_to, int num_succs, unsigned short flags, unsigned char player_acting,
        unsigned char num_remaining);
-  ~Node(void) {}
+  // For nodes allocated in bulk.  Init() must be called before use.
+  Node(void) : succs_(nullptr), owns_succs_(false), id_(-1), last_bet_to_(0), num_succs_(0),
+	       flags_(0), player_acting_(0), num_remaining_(0) {}
+  Node(const Node &) = delete;
+  Node &operator=(const Node &) = delete;
+  ~Node(void) {if (owns_succs_) delete [] succs_;}
+  // The succs live in storage owned by the caller (e.g., the bulk-loaded tree).
+  void Init(int id, int last_bet_to, int num_succs, unsigned short flags,
+	    unsigned char player_acting, unsigned char num_remaining,
+	    std::shared_ptr<Node> *succs);
 
   int PlayerActing(void) const {return player_acting_;}
   bool Terminal(void) const {return NumSuccs() == 0;}
@@ -65,7 +74,8 @@ public:
   static const int kStreetShift = 3;
 
  private:
-  std::unique_ptr<std::shared_ptr<Node> []> succs_;
+  std::shared_ptr<Node> *succs_;
+  bool owns_succs_;
   int id_;
   short last_bet_to_;
   short num_succs_;
@@ -98,14 +108,44 @@ class BettingTree {
   void Initialize(int target_player, const BettingAbstraction &ba);
   std::shared_ptr<Node> Read(Reader *reader,
 			     std::unordered_map< int, std::shared_ptr<Node> > *maps);
+  bool ReadFlat(const char *filename);
 
   std::shared_ptr<Node> root_;
   int initial_street_;
   int num_terminals_;
   std::unique_ptr<Node * []> terminals_;
   std::unique_ptr<int []> num_nonterminals_;
+  // Storage for trees read from files in the flat format.  root_ and the succs do not own the
+  // nodes; these arrays do.
+  std::unique_ptr<Node []> flat_nodes_;
+  std::unique_ptr<std::shared_ptr<Node> []> flat_succs_;
 };
 
+// The current file format is a flat array of node records followed by an array of successor
+// indices.  The succs of each node are contiguous in the index array, in the same order as the
+// records, so the offsets of the succs need not be stored.  A reentrant node is stored once and
+// referenced by index from each of its parents, while terminals get one record per occurrence,
+// as in the old recursive format.  Records are in depth-first order with the root first.  Files
+// in the old format (which has no header) can still be read.
+struct BettingTreeFileHeader {
+  unsigned int magic;
+  unsigned int version;
+  unsigned int num_nodes;
+  unsigned int num_succs;
+};
+
+struct BettingTreeFileNode {
+  int id;
+  unsigned short last_bet_to;
+  unsigned short num_succs;
+  unsigned short flags;
+  unsigned char player_acting;
+  unsigned char num_remaining;
+};
+
+static const unsigned int kBettingTreeFileMagic = 0x5442425a;
+static const unsigned int kBettingTreeFileVersion = 1;
+
 bool TwoSuccsCorrespond(Node *node1, int s1, Node *node2, int s2);
 std::unique_ptr<int []> GetSuccMapping(Node *acting_node, Node *opp_node);
 
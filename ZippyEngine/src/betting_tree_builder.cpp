@@ -1,8 +1,10 @@
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "betting_abstraction.h"
@@ -13,10 +15,155 @@
 #include "io.h"
 
 using std::shared_ptr;
+using std::unique_ptr;
 using std::unordered_map;
+using std::unordered_set;
 using std::vector;
 
-void BettingTreeBuilder::Build(void) {
+class StreetTaskThread {
+public:
+  StreetTaskThread(const BettingAbstraction &ba, bool asymmetric, int target_player,
+		   vector< unique_ptr<StreetTask> > *tasks, int *next_task,
+		   pthread_mutex_t *mutex);
+  void Go(void);
+  void Run(void);
+  void Join(void);
+private:
+  const BettingAbstraction &betting_abstraction_;
+  bool asymmetric_;
+  int target_player_;
+  vector< unique_ptr<StreetTask> > *tasks_;
+  int *next_task_;
+  pthread_mutex_t *mutex_;
+  pthread_t pthread_id_;
+};
+
+StreetTaskThread::StreetTaskThread(const BettingAbstraction &ba, bool asymmetric,
+				   int target_player, vector< unique_ptr<StreetTask> > *tasks,
+				   int *next_task, pthread_mutex_t *mutex) :
+  betting_abstraction_(ba), asymmetric_(asymmetric), target_player_(target_player),
+  tasks_(tasks), next_task_(next_task), mutex_(mutex) {
+}
+
+// Each task gets a builder of its own, and hence a reentrant node map of its own.
+void StreetTaskThread::Go(void) {
+  int num_tasks = tasks_->size();
+  while (true) {
+    pthread_mutex_lock(mutex_);
+    int t = (*next_task_)++;
+    pthread_mutex_unlock(mutex_);
+    if (t >= num_tasks) break;
+    unique_ptr<BettingTreeBuilder> builder;
+    if (asymmetric_) {
+      builder.reset(new BettingTreeBuilder(betting_abstraction_, target_player_));
+    } else {
+      builder.reset(new BettingTreeBuilder(betting_abstraction_));
+    }
+    builder->BuildStreetTask((*tasks_)[t].get());
+  }
+}
+
+static void *thread_run(void *v_t) {
+  StreetTaskThread *t = (StreetTaskThread *)v_t;
+  t->Go();
+  return NULL;
+}
+
+void StreetTaskThread::Run(void) {
+  pthread_create(&pthread_id_, NULL, thread_run, this);
+}
+
+void StreetTaskThread::Join(void) {
+  pthread_join(pthread_id_, NULL);
+}
+
+// History IDs are local to a builder.  The task's builder has a history map of its own in which
+// the history leading to the task is the empty history; every history within the task extends
+// that one, so the reentrant keys still tell histories apart.
+void BettingTreeBuilder::BuildStreetTask(StreetTask *task) {
+  int terminal_id = 0;
+  unsigned long long int key = 0;
+  task->root = CreateMPStreet(task->street, task->bet_to, task->num_bets, task->folded.get(),
+			      task->target_player, &key, &terminal_id);
+}
+
+// Nodes in different street subtrees can only be merged if the street or a later street is
+// reentrant and the action before the street is not fully captured in the reentrant key.
+bool BettingTreeBuilder::CanBuildStreetsInParallel(int st) const {
+  int max_street = Game::MaxStreet();
+  if (st > max_street) return false;
+  bool reentrant = false;
+  for (int st1 = st; st1 <= max_street; ++st1) {
+    if (betting_abstraction_.ReentrantStreet(st1)) reentrant = true;
+  }
+  if (! reentrant) return true;
+  for (int st1 = initial_street_; st1 < st; ++st1) {
+    if (! betting_abstraction_.BettingKey(st1)) return false;
+  }
+  return true;
+}
+
+// Replace the placeholders in the tree with the subtrees built for them.
+static void Graft(Node *node, const unordered_map<Node *, shared_ptr<Node> > &subtrees,
+		  unordered_set<Node *> *seen) {
+  if (node->Terminal()) return;
+  if (! seen->insert(node).second) return;
+  int num_succs = node->NumSuccs();
+  for (int s = 0; s < num_succs; ++s) {
+    Node *succ = node->IthSucc(s);
+    auto it = subtrees.find(succ);
+    if (it != subtrees.end()) {
+      node->SetIthSucc(s, it->second);
+    } else {
+      Graft(succ, subtrees, seen);
+    }
+  }
+}
+
+// Terminal IDs are assigned in the order that the terminals are created in a serial build,
+// which is the order of a depth-first traversal that visits reentrant nodes once.
+static void AssignTerminalIDs(Node *node, unordered_set<Node *> *seen, int *terminal_id) {
+  if (node->Terminal()) {
+    node->SetTerminalID((*terminal_id)++);
+    return;
+  }
+  if (! seen->insert(node).second) return;
+  int num_succs = node->NumSuccs();
+  for (int s = 0; s < num_succs; ++s) {
+    AssignTerminalIDs(node->IthSucc(s), seen, terminal_id);
+  }
+}
+
+void BettingTreeBuilder::BuildStreetsInParallel(int num_threads) {
+  int next_task = 0;
+  pthread_mutex_t mutex;
+  pthread_mutex_init(&mutex, NULL);
+  unique_ptr<unique_ptr<StreetTaskThread> []>
+    threads(new unique_ptr<StreetTaskThread>[num_threads]);
+  for (int t = 0; t < num_threads; ++t) {
+    threads[t].reset(new StreetTaskThread(betting_abstraction_, asymmetric_, target_player_,
+					  &tasks_, &next_task, &mutex));
+  }
+  for (int t = 1; t < num_threads; ++t) {
+    threads[t]->Run();
+  }
+  // Execute thread 0 in main execution thread
+  threads[0]->Go();
+  for (int t = 1; t < num_threads; ++t) {
+    threads[t]->Join();
+  }
+  pthread_mutex_destroy(&mutex);
+
+  unordered_map<Node *, shared_ptr<Node> > subtrees;
+  for (size_t i = 0; i < tasks_.size(); ++i) {
+    subtrees[tasks_[i]->placeholder.get()] = tasks_[i]->root;
+  }
+  unordered_set<Node *> seen;
+  Graft(root_.get(), subtrees, &seen);
+  tasks_.clear();
+}
+
+void BettingTreeBuilder::Build(int num_threads) {
   int terminal_id = 0;
 
 #if 0
@@ -34,40 +181,58 @@ void BettingTreeBuilder::Build(void) {
   // Used to do this for 2-person games
   // root_ = CreateNoLimitTree1(target_player_, &terminal_id);
   // Used to do this only for games with 3 or more players
-  root_ = CreateMPTree(target_player_, &terminal_id);
+  int parallel_street = initial_street_ + 1;
+  if (num_threads > 1 && CanBuildStreetsInParallel(parallel_street)) {
+    parallel_street_ = parallel_street;
+    root_ = CreateMPTree(target_player_, &terminal_id);
+    parallel_street_ = -1;
+    BuildStreetsInParallel(num_threads);
+    // Each subtree numbered its terminals from zero
+    terminal_id = 0;
+    unordered_set<Node *> seen;
+    AssignTerminalIDs(root_.get(), &seen, &terminal_id);
+  } else {
+    root_ = CreateMPTree(target_player_, &terminal_id);
+  }
   num_terminals_ = terminal_id;
 }
 
-// To handle reentrant trees we keep a boolean array of nodes that have
-// already been visited.  Note that even if a node has already been visited,
-// we still write out the properties of the node (ID, flags, pot size, etc.).
-// But we prevent ourselves from redundantly writing out the subtree below
-// the node more than once.
-void BettingTreeBuilder::Write(Node *node, vector< vector<int> > *num_nonterminals,
-			       Writer *writer) {
+// Lays out the tree in the flat file format (see betting_tree.h), assigning nonterminal IDs as
+// we go.  A reentrant node gets one record, the first time we reach it; later parents refer to
+// it by index.  Returns the index of the node's record.
+unsigned int BettingTreeBuilder::Flatten(Node *node, vector< vector<int> > *num_nonterminals,
+					 unordered_map<Node *, unsigned int> *indices,
+					 vector<BettingTreeFileNode> *records,
+					 vector<unsigned int> *succs) {
+  int num_succs = node->NumSuccs();
+  if (num_succs > 0) {
+    auto it = indices->find(node);
+    if (it != indices->end()) return it->second;
+  }
   int st = node->Street();
-  int id = node->ID();
   int pa = node->PlayerActing();
-  bool nt_first_seen = (id == -1);
   // Assign IDs during writing
-  if (nt_first_seen) {
-    id = (*num_nonterminals)[pa][st]++;
-    node->SetNonterminalID(id);
-  }
-  writer->WriteUnsignedInt(id);
-  writer->WriteUnsignedShort(node->LastBetTo());
-  writer->WriteUnsignedShort(node->NumSuccs());
-  writer->WriteUnsignedShort(node->Flags());
-  writer->WriteUnsignedChar(pa);
-  writer->WriteUnsignedChar(node->NumRemaining());
-  if (node->Terminal()) {
-    return;
+  if (num_succs > 0 && node->ID() == -1) {
+    node->SetNonterminalID((*num_nonterminals)[pa][st]++);
   }
-  if (! nt_first_seen) return;
-  int num_succs = node->NumSuccs();
+  unsigned int index = records->size();
+  if (num_succs > 0) (*indices)[node] = index;
+  BettingTreeFileNode r;
+  r.id = node->ID();
+  r.last_bet_to = node->LastBetTo();
+  r.num_succs = num_succs;
+  r.flags = node->Flags();
+  r.player_acting = pa;
+  r.num_remaining = node->NumRemaining();
+  records->push_back(r);
+  // Reserve the slots for our succs now so that they precede those of our descendants.
+  unsigned int first_succ = succs->size();
+  succs->resize(first_succ + num_succs);
   for (int s = 0; s < num_succs; ++s) {
-    Write(node->IthSucc(s), num_nonterminals, writer);
+    unsigned int succ_index = Flatten(node->IthSucc(s), num_nonterminals, indices, records, succs);
+    (*succs)[first_succ + s] = succ_index;
   }
+  return index;
 }
 
 void BettingTreeBuilder::Write(void) {
@@ -93,8 +258,30 @@ void BettingTreeBuilder::Write(void) {
     }
   }
   
+  unordered_map<Node *, unsigned int> indices;
+  vector<BettingTreeFileNode> records;
+  vector<unsigned int> succs;
+  Flatten(root_.get(), &num_nonterminals, &indices, &records, &succs);
+
   Writer writer(buf);
-  Write(root_.get(), &num_nonterminals, &writer);
+  writer.WriteUnsignedInt(kBettingTreeFileMagic);
+  writer.WriteUnsignedInt(kBettingTreeFileVersion);
+  writer.WriteUnsignedInt(records.size());
+  writer.WriteUnsignedInt(succs.size());
+  int num_records = records.size();
+  for (int i = 0; i < num_records; ++i) {
+    const BettingTreeFileNode &r = records[i];
+    writer.WriteInt(r.id);
+    writer.WriteUnsignedShort(r.last_bet_to);
+    writer.WriteUnsignedShort(r.num_succs);
+    writer.WriteUnsignedShort(r.flags);
+    writer.WriteUnsignedChar(r.player_acting);
+    writer.WriteUnsignedChar(r.num_remaining);
+  }
+  int num_succs = succs.size();
+  for (int i = 0; i < num_succs; ++i) {
+    writer.WriteUnsignedInt(succs[i]);
+  }
   for (int st = 0; st <= max_street; ++st) {
     int sum = 0;
     for (int pa = 0; pa < num_players; ++pa) {
@@ -113,6 +300,7 @@ void BettingTreeBuilder::Initialize(void) {
 
   root_ = NULL;
   num_terminals_ = 0;
+  parallel_street_ = -1;
 }
 
 BettingTreeBuilder::BettingTreeBuilder(const BettingAbstraction &ba) :
@@ -120,8 +308,6 @@ BettingTreeBuilder::BettingTreeBuilder(const BettingAbstraction &ba) :
   asymmetric_ = false;
   // Parameter should be ignored for symmetric trees.
   target_player_ = -1;
-  node_map_.reset(new unordered_map< unsigned long long int, shared_ptr<Node> >);
-    
   Initialize();
 }
 
@@ -8,13 +8,88 @@
 
 class BettingAbstraction;
 class Node;
-class Writer;
+struct BettingTreeFileNode;
+
+// Identifies nodes that can be merged in reentrant trees.  history is the HistoryMap ID of
+// the actions leading to the node on streets for which BettingKey() is true.
+struct ReentrantKey {
+  unsigned long long int history;
+  int st;
+  int player_acting;
+  int num_street_bets;
+  int bet_to;
+  int last_bet_size;
+  int num_remaining;
+  int num_players_to_act;
+  // So the struct has no padding and can be hashed as raw bytes
+  int unused;
+};
+
+// Open addressing hash table with linear probing
+class ReentrantNodeMap {
+public:
+  ReentrantNodeMap(void);
+  bool Find(const ReentrantKey &key, std::shared_ptr<Node> *node) const;
+  void Insert(const ReentrantKey &key, const std::shared_ptr<Node> &node);
+private:
+  static unsigned long long int Hash(const ReentrantKey &key);
+  void Grow(void);
+
+  // Always a power of two
+  int capacity_;
+  int size_;
+  std::vector<ReentrantKey> keys_;
+  // Empty slots have null nodes
+  std::vector< std::shared_ptr<Node> > nodes_;
+};
+
+// Assigns a distinct ID to every action history.  The empty history is zero.  A history is
+// stored as the ID of its prefix plus its last action, and lookups compare all three, so two
+// different histories never get the same ID.  Open addressing with linear probing, like
+// ReentrantNodeMap.
+class HistoryMap {
+public:
+  HistoryMap(void);
+  unsigned long long int Extend(unsigned long long int history, char action, int bet_size);
+private:
+  struct Entry {
+    unsigned long long int prefix;
+    int action;
+    int bet_size;
+  };
+
+  static unsigned long long int Hash(const Entry &e);
+  void Insert(const Entry &e, unsigned long long int id);
+  void Grow(void);
+
+  // Always a power of two
+  int capacity_;
+  int size_;
+  std::vector<Entry> entries_;
+  // Empty slots have ID zero
+  std::vector<unsigned long long int> ids_;
+};
+
+// A deferred call to CreateMPStreet(), for building street subtrees in parallel
+struct StreetTask {
+  int street;
+  int bet_to;
+  int num_bets;
+  std::unique_ptr<bool []> folded;
+  int target_player;
+  // Stands in for the subtree until it is built
+  std::shared_ptr<Node> placeholder;
+  std::shared_ptr<Node> root;
+};
 
 class BettingTreeBuilder {
 public:
   BettingTreeBuilder(const BettingAbstraction &ba);
   BettingTreeBuilder(const BettingAbstraction &ba, int target_player);
-  void Build(void);
+  // With multiple threads, the subtrees below the street-initial nodes of the street after the
+  // initial street are built in parallel when that cannot change the result; i.e., when nodes
+  // in different subtrees can never be merged.
+  void Build(int num_threads);
   void Write(void);
   // std::shared_ptr<Node> CreateLimitTree(int *terminal_id);
   std::shared_ptr<Node>
@@ -28,37 +103,40 @@ public:
 				    int bet_to, int num_street_bets,
 				    int num_bets, int player_acting,
 				    int num_players_to_act, bool *folded,
-				    int target_player, std::string *key,
+				    int target_player, unsigned long long int *key,
 				    int *terminal_id);
   std::shared_ptr<Node> CreateMPCallSucc(int street, int last_bet_size,
 				    int bet_to, int num_street_bets,
 				    int num_bets, int player_acting,
 				    int num_players_to_act, bool *folded,
-				    int target_player, std::string *key,
+				    int target_player, unsigned long long int *key,
 				    int *terminal_id);
   void MPHandleBet(int street, int last_bet_size, int last_bet_to,
 		   int new_bet_to, int num_street_bets, int num_bets,
 		   int player_acting, int num_players_to_act, bool *folded,
-		   int target_player, std::string *key, int *terminal_id,
+		   int target_player, unsigned long long int *key, int *terminal_id,
 		   std::vector< std::shared_ptr<Node> > *bet_succs);
   void CreateMPSuccs(int street, int last_bet_size, int bet_to,
 		     int num_street_bets, int num_bets,
 		     int player_acting, int num_players_to_act, bool *folded,
-		     int target_player, std::string *key, int *terminal_id,
+		     int target_player, unsigned long long int *key, int *terminal_id,
 		     std::shared_ptr<Node> *call_succ, std::shared_ptr<Node> *fold_succ,
 		     std::vector< std::shared_ptr<Node> > *bet_succs);
   std::shared_ptr<Node> CreateMPSubtree(int st, int last_bet_size, int bet_to, int num_street_bets,
 					int num_bets, int player_acting, int num_players_to_act,
-					bool *folded, int target_player, std::string *key,
+					bool *folded, int target_player, unsigned long long int *key,
 					int *terminal_id);
   std::shared_ptr<Node> CreateMPStreet(int street, int bet_to, int num_bets,
-				  bool *folded, int target_player, std::string *key,
+				  bool *folded, int target_player, unsigned long long int *key,
 				  int *terminal_id);
   std::shared_ptr<Node> CreateMPTree(int target_player, int *terminal_id);
+  void BuildStreetTask(StreetTask *task);
   
 private:
-  bool FindReentrantNode(const std::string &key, std::shared_ptr<Node> *node);
-  void AddReentrantNode(const std::string &key, std::shared_ptr<Node> node);
+  bool FindReentrantNode(const ReentrantKey &key, std::shared_ptr<Node> *node);
+  void AddReentrantNode(const ReentrantKey &key, std::shared_ptr<Node> node);
+  bool CanBuildStreetsInParallel(int st) const;
+  void BuildStreetsInParallel(int num_threads);
   int NearestAllowableBetTo(int old_pot_size, int new_bet_to, int last_bet_size);
   void GetNewBetTos(int old_bet_to, int last_bet_size, const std::vector<double> &pot_fracs,
 		    int player_acting, int target_player, bool *bet_to_seen);
@@ -85,7 +163,9 @@ private:
   void GetNewPotSizes(int old_pot_size, const std::vector<int> &bet_amounts, int player_acting,
 		      int target_player, std::vector<int> *new_pot_sizes);
   void Initialize(void);
-  void Write(Node *node, std::vector< std::vector<int> > *num_nonterminals, Writer *writer);
+  unsigned int Flatten(Node *node, std::vector< std::vector<int> > *num_nonterminals,
+		       std::unordered_map<Node *, unsigned int> *indices,
+		       std::vector<BettingTreeFileNode> *records, std::vector<unsigned int> *succs);
 
   const BettingAbstraction &betting_abstraction_;
   bool asymmetric_;
@@ -98,8 +178,12 @@ private:
   std::shared_ptr<Node> root_;
   int num_terminals_;
   // For reentrant trees
-  std::unique_ptr< std::unordered_map< unsigned long long int, std::shared_ptr<Node> > >
-    node_map_;
+  ReentrantNodeMap node_map_;
+  HistoryMap history_map_;
+  // When building in parallel, CreateMPStreet() defers the subtrees for this street to tasks_.
+  // -1 otherwise.
+  int parallel_street_;
+  std::vector< std::unique_ptr<StreetTask> > tasks_;
 };
 
 #endif
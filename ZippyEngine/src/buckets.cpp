@@ -1,5 +1,14 @@
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
 
 #include "board_tree.h"
 #include "buckets.h"
@@ -8,34 +17,77 @@
 #include "game.h"
 #include "io.h"
 
+using std::string;
+using std::vector;
+
 /*
   Load buckets from file for a given CardAbstraction
   Load num_buckets per street always from
     static/num_buckets.{game_name}.{num_ranks}.{num_suits}.{max_street}.{ca_bucketing(street)}.{street}
   Load buckets only if numb_only is false from
     static/buckets.{game_name}.{num_ranks}.{num_suits}.{max_street}.{ca_bucketing(street)}.{street}
+  If static/buckets....{street}.packed exists and is up to date, it is mapped instead.
   --Jon*/
+
+int PackedBucketBits(int num_buckets) {
+  int bits = 1;
+  while ((1LL << bits) < num_buckets) ++bits;
+  return bits;
+}
+
+long long int PackedBucketsFileSize(unsigned long long int num_hands, int bits) {
+  unsigned long long int num_words = (num_hands * bits + 63) / 64;
+  return kPackedBucketsHeaderSize + (long long int)(num_words + 1) * 8;
+}
+
+void RemovePackedBuckets(const char *filename) {
+  char packed_buf[510];
+  sprintf(packed_buf, "%s.packed", filename);
+  if (unlink(packed_buf) != 0 && errno != ENOENT) {
+    fprintf(stderr, "Couldn't remove %s; errno %i\n", packed_buf, errno);
+    exit(-1);
+  }
+}
+
 Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
+  Initialize(ca.Bucketings(), numb_only);
+}
+
+// Loads the buckets of street st only; the other streets are treated as unbucketed.
+Buckets::Buckets(int st, const string &bucketing) {
+  vector<string> bucketings(Game::MaxStreet() + 1, "none");
+  bucketings[st] = bucketing;
+  Initialize(bucketings, false);
+}
+
+void Buckets::Initialize(const vector<string> &bucketings, bool numb_only) {
   BoardTree::Create();
   int max_street = Game::MaxStreet();
   none_.reset(new bool[max_street + 1]);
   short_buckets_ = new unsigned short *[max_street + 1];
   int_buckets_ = new int *[max_street + 1];
+  packed_ = new const unsigned char *[max_street + 1];
+  bits_.reset(new int[max_street + 1]);
+  masks_.reset(new unsigned long long int[max_street + 1]);
+  mapped_.reset(new void *[max_street + 1]);
+  mapped_sizes_.reset(new long long int[max_street + 1]);
   for (int st = 0; st <= max_street; ++st) {
     short_buckets_[st] = nullptr;
     int_buckets_[st] = nullptr;
+    packed_[st] = nullptr;
+    mapped_[st] = nullptr;
   }
   char buf[500];
   num_buckets_.reset(new int[max_street + 1]);
   for (int st = 0; st <= max_street; ++st) {
-    if (ca.Bucketing(st) == "none") {
+    if (bucketings[st] == "none") {
       none_[st] = true;
       num_buckets_[st] = 0;
       continue;
     }
     none_[st] = false;
     sprintf(buf, "%s/num_buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
-	    Game::NumRanks(), Game::NumSuits(), max_street, ca.Bucketing(st).c_str(), st);
+	    Game::NumRanks(), Game::NumSuits(), max_street, bucketings[st].c_str(), st);
     Reader reader(buf);
     num_buckets_[st] = reader.ReadIntOrDie();
   }
@@ -50,7 +102,10 @@ Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
       long long int lli_num_hands = num_hands;
 
       sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
-	      Game::NumRanks(), Game::NumSuits(), max_street, ca.Bucketing(st).c_str(), st);
+	      Game::NumRanks(), Game::NumSuits(), max_street, bucketings[st].c_str(), st);
+      char packed_buf[510];
+      sprintf(packed_buf, "%s.packed", buf);
+      if (FileExists(packed_buf) && MapPacked(st, packed_buf, buf, num_hands)) continue;
       Reader reader(buf);
       long long int file_size = reader.FileSize();
       if (file_size == lli_num_hands * 2) {
@@ -71,10 +126,92 @@ Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
   }
 }
 
+// Returns false, leaving nothing mapped, if unpacked_filename exists and has changed since the
+// packed file was built from it.  If there is no unpacked file, the packed file is all we have.
+bool Buckets::MapPacked(int st, const char *filename, const char *unpacked_filename,
+			unsigned int num_hands) {
+  int fd = open(filename, O_RDONLY, 0);
+  if (fd == -1) {
+    fprintf(stderr, "Failed to open %s\n", filename);
+    exit(-1);
+  }
+  struct stat stbuf;
+  if (fstat(fd, &stbuf) == -1) {
+    fprintf(stderr, "Couldn't stat %s\n", filename);
+    exit(-1);
+  }
+  if (stbuf.st_size < kPackedBucketsHeaderSize) {
+    fprintf(stderr, "%s is too small to be a packed bucket file\n", filename);
+    exit(-1);
+  }
+  mapped_sizes_[st] = stbuf.st_size;
+  mapped_[st] = mmap(NULL, mapped_sizes_[st], PROT_READ, MAP_SHARED, fd, 0);
+  if (mapped_[st] == MAP_FAILED) {
+    fprintf(stderr, "Failed to mmap %s\n", filename);
+    exit(-1);
+  }
+  close(fd);
+  const unsigned char *p = (const unsigned char *)mapped_[st];
+  unsigned int magic;
+  int version, bits;
+  unsigned long long int file_num_hands;
+  long long int unpacked_size, unpacked_mtime;
+  memcpy(&magic, p, 4);
+  memcpy(&version, p + 4, 4);
+  memcpy(&bits, p + 8, 4);
+  memcpy(&file_num_hands, p + 16, 8);
+  memcpy(&unpacked_size, p + 24, 8);
+  memcpy(&unpacked_mtime, p + 32, 8);
+  if (magic != kPackedBucketsMagic || version != kPackedBucketsVersion) {
+    fprintf(stderr, "%s is not a packed bucket file (or has the wrong version)\n", filename);
+    exit(-1);
+  }
+  if (file_num_hands != num_hands || bits != PackedBucketBits(num_buckets_[st]) ||
+      stbuf.st_size != PackedBucketsFileSize(num_hands, bits)) {
+    fprintf(stderr, "%s doesn't match the current game and bucketing\n", filename);
+    exit(-1);
+  }
+  struct stat unpacked_stbuf;
+  if (stat(unpacked_filename, &unpacked_stbuf) == 0 &&
+      (unpacked_stbuf.st_size != unpacked_size || unpacked_stbuf.st_mtime != unpacked_mtime)) {
+    fprintf(stderr, "%s is out of date; reading %s instead\n", filename, unpacked_filename);
+    munmap(mapped_[st], mapped_sizes_[st]);
+    mapped_[st] = nullptr;
+    return false;
+  }
+  packed_[st] = p + kPackedBucketsHeaderSize;
+  bits_[st] = bits;
+  masks_[st] = (1ULL << bits) - 1;
+  return true;
+}
+
+// Walks the bitstream rather than recomputing each bucket's offset.  VCFR looks up the buckets
+// of a whole board at a time, and those are contiguous.
+void Buckets::Bucket(int st, unsigned int h0, int num, int *buckets) const {
+  if (packed_[st]) {
+    const unsigned char *packed = packed_[st];
+    int bits = bits_[st];
+    unsigned long long int mask = masks_[st];
+    unsigned long long int bit = ((unsigned long long int)h0) * bits;
+    for (int i = 0; i < num; ++i) {
+      unsigned long long int w;
+      memcpy(&w, packed + (bit >> 3), 8);
+      buckets[i] = (int)((w >> (bit & 7)) & mask);
+      bit += bits;
+    }
+  } else if (short_buckets_[st]) {
+    const unsigned short *short_buckets = short_buckets_[st] + h0;
+    for (int i = 0; i < num; ++i) buckets[i] = short_buckets[i];
+  } else {
+    memcpy(buckets, int_buckets_[st] + h0, num * sizeof(int));
+  }
+}
+
 // Allow a dummy empty buckets object to be created
 Buckets::Buckets(void) {
   short_buckets_ = nullptr;
   int_buckets_ = nullptr;
+  packed_ = nullptr;
 }
 
 // Destructor to free memory
@@ -92,4 +229,10 @@ Buckets::~Buckets(void) {
     }
     delete [] int_buckets_;
   }
+  if (packed_) {
+    for (int st = 0; st <= max_street; ++st) {
+      if (mapped_[st]) munmap(mapped_[st], mapped_sizes_[st]);
+    }
+    delete [] packed_;
+  }
 }
@@ -1,10 +1,33 @@
 #ifndef _BUCKETS_H_
 #define _BUCKETS_H_
 
+#include <string.h>
+
 #include <memory>
+#include <string>
+#include <vector>
 
 class CardAbstraction;
 
+// Bit-packed bucket files.  For a bucket file F, F.packed holds the same buckets using only
+// PackedBucketBits(num_buckets) bits per hand.  It has a header of kPackedBucketsHeaderSize
+// bytes:
+//   magic, version, bits per hand (four bytes each), four bytes of padding, number of hands,
+//   size of F, modification time of F in seconds (eight bytes each)
+// followed by the buckets as a little-endian bitstream in 64-bit words, and then one extra
+// zero word so that any bucket can be decoded with a single unaligned eight-byte load.  Built
+// from F by pack_buckets.  The bucket builders remove F.packed when they write F, and a
+// F.packed whose recorded size or modification time doesn't match F is ignored.
+static const unsigned int kPackedBucketsMagic = 0x4b504b42;
+static const int kPackedBucketsVersion = 2;
+static const int kPackedBucketsHeaderSize = 40;
+
+int PackedBucketBits(int num_buckets);
+long long int PackedBucketsFileSize(unsigned long long int num_hands, int bits);
+// Removes the packed copy of bucket file filename, if there is one.  Called by anything that
+// writes a bucket file, before writing it.
+void RemovePackedBuckets(const char *filename);
+
 /*
   Class for holding card buckets per street.
     NumBuckets
@@ -13,28 +36,49 @@ class CardAbstraction;
       Return bucket for hand per street
     None
       Return true if street is not bucketed, else false
+
+  If an up-to-date packed bucket file exists for a street, it is mapped rather than read, so
+  that all processes using the same buckets share one copy through the page cache.
   */
 class Buckets {
 public:
   Buckets(const CardAbstraction &ca, bool numb_only);
+  Buckets(int st, const std::string &bucketing);
   Buckets(void);
   ~Buckets(void);
   bool None(int st) const {return none_[st];}
   // Use an unsigned int for hands.  For full holdem, the number of hands exceeds kMaxInt.
   int Bucket(int st, unsigned int h) const {
-    if (short_buckets_[st]) {
+    if (packed_[st]) {
+      unsigned long long int bit = ((unsigned long long int)h) * bits_[st];
+      unsigned long long int w;
+      memcpy(&w, packed_[st] + (bit >> 3), 8);
+      return (int)((w >> (bit & 7)) & masks_[st]);
+    } else if (short_buckets_[st]) {
       return (int)short_buckets_[st][h];
     } else {
       return int_buckets_[st][h];
     }
   }
+  // Writes the buckets of hands h0 ... h0 + num - 1 to buckets
+  void Bucket(int st, unsigned int h0, int num, int *buckets) const;
   const int *NumBuckets(void) const {return num_buckets_.get();}
   int NumBuckets(int st) const {return num_buckets_[st];}
 private:
+  void Initialize(const std::vector<std::string> &bucketings, bool numb_only);
+  bool MapPacked(int st, const char *filename, const char *unpacked_filename,
+		 unsigned int num_hands);
+
   std::unique_ptr<bool []> none_;
   // Should make these unique pointers, no?
   unsigned short **short_buckets_;
   int **int_buckets_;
+  // For streets with a packed bucket file; nullptr otherwise
+  const unsigned char **packed_;
+  std::unique_ptr<int []> bits_;
+  std::unique_ptr<unsigned long long int []> masks_;
+  std::unique_ptr<void *[]> mapped_;
+  std::unique_ptr<long long int []> mapped_sizes_;
   std::unique_ptr<int []> num_buckets_;
 };
 
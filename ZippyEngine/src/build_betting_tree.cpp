@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <memory>
 #include <string>
@@ -17,13 +18,13 @@ using std::string;
 using std::unique_ptr;
 
 static void Usage(const char *prog_name) {
-  fprintf(stderr, "USAGE: %s <game params> <betting params> ([p0|p1])\n",
+  fprintf(stderr, "USAGE: %s <game params> <betting params> ([p0|p1]) (<num threads>)\n",
 	  prog_name);
   exit(-1);
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 3 && argc != 4) Usage(argv[0]);
+  if (argc < 3 || argc > 5) Usage(argv[0]);
   Files::Init();
   unique_ptr<Params> game_params = CreateGameParams();
   game_params->ReadFromFile(argv[1]);
@@ -32,17 +33,25 @@ int main(int argc, char *argv[]) {
   betting_params->ReadFromFile(argv[2]);
   unique_ptr<BettingAbstraction> ba(new BettingAbstraction(*betting_params));
 
+  // Optional arguments are a player (for asymmetric abstractions) and a number of threads
+  int p = -1;
+  int num_threads = 1;
+  for (int a = 3; a < argc; ++a) {
+    string arg = argv[a];
+    if (arg == "p0") {
+      p = 0;
+    } else if (arg == "p1") {
+      p = 1;
+    } else if (sscanf(argv[a], "%i", &num_threads) != 1 || num_threads < 1) {
+      Usage(argv[0]);
+    }
+  }
   BettingTreeBuilder *builder = NULL;
-  if (argc == 4) {
+  if (p >= 0) {
     if (! ba->Asymmetric()) {
       fprintf(stderr, "With symmetric betting abstractions, no player argument allowed\n");
       exit(-1);
     }
-    int p;
-    string p_arg = argv[3];
-    if (p_arg == "p0")      p = 0;
-    else if (p_arg == "p1") p = 1;
-    else                    Usage(argv[0]);
     builder = new BettingTreeBuilder(*ba, p);
   } else {
     if (ba->Asymmetric()) {
@@ -51,7 +60,12 @@ int main(int argc, char *argv[]) {
     }
     builder = new BettingTreeBuilder(*ba);
   }
-  builder->Build();
+  struct timespec start, finish;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  builder->Build(num_threads);
+  clock_gettime(CLOCK_MONOTONIC, &finish);
+  double secs = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9;
+  fprintf(stderr, "Built tree in %.2f secs\n", secs);
   builder->Write();
   delete builder;
 }
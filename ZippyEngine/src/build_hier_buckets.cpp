@@ -0,0 +1,363 @@
+// Builds imperfect recall buckets for one street by clustering hierarchically.  First the boards
+// of an earlier (or the same) street, the texture street, are clustered into texture groups.
+// Then, for each group, the hands on all the boards of the street that descend from the group's
+// boards are clustered by their features.  Every group gets its own buckets, so hands on boards
+// with different textures never share a bucket.
+//
+// A texture board is described by the mean and standard deviation of each feature over the
+// hands of its descendant boards.  For example, with the flop as the texture street, river
+// hands are clustered separately for each group of flops.
+//
+// The groups are independent, so they are clustered in parallel, one group per thread at a
+// time; each group's objects are small enough to stay in cache far better than the whole
+// street's.  The result is a standard bucket file, the same as written by build_kmeans_buckets.
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "board_tree.h"
+#include "buckets.h" // RemovePackedBuckets()
+#include "constants.h"
+#include "feature_store.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "io.h"
+#include "kmeans.h"
+#include "params.h"
+
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// The boards of street st that descend from board tbd of street tst
+static void BoardRange(int tst, int tbd, int st, int *begin, int *end) {
+  if (tst == st) {
+    *begin = tbd;
+    *end = tbd + 1;
+  } else {
+    *begin = BoardTree::SuccBoardBegin(tst, tbd, st);
+    *end = BoardTree::SuccBoardEnd(tst, tbd, st);
+  }
+}
+
+class TextureThread {
+public:
+  TextureThread(const FeatureFile &file, int tst, int st, float *descriptors, int thread_index,
+		int num_threads);
+  ~TextureThread(void) {}
+  void Go(void);
+  void Run(void);
+  void Join(void);
+private:
+  const FeatureFile &file_;
+  int tst_;
+  int st_;
+  float *descriptors_;
+  int thread_index_;
+  int num_threads_;
+  pthread_t pthread_id_;
+};
+
+TextureThread::TextureThread(const FeatureFile &file, int tst, int st, float *descriptors,
+			     int thread_index, int num_threads) :
+  file_(file), tst_(tst), st_(st), descriptors_(descriptors), thread_index_(thread_index),
+  num_threads_(num_threads) {
+}
+
+void TextureThread::Go(void) {
+  int num_features = file_.NumFeatures();
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st_);
+  unique_ptr<double []> sums(new double[num_features]);
+  unique_ptr<double []> sq_sums(new double[num_features]);
+  int num_texture_boards = BoardTree::NumBoards(tst_);
+  for (int tbd = thread_index_; tbd < num_texture_boards; tbd += num_threads_) {
+    for (int f = 0; f < num_features; ++f) sums[f] = sq_sums[f] = 0;
+    int begin, end;
+    BoardRange(tst_, tbd, st_, &begin, &end);
+    unsigned int hb = ((unsigned int)begin) * num_hole_card_pairs;
+    unsigned int he = ((unsigned int)end) * num_hole_card_pairs;
+    for (unsigned int h = hb; h < he; ++h) {
+      const short *vals = file_.Vals(h);
+      for (int f = 0; f < num_features; ++f) {
+	double v = vals[f];
+	sums[f] += v;
+	sq_sums[f] += v * v;
+      }
+    }
+    float *descriptor = descriptors_ + ((long long int)tbd) * 2 * num_features;
+    double n = he - hb;
+    for (int f = 0; f < num_features; ++f) {
+      double mean = sums[f] / n;
+      double var = sq_sums[f] / n - mean * mean;
+      descriptor[f] = mean;
+      descriptor[num_features + f] = var > 0 ? sqrt(var) : 0;
+    }
+  }
+}
+
+static void *texture_thread_run(void *v_t) {
+  TextureThread *t = (TextureThread *)v_t;
+  t->Go();
+  return NULL;
+}
+
+void TextureThread::Run(void) {
+  pthread_create(&pthread_id_, NULL, texture_thread_run, this);
+}
+
+void TextureThread::Join(void) {
+  pthread_join(pthread_id_, NULL);
+}
+
+// Clusters the hands of one texture group at a time, taking the next group from the queue
+// shared with the other threads.  Each group's buckets are numbered from zero; the caller
+// offsets them afterwards.
+class GroupThread {
+public:
+  GroupThread(const FeatureFile &file, int tst, int st, FeatureEncoding encoding,
+	      const short *mins, const short *maxes, const vector< vector<int> > &group_boards,
+	      const int *order, int *next_group, pthread_mutex_t *mutex, int num_clusters,
+	      double neighbor_thresh, int num_iterations, int *buckets, int *group_num_buckets);
+  ~GroupThread(void) {}
+  void Go(void);
+  void Run(void);
+  void Join(void);
+private:
+  void Cluster(int g);
+
+  const FeatureFile &file_;
+  int tst_;
+  int st_;
+  FeatureEncoding encoding_;
+  const short *mins_;
+  const short *maxes_;
+  const vector< vector<int> > &group_boards_;
+  const int *order_;
+  int *next_group_;
+  pthread_mutex_t *mutex_;
+  int num_clusters_;
+  double neighbor_thresh_;
+  int num_iterations_;
+  int *buckets_;
+  int *group_num_buckets_;
+  pthread_t pthread_id_;
+};
+
+GroupThread::GroupThread(const FeatureFile &file, int tst, int st, FeatureEncoding encoding,
+			 const short *mins, const short *maxes,
+			 const vector< vector<int> > &group_boards, const int *order,
+			 int *next_group, pthread_mutex_t *mutex, int num_clusters,
+			 double neighbor_thresh, int num_iterations, int *buckets,
+			 int *group_num_buckets) :
+  file_(file), tst_(tst), st_(st), encoding_(encoding), mins_(mins), maxes_(maxes),
+  group_boards_(group_boards), order_(order), next_group_(next_group), mutex_(mutex),
+  num_clusters_(num_clusters), neighbor_thresh_(neighbor_thresh),
+  num_iterations_(num_iterations), buckets_(buckets), group_num_buckets_(group_num_buckets) {
+}
+
+void GroupThread::Cluster(int g) {
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st_);
+  const vector<int> &tbds = group_boards_[g];
+  int num_tbds = tbds.size();
+  FeatureStore objects(file_.NumFeatures(), encoding_, nullptr);
+  if (encoding_ == FeatureEncoding::BYTE) objects.SetRanges(mins_, maxes_);
+  // For now buckets_ holds the index of each hand's object
+  for (int i = 0; i < num_tbds; ++i) {
+    int begin, end;
+    BoardRange(tst_, tbds[i], st_, &begin, &end);
+    unsigned int hb = ((unsigned int)begin) * num_hole_card_pairs;
+    unsigned int he = ((unsigned int)end) * num_hole_card_pairs;
+    objects.AddUnique(file_, hb, he, 1, buckets_ + hb);
+  }
+  objects.DoneAdding();
+  // Seeded by group so that the result doesn't depend on which thread clusters which group
+  KMeans kmeans(num_clusters_, &objects, neighbor_thresh_, 1, g);
+  kmeans.Cluster(num_iterations_);
+  for (int i = 0; i < num_tbds; ++i) {
+    int begin, end;
+    BoardRange(tst_, tbds[i], st_, &begin, &end);
+    unsigned int hb = ((unsigned int)begin) * num_hole_card_pairs;
+    unsigned int he = ((unsigned int)end) * num_hole_card_pairs;
+    for (unsigned int h = hb; h < he; ++h) buckets_[h] = kmeans.Assignment(buckets_[h]);
+  }
+  group_num_buckets_[g] = kmeans.NumClusters();
+  fprintf(stderr, "Group %i: %i texture boards, %i objects, %i buckets\n", g, num_tbds,
+	  objects.NumObjects(), group_num_buckets_[g]);
+}
+
+void GroupThread::Go(void) {
+  int num_groups = group_boards_.size();
+  while (true) {
+    pthread_mutex_lock(mutex_);
+    int i = (*next_group_)++;
+    pthread_mutex_unlock(mutex_);
+    if (i >= num_groups) break;
+    Cluster(order_[i]);
+  }
+}
+
+static void *group_thread_run(void *v_t) {
+  GroupThread *t = (GroupThread *)v_t;
+  t->Go();
+  return NULL;
+}
+
+void GroupThread::Run(void) {
+  pthread_create(&pthread_id_, NULL, group_thread_run, this);
+}
+
+void GroupThread::Join(void) {
+  pthread_join(pthread_id_, NULL);
+}
+
+static void Write(int st, const string &bucketing, const int *buckets, int num_buckets) {
+  int max_street = Game::MaxStreet();
+  char buf[500];
+  bool short_buckets = num_buckets <= 65536;
+  sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
+	  Game::NumRanks(), Game::NumSuits(), max_street, bucketing.c_str(), st);
+  RemovePackedBuckets(buf);
+  Writer writer(buf);
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  unsigned int num_hands = ((unsigned int)BoardTree::NumBoards(st)) * num_hole_card_pairs;
+  for (unsigned int h = 0; h < num_hands; ++h) {
+    if (short_buckets) writer.WriteUnsignedShort(buckets[h]);
+    else               writer.WriteInt(buckets[h]);
+  }
+
+  sprintf(buf, "%s/num_buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
+	  Game::NumRanks(), Game::NumSuits(), max_street, bucketing.c_str(), st);
+  Writer writer2(buf);
+  writer2.WriteInt(num_buckets);
+}
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <street> <texture street> <num textures> "
+	  "<num clusters per texture> <bucketing> <features> <neighbor thresh> <num iterations> "
+	  "<num threads> ([float|short|half|byte])\n", prog_name);
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 11 && argc != 12) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  int st, tst, num_textures, num_clusters;
+  if (sscanf(argv[2], "%i", &st) != 1)           Usage(argv[0]);
+  if (sscanf(argv[3], "%i", &tst) != 1)          Usage(argv[0]);
+  if (sscanf(argv[4], "%i", &num_textures) != 1) Usage(argv[0]);
+  if (sscanf(argv[5], "%i", &num_clusters) != 1) Usage(argv[0]);
+  string bucketing = argv[6];
+  string features = argv[7];
+  double neighbor_thresh;
+  if (sscanf(argv[8], "%lf", &neighbor_thresh) != 1) Usage(argv[0]);
+  int num_iterations, num_threads;
+  if (sscanf(argv[9], "%i", &num_iterations) != 1) Usage(argv[0]);
+  if (sscanf(argv[10], "%i", &num_threads) != 1)   Usage(argv[0]);
+  FeatureEncoding encoding = FeatureEncoding::SHORT;
+  if (argc == 12 && ! ParseFeatureEncoding(argv[11], &encoding)) Usage(argv[0]);
+  if (tst < 1 || tst > st || st > Game::MaxStreet()) {
+    fprintf(stderr, "Need 1 <= texture street <= street <= max street\n");
+    exit(-1);
+  }
+
+  BoardTree::Create();
+  FeatureFile file(features, st);
+  int num_features = file.NumFeatures();
+  unsigned int num_hands = file.NumHands();
+  fprintf(stderr, "%u hands, %i features\n", num_hands, num_features);
+
+  int num_texture_boards = BoardTree::NumBoards(tst);
+  unique_ptr<float []> descriptors(new float[((long long int)num_texture_boards) * 2 *
+					    num_features]);
+  vector< unique_ptr<TextureThread> > texture_threads(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    texture_threads[t].reset(new TextureThread(file, tst, st, descriptors.get(), t,
+					       num_threads));
+  }
+  for (int t = 1; t < num_threads; ++t) texture_threads[t]->Run();
+  texture_threads[0]->Go();
+  for (int t = 1; t < num_threads; ++t) texture_threads[t]->Join();
+
+  FeatureStore textures(2 * num_features, FeatureEncoding::FLOAT, nullptr);
+  for (int tbd = 0; tbd < num_texture_boards; ++tbd) {
+    textures.AddFloats(descriptors.get() + ((long long int)tbd) * 2 * num_features);
+  }
+  descriptors.reset();
+  KMeans texture_kmeans(num_textures, &textures, neighbor_thresh, num_threads, 0);
+  texture_kmeans.Cluster(num_iterations);
+  int num_groups = texture_kmeans.NumClusters();
+  fprintf(stderr, "%i texture groups\n", num_groups);
+  vector< vector<int> > group_boards(num_groups);
+  for (int tbd = 0; tbd < num_texture_boards; ++tbd) {
+    group_boards[texture_kmeans.Assignment(tbd)].push_back(tbd);
+  }
+
+  // Biggest groups first, so that no thread is left with a big group at the end
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  vector< pair<long long int, int> > neg_sizes(num_groups);
+  for (int g = 0; g < num_groups; ++g) {
+    long long int num_group_hands = 0;
+    int num_tbds = group_boards[g].size();
+    for (int i = 0; i < num_tbds; ++i) {
+      int begin, end;
+      BoardRange(tst, group_boards[g][i], st, &begin, &end);
+      num_group_hands += ((long long int)(end - begin)) * num_hole_card_pairs;
+    }
+    neg_sizes[g] = std::make_pair(-num_group_hands, g);
+  }
+  std::sort(neg_sizes.begin(), neg_sizes.end());
+  unique_ptr<int []> order(new int[num_groups]);
+  for (int i = 0; i < num_groups; ++i) order[i] = neg_sizes[i].second;
+
+  unique_ptr<short []> mins, maxes;
+  if (encoding == FeatureEncoding::BYTE) {
+    mins.reset(new short[num_features]);
+    maxes.reset(new short[num_features]);
+    file.Ranges(num_threads, mins.get(), maxes.get());
+  }
+  unique_ptr<int []> buckets(new int[num_hands]);
+  unique_ptr<int []> group_num_buckets(new int[num_groups]);
+  int next_group = 0;
+  pthread_mutex_t mutex;
+  pthread_mutex_init(&mutex, NULL);
+  vector< unique_ptr<GroupThread> > group_threads(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    group_threads[t].reset(new GroupThread(file, tst, st, encoding, mins.get(), maxes.get(),
+					   group_boards, order.get(), &next_group, &mutex,
+					   num_clusters, neighbor_thresh, num_iterations,
+					   buckets.get(), group_num_buckets.get()));
+  }
+  for (int t = 1; t < num_threads; ++t) group_threads[t]->Run();
+  group_threads[0]->Go();
+  for (int t = 1; t < num_threads; ++t) group_threads[t]->Join();
+  pthread_mutex_destroy(&mutex);
+
+  // Give each group its own range of buckets
+  int num_buckets = 0;
+  for (int g = 0; g < num_groups; ++g) {
+    int num_tbds = group_boards[g].size();
+    for (int i = 0; i < num_tbds; ++i) {
+      int begin, end;
+      BoardRange(tst, group_boards[g][i], st, &begin, &end);
+      unsigned int hb = ((unsigned int)begin) * num_hole_card_pairs;
+      unsigned int he = ((unsigned int)end) * num_hole_card_pairs;
+      for (unsigned int h = hb; h < he; ++h) buckets[h] += num_buckets;
+    }
+    num_buckets += group_num_buckets[g];
+  }
+  fprintf(stderr, "Num actual buckets: %i\n", num_buckets);
+
+  Write(st, bucketing, buckets.get(), num_buckets);
+}
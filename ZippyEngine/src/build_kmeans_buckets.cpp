@@ -1,11 +1,16 @@
-// Currently we assume all features values are shorts, but we should generalize.
+// Clusters the hands of a street by their features.  Hands with identical feature vectors
+// always get the same bucket, so only the distinct vectors are clustered.
 
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <memory>
+#include <string>
+
 #include "board_tree.h"
+#include "buckets.h" // RemovePackedBuckets()
 #include "constants.h"
-#include "fast_hash.h"
+#include "feature_store.h"
 #include "files.h"
 #include "game.h"
 #include "game_params.h"
@@ -13,7 +18,6 @@
 #include "kmeans.h"
 #include "params.h"
 #include "rand.h"
-#include "sparse_and_dense.h"
 
 using namespace std;
 
@@ -23,6 +27,7 @@ static void Write(int st, const string &bucketing, KMeans *kmeans, int *indices,
   bool short_buckets = num_buckets <= 65536;
   sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
 	  Game::NumRanks(), Game::NumSuits(), max_street, bucketing.c_str(), st);
+  RemovePackedBuckets(buf);
   Writer writer(buf);
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   unsigned int num_hands = ((unsigned int)BoardTree::NumBoards(st)) * num_hole_card_pairs;
@@ -48,12 +53,15 @@ static void Write(int st, const string &bucketing, KMeans *kmeans, int *indices,
 
 static void Usage(const char *prog_name) {
   fprintf(stderr, "USAGE: %s <game params> <street> <num clusters> <bucketing> <features> "
-	  "<neighbor thresh> <num iterations> <num threads>\n", prog_name);
+	  "<neighbor thresh> <num iterations> <num threads> ([float|short|half|byte]) "
+	  "(<backing file>)\n", prog_name);
+  fprintf(stderr, "\nThe distinct feature vectors are held as shorts by default.  With a backing "
+	  "file, they are\nkept in that file rather than in anonymous memory.\n");
   exit(-1);
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 9) Usage(argv[0]);
+  if (argc < 9 || argc > 11) Usage(argv[0]);
   Files::Init();
   unique_ptr<Params> game_params = CreateGameParams();
   game_params->ReadFromFile(argv[1]);
@@ -69,6 +77,9 @@ int main(int argc, char *argv[]) {
   int num_iterations, num_threads;
   if (sscanf(argv[7], "%i", &num_iterations) != 1)  Usage(argv[0]);
   if (sscanf(argv[8], "%i", &num_threads) != 1)     Usage(argv[0]);
+  FeatureEncoding encoding = FeatureEncoding::SHORT;
+  if (argc >= 10 && ! ParseFeatureEncoding(argv[9], &encoding)) Usage(argv[0]);
+  const char *backing_filename = argc == 11 ? argv[10] : nullptr;
 
   // Make clustering deterministic
   SeedRand(0);
@@ -78,78 +89,21 @@ int main(int argc, char *argv[]) {
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   unsigned int num_hands = ((unsigned int)BoardTree::NumBoards(st)) * num_hole_card_pairs;
   fprintf(stderr, "%u hands\n", num_hands);
-  int *indices = new int[num_hands];
+  unique_ptr<int []> indices(new int[num_hands]);
 
-  char buf[500];
-  sprintf(buf, "%s/features.%s.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
-	  Game::NumRanks(), features.c_str(), st);
-  Reader reader(buf);
-  int num_features = reader.ReadIntOrDie();
+  FeatureFile file(features, st);
+  int num_features = file.NumFeatures();
   fprintf(stderr, "%u features\n", num_features);
-  short *feature_vals = new short[num_features];
-  SparseAndDenseLong *sad = new SparseAndDenseLong;
-  uint64_t hash_seed = 0;
-  vector<short *> *unique_objects = new vector<short *>;
-  for (unsigned int h = 0; h < num_hands; ++h) {
-    if (h % 10000000 == 0) {
-      fprintf(stderr, "h %u\n", h);
-    }
-    for (int f = 0; f < num_features; ++f) {
-      feature_vals[f] = reader.ReadShortOrDie();
-    }
-    unsigned long long int hash = fasthash64((void *)feature_vals, num_features * sizeof(short),
-					     hash_seed);
-    int old_num = sad->Num();
-    int index = sad->SparseToDense(hash);
-    indices[h] = index;
-    int new_num = sad->Num();
-    if (new_num > old_num && new_num % 1000000 == 0) {
-      fprintf(stderr, "%i unique feature combos so far\n", new_num);
-    }
-    if (new_num > old_num) {
-      // Previously unseen feature value vector
-      short *copy = new short[num_features];
-      for (int f = 0; f < num_features; ++f) {
-	copy[f] = feature_vals[f];
-      }
-      unique_objects->push_back(copy);
-    }
-    if (sad->Num() != (int)unique_objects->size()) {
-      fprintf(stderr, "Size mismatch: %i vs. %i\n", sad->Num(), (int)unique_objects->size());
-      exit(-1);
-    }
-  }
-  delete [] feature_vals;
-
-  int num_unique = sad->Num();
-  if (num_unique != (int)unique_objects->size()) {
-    fprintf(stderr, "Final size mismatch: %i vs. %i\n", num_unique, (int)unique_objects->size());
-    exit(-1);
-  }
+  FeatureStore objects(num_features, encoding, backing_filename);
+  objects.AddUnique(file, 0, num_hands, num_threads, indices.get());
+  objects.DoneAdding();
+  int num_unique = objects.NumObjects();
   fprintf(stderr, "%i unique objects\n", num_unique);
-  delete sad;
 
-  float **objects = new float *[num_unique];
-  for (int i = 0; i < num_unique; ++i) {
-    objects[i] = new float[num_features];
-    for (int f = 0; f < num_features; ++f) {
-      objects[i][f] = (*unique_objects)[i][f];
-    }
-    delete [] (*unique_objects)[i];
-  }
-  delete unique_objects;
-
-  KMeans kmeans(num_clusters, num_features, num_unique, objects, neighbor_thresh, num_threads);
+  KMeans kmeans(num_clusters, &objects, neighbor_thresh, num_threads, -1);
   kmeans.Cluster(num_iterations);
   int num_actual = kmeans.NumClusters();
   fprintf(stderr, "Num actual buckets: %i\n", num_actual);
 
-  for (int i = 0; i < num_unique; ++i) {
-    delete [] objects[i];
-  }
-  delete [] objects;
-
-  Write(st, bucketing, &kmeans, indices, num_actual);
-
-  delete [] indices;
+  Write(st, bucketing, &kmeans, indices.get(), num_actual);
 }
@@ -0,0 +1,126 @@
+// Builds the table of leaf values used by depth-limited resolving (see LeafValueTable).  The leaf
+// value of a bucket is the average over the hands in the bucket of the expected payoff of
+// checking the hand down against a uniform opponent range.  The table is keyed by pot as well,
+// using the pots of the street-initial nodes of the next street in the given betting tree.
+// These rollout values simply scale with the pot, but tables built from other sources need not.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "betting_abstraction.h"
+#include "betting_abstraction_params.h"
+#include "betting_tree.h"
+#include "betting_trees.h"
+#include "board_tree.h"
+#include "buckets.h"
+#include "card_abstraction.h"
+#include "card_abstraction_params.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "hand_value_tree.h"
+#include "leaf_value_table.h"
+#include "params.h"
+#include "rollout.h"
+
+using std::set;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <card params> <betting params> <street>\n",
+	  prog_name);
+  fprintf(stderr, "\nBuilds the table for leaves at the start of <street> + 1\n");
+  exit(-1);
+}
+
+// Collect the pot sizes of the nodes at the start of street st + 1.
+static void CollectPots(Node *node, int st, set<int> *pots) {
+  if (node->Terminal()) return;
+  int nst = node->Street();
+  if (nst > st) {
+    pots->insert(node->LastBetTo());
+    return;
+  }
+  int num_succs = node->NumSuccs();
+  for (int s = 0; s < num_succs; ++s) {
+    CollectPots(node->IthSucc(s), st, pots);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 5) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unique_ptr<Params> card_params = CreateCardAbstractionParams();
+  card_params->ReadFromFile(argv[2]);
+  unique_ptr<CardAbstraction> card_abstraction(new CardAbstraction(*card_params));
+  unique_ptr<Params> betting_params = CreateBettingAbstractionParams();
+  betting_params->ReadFromFile(argv[3]);
+  unique_ptr<BettingAbstraction> betting_abstraction(new BettingAbstraction(*betting_params));
+  int st;
+  if (sscanf(argv[4], "%i", &st) != 1) Usage(argv[0]);
+  if (st < 1 || st >= Game::MaxStreet()) {
+    fprintf(stderr, "Street must be postflop and before the final street\n");
+    exit(-1);
+  }
+  const string &bucketing = card_abstraction->Bucketing(st);
+  if (bucketing == "none") {
+    fprintf(stderr, "Street %i is not bucketed\n", st);
+    exit(-1);
+  }
+
+  HandValueTree::Create();
+  BoardTree::Create();
+  BoardTree::BuildBoardCounts();
+  Buckets buckets(*card_abstraction, false);
+  BettingTrees betting_trees(*betting_abstraction);
+  set<int> pot_set;
+  CollectPots(betting_trees.Root(), st, &pot_set);
+  if (pot_set.size() == 0) {
+    fprintf(stderr, "No nodes at the start of street %i\n", st + 1);
+    exit(-1);
+  }
+  // Sets are sorted
+  vector<int> pots(pot_set.begin(), pot_set.end());
+
+  unique_ptr<double []> equities(ComputeRolloutEquities(st));
+  int num_buckets = buckets.NumBuckets(st);
+  unique_ptr<double []> sum_equities(new double[num_buckets]);
+  unique_ptr<double []> sum_weights(new double[num_buckets]);
+  for (int b = 0; b < num_buckets; ++b) {
+    sum_equities[b] = 0;
+    sum_weights[b] = 0;
+  }
+  int num_boards = BoardTree::NumBoards(st);
+  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  for (int bd = 0; bd < num_boards; ++bd) {
+    int board_count = BoardTree::BoardCount(st, bd);
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      unsigned int h = ((unsigned int)bd) * ((unsigned int)num_hole_card_pairs) + i;
+      int b = buckets.Bucket(st, h);
+      sum_equities[b] += board_count * equities[h];
+      sum_weights[b] += board_count;
+    }
+  }
+
+  int num_pots = pots.size();
+  unique_ptr<double []> vals(new double[num_buckets * num_pots]);
+  for (int b = 0; b < num_buckets; ++b) {
+    double equity = sum_weights[b] > 0 ? sum_equities[b] / sum_weights[b] : 0;
+    for (int i = 0; i < num_pots; ++i) {
+      vals[b * num_pots + i] = equity * pots[i];
+    }
+  }
+  LeafValueTable::Write(bucketing, st, num_buckets, pots, vals.get());
+  fprintf(stderr, "Wrote %i buckets x %i pots\n", num_buckets, num_pots);
+}
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "board_tree.h"
+#include "buckets.h" // RemovePackedBuckets()
 #include "canonical_cards.h"
 #include "constants.h"
 #include "files.h"
@@ -73,6 +74,7 @@ int main(int argc, char *argv[]) {
   sprintf(buf, "%s/buckets.%s.%u.%u.%u.null.%u",
 	  Files::StaticBase(), Game::GameName().c_str(), Game::NumRanks(),
 	  Game::NumSuits(), Game::MaxStreet(), street);
+  RemovePackedBuckets(buf);
   Writer writer(buf);
   for (int h = 0; h < num_hands; ++h) {
     if (short_buckets) writer.WriteUnsignedShort(buckets[h]);
@@ -10,6 +10,7 @@
 #include <unordered_map>
 
 #include "board_tree.h"
+#include "buckets.h" // RemovePackedBuckets()
 #include "constants.h"
 #include "fast_hash.h"
 #include "files.h"
@@ -84,6 +85,7 @@ int main(int argc, char *argv[]) {
   sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i",
 	  Files::StaticBase(), Game::GameName().c_str(), Game::NumRanks(),
 	  Game::NumSuits(), Game::MaxStreet(), bucketing.c_str(), st);
+  RemovePackedBuckets(buf);
   Writer writer(buf);
   if (short_buckets) {
     for (unsigned int h = 0; h < num_hands; ++h) {
@@ -350,19 +350,11 @@ void CanonicalCards::SortByHandStrength(const Card *board) {
 #endif
   vector<Hand> hands(num_raw_);
   Hand h;
-  int hole_cards[2];
+  // We know hole cards are sorted
+  unique_ptr<int []> hvs(new int[num_raw_]);
+  HandValueTree::Vals(sorted_board.get(), cards_.get(), num_raw_, hvs.get());
   for (int i = 0; i < num_raw_; ++i) {
-    Card *cards = &cards_[i * n_];
-    hole_cards[0] = cards[0];
-    hole_cards[1] = cards[1];
-    // We know hole cards are sorted
-#if 0
-    for (int j = 0; j < num_board_cards; ++j) {
-      fprintf(stderr, "%i ", (int)sorted_board.get()[j]);
-    }
-    fprintf(stderr, "/ %i %i\n", hole_cards[0], hole_cards[1]);
-#endif
-    h.hv = HandValueTree::Val(sorted_board.get(), hole_cards);
+    h.hv = hvs[i];
     h.index = i;
     hands[i] = h;
   }
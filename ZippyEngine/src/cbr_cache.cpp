@@ -0,0 +1,83 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+
+#include "cbr_cache.h"
+#include "fast_hash.h"
+#include "game.h"
+
+using std::shared_ptr;
+using std::unique_ptr;
+
+CBRCache::CBRCache(int max_size) {
+  max_size_ = max_size;
+  int max_card1 = Game::MaxCard() + 1;
+  num_opp_probs_ = max_card1 * max_card1;
+  num_lookups_ = 0;
+  num_hits_ = 0;
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+CBRCache::~CBRCache(void) {
+  pthread_mutex_destroy(&mutex_);
+}
+
+// Reach probs are indexed by hole card encoding (hi * (max_card + 1) + lo).  The hash only picks
+// the bucket; Key::operator==() compares the reach probs themselves.
+CBRCache::Key CBRCache::MakeKey(Node *node, int gbd, int p, const double *opp_probs,
+				unsigned int seed) const {
+  unsigned long long int reach_hash =
+    fasthash64(opp_probs, num_opp_probs_ * sizeof(double), seed);
+  return Key{node, gbd, p, seed, reach_hash, opp_probs, num_opp_probs_};
+}
+
+shared_ptr<double []> CBRCache::Lookup(Node *node, int gbd, int p, const double *opp_probs,
+				       unsigned int seed) {
+  Key key = MakeKey(node, gbd, p, opp_probs, seed);
+  shared_ptr<double []> vals;
+  pthread_mutex_lock(&mutex_);
+  ++num_lookups_;
+  auto it = map_.find(key);
+  if (it != map_.end()) {
+    ++num_hits_;
+    // Move to front
+    entries_.splice(entries_.begin(), entries_, it->second);
+    const Entry &entry = *it->second;
+    vals.reset(new double[entry.num_vals]);
+    for (int i = 0; i < entry.num_vals; ++i) vals[i] = entry.vals[i];
+  }
+  pthread_mutex_unlock(&mutex_);
+  return vals;
+}
+
+void CBRCache::Insert(Node *node, int gbd, int p, const double *opp_probs, unsigned int seed,
+		      const double *vals, int num_vals) {
+  if (max_size_ <= 0) return;
+  unique_ptr<double []> opp_probs_copy(new double[num_opp_probs_]);
+  for (int i = 0; i < num_opp_probs_; ++i) opp_probs_copy[i] = opp_probs[i];
+  // The key must point to the copy, which lives as long as the entry does
+  Key key = MakeKey(node, gbd, p, opp_probs_copy.get(), seed);
+  unique_ptr<double []> copy(new double[num_vals]);
+  for (int i = 0; i < num_vals; ++i) copy[i] = vals[i];
+  pthread_mutex_lock(&mutex_);
+  // Another thread may have computed the same values in the meantime
+  if (map_.find(key) == map_.end()) {
+    if ((int)entries_.size() >= max_size_) {
+      map_.erase(entries_.back().key);
+      entries_.pop_back();
+    }
+    entries_.push_front(Entry{key, std::move(opp_probs_copy), std::move(copy), num_vals});
+    map_[key] = entries_.begin();
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void CBRCache::Report(void) const {
+  pthread_mutex_lock(&mutex_);
+  double hit_rate = num_lookups_ > 0 ? 100.0 * num_hits_ / num_lookups_ : 0;
+  fprintf(stderr, "CBR cache: %lli lookups, %lli hits (%.1f%%), %i entries\n", num_lookups_,
+	  num_hits_, hit_rate, (int)entries_.size());
+  pthread_mutex_unlock(&mutex_);
+}
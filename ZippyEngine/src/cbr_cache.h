@@ -0,0 +1,72 @@
+#ifndef _CBR_CACHE_H_
+#define _CBR_CACHE_H_
+
+#include <pthread.h>
+#include <string.h>
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+class Node;
+
+// A bounded LRU cache of the CBR vectors computed by DynamicCBR, so that repeated requests for
+// the same node, board and opponent reach probs don't each require a traversal.  Threadsafe; one
+// cache can be shared by resolving threads.
+//
+// The node pointer is part of the key, so the betting tree must outlive the cache.  All the
+// DynamicCBR objects sharing a cache must be using the same base strategy.  Each entry holds a
+// copy of the reach probs it was computed from; a lookup only hits if they match exactly.  The
+// seed identifies anything else that affects the values (e.g., whether to purify).
+class CBRCache {
+public:
+  CBRCache(int max_size);
+  ~CBRCache(void);
+  // Returns a copy of the cached values, or nullptr on a miss.
+  std::shared_ptr<double []> Lookup(Node *node, int gbd, int p, const double *opp_probs,
+				    unsigned int seed);
+  void Insert(Node *node, int gbd, int p, const double *opp_probs, unsigned int seed,
+	      const double *vals, int num_vals);
+  void Report(void) const;
+private:
+  // On a lookup, opp_probs points to the caller's reach probs; in the map, it points to the
+  // entry's copy.
+  struct Key {
+    Node *node;
+    int gbd;
+    int p;
+    unsigned int seed;
+    unsigned long long int reach_hash;
+    const double *opp_probs;
+    int num_opp_probs;
+    bool operator==(const Key &k) const {
+      return node == k.node && gbd == k.gbd && p == k.p && seed == k.seed &&
+	reach_hash == k.reach_hash && num_opp_probs == k.num_opp_probs &&
+	memcmp(opp_probs, k.opp_probs, num_opp_probs * sizeof(double)) == 0;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &k) const {
+      return k.reach_hash ^ (((size_t)k.node) * 31) ^ (((size_t)k.gbd) << 32) ^ k.p;
+    }
+  };
+  struct Entry {
+    Key key;
+    std::unique_ptr<double []> opp_probs;
+    std::unique_ptr<double []> vals;
+    int num_vals;
+  };
+
+  Key MakeKey(Node *node, int gbd, int p, const double *opp_probs, unsigned int seed) const;
+
+  int max_size_;
+  int num_opp_probs_;
+  // Most recently used entries at the front
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> map_;
+  mutable pthread_mutex_t mutex_;
+  long long int num_lookups_;
+  long long int num_hits_;
+};
+
+#endif
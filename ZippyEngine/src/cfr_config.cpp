@@ -142,4 +142,18 @@ CFRConfig::CFRConfig(const Params &params) {
   deal_twice_ = params.GetBooleanValue("DealTwice");
   ParseDoubles(params.GetStringValue("BoostThresholds"), &boost_thresholds_);
   ParseInts(params.GetStringValue("Freeze"), &freeze_);
+  // Both default to zero, meaning no warm start and no early stopping when resolving.
+  warm_start_its_ = params.GetIntValue("WarmStartIts");
+  convergence_threshold_ = params.GetDoubleValue("ConvergenceThreshold");
+  depth_limit_ = params.GetIntValue("DepthLimit");
+  leaf_value_bucketing_ = params.GetStringValue("LeafValueBucketing");
+  direct_io_ = params.GetBooleanValue("DirectIO");
+  delta_checkpoints_ = params.GetBooleanValue("DeltaCheckpoints");
+  regret_pruning_interval_ = params.GetIntValue("RegretPruningInterval");
+  traversal_stats_ = params.GetBooleanValue("TraversalStats");
+  ParseDoubles(params.GetStringValue("DCFR"), &dcfr_params_);
+  if (dcfr_params_.size() != 0 && dcfr_params_.size() != 3) {
+    fprintf(stderr, "Expected DCFR to be alpha,beta,gamma\n");
+    exit(-1);
+  }
 }
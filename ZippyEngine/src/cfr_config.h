@@ -59,6 +59,23 @@ public:
   bool DealTwice(void) const {return deal_twice_;}
   const std::vector<double> &BoostThresholds(void) const {return boost_thresholds_;}
   const std::vector<int> &Freeze(void) const {return freeze_;}
+  int WarmStartIts(void) const {return warm_start_its_;}
+  double ConvergenceThreshold(void) const {return convergence_threshold_;}
+  int DepthLimit(void) const {return depth_limit_;}
+  const std::string &LeafValueBucketing(void) const {return leaf_value_bucketing_;}
+  // Read and write checkpoints with O_DIRECT, bypassing the page cache
+  bool DirectIO(void) const {return direct_io_;}
+  // Write checkpoints as deltas against the previous checkpoint; see delta_io.h
+  bool DeltaCheckpoints(void) const {return delta_checkpoints_;}
+  // If nonzero, CFR+ skips succs that no hand plays under the current strategy, except on every
+  // nth iteration (starting with the first), which is a full pass.  Zero means no such pruning.
+  int RegretPruningInterval(void) const {return regret_pruning_interval_;}
+  // Count node visits and bucket lookups and report them after each iteration
+  bool TraversalStats(void) const {return traversal_stats_;}
+  // Discounted CFR parameters alpha, beta and gamma; empty if not discounting.  After iteration t,
+  // positive regrets are multiplied by t^alpha/(t^alpha+1), negative regrets by
+  // t^beta/(t^beta+1) and the sumprobs by (t/(t+1))^gamma.  1,1,1 gives Linear CFR.
+  const std::vector<double> &DCFRParams(void) const {return dcfr_params_;}
  private:
   std::string cfr_config_name_;
   std::string algorithm_;
@@ -96,6 +113,15 @@ public:
   bool deal_twice_;
   std::vector<double> boost_thresholds_;
   std::vector<int> freeze_;
+  int warm_start_its_;
+  double convergence_threshold_;
+  int depth_limit_;
+  std::string leaf_value_bucketing_;
+  bool direct_io_;
+  bool delta_checkpoints_;
+  int regret_pruning_interval_;
+  bool traversal_stats_;
+  std::vector<double> dcfr_params_;
 };
 
 #endif
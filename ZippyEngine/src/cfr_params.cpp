@@ -45,6 +45,15 @@ unique_ptr<Params> CreateCFRParams(void) {
   params->AddParam("DealTwice", P_BOOLEAN);
   params->AddParam("BoostThresholds", P_STRING);
   params->AddParam("Freeze", P_STRING);
+  params->AddParam("WarmStartIts", P_INT);
+  params->AddParam("ConvergenceThreshold", P_DOUBLE);
+  params->AddParam("DepthLimit", P_INT);
+  params->AddParam("LeafValueBucketing", P_STRING);
+  params->AddParam("DirectIO", P_BOOLEAN);
+  params->AddParam("DeltaCheckpoints", P_BOOLEAN);
+  params->AddParam("RegretPruningInterval", P_INT);
+  params->AddParam("TraversalStats", P_BOOLEAN);
+  params->AddParam("DCFR", P_STRING);
 
   return params;
 }
@@ -1,3 +1,4 @@
+#include <math.h> // lrint()
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -232,23 +233,25 @@ void CFRStreetValues<T>::PureProbs(int p, int nt, int offset, int num_succs,
 template <typename T>
 void CFRStreetValues<T>::ComputeOurValsBucketed(int pa, int nt, int num_hole_card_pairs,
 						int num_succs, int dsi,
-						shared_ptr<double []> *succ_vals,
-						int *street_buckets, shared_ptr<double []> vals)
-  const {
+						shared_ptr<VCFR_VALUE []> *succ_vals,
+						const int *street_buckets,
+						shared_ptr<VCFR_VALUE []> vals,
+						const int *canon_hands, int num_canon_hands) const {
   const T *all_cs_vals = data_[pa][nt];
   ::ComputeOurValsBucketed(all_cs_vals, num_hole_card_pairs, num_succs, dsi, succ_vals,
-			   street_buckets, vals);
+			   street_buckets, vals, canon_hands, num_canon_hands);
 }
 
 // Uses the current strategy (from regrets or sumprobs) to compute the weighted average of
 // the successor values.  This version for systems employing no card abstraction.
 template <typename T>
 void CFRStreetValues<T>::ComputeOurVals(int pa, int nt, int num_hole_card_pairs, int num_succs,
-					int dsi, shared_ptr<double []> *succ_vals, int lbd,
-					shared_ptr<double []> vals)
-  const {
+					int dsi, shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+					shared_ptr<VCFR_VALUE []> vals, const int *canon_hands,
+					int num_canon_hands) const {
   const T *all_cs_vals = data_[pa][nt];
-  ::ComputeOurVals(all_cs_vals, num_hole_card_pairs, num_succs, dsi, succ_vals, lbd, vals);
+  ::ComputeOurVals(all_cs_vals, num_hole_card_pairs, num_succs, dsi, succ_vals, lbd, vals,
+		   canon_hands, num_canon_hands);
 }
 
 // Set the current strategy probs from the regrets.  Used for abstracted systems in CFR+.
@@ -260,6 +263,23 @@ void CFRStreetValues<T>::SetCurrentAbstractedStrategy(int pa, int nt, int num_bu
   ::SetCurrentAbstractedStrategy(all_regrets, num_buckets, num_succs, dsi, all_cs_probs);
 }
 
+// Sets prunable[s] to true if regret matching gives succ s probability zero for each of the
+// num_holdings holdings starting at offset; i.e., if none of them has positive regret for s.
+// The default succ is never prunable because regret matching falls back on it when no succ has
+// positive regret.
+template <typename T>
+void CFRStreetValues<T>::PrunableSuccs(int p, int nt, int offset, int num_holdings, int num_succs,
+				       int dsi, bool *prunable) const {
+  const T *my_vals = &data_[p][nt][offset];
+  for (int s = 0; s < num_succs; ++s) prunable[s] = s != dsi;
+  for (int i = 0; i < num_holdings; ++i) {
+    for (int s = 0; s < num_succs; ++s) {
+      if (my_vals[s] > 0) prunable[s] = false;
+    }
+    my_vals += num_succs;
+  }
+}
+
 template <typename T>
 void CFRStreetValues<T>::Floor(int p, int nt, int num_succs, int floor) {
   int num = num_holdings_ * num_succs;
@@ -268,6 +288,32 @@ void CFRStreetValues<T>::Floor(int p, int nt, int num_succs, int floor) {
   }
 }
 
+// Multiplies the positive values for the node by pos_scale and the negative values by neg_scale.
+// Integer values are rounded, as in the regret update kernels.
+template <typename T>
+void CFRStreetValues<T>::ScaleSigned(int p, int nt, int num_succs, double pos_scale,
+				     double neg_scale) {
+  int num = num_holdings_ * num_succs;
+  T *vals = data_[p][nt];
+  for (int i = 0; i < num; ++i) {
+    T v = vals[i];
+    if (v > 0)      vals[i] = lrint(v * pos_scale);
+    else if (v < 0) vals[i] = lrint(v * neg_scale);
+  }
+}
+
+template <>
+void CFRStreetValues<double>::ScaleSigned(int p, int nt, int num_succs, double pos_scale,
+					  double neg_scale) {
+  int num = num_holdings_ * num_succs;
+  double *vals = data_[p][nt];
+  for (int i = 0; i < num; ++i) {
+    double v = vals[i];
+    if (v > 0)      vals[i] = v * pos_scale;
+    else if (v < 0) vals[i] = v * neg_scale;
+  }
+}
+
 template <typename T>
 void CFRStreetValues<T>::Set(int p, int nt, int h, int num_succs, T *vals) {
   int offset = h * num_succs;
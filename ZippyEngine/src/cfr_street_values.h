@@ -17,15 +17,20 @@ class AbstractCFRStreetValues {
   virtual void RMProbs(int p, int nt, int offset,  int num_succs, int dsi, double *probs) const = 0;
   virtual void PureProbs(int p, int nt, int offset, int num_succs, double *probs) const = 0;
   virtual void ComputeOurValsBucketed(int pa, int nt, int num_hole_card_pairs, int num_succs,
-				      int dsi, std::shared_ptr<double []> *succ_vals,
-				      int *street_buckets,
-				      std::shared_ptr<double []> vals) const = 0;
+				      int dsi, std::shared_ptr<VCFR_VALUE []> *succ_vals,
+				      const int *street_buckets,
+				      std::shared_ptr<VCFR_VALUE []> vals,
+				      const int *canon_hands, int num_canon_hands) const = 0;
   virtual void ComputeOurVals(int pa, int nt, int num_hole_card_pairs, int num_succs, int dsi,
-			      std::shared_ptr<double []> *succ_vals, int lbd,
-			      std::shared_ptr<double []> vals) const = 0;
+			      std::shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+			      std::shared_ptr<VCFR_VALUE []> vals, const int *canon_hands,
+			      int num_canon_hands) const = 0;
   virtual void SetCurrentAbstractedStrategy(int pa, int nt, int num_buckets, int num_succs, int dsi,
 					    double *all_cs_probs) const = 0;
+  virtual void PrunableSuccs(int p, int nt, int offset, int num_holdings, int num_succs, int dsi,
+			     bool *prunable) const = 0;
   virtual void Floor(int p, int nt, int num_succs, int floor) = 0;
+  virtual void ScaleSigned(int p, int nt, int num_succs, double pos_scale, double neg_scale) = 0;
   virtual bool Players(int p) const = 0;
   virtual void ReadNode(Node *node, Reader *reader, void *decompressor) = 0;
   virtual void ReadBoardValuesForNode(Node *node, Reader *reader, void *decompressor, int lbd,
@@ -57,14 +62,19 @@ public:
   // Note: doesn't handle nodes with one succ
   void PureProbs(int p, int nt, int offset, int num_succs, double *probs) const;
   void ComputeOurValsBucketed(int pa, int nt, int num_hole_card_pairs, int num_succs, int dsi,
-			      std::shared_ptr<double []> *succ_vals, int *street_buckets,
-			      std::shared_ptr<double []> vals) const;
+			      std::shared_ptr<VCFR_VALUE []> *succ_vals, const int *street_buckets,
+			      std::shared_ptr<VCFR_VALUE []> vals, const int *canon_hands,
+			      int num_canon_hands) const;
   void ComputeOurVals(int pa, int nt, int num_hole_card_pairs, int num_succs, int dsi,
-		      std::shared_ptr<double []> *succ_vals, int lbd,
-		      std::shared_ptr<double []> vals) const;
+		      std::shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+		      std::shared_ptr<VCFR_VALUE []> vals, const int *canon_hands,
+		      int num_canon_hands) const;
   void SetCurrentAbstractedStrategy(int pa, int nt, int num_buckets, int num_succs, int dsi,
 				    double *all_cs_probs) const;
+  void PrunableSuccs(int p, int nt, int offset, int num_holdings, int num_succs, int dsi,
+		     bool *prunable) const;
   void Floor(int p, int nt, int num_succs, int floor);
+  void ScaleSigned(int p, int nt, int num_succs, double pos_scale, double neg_scale);
   void Set(int p, int nt, int h, int num_succs, T *vals);
   void InitializeValuesForReading(int p, int nt, int num_succs);
   void ReadNode(Node *node, Reader *reader, void *decompressor);
@@ -83,10 +83,13 @@ template void RMProbs<unsigned char>(const unsigned char *vals, int num_succs, i
 // the successor values.  This version for systems employing card abstraction.
 template <typename T> void ComputeOurValsBucketed(const T *all_cs_vals, int num_hole_card_pairs,
 						  int num_succs, int dsi,
-						  shared_ptr<double []> *succ_vals,
-						  int *street_buckets, shared_ptr<double []> vals) {
+						  shared_ptr<VCFR_VALUE []> *succ_vals,
+						  const int *street_buckets,
+						  shared_ptr<VCFR_VALUE []> vals,
+						  const int *canon_hands, int num_canon_hands) {
   unique_ptr<double []> current_probs(new double[num_succs]);
-  for (int i = 0; i < num_hole_card_pairs; ++i) {
+  for (int j = 0; j < num_canon_hands; ++j) {
+    int i = canon_hands ? canon_hands[j] : j;
     int b = street_buckets[i];
     RMProbs(all_cs_vals + b * num_succs, num_succs, dsi, current_probs.get());
     for (int s = 0; s < num_succs; ++s) {
@@ -97,22 +100,28 @@ template <typename T> void ComputeOurValsBucketed(const T *all_cs_vals, int num_
 
 template void ComputeOurValsBucketed<double>(const double *all_cs_vals, int num_hole_card_pairs,
 					     int num_succs, int dsi,
-					     shared_ptr<double []> *succ_vals,
-					     int *street_buckets, shared_ptr<double []> vals);
+					     shared_ptr<VCFR_VALUE []> *succ_vals,
+					     const int *street_buckets,
+					     shared_ptr<VCFR_VALUE []> vals,
+					     const int *canon_hands, int num_canon_hands);
 template void ComputeOurValsBucketed<int>(const int *all_cs_vals, int num_hole_card_pairs,
-					  int num_succs, int dsi, shared_ptr<double []> *succ_vals,
-					  int *street_buckets, shared_ptr<double []> vals);
+					  int num_succs, int dsi,
+					  shared_ptr<VCFR_VALUE []> *succ_vals,
+					  const int *street_buckets, shared_ptr<VCFR_VALUE []> vals,
+					  const int *canon_hands, int num_canon_hands);
 template void ComputeOurValsBucketed<unsigned short>(const unsigned short *all_cs_vals, 
 						     int num_hole_card_pairs, int num_succs,
-						     int dsi, shared_ptr<double []> *succ_vals,
-						     int *street_buckets,
-						     shared_ptr<double []> vals);
+						     int dsi, shared_ptr<VCFR_VALUE []> *succ_vals,
+						     const int *street_buckets,
+						     shared_ptr<VCFR_VALUE []> vals,
+						     const int *canon_hands, int num_canon_hands);
 template void ComputeOurValsBucketed<unsigned char>(const unsigned char *all_cs_vals,
 						    int num_hole_card_pairs,
 						    int num_succs, int dsi,
-						    shared_ptr<double []> *succ_vals,
-						    int *street_buckets,
-						    shared_ptr<double []> vals);
+						    shared_ptr<VCFR_VALUE []> *succ_vals,
+						    const int *street_buckets,
+						    shared_ptr<VCFR_VALUE []> vals,
+						    const int *canon_hands, int num_canon_hands);
 
 // Uses the current strategy (from regrets or sumprobs) to compute the weighted average of
 // the successor values.  This version for unabstracted systems.
@@ -142,11 +151,14 @@ that might be what all_cs_vals and lbd are used for
 -Brian
 */
 template <typename T> void ComputeOurVals(const T *all_cs_vals, int num_hole_card_pairs,
-					  int num_succs, int dsi, shared_ptr<double []> *succ_vals,
-					  int lbd, shared_ptr<double []> vals) {
+					  int num_succs, int dsi,
+					  shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+					  shared_ptr<VCFR_VALUE []> vals,
+					  const int *canon_hands, int num_canon_hands) {
   unique_ptr<double []> current_probs(new double[num_succs]);
   int base = lbd * num_hole_card_pairs * num_succs;
-  for (int i = 0; i < num_hole_card_pairs; ++i) {
+  for (int j = 0; j < num_canon_hands; ++j) {
+    int i = canon_hands ? canon_hands[j] : j;
     int offset = base + i * num_succs;
     RMProbs(all_cs_vals + offset, num_succs, dsi, current_probs.get());
     for (int s = 0; s < num_succs; ++s) {
@@ -156,19 +168,24 @@ template <typename T> void ComputeOurVals(const T *all_cs_vals, int num_hole_car
 }
 
 template void ComputeOurVals<double>(const double *all_cs_vals, int num_hole_card_pairs,
-				     int num_succs, int dsi, shared_ptr<double []> *succ_vals,
-				     int lbd, shared_ptr<double []> vals);
+				     int num_succs, int dsi,
+				     shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+				     shared_ptr<VCFR_VALUE []> vals,
+				     const int *canon_hands, int num_canon_hands);
 template void ComputeOurVals<int>(const int *all_cs_vals, int num_hole_card_pairs, int num_succs,
-				  int dsi, shared_ptr<double []> *succ_vals, int lbd,
-				  shared_ptr<double []> vals);
+				  int dsi, shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+				  shared_ptr<VCFR_VALUE []> vals,
+				  const int *canon_hands, int num_canon_hands);
 template void ComputeOurVals<unsigned short>(const unsigned short *all_cs_vals,
 					     int num_hole_card_pairs, int num_succs, int dsi,
-					     shared_ptr<double []> *succ_vals, int lbd,
-					     shared_ptr<double []> vals);
+					     shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+					     shared_ptr<VCFR_VALUE []> vals,
+					     const int *canon_hands, int num_canon_hands);
 template void ComputeOurVals<unsigned char>(const unsigned char *all_cs_vals,
 					    int num_hole_card_pairs, int num_succs, int dsi,
-					    shared_ptr<double []> *succ_vals, int lbd,
-					    shared_ptr<double []> vals);
+					    shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+					    shared_ptr<VCFR_VALUE []> vals,
+					    const int *canon_hands, int num_canon_hands);
 
 template <typename T> void SetCurrentAbstractedStrategy(const T *all_regrets, int num_buckets,
 							int num_succs, int dsi,
@@ -207,8 +224,9 @@ template void SetCurrentAbstractedStrategy<unsigned char>(const unsigned char *a
   -Brian
 */
 
-shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
-			       double sum_opp_probs, double *total_card_probs) {
+shared_ptr<VCFR_VALUE []> Showdown(Node *node, const CanonicalCards *hands,
+				   VCFR_VALUE *opp_probs, double sum_opp_probs,
+				   double *total_card_probs) {
   int max_card1 = Game::MaxCard() + 1;
   double cum_prob = 0;
   double cum_card_probs[52];
@@ -216,7 +234,7 @@ shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *
   int num_hole_card_pairs = hands->NumRaw();
   unique_ptr<double []> win_probs(new double[num_hole_card_pairs]);
   double half_pot = node->LastBetTo();
-  shared_ptr<double []> vals(new double[num_hole_card_pairs]);
+  shared_ptr<VCFR_VALUE []> vals(new VCFR_VALUE[num_hole_card_pairs]);
 
   int j = 0;
   while (j < num_hole_card_pairs) {
@@ -240,8 +258,7 @@ shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *
       const Card *cards = hands->Cards(k);
       Card hi = cards[0];
       Card lo = cards[1];
-      int code = hi * max_card1 + lo;
-      double prob = opp_probs[code];
+      double prob = opp_probs[k];
       cum_card_probs[hi] += prob;
       cum_card_probs[lo] += prob;
       cum_prob += prob;
@@ -288,9 +305,9 @@ shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *
   outputs: ev for each hand
   -Brian
 */
-shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, double *opp_probs,
-			   double sum_opp_probs, double *total_card_probs) {
-  int max_card1 = Game::MaxCard() + 1;
+shared_ptr<VCFR_VALUE []> Fold(Node *node, int p, const CanonicalCards *hands,
+			       VCFR_VALUE *opp_probs, double sum_opp_probs,
+			       double *total_card_probs) {
   // Sign of half_pot reflects who wins the pot
   double half_pot;
   // Player acting encodes player remaining at fold nodes
@@ -301,14 +318,13 @@ shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, doubl
     half_pot = -node->LastBetTo();
   }
   int num_hole_card_pairs = hands->NumRaw();
-  shared_ptr<double []> vals(new double[num_hole_card_pairs]);
+  shared_ptr<VCFR_VALUE []> vals(new VCFR_VALUE[num_hole_card_pairs]);
 
   for (int i = 0; i < num_hole_card_pairs; ++i) {
     const Card *cards = hands->Cards(i);
     Card hi = cards[0];
     Card lo = cards[1];
-    int enc = hi * max_card1 + lo;
-    double opp_prob = opp_probs[enc];
+    double opp_prob = opp_probs[i];
     vals[i] = half_pot *
       (sum_opp_probs + opp_prob - (total_card_probs[hi] + total_card_probs[lo]));
   }
@@ -327,7 +343,7 @@ shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, doubl
   I really do not understand this functions name
   -Brian
 */
-void CommonBetResponseCalcs(int st, const CanonicalCards *hands, double *opp_probs,
+void CommonBetResponseCalcs(int st, const CanonicalCards *hands, VCFR_VALUE *opp_probs,
 			    double *ret_sum_opp_probs, double *total_card_probs) {
   double sum_opp_probs = 0;
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
@@ -338,8 +354,7 @@ void CommonBetResponseCalcs(int st, const CanonicalCards *hands, double *opp_pro
     const Card *cards = hands->Cards(i);
     Card hi = cards[0];
     Card lo = cards[1];
-    int enc = hi * (max_card + 1) + lo;
-    double opp_prob = opp_probs[enc];
+    double opp_prob = opp_probs[i];
     sum_opp_probs += opp_prob;
     total_card_probs[hi] += opp_prob;
     total_card_probs[lo] += opp_prob;
@@ -347,16 +362,58 @@ void CommonBetResponseCalcs(int st, const CanonicalCards *hands, double *opp_pro
   *ret_sum_opp_probs = sum_opp_probs;
 }
 
+shared_ptr<VCFR_VALUE []> DenseOppProbs(const CanonicalCards *hands, const double *enc_probs) {
+  int max_card1 = Game::MaxCard() + 1;
+  int num_hole_card_pairs = hands->NumRaw();
+  shared_ptr<VCFR_VALUE []> opp_probs(new VCFR_VALUE[num_hole_card_pairs]);
+  for (int i = 0; i < num_hole_card_pairs; ++i) {
+    const Card *cards = hands->Cards(i);
+    opp_probs[i] = enc_probs[cards[0] * max_card1 + cards[1]];
+  }
+  return opp_probs;
+}
+
+shared_ptr<double []> WideVals(const shared_ptr<double []> &vals, int num) {
+  return vals;
+}
+
+shared_ptr<double []> WideVals(const shared_ptr<float []> &vals, int num) {
+  shared_ptr<double []> wide_vals(new double[num]);
+  for (int i = 0; i < num; ++i) wide_vals[i] = vals[i];
+  return wide_vals;
+}
+
+// The weight given to the current strategy when it is added into the sumprobs on iteration it.
+// With a gamma of zero we get the traditional scheme: a weight of one on every iteration if there
+// is no warmup; otherwise no weight (hard warmup) or a weight of one (soft warmup) during the
+// warmup, and a weight of (it - warmup) afterwards.  A nonzero gamma gives the DCFR weighting of
+// (it - warmup)^gamma, which is the same as discounting the sumprobs by ((t-1)/t)^gamma at
+// the end of every iteration t, but doesn't require touching the sumprobs.
+double SumprobWeight(int it, int soft_warmup, int hard_warmup, double gamma) {
+  int base;
+  if (hard_warmup > 0) {
+    if (it <= hard_warmup) return 0;
+    base = it - hard_warmup;
+  } else if (soft_warmup > 0) {
+    if (it <= soft_warmup) return 1.0;
+    base = it - soft_warmup;
+  } else {
+    if (gamma == 0) return 1.0;
+    base = it;
+  }
+  if (gamma == 0) return base;
+  return pow(base, gamma);
+}
+
 /* This function is called for every possible hand (by function ProcessOppProbs). It updates opponent reach for each hand after his action.
     It also updates his sumprobs (cumulative strategy, can be used to find average strategy at any point)
-    warmup looks like an optional parameter for the solver to give less weight to strategies played in earlier iterations.
+    sumprob_weight (see SumprobWeight()) lets the solver give less weight to strategies played in earlier iterations.
 
-    inputs: enc = hand index
+    inputs: i = hand index
             num_succs = number of actions/number of successor nodes
             reach prob = current probability that villain holds this hand at this node
             current_probs = villains current strategy at this node (calculated by regret matching in the ProcessOppProbs function, before this function is called)
-            it = iteration, used for the warmup stuff
-            soft warmup, hardwarmup
+            sumprob_weight = weight of this iteration's strategy
             sumprob scaling is not even used in this function. It is used in a similar function below.
             sumprob scaling might have to do with preventing overflow? 
     outputs: succ_opp_probs = probability opponent reaches each successor node with current hand
@@ -364,67 +421,45 @@ void CommonBetResponseCalcs(int st, const CanonicalCards *hands, double *opp_pro
     -Brian
 */
 
-static void UpdateSumprobsAndSuccOppProbs(int enc, int num_succs, double reach_prob,
+static void UpdateSumprobsAndSuccOppProbs(int i, int num_succs, double reach_prob,
 					  double *current_probs,
-					  shared_ptr<double []> *succ_opp_probs, int it,
-					  int soft_warmup, int hard_warmup, double sumprob_scaling,
+					  shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+					  double sumprob_weight, double sumprob_scaling,
 					  double *sumprobs) {
   for (int s = 0; s < num_succs; ++s) {
     double succ_opp_prob = reach_prob * current_probs[s];
-    succ_opp_probs[s][enc] = succ_opp_prob;
+    succ_opp_probs[s][i] = succ_opp_prob;
     if (sumprobs) {
-      if ((hard_warmup == 0 && soft_warmup == 0) ||
-	  (soft_warmup > 0 && it <= soft_warmup)) {
-	// Update sumprobs with weight of 1.  Do this when either:
-	// a) There is no warmup (hard or soft), or
-	// b) We are during the soft warmup period.
-	sumprobs[s] += succ_opp_prob;
-      } else if (hard_warmup > 0 && it > hard_warmup) {
-	// Use a weight of (it - hard_warmup)
-	sumprobs[s] += succ_opp_prob * (it - hard_warmup);
-      } else if (soft_warmup > 0) {
-	// Use a weight of (it - soft_warmup)
-	sumprobs[s] += succ_opp_prob * (it - soft_warmup);
-      }
+      sumprobs[s] += succ_opp_prob * sumprob_weight;
     }
   }
 }
 /*similar as above function but int* sumprobs instead of double* sumprobs
   also uses sumprob scaling and downscaling to prevent overflow? -Brian*/
-static void UpdateSumprobsAndSuccOppProbs(int enc, int num_succs, double reach_prob,
+static void UpdateSumprobsAndSuccOppProbs(int i, int num_succs, double reach_prob,
 					  double *current_probs,
-					  shared_ptr<double []> *succ_opp_probs, int it,
-					  int soft_warmup, int hard_warmup, double sumprob_scaling,
+					  shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+					  double sumprob_weight, double sumprob_scaling,
 					  int *sumprobs) {
-  bool downscale = false;
+  for (int s = 0; s < num_succs; ++s) {
+    succ_opp_probs[s][i] = reach_prob * current_probs[s];
+  }
+  if (sumprobs == nullptr) return;
+  // The new sumprobs are formed in 64 bits since with DCFR weights of t^gamma an increment can
+  // exceed the range of an int by itself.  We halve all the sumprobs of the hand as many times as
+  // it takes to bring them under 2 billion.
+  long long int max_sumprob = 0;
   for (int s = 0; s < num_succs; ++s) {
     double succ_opp_prob = reach_prob * current_probs[s];
-    succ_opp_probs[s][enc] = succ_opp_prob;
-    if (sumprobs) {
-      if ((hard_warmup == 0 && soft_warmup == 0) ||
-	  (soft_warmup > 0 && it <= soft_warmup)) {
-	// Update sumprobs with weight of 1.  Do this when either:
-	// a) There is no warmup (hard or soft), or
-	// b) We are during the soft warmup period.
-	sumprobs[s] += lrint(succ_opp_prob * sumprob_scaling);
-      } else if (hard_warmup > 0) {
-	// Use a weight of (it - hard_warmup)
-	sumprobs[s] += lrint(succ_opp_prob * (it - hard_warmup) *
-			     sumprob_scaling);
-      } else {
-	// Use a weight of (it - soft_warmup)
-	sumprobs[s] += lrint(succ_opp_prob * (it - soft_warmup) *
-			     sumprob_scaling);
-      }
-      if (sumprobs[s] > 2000000000) {
-	downscale = true;
-      }
-    }
+    long long int sumprob = sumprobs[s] + lrint(succ_opp_prob * sumprob_weight * sumprob_scaling);
+    if (sumprob > max_sumprob) max_sumprob = sumprob;
   }
-  if (downscale) {
-    for (int s = 0; s < num_succs; ++s) {
-      sumprobs[s] /= 2;
-    }
+  int shift = 0;
+  while ((max_sumprob >> shift) > 2000000000) ++shift;
+  for (int s = 0; s < num_succs; ++s) {
+    double succ_opp_prob = reach_prob * current_probs[s];
+    long long int sumprob = sumprobs[s] + lrint(succ_opp_prob * sumprob_weight * sumprob_scaling);
+    sumprobs[s] = sumprob >> shift;
   }
 }
 
@@ -436,31 +471,19 @@ static void UpdateSumprobsAndSuccOppProbs(int enc, int num_succs, double reach_p
 
 /*This one is for cfr+ with abstraction, see below function for what we're interested in -Brian*/
 template <typename T>
-void ProcessOppProbs(Node *node, const CanonicalCards *hands, int *street_buckets,
-		     double *opp_probs, shared_ptr<double []> *succ_opp_probs,
-		     double *current_probs, int it, int soft_warmup, int hard_warmup,
-		     double sumprob_scaling, CFRStreetValues<T> *sumprobs) {
-  int st = node->Street();
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, const int *street_buckets,
+		     VCFR_VALUE *opp_probs, shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+		     double *current_probs, double sumprob_weight, double sumprob_scaling,
+		     CFRStreetValues<T> *sumprobs, const int *canon_hands, int num_canon_hands) {
   int num_succs = node->NumSuccs();
   int pa = node->PlayerActing();
   int nt = node->NonterminalID();
-  int num_hole_cards = Game::NumCardsForStreet(0);
-  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-  int max_card1 = Game::MaxCard() + 1;
-  for (int i = 0; i < num_hole_card_pairs; ++i) {
-    const Card *cards = hands->Cards(i);
-    Card hi = cards[0];
-    int enc;
-    if (num_hole_cards == 1) {
-      enc = hi;
-    } else {
-      Card lo = cards[1];
-      enc = hi * max_card1 + lo;
-    }
-    double opp_prob = opp_probs[enc];
+  for (int j = 0; j < num_canon_hands; ++j) {
+    int i = canon_hands ? canon_hands[j] : j;
+    double opp_prob = opp_probs[i];
     if (opp_prob == 0) {
       for (int s = 0; s < num_succs; ++s) {
-	succ_opp_probs[s][enc] = 0;
+	succ_opp_probs[s][i] = 0;
       }
     } else {
       double *my_current_probs;
@@ -469,24 +492,25 @@ void ProcessOppProbs(Node *node, const CanonicalCards *hands, int *street_bucket
       int offset = b * num_succs;
       my_current_probs = current_probs + offset;
       if (sumprobs) my_sumprobs = sumprobs->AllValues(pa, nt) + offset;
-      UpdateSumprobsAndSuccOppProbs(enc, num_succs, opp_prob, my_current_probs, succ_opp_probs, it,
-				    soft_warmup, hard_warmup, sumprob_scaling, my_sumprobs);
+      UpdateSumprobsAndSuccOppProbs(i, num_succs, opp_prob, my_current_probs, succ_opp_probs,
+				    sumprob_weight, sumprob_scaling, my_sumprobs);
     }
   }
 }
 
 // Instantiate
-template void ProcessOppProbs<int>(Node *node, const CanonicalCards *hands, int *street_buckets,
-				   double *opp_probs, shared_ptr<double []> *succ_opp_probs,
-				   double *current_probs, int it, int soft_warmup,
-				   int hard_warmup, double sumprob_scaling,
-				   CFRStreetValues<int> *sumprobs);
+template void ProcessOppProbs<int>(Node *node, const CanonicalCards *hands,
+				   const int *street_buckets, VCFR_VALUE *opp_probs,
+				   shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+				   double *current_probs, double sumprob_weight,
+				   double sumprob_scaling, CFRStreetValues<int> *sumprobs,
+				   const int *canon_hands, int num_canon_hands);
 template void ProcessOppProbs<double>(Node *node, const CanonicalCards *hands,
-				      int *street_buckets, double *opp_probs,
-				      shared_ptr<double []> *succ_opp_probs,
-				      double *current_probs, int it, int soft_warmup,
-				      int hard_warmup, double sumprob_scaling,
-				      CFRStreetValues<double> *sumprobs);
+				      const int *street_buckets, VCFR_VALUE *opp_probs,
+				      shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+				      double *current_probs, double sumprob_weight,
+				      double sumprob_scaling, CFRStreetValues<double> *sumprobs,
+				      const int *canon_hands, int num_canon_hands);
 
 /*For all possible hands-
   Calculates opponents strategy with reget matching
@@ -502,8 +526,7 @@ template void ProcessOppProbs<double>(Node *node, const CanonicalCards *hands,
           opp_probs = opponent reach probabilities for every hand for the current node
           cs_vals = all regret values
           dsi = default strategy index? used on the first iteration in RMProbs function when regrets = 0
-          it = iteration, used for warmups when calculating strategy sum (placing less weight on earlier iterations)
-          softwarmup,hardwarmup = solver parameters
+          sumprob_weight = weight of this iteration's strategy in the strategy sum (see SumprobWeight())
           sumprob scaling not even used when using doubles
 
 
@@ -516,34 +539,25 @@ template void ProcessOppProbs<double>(Node *node, const CanonicalCards *hands,
 
 template <typename T1, typename T2>
 void ProcessOppProbs(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
-		     int *street_buckets, double *opp_probs, shared_ptr<double []> *succ_opp_probs,
-		     const CFRStreetValues<T1> &cs_vals, int dsi, int it, int soft_warmup,
-		     int hard_warmup, double sumprob_scaling, CFRStreetValues<T2> *sumprobs) {
+		     const int *street_buckets, VCFR_VALUE *opp_probs,
+		     shared_ptr<VCFR_VALUE []> *succ_opp_probs, const CFRStreetValues<T1> &cs_vals,
+		     int dsi, double sumprob_weight, double sumprob_scaling,
+		     CFRStreetValues<T2> *sumprobs, const int *canon_hands, int num_canon_hands) {
   int st = node->Street();
   int num_succs = node->NumSuccs();
   int pa = node->PlayerActing();
   int nt = node->NonterminalID();
   unique_ptr<double []> current_probs(new double[num_succs]);
-  int num_hole_cards = Game::NumCardsForStreet(0);
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-  int max_card1 = Game::MaxCard() + 1;
   const T1 *all_cs_vals = cs_vals.AllValues(pa, nt);
   T2 *all_sumprobs = nullptr;
   if (sumprobs) all_sumprobs = sumprobs->AllValues(pa, nt);
-  for (int i = 0; i < num_hole_card_pairs; ++i) {
-    const Card *cards = hands->Cards(i);
-    Card hi = cards[0];
-    int enc;
-    if (num_hole_cards == 1) {
-      enc = hi;
-    } else {
-      Card lo = cards[1];
-      enc = hi * max_card1 + lo;
-    }
-    double opp_prob = opp_probs[enc];
+  for (int j = 0; j < num_canon_hands; ++j) {
+    int i = canon_hands ? canon_hands[j] : j;
+    double opp_prob = opp_probs[i];
     if (opp_prob == 0) {
       for (int s = 0; s < num_succs; ++s) {
-	succ_opp_probs[s][enc] = 0;
+	succ_opp_probs[s][i] = 0;
       }
     } else {
       int offset;
@@ -554,8 +568,8 @@ void ProcessOppProbs(Node *node, int lbd, const CanonicalCards *hands, bool buck
       }
       // cs_vals.RMProbs(pa, nt, offset, num_succs, dsi, current_probs.get());
       RMProbs(all_cs_vals + offset, num_succs, dsi, current_probs.get());
-      UpdateSumprobsAndSuccOppProbs(enc, num_succs, opp_prob, current_probs.get(), succ_opp_probs,
-				    it, soft_warmup, hard_warmup, sumprob_scaling,
+      UpdateSumprobsAndSuccOppProbs(i, num_succs, opp_prob, current_probs.get(), succ_opp_probs,
+				    sumprob_weight, sumprob_scaling,
 				    all_sumprobs ? all_sumprobs + offset : nullptr);
     }
   }
@@ -564,40 +578,42 @@ void ProcessOppProbs(Node *node, int lbd, const CanonicalCards *hands, bool buck
 // Instantiate
 template void
 ProcessOppProbs<int, int>(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
-			  int *street_buckets, double *opp_probs,
-			  shared_ptr<double []> *succ_opp_probs,
-			  const CFRStreetValues<int> &cs_vals, int dsi, int it,
-			  int soft_warmup, int hard_warmup, double sumprob_scaling,
-			  CFRStreetValues<int> *sumprobs);
+			  const int *street_buckets, VCFR_VALUE *opp_probs,
+			  shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+			  const CFRStreetValues<int> &cs_vals, int dsi, double sumprob_weight,
+			  double sumprob_scaling, CFRStreetValues<int> *sumprobs,
+			  const int *canon_hands, int num_canon_hands);
 template void
 ProcessOppProbs<double, double>(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
-				int *street_buckets, double *opp_probs,
-				shared_ptr<double []> *succ_opp_probs,
+				const int *street_buckets, VCFR_VALUE *opp_probs,
+				shared_ptr<VCFR_VALUE []> *succ_opp_probs,
 				const CFRStreetValues<double> &cs_vals,
-				int dsi, int it, int soft_warmup, int hard_warmup,
-				double sumprob_scaling,	CFRStreetValues<double> *sumprobs);
+				int dsi, double sumprob_weight, double sumprob_scaling,
+				CFRStreetValues<double> *sumprobs,
+				const int *canon_hands, int num_canon_hands);
 template void
 ProcessOppProbs<int, double>(Node *node, int lbd, const CanonicalCards *hands,
-			     bool bucketed, int *street_buckets, double *opp_probs,
-			     shared_ptr<double []> *succ_opp_probs,
-			     const CFRStreetValues<int> &cs_vals, int dsi, int it,
-			     int soft_warmup, int hard_warmup, double sumprob_scaling,
-			     CFRStreetValues<double> *sumprobs);
+			     bool bucketed, const int *street_buckets, VCFR_VALUE *opp_probs,
+			     shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+			     const CFRStreetValues<int> &cs_vals, int dsi, double sumprob_weight,
+			     double sumprob_scaling, CFRStreetValues<double> *sumprobs,
+			     const int *canon_hands, int num_canon_hands);
 template void
 ProcessOppProbs<double, int>(Node *node, int lbd, const CanonicalCards *hands,
-			     bool bucketed, int *street_buckets, double *opp_probs,
-			     shared_ptr<double []> *succ_opp_probs,
+			     bool bucketed, const int *street_buckets, VCFR_VALUE *opp_probs,
+			     shared_ptr<VCFR_VALUE []> *succ_opp_probs,
 			     const CFRStreetValues<double> &cs_vals, int dsi,
-			     int it, int soft_warmup, int hard_warmup,
-			     double sumprob_scaling,
-			     CFRStreetValues<int> *sumprobs);
+			     double sumprob_weight, double sumprob_scaling,
+			     CFRStreetValues<int> *sumprobs,
+			     const int *canon_hands, int num_canon_hands);
 template void
 ProcessOppProbs<unsigned char, int>(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
-				    int *street_buckets, double *opp_probs,
-				    shared_ptr<double []> *succ_opp_probs,
-				    const CFRStreetValues<unsigned char> &cs_vals, int dsi, int it,
-				    int soft_warmup, int hard_warmup, double sumprob_scaling,
-				    CFRStreetValues<int> *sumprobs);
+				    const int *street_buckets, VCFR_VALUE *opp_probs,
+				    shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+				    const CFRStreetValues<unsigned char> &cs_vals, int dsi,
+				    double sumprob_weight, double sumprob_scaling,
+				    CFRStreetValues<int> *sumprobs,
+				    const int *canon_hands, int num_canon_hands);
 
 #if 0
 // Abstracted, integer regrets
@@ -710,7 +726,8 @@ void DeleteOldFiles(const CardAbstraction &ca, const string &betting_abstraction
       string filename(full_path, j + 1, full_path_len - (j + 1));
       vector<string> comps;
       Split(filename.c_str(), '.', false, &comps);
-      if (comps.size() != 8) {
+      // Delta checkpoints add a component (e.g., ".manifest")
+      if (comps.size() < 8) {
 	fprintf(stderr, "File \"%s\" has wrong number of components\n",
 		full_path.c_str());
 	exit(-1);
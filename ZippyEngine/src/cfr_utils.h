@@ -4,6 +4,8 @@
 #include <memory>
 #include <string>
 
+#include "cfr_value_type.h"
+
 template<typename T> class CFRStreetValues;
 class CanonicalCards;
 class CardAbstraction;
@@ -12,29 +14,52 @@ class Node;
 
 /*Calculates playing strategy as variable probs by using regret matching -Brian*/
 template <typename T> void RMProbs(const T *vals, int num_succs, int dsi, double *probs);
+/* In ComputeOurValsBucketed(), ComputeOurVals() and ProcessOppProbs(), canon_hands may list the
+   hands to process, num_canon_hands of them; the entries of the other hands are left alone.  If
+   canon_hands is null, every hand is processed and num_canon_hands is the number of hands.
+   When ProcessOppProbs() updates bucketed sumprobs, pass null so that each hand adds its own
+   increment. */
 template <typename T> void ComputeOurValsBucketed(const T *all_cs_vals, int num_hole_card_pairs,
 						  int num_succs, int dsi,
-						  std::shared_ptr<double []> *succ_vals,
-						  int *street_buckets,
-						  std::shared_ptr<double []> vals);
+						  std::shared_ptr<VCFR_VALUE []> *succ_vals,
+						  const int *street_buckets,
+						  std::shared_ptr<VCFR_VALUE []> vals,
+						  const int *canon_hands, int num_canon_hands);
 /*Calculates ev for each hand
   ev = summation of (ev of taking an action * how often we take that action) for all actions -Brian*/
 template <typename T> void ComputeOurVals(const T *all_cs_vals, int num_hole_card_pairs,
 					  int num_succs, int dsi,
-					  std::shared_ptr<double []> *succ_vals, int lbd,
-					  std::shared_ptr<double []> vals);
+					  std::shared_ptr<VCFR_VALUE []> *succ_vals, int lbd,
+					  std::shared_ptr<VCFR_VALUE []> vals,
+					  const int *canon_hands, int num_canon_hands);
 template <typename T> void SetCurrentAbstractedStrategy(const T *all_regrets, int num_buckets,
 							int num_succs, int dsi,
 							double *all_cs_probs);
+/* In Showdown(), Fold(), CommonBetResponseCalcs() and ProcessOppProbs() the opponent reach
+   probabilities are indexed like hands; i.e., by the hand's position on the current board in
+   HandTree order, not by hole card encoding. */
 /*Calculates ev of each hand at showdown -Brian*/
-std::shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
-				    double sum_opp_probs, double *total_card_probs);
+std::shared_ptr<VCFR_VALUE []> Showdown(Node *node, const CanonicalCards *hands,
+					VCFR_VALUE *opp_probs, double sum_opp_probs,
+					double *total_card_probs);
 /* Calculates ev of each hand when someone folds -Brian*/
-std::shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, double *opp_probs,
-				double sum_opp_probs, double *total_card_probs);
+std::shared_ptr<VCFR_VALUE []> Fold(Node *node, int p, const CanonicalCards *hands,
+				    VCFR_VALUE *opp_probs, double sum_opp_probs,
+				    double *total_card_probs);
 /* updates opp reach sum and card reach sum (see Fold function for information on card reach) after they take an action -Brian*/
-void CommonBetResponseCalcs(int st, const CanonicalCards *hands, double *opp_probs,
+void CommonBetResponseCalcs(int st, const CanonicalCards *hands, VCFR_VALUE *opp_probs,
 			    double *sum_opp_probs, double *total_card_probs);
+/* Converts reach probabilities indexed by hole card encoding (hi * (max_card + 1) + lo), as
+   ReachProbs keeps them, into reach probabilities indexed like hands. */
+std::shared_ptr<VCFR_VALUE []> DenseOppProbs(const CanonicalCards *hands,
+					     const double *enc_probs);
+/* Values computed by a traversal are handed back to callers outside of it as doubles.  Free
+   unless the traversal runs in single precision. */
+std::shared_ptr<double []> WideVals(const std::shared_ptr<double []> &vals, int num);
+std::shared_ptr<double []> WideVals(const std::shared_ptr<float []> &vals, int num);
+/* Weight of iteration it's current strategy in the sumprobs.  gamma is the DCFR sumprob exponent;
+   zero gives the traditional warmup-based weighting. */
+double SumprobWeight(int it, int soft_warmup, int hard_warmup, double gamma);
 template <typename T>
 /*For all possible hands-
   Calculates opponents strategy with reget matching
@@ -42,17 +67,17 @@ template <typename T>
    to update villains strategysum at this node and update 
   their reach probability for each successor node based on their current strategy for this node -Brian
 */
-void ProcessOppProbs(Node *node, const CanonicalCards *hands, int *street_buckets,
-		     double *opp_probs, std::shared_ptr<double []> *succ_opp_probs,
-		     double *current_probs, int it, int soft_warmup, int hard_warmup,
-		     double sumprob_scaling, CFRStreetValues<T> *sumprobs);
+void ProcessOppProbs(Node *node, const CanonicalCards *hands, const int *street_buckets,
+		     VCFR_VALUE *opp_probs, std::shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+		     double *current_probs, double sumprob_weight, double sumprob_scaling,
+		     CFRStreetValues<T> *sumprobs, const int *canon_hands, int num_canon_hands);
 template <typename T1, typename T2>
 void ProcessOppProbs(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
-		     int *street_buckets, double *opp_probs,
-		     std::shared_ptr<double []> *succ_opp_probs,
-		     const CFRStreetValues<T1> &cs_vals, int dsi, int it, int soft_warmup,
-		     int hard_warmup, double sumprob_scaling,
-		     CFRStreetValues<T2> *sumprobs);
+		     const int *street_buckets, VCFR_VALUE *opp_probs,
+		     std::shared_ptr<VCFR_VALUE []> *succ_opp_probs,
+		     const CFRStreetValues<T1> &cs_vals, int dsi, double sumprob_weight,
+		     double sumprob_scaling, CFRStreetValues<T2> *sumprobs,
+		     const int *canon_hands, int num_canon_hands);
 /*
     I think every iteration is saved in the cfr folder. This function is for deleting the old files,
      as we're just interested in the last iteration. -Brian
@@ -8,4 +8,15 @@ enum class CFRValueType {
   CFR_DOUBLE
 };
 
+// The type of the per-hand vectors that a VCFR traversal passes between nodes: hand values and
+// opponent reach probabilities.  Build with -DVCFR_FLOAT to use single precision, which halves
+// the memory traffic of the traversal and doubles the width of the vectorized loops.  Regrets,
+// sumprobs and the current strategy keep their own types, and the updates to them, like the
+// sums over the opponent's reach probabilities, are done in double precision either way.
+#ifdef VCFR_FLOAT
+#define VCFR_VALUE float
+#else
+#define VCFR_VALUE double
+#endif
+
 #endif
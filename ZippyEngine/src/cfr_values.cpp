@@ -11,6 +11,7 @@
 #include "cfr_street_values.h"
 #include "cfr_value_type.h"
 #include "cfr_values.h"
+#include "delta_io.h"
 #include "game.h"
 #include "io.h"
 #include "nonterminal_ids.h"
@@ -18,10 +19,43 @@
 using std::string;
 using std::unique_ptr;
 
+static int ValueSize(CFRValueType value_type) {
+  if (value_type == CFRValueType::CFR_CHAR)        return sizeof(unsigned char);
+  else if (value_type == CFRValueType::CFR_SHORT)  return sizeof(unsigned short);
+  else if (value_type == CFRValueType::CFR_INT)    return sizeof(int);
+  else if (value_type == CFRValueType::CFR_DOUBLE) return sizeof(double);
+  fprintf(stderr, "ValueSize(): unexpected value type %i\n", (int)value_type);
+  exit(-1);
+}
+
+// Computes the byte offset within the values file of each of player p's nonterminals on street st.
+// Mirrors the order in which Write() lays out the file, including the skipping of reentrant nodes.
+// offsets must be initialized to -1.  Nodes with one succ get an offset, but take up no space.
+static void ComputeNodeOffsets(Node *node, int p, int st, long long int num_holdings,
+			       int value_size, long long int *offsets, long long int *pos) {
+  if (node->Terminal()) return;
+  int nst = node->Street();
+  if (nst > st) return;
+  int num_succs = node->NumSuccs();
+  if (nst == st && node->PlayerActing() == p) {
+    int nt = node->NonterminalID();
+    // Reentrant node; we have already seen all of its descendants.
+    if (offsets[nt] != -1) return;
+    offsets[nt] = *pos;
+    if (num_succs > 1) *pos += num_holdings * num_succs * value_size;
+  }
+  for (int s = 0; s < num_succs; ++s) {
+    ComputeNodeOffsets(node->IthSucc(s), p, st, num_holdings, value_size, offsets, pos);
+  }
+}
+
 void CFRValues::Initialize(const bool *players, const bool *streets, int root_bd, int root_bd_st,
 			   const Buckets &buckets) {
   root_bd_ = root_bd;
   root_bd_st_ = root_bd_st;
+  direct_io_ = false;
+  delta_ = false;
+  delta_base_it_ = -1;
   int num_players = Game::NumPlayers();
   players_.reset(new bool[num_players]);
   for (int p = 0; p < num_players; ++p) {
@@ -97,6 +131,9 @@ CFRValues::CFRValues(const bool *players, const bool *streets, int root_bd, int
 CFRValues::CFRValues(const CFRValues &p0_values, const CFRValues &p1_values) {
   root_bd_st_ = p0_values.RootSt();
   root_bd_ = p0_values.RootBd();
+  direct_io_ = false;
+  delta_ = false;
+  delta_base_it_ = -1;
   int num_players = Game::NumPlayers();
   players_.reset(new bool[num_players]);
   for (int p = 0; p < num_players; ++p) {
@@ -274,9 +311,10 @@ void CFRValues::Read(Node *node, Reader ***readers, void ***decompressors, int p
 
 Reader *CFRValues::InitializeReader(const char *dir, int p, int st, int it,
 				    const string &action_sequence, int root_bd_st, int root_bd,
-				    bool sumprobs, CFRValueType *value_type) {
+				    bool sumprobs, bool sequential, CFRValueType *value_type) {
   char buf[500];
 
+  bool delta = false;
   int t;
   for (t = 0; t < 4; ++t) {
     unsigned char suffix;
@@ -296,13 +334,22 @@ Reader *CFRValues::InitializeReader(const char *dir, int p, int st, int it,
     sprintf(buf, "%s/%s.%s.%u.%u.%u.%u.p%u.%c", dir, sumprobs ? "sumprobs" : "regrets",
 	    action_sequence.c_str(), root_bd_st, root_bd, st, it, p, suffix);
     if (FileExists(buf)) break;
+    if (DeltaCheckpointExists(buf)) {
+      delta = true;
+      break;
+    }
   }
   if (t == 4) {
     fprintf(stderr, "Couldn't find file\n");
     fprintf(stderr, "buf: %s\n", buf);
     exit(-1);
   }
-  Reader *reader = new Reader(buf);
+  // Sequential reads stream through the whole file, so read ahead in big chunks.  Random access
+  // reads only want a little at each offset.
+  Reader *reader;
+  if (delta)           reader = new DeltaReader(buf);
+  else if (sequential) reader = new AsyncReader(buf, kAsyncBufSize, direct_io_);
+  else                 reader = new Reader(buf);
   return reader;
 }
 
@@ -330,7 +377,7 @@ void CFRValues::Read(const char *dir, int it, const BettingTree *betting_tree,
       }
       CFRValueType value_type;
       readers[p][st] = InitializeReader(dir, p, st, it, action_sequence, root_bd_st_, root_bd_,
-					sumprobs, &value_type);
+					sumprobs, true, &value_type);
       if (street_values_[st] == nullptr) {
 	CreateStreetValues(st, value_type, quantize);
       }
@@ -392,7 +439,7 @@ void CFRValues::ReadAsymmetric(const char *dir, int it, const BettingTrees &bett
       }
       CFRValueType value_type;
       readers[p][st] = InitializeReader(asym_dir, p, st, it, action_sequence, root_bd_st_, root_bd_,
-					sumprobs, &value_type);
+					sumprobs, true, &value_type);
       if (street_values_[st] == nullptr) {
 	CreateStreetValues(st, value_type, quantize);
       }
@@ -502,7 +549,15 @@ Writer ***CFRValues::InitializeWriters(const char *dir, int it, const string &ac
       sprintf(buf, "%s/%s.%s.%u.%u.%u.%u.p%u.%c", dir,
 	      sumprobs ? "sumprobs" : "regrets", action_sequence.c_str(),
 	      root_bd_st_, root_bd_, st, it, p, suffix);
-      writers[p][st] = new Writer(buf);
+      if (delta_) {
+	char base_buf[500];
+	sprintf(base_buf, "%s/%s.%s.%u.%u.%u.%u.p%u.%c", dir,
+		sumprobs ? "sumprobs" : "regrets", action_sequence.c_str(),
+		root_bd_st_, root_bd_, st, delta_base_it_, p, suffix);
+	writers[p][st] = new DeltaWriter(buf, delta_base_it_ >= 0 ? base_buf : nullptr);
+      } else {
+	writers[p][st] = new AsyncWriter(buf, kAsyncBufSize, direct_io_);
+      }
       (*compressors)[p][st] = nullptr;
     }
   }
@@ -541,6 +596,88 @@ void CFRValues::Write(const char *dir, int it, Node *root, const string &action_
   delete [] seen;
 }
 
+void CFRValues::ReadSubtree(Node *base_node, Node *subtree_node, int p, int st, Reader *reader,
+			    const long long int *offsets, int value_size, bool bucketed) {
+  if (base_node->Terminal()) return;
+  int nst = base_node->Street();
+  if (nst > st) return;
+  int num_succs = base_node->NumSuccs();
+  if (subtree_node->NumSuccs() != num_succs) {
+    fprintf(stderr, "CFRValues::ReadSubtree(): subtree doesn't match base tree\n");
+    exit(-1);
+  }
+  if (nst == st && base_node->PlayerActing() == p && num_succs > 1) {
+    long long int offset = offsets[base_node->NonterminalID()];
+    if (offset == -1) {
+      fprintf(stderr, "CFRValues::ReadSubtree(): no offset for p %i st %i nt %i\n", p, st,
+	      base_node->NonterminalID());
+      exit(-1);
+    }
+    if (bucketed) {
+      reader->SeekTo(offset);
+      street_values_[st]->ReadNode(subtree_node, reader, nullptr);
+    } else {
+      // Our local boards are a contiguous range of global boards, so one seek suffices.
+      int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+      int first_gbd = BoardTree::GlobalIndex(root_bd_st_, root_bd_, st, 0);
+      int num_local_boards = BoardTree::NumLocalBoards(root_bd_st_, root_bd_, st);
+      reader->SeekTo(offset + ((long long int)first_gbd) * num_hole_card_pairs * num_succs *
+		     value_size);
+      for (int lbd = 0; lbd < num_local_boards; ++lbd) {
+	street_values_[st]->ReadBoardValuesForNode(subtree_node, reader, nullptr, lbd,
+						   num_hole_card_pairs);
+      }
+    }
+  }
+  for (int s = 0; s < num_succs; ++s) {
+    ReadSubtree(base_node->IthSucc(s), subtree_node->IthSucc(s), p, st, reader, offsets,
+		value_size, bucketed);
+  }
+}
+
+void CFRValues::ReadSubtree(const char *dir, int it, Node *full_root, Node *base_node,
+			    Node *subtree_root, const string &action_sequence,
+			    const Buckets &buckets, int only_p, bool sumprobs) {
+  int num_players = Game::NumPlayers();
+  int max_street = Game::MaxStreet();
+  int full_root_st = full_root->Street();
+  // The files we read from are for the full tree, so they are rooted at board 0 of the full
+  // root's street.
+  int full_root_bd = 0;
+  unique_ptr<int []> num_nonterminals(new int[num_players * (max_street + 1)]);
+  CountNumNonterminals(full_root, num_nonterminals.get());
+  for (int p = 0; p < num_players; ++p) {
+    if (only_p != -1 && p != only_p) continue;
+    if (! players_[p]) continue;
+    for (int st = base_node->Street(); st <= max_street; ++st) {
+      if (! streets_[st]) continue;
+      CFRValueType value_type;
+      unique_ptr<Reader> reader(InitializeReader(dir, p, st, it, action_sequence, full_root_st,
+						 full_root_bd, sumprobs, false, &value_type));
+      if (street_values_[st] == nullptr) {
+	CreateStreetValues(st, value_type, false);
+      }
+      int value_size = ValueSize(value_type);
+      bool bucketed = ! buckets.None(st);
+      int num_nt = num_nonterminals[p * (max_street + 1) + st];
+      unique_ptr<long long int []> offsets(new long long int[num_nt]);
+      long long int num_full_holdings;
+      if (bucketed) {
+	num_full_holdings = buckets.NumBuckets(st);
+      } else {
+	num_full_holdings = ((long long int)BoardTree::NumLocalBoards(full_root_st, full_root_bd,
+								      st)) *
+	  Game::NumHoleCardPairs(st);
+      }
+      for (int i = 0; i < num_nt; ++i) offsets[i] = -1;
+      long long int pos = 0;
+      ComputeNodeOffsets(full_root, p, st, num_full_holdings, value_size, offsets.get(), &pos);
+      ReadSubtree(base_node, subtree_root, p, st, reader.get(), offsets.get(), value_size,
+		  bucketed);
+    }
+  }
+}
+
 void CFRValues::MergeInto(Node *full_node, Node *subgame_node, int root_bd_st, int root_bd,
 			  const CFRValues &subgame_values, const Buckets &buckets,
 			  int final_st) {
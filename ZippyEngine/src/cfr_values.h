@@ -32,6 +32,12 @@ class CFRValues {
   void ReadAsymmetric(const char *dir, int it, const BettingTrees &betting_trees,
 		      const std::string &action_sequence, int only_p, bool sumprobs,
 		      bool quantize);
+  // Reads the values for the subtree rooted at subtree_root, which mirrors the part of the full
+  // tree (rooted at full_root) below base_node.  Only the boards below our root board are read.
+  // The offset of each node's values within the files is computed by walking the full tree.
+  void ReadSubtree(const char *dir, int it, Node *full_root, Node *base_node, Node *subtree_root,
+		   const std::string &action_sequence, const Buckets &buckets, int only_p,
+		   bool sumprobs);
   void Write(const char *dir, int it, Node *root, const std::string &action_sequence, int only_p,
 	     bool sumprobs) const;
   // Note: doesn't handle nodes with one succ
@@ -63,11 +69,22 @@ class CFRValues {
   int NumHoldings(int st) const {return num_holdings_[st];}
   int RootSt(void) const {return root_bd_st_;}
   int RootBd(void) const {return root_bd_;}
+  // Read() and Write() will bypass the page cache
+  void SetDirectIO(bool direct_io) {direct_io_ = direct_io;}
+  // If delta is true, Write() writes delta checkpoints (see delta_io.h) that only contain what
+  // changed since the checkpoint for iteration base_it.  base_it may be -1 if there is no prior
+  // checkpoint.  Read() handles full and delta checkpoints alike.
+  void SetDeltaCheckpoints(bool delta, int base_it) {
+    delta_ = delta;
+    delta_base_it_ = base_it;
+  }
  protected:
   void Read(Node *node, Reader ***readers, void ***decompressors, int p);
   Reader *InitializeReader(const char *dir, int p, int st, int it,
 			   const std::string &action_sequence, int root_bd_st, int root_bd,
-			   bool sumprobs, CFRValueType *value_type);
+			   bool sumprobs, bool sequential, CFRValueType *value_type);
+  void ReadSubtree(Node *base_node, Node *subtree_node, int p, int st, Reader *reader,
+		   const long long int *offsets, int value_size, bool bucketed);
   void Write(Node *node, Writer ***writers, void ***compressors, bool ***seen) const;
   Writer ***InitializeWriters(const char *dir, int it, const std::string &action_sequence,
 			      int only_p, bool sumprobs, void ****compressors) const;
@@ -81,6 +98,9 @@ class CFRValues {
   std::unique_ptr<bool []> streets_;
   int root_bd_;
   int root_bd_st_;
+  bool direct_io_;
+  bool delta_;
+  int delta_base_it_;
   std::unique_ptr<int []> num_holdings_;
   std::unique_ptr<int []> num_nonterminals_;
 };
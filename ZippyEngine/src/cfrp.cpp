@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <memory>
@@ -35,8 +36,10 @@
 #include "files.h"
 #include "game.h"
 #include "hand_tree.h"
+#include "hand_tree_buckets.h"
 #include "hand_value_tree.h"
 #include "io.h"
+#include "nonterminal_ids.h"
 #include "split.h"
 #include "vcfr_state.h"
 
@@ -44,6 +47,11 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 
+// The smallest DCFR regret scales we allow before folding them into the stored regrets.  Stored
+// regrets grow by the inverse of the scale, so int regrets get a larger minimum.
+static const double kMinDoubleRegretScale = 1e-6;
+static const double kMinIntRegretScale = 1.0 / 64;
+
 // Called from run_cfrp
 void CFRP::Initialize(const BettingAbstraction &ba, int target_p) {
   asymmetric_ = ba.Asymmetric();
@@ -82,6 +90,9 @@ void CFRP::Initialize(const BettingAbstraction &ba, int target_p) {
     sumprobs_.reset(new CFRValues(nullptr, streets.get(), 0, 0, buckets_,
 				  betting_trees_->GetBettingTree()));
   }
+  regrets_->SetDirectIO(cfr_config_.DirectIO());
+  sumprobs_->SetDirectIO(cfr_config_.DirectIO());
+  last_checkpoint_it_ = -1;
 
   unique_ptr<bool []> bucketed_streets(new bool[max_street + 1]);
   bucketed_ = false;
@@ -263,6 +274,69 @@ void CFRP::FloorRegrets(Node *node, int p) {
   }
 }
 
+// Scaling is not idempotent, so in a reentrant tree we must visit each nonterminal only once.
+// As in CFRValues::Write(), once we have seen a node we have also seen all its descendants.
+void CFRP::NormalizeRegrets(Node *node, bool ***seen) {
+  if (node->Terminal()) return;
+  int st = node->Street();
+  int pa = node->PlayerActing();
+  int nt = node->NonterminalID();
+  if (seen[st][pa][nt]) return;
+  seen[st][pa][nt] = true;
+  int num_succs = node->NumSuccs();
+  if (num_succs > 1) {
+    AbstractCFRStreetValues *street_values = regrets_->StreetValues(st);
+    if (street_values && street_values->Players(pa)) {
+      street_values->ScaleSigned(pa, nt, num_succs, pos_regret_scale_, neg_regret_scale_);
+    }
+  }
+  for (int s = 0; s < num_succs; ++s) {
+    NormalizeRegrets(node->IthSucc(s), seen);
+  }
+}
+
+// Folds the DCFR scales into the stored regrets, so that they hold the true regrets again.
+void CFRP::NormalizeRegrets(void) {
+  if (pos_regret_scale_ == 1.0 && neg_regret_scale_ == 1.0) return;
+  int max_street = Game::MaxStreet();
+  int num_players = Game::NumPlayers();
+  Node *root = betting_trees_->Root();
+  unique_ptr<int []> num_nonterminals(new int[num_players * (max_street + 1)]);
+  CountNumNonterminals(root, num_nonterminals.get());
+  bool ***seen = new bool **[max_street + 1];
+  for (int st = 0; st <= max_street; ++st) {
+    seen[st] = new bool *[num_players];
+    for (int p = 0; p < num_players; ++p) {
+      int num_nt = num_nonterminals[p * (max_street + 1) + st];
+      seen[st][p] = new bool[num_nt];
+      for (int i = 0; i < num_nt; ++i) seen[st][p][i] = false;
+    }
+  }
+  NormalizeRegrets(root, seen);
+  for (int st = 0; st <= max_street; ++st) {
+    for (int p = 0; p < num_players; ++p) {
+      delete [] seen[st][p];
+    }
+    delete [] seen[st];
+  }
+  delete [] seen;
+  pos_regret_scale_ = 1.0;
+  neg_regret_scale_ = 1.0;
+}
+
+// Applies the DCFR discount for the end of iteration it.  t^a/(t^a+1) is computed as
+// 1/(1+t^-a) so that a very large alpha or beta works.  We only adjust the scales (see
+// VCFR::UpdateDiscountedRegrets()) until one of them gets small enough that the stored regrets
+// might lose precision (doubles) or overflow (ints).
+void CFRP::DiscountRegrets(int it) {
+  pos_regret_scale_ *= 1.0 / (1.0 + pow(it, -regret_alpha_));
+  neg_regret_scale_ *= 1.0 / (1.0 + pow(it, -regret_beta_));
+  double min_scale = cfr_config_.DoubleRegrets() ? kMinDoubleRegretScale : kMinIntRegretScale;
+  if (pos_regret_scale_ < min_scale || neg_regret_scale_ < min_scale) {
+    NormalizeRegrets();
+  }
+}
+
 // Do trunk in main thread
 void CFRP::HalfIteration(int p) {
   fprintf(stderr, "P%u half iteration\n", p);
@@ -330,8 +404,15 @@ void CFRP::Checkpoint(int it) {
     strcat(dir, buf);
   }
   Mkdir(dir);
+  // The files hold the true regrets
+  NormalizeRegrets();
+  if (cfr_config_.DeltaCheckpoints()) {
+    regrets_->SetDeltaCheckpoints(true, last_checkpoint_it_);
+    sumprobs_->SetDeltaCheckpoints(true, last_checkpoint_it_);
+  }
   regrets_->Write(dir, it, betting_trees_->Root(), "x", -1, false);
   sumprobs_->Write(dir, it, betting_trees_->Root(), "x", -1, true);
+  last_checkpoint_it_ = it;
 }
 
 void CFRP::ReadFromCheckpoint(int it) {
@@ -388,10 +469,47 @@ void CFRP::Run(int start_it, int end_it) {
     prune_ = false;
   }
   
+  // With regret pruning, every pruning_interval-th iteration (starting with the first) is a full
+  // pass.  We report the node visits and time of the others relative to the last full pass.
+  int pruning_interval = cfr_config_.RegretPruningInterval();
+  collect_stats_ = cfr_config_.TraversalStats() || pruning_interval > 0;
+  long long int full_visits = 0;
+  double full_secs = 0;
   for (it_ = start_it; it_ <= end_it; ++it_) {
     fprintf(stderr, "It %u\n", it_);
+    regret_pruning_ = pruning_interval > 0 && (it_ - 1) % pruning_interval != 0;
+    stats_.Clear();
+    struct timespec start, finish;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     HalfIteration(1);
     HalfIteration(0);
+    if (discounted_) DiscountRegrets(it_);
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    double secs = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9;
+    if (! collect_stats_) continue;
+    if (hand_tree_buckets_ && hand_tree_buckets_->NumBoards() > 0) {
+      // What the lookups would have cost at the rate at which the cache was built
+      double saved = stats_.num_bucket_lookups * hand_tree_buckets_->BuildSecs() /
+	hand_tree_buckets_->NumBoards();
+      fprintf(stderr, "It %u: buckets of %lli boards from cache, about %.4f secs saved (cache "
+	      "built in %.4f secs)\n", it_, stats_.num_bucket_lookups, saved,
+	      hand_tree_buckets_->BuildSecs());
+    }
+    if (pruning_interval == 0) continue;
+    if (! regret_pruning_) {
+      full_visits = stats_.num_node_visits;
+      full_secs = secs;
+      fprintf(stderr, "It %u full pass: %lli node visits, %.3f secs\n", it_,
+	      stats_.num_node_visits, secs);
+    } else if (full_visits > 0) {
+      fprintf(stderr, "It %u pruned %lli succs: %lli node visits (%.1f%% saved), %.3f secs "
+	      "(%.1f%% saved)\n", it_, stats_.num_pruned_succs, stats_.num_node_visits,
+	      100.0 * (full_visits - stats_.num_node_visits) / full_visits, secs,
+	      100.0 * (full_secs - secs) / full_secs);
+    } else {
+      fprintf(stderr, "It %u pruned %lli succs: %lli node visits, %.3f secs\n", it_,
+	      stats_.num_pruned_succs, stats_.num_node_visits, secs);
+    }
   }
 
   Checkpoint(end_it);
@@ -34,6 +34,9 @@ public:
 		    const std::shared_ptr<double []> &opp_probs);
 #endif
   void FloorRegrets(Node *node, int p);
+  void NormalizeRegrets(Node *node, bool ***seen);
+  void NormalizeRegrets(void);
+  void DiscountRegrets(int it);
   void HalfIteration(int p);
   void Checkpoint(int it);
   void ReadFromCheckpoint(int it);
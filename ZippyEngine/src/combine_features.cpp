@@ -6,6 +6,7 @@
 #include "board_tree.h"
 #include "cards.h"
 #include "constants.h"
+#include "feature_store.h"
 #include "files.h"
 #include "game.h"
 #include "game_params.h"
@@ -36,7 +37,7 @@ static int **BuildPredBoards(int st) {
   return pred_boards;
 }
 
-static void Go(int st, short **vals, int *num_features, Writer *writer, double multiplier) {
+static void Go(int st, FeatureFile **files, Writer *writer, double multiplier) {
   int max_street = Game::MaxStreet();
   Card cards[7];
   int num_boards = BoardTree::NumBoards(st);
@@ -60,7 +61,7 @@ static void Go(int st, short **vals, int *num_features, Writer *writer, double m
 	if (InCards(lo, cards + 2, num_board_cards)) continue;
 	cards[1] = lo;
 	for (int pst = 0; pst <= st; ++pst) {
-	  if (vals[pst] == NULL) continue;
+	  if (files[pst] == nullptr) continue;
 	  unsigned int ph;
 	  if (pst < st) {
 	    int pbd;
@@ -75,9 +76,10 @@ static void Go(int st, short **vals, int *num_features, Writer *writer, double m
 	  } else {
 	    ph = h;
 	  }
-	  int num_f = num_features[pst];
+	  int num_f = files[pst]->NumFeatures();
+	  const short *vals = files[pst]->Vals(ph);
 	  for (int f = 0; f < num_f; ++f) {
-	    int v = vals[pst][ph * num_f + f];
+	    int v = vals[f];
 	    if (pst == max_street) {
 	      v *= multiplier;
 	      if (v > kMaxShort || v < kMinShort) {
@@ -130,9 +132,10 @@ int main(int argc, char *argv[]) {
   BoardTree::Create();
   BoardTree::BuildPredBoards();
 
+  // The files are mapped rather than read, so only the parts we touch are paged in, and the
+  // preceding streets' features are shared with any other process reading them.
   int num_combined_features = 0;
-  int *num_features = new int[street + 1];
-  short **vals = new short *[street + 1];
+  FeatureFile **files = new FeatureFile *[street + 1];
   for (int st = 0; st <= street; ++st) {
     string features;
     if (st == 0)      features = preflop_features;
@@ -140,25 +143,11 @@ int main(int argc, char *argv[]) {
     else if (st == 2) features = turn_features;
     else              features = river_features;
     if (features == "null") {
-      num_features[st] = 0;
-      vals[st] = NULL;
+      files[st] = nullptr;
       continue;
     }
-    char buf[500];
-    sprintf(buf, "%s/features.%s.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
-	    Game::NumRanks(), features.c_str(), st);
-    Reader reader(buf);
-    int num_f = reader.ReadIntOrDie();
-    num_features[st] = num_f;
-    num_combined_features += num_f;
-    unsigned int num_boards = BoardTree::NumBoards(st);
-    unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-    unsigned int num_hands = num_boards * num_hole_card_pairs;
-    unsigned int num_vals = num_hands * num_f;
-    vals[st] = new short[num_vals];
-    for (unsigned int i = 0; i < num_vals; ++i) {
-      vals[st][i] = reader.ReadShortOrDie();
-    }
+    files[st] = new FeatureFile(features, st);
+    num_combined_features += files[st]->NumFeatures();
   }
   char buf[500];
   sprintf(buf, "%s/features.%s.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
@@ -166,10 +155,10 @@ int main(int argc, char *argv[]) {
   Writer writer(buf);
   writer.WriteInt(num_combined_features);
 
-  Go(street, vals, num_features, &writer, multiplier);
+  Go(street, files, &writer, multiplier);
 
   for (int st = 0; st <= street; ++st) {
-    delete [] vals[st];
+    delete files[st];
   }
-  delete [] vals;
+  delete [] files;
 }
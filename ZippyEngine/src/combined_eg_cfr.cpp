@@ -200,9 +200,11 @@ void CombinedEGCFR::SolveSubgame(BettingTrees *subtrees, int solve_bd,
   int num_players = Game::NumPlayers();
   int max_street = Game::MaxStreet();
   
+  // Nothing to store past the depth limit, if any
+  int leaf_st = LeafStreet(subtree_st);
   unique_ptr<bool []> subtree_streets(new bool[max_street + 1]);
   for (int st = 0; st <= max_street; ++st) {
-    subtree_streets[st] = st >= subtree_st;
+    subtree_streets[st] = st >= subtree_st && st < leaf_st;
   }
   regrets_.reset(new CFRValues(nullptr, subtree_streets.get(), solve_bd, subtree_st, buckets_,
 			       subtrees->GetBettingTree()));
@@ -225,11 +227,14 @@ void CombinedEGCFR::SolveSubgame(BettingTrees *subtrees, int solve_bd,
     combined_regrets_[i * 2 + 1] = 0;
   }
   
+  PrepareSubgame(subtrees, solve_bd, reach_probs, hand_tree);
+
   for (it_ = 1; it_ <= num_its; ++it_) {
     // Go from high to low to mimic slumbot2017 code
     for (int p = (int)num_players - 1; p >= 0; --p) {
       HalfIteration(subtrees, target_p, p, reach_probs, hand_tree, action_sequence, opp_cvs);
     }
+    if (Converged(subtrees->Root())) break;
   }
 }
 
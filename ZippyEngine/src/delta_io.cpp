@@ -0,0 +1,327 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "delta_io.h"
+#include "fast_hash.h"
+#include "io.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+static const unsigned int kDeltaManifestMagic = 0x544c445a;
+static const int kDeltaManifestVersion = 1;
+
+// The hash only rules blocks out quickly.  A block whose hash matches is still compared byte
+// for byte with the base block before we refer to it.
+static unsigned long long int HashBlock(const unsigned char *data, int len) {
+  return fasthash64((void *)data, len, 0);
+}
+
+static string ManifestName(const char *filename) {
+  return string(filename) + ".manifest";
+}
+
+static string Dirname(const char *filename) {
+  const char *slash = strrchr(filename, '/');
+  if (slash == nullptr) return ".";
+  return string(filename, slash - filename);
+}
+
+static string Basename(const string &filename) {
+  size_t slash = filename.rfind('/');
+  if (slash == string::npos) return filename;
+  return filename.substr(slash + 1);
+}
+
+bool DeltaCheckpointExists(const char *filename) {
+  return FileExists(ManifestName(filename).c_str());
+}
+
+// Returns false if there is no manifest for filename
+bool ReadDeltaManifest(const char *filename, DeltaManifest *manifest) {
+  string manifest_name = ManifestName(filename);
+  if (! FileExists(manifest_name.c_str())) return false;
+  Reader reader(manifest_name.c_str());
+  if (reader.ReadUnsignedIntOrDie() != kDeltaManifestMagic) {
+    fprintf(stderr, "%s is not a delta manifest\n", manifest_name.c_str());
+    exit(-1);
+  }
+  int version = reader.ReadIntOrDie();
+  if (version != kDeltaManifestVersion) {
+    fprintf(stderr, "%s has version %i; expected %i\n", manifest_name.c_str(), version,
+	    kDeltaManifestVersion);
+    exit(-1);
+  }
+  manifest->file_size = reader.ReadLongOrDie();
+  manifest->block_size = reader.ReadIntOrDie();
+  int num_sources = reader.ReadIntOrDie();
+  manifest->sources.resize(num_sources);
+  for (int i = 0; i < num_sources; ++i) {
+    manifest->sources[i] = reader.ReadCStringOrDie();
+  }
+  long long int num_blocks =
+    (manifest->file_size + manifest->block_size - 1) / manifest->block_size;
+  manifest->hashes.resize(num_blocks);
+  manifest->block_sources.resize(num_blocks);
+  manifest->offsets.resize(num_blocks);
+  for (long long int b = 0; b < num_blocks; ++b) {
+    manifest->hashes[b] = reader.ReadUnsignedLongOrDie();
+    manifest->block_sources[b] = reader.ReadIntOrDie();
+    manifest->offsets[b] = reader.ReadLongOrDie();
+    if (manifest->block_sources[b] < 0 || manifest->block_sources[b] >= num_sources) {
+      fprintf(stderr, "%s: bad source for block %lli\n", manifest_name.c_str(), b);
+      exit(-1);
+    }
+  }
+  if (! reader.AtEnd()) {
+    fprintf(stderr, "%s: trailing bytes\n", manifest_name.c_str());
+    exit(-1);
+  }
+  return true;
+}
+
+DeltaWriter::DeltaWriter(const char *filename, const char *base_filename) {
+  string blocks_name = string(filename) + ".blocks";
+  Init(blocks_name.c_str(), false, kDeltaBlockSize);
+  filename_ = filename;
+  // Don't leave behind a full file of the same name; readers would prefer it to our manifest.
+  UnlinkFile(filename);
+  have_base_ = base_filename && strcmp(base_filename, filename) &&
+    ReadDeltaManifest(base_filename, &base_) && base_.block_size == kDeltaBlockSize;
+  if (have_base_) {
+    base_dir_ = Dirname(base_filename);
+    base_source_map_.resize(base_.sources.size(), -1);
+    base_fds_.resize(base_.sources.size(), -1);
+    base_block_.reset(new unsigned char[kDeltaBlockSize]);
+  }
+  manifest_.file_size = 0;
+  manifest_.block_size = kDeltaBlockSize;
+  manifest_.sources.push_back(Basename(blocks_name));
+  block_.reset(new unsigned char[kDeltaBlockSize]);
+  block_len_ = 0;
+  blocks_offset_ = 0;
+  num_blocks_written_ = 0;
+}
+
+DeltaWriter::~DeltaWriter(void) {
+  Flush();
+  if (block_len_ > 0) WriteBlock();
+  WriteManifest();
+  int num_base_sources = base_fds_.size();
+  for (int i = 0; i < num_base_sources; ++i) {
+    if (base_fds_[i] != -1) close(base_fds_[i]);
+  }
+}
+
+// Moves the contents of buf_ into block_, processing each block as it fills up.  WriteNBytes()
+// may have grown buf_, so there may be more than one block's worth.
+void DeltaWriter::Flush(void) {
+  unsigned char *p = buf_.get();
+  int len = (int)(buf_ptr_ - p);
+  while (len > 0) {
+    int n = kDeltaBlockSize - block_len_;
+    if (n > len) n = len;
+    memcpy(block_.get() + block_len_, p, n);
+    block_len_ += n;
+    p += n;
+    len -= n;
+    if (block_len_ == kDeltaBlockSize) WriteBlock();
+  }
+  buf_ptr_ = buf_.get();
+}
+
+// Returns true if block_ holds the same bytes as block b of the base checkpoint.  The blocks files
+// of the base are opened as they are needed.
+bool DeltaWriter::SameAsBase(long long int b) {
+  long long int base_len = base_.file_size - b * kDeltaBlockSize;
+  if (base_len > kDeltaBlockSize) base_len = kDeltaBlockSize;
+  if (base_len != block_len_) return false;
+  int base_source = base_.block_sources[b];
+  if (base_fds_[base_source] == -1) {
+    string source = base_dir_ + "/" + base_.sources[base_source];
+    base_fds_[base_source] = open(source.c_str(), O_RDONLY, 0);
+    if (base_fds_[base_source] == -1) {
+      fprintf(stderr, "Failed to open \"%s\", errno %i\n", source.c_str(), errno);
+      exit(-1);
+    }
+  }
+  int done = 0;
+  while (done < block_len_) {
+    int ret = pread(base_fds_[base_source], base_block_.get() + done, block_len_ - done,
+		    base_.offsets[b] + done);
+    if (ret <= 0) {
+      fprintf(stderr, "pread returned %i; base block %lli, errno %i\n", ret, b, errno);
+      fprintf(stderr, "File: %s/%s\n", base_dir_.c_str(), base_.sources[base_source].c_str());
+      exit(-1);
+    }
+    done += ret;
+  }
+  return memcmp(block_.get(), base_block_.get(), block_len_) == 0;
+}
+
+void DeltaWriter::WriteBlock(void) {
+  unsigned long long int h = HashBlock(block_.get(), block_len_);
+  long long int b = manifest_.hashes.size();
+  manifest_.hashes.push_back(h);
+  if (have_base_ && b < (long long int)base_.hashes.size() && base_.hashes[b] == h &&
+      SameAsBase(b)) {
+    // Unchanged; refer to wherever the base checkpoint got the block from
+    int base_source = base_.block_sources[b];
+    if (base_source_map_[base_source] == -1) {
+      base_source_map_[base_source] = manifest_.sources.size();
+      manifest_.sources.push_back(base_.sources[base_source]);
+    }
+    manifest_.block_sources.push_back(base_source_map_[base_source]);
+    manifest_.offsets.push_back(base_.offsets[b]);
+  } else {
+    int done = 0;
+    while (done < block_len_) {
+      int written = pwrite(fd_, block_.get() + done, block_len_ - done, blocks_offset_ + done);
+      if (written < 0) {
+	fprintf(stderr, "pwrite failed: tried to write %i; errno %i\n", block_len_ - done, errno);
+	fprintf(stderr, "File: %s.blocks\n", filename_.c_str());
+	exit(-1);
+      }
+      done += written;
+    }
+    manifest_.block_sources.push_back(0);
+    manifest_.offsets.push_back(blocks_offset_);
+    blocks_offset_ += block_len_;
+    ++num_blocks_written_;
+  }
+  manifest_.file_size += block_len_;
+  block_len_ = 0;
+}
+
+// Written to a temporary file and then renamed, so that a crash part way through doesn't leave
+// a truncated manifest behind.
+void DeltaWriter::WriteManifest(void) {
+  string manifest_name = ManifestName(filename_.c_str());
+  string tmp_name = manifest_name + ".tmp";
+  {
+    Writer writer(tmp_name.c_str());
+    writer.WriteUnsignedInt(kDeltaManifestMagic);
+    writer.WriteInt(kDeltaManifestVersion);
+    writer.WriteLong(manifest_.file_size);
+    writer.WriteInt(manifest_.block_size);
+    int num_sources = manifest_.sources.size();
+    writer.WriteInt(num_sources);
+    for (int i = 0; i < num_sources; ++i) {
+      writer.WriteCString(manifest_.sources[i].c_str());
+    }
+    long long int num_blocks = manifest_.hashes.size();
+    for (long long int b = 0; b < num_blocks; ++b) {
+      writer.WriteUnsignedLong(manifest_.hashes[b]);
+      writer.WriteInt(manifest_.block_sources[b]);
+      writer.WriteLong(manifest_.offsets[b]);
+    }
+  }
+  if (rename(tmp_name.c_str(), manifest_name.c_str()) != 0) {
+    fprintf(stderr, "Couldn't rename %s; errno %i\n", tmp_name.c_str(), errno);
+    exit(-1);
+  }
+}
+
+void DeltaWriter::SeekTo(long long int offset) {
+  fprintf(stderr, "DeltaWriter::SeekTo() not supported\n");
+  exit(-1);
+}
+
+long long int DeltaWriter::Tell(void) {
+  return manifest_.file_size + block_len_ + (buf_ptr_ - buf_.get());
+}
+
+DeltaReader::DeltaReader(const char *filename) {
+  if (! ReadDeltaManifest(filename, &manifest_)) {
+    fprintf(stderr, "Couldn't find manifest for %s\n", filename);
+    exit(-1);
+  }
+  filename_ = filename;
+  string dir = Dirname(filename);
+  int num_sources = manifest_.sources.size();
+  fds_.resize(num_sources);
+  for (int i = 0; i < num_sources; ++i) {
+    string source = dir + "/" + manifest_.sources[i];
+    fds_[i] = open(source.c_str(), O_RDONLY, 0);
+    if (fds_[i] == -1) {
+      fprintf(stderr, "Failed to open \"%s\", errno %i\n", source.c_str(), errno);
+      exit(-1);
+    }
+    posix_fadvise(fds_[i], 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+  // The blocks are read with pread() on fds_
+  fd_ = -1;
+  file_size_ = manifest_.file_size;
+  remaining_ = file_size_;
+  overflow_size_ = 0;
+  byte_pos_ = 0;
+  buf_size_ = manifest_.block_size;
+  if (remaining_ < buf_size_) buf_size_ = remaining_;
+  buf_.reset(new unsigned char[buf_size_]);
+  buf_ptr_ = buf_.get();
+  end_read_ = buf_.get();
+  if (! Refresh()) {
+    fprintf(stderr, "Warning: empty file: %s\n", filename);
+  }
+}
+
+DeltaReader::~DeltaReader(void) {
+  int num_sources = fds_.size();
+  for (int i = 0; i < num_sources; ++i) {
+    close(fds_[i]);
+  }
+}
+
+void DeltaReader::SeekTo(long long int offset) {
+  remaining_ = file_size_ - offset;
+  overflow_size_ = 0;
+  byte_pos_ = offset;
+  Refresh();
+}
+
+bool DeltaReader::Refresh(void) {
+  if (remaining_ == 0 && overflow_size_ == 0) return false;
+
+  if (overflow_size_ > 0) {
+    memcpy(buf_.get(), overflow_, overflow_size_);
+  }
+  buf_ptr_ = buf_.get();
+  unsigned char *read_into = buf_.get() + overflow_size_;
+  int to_read = buf_size_ - overflow_size_;
+  if (to_read > remaining_) to_read = remaining_;
+
+  // The bytes wanted may straddle blocks that live in different blocks files
+  long long int pos = file_size_ - remaining_;
+  int block_size = manifest_.block_size;
+  int done = 0;
+  while (done < to_read) {
+    long long int b = pos / block_size;
+    int within = pos % block_size;
+    int n = block_size - within;
+    if (n > to_read - done) n = to_read - done;
+    int ret = pread(fds_[manifest_.block_sources[b]], read_into + done, n,
+		    manifest_.offsets[b] + within);
+    if (ret <= 0) {
+      fprintf(stderr, "pread returned %i; block %lli, errno %i\n", ret, b, errno);
+      fprintf(stderr, "File: %s\n", filename_.c_str());
+      exit(-1);
+    }
+    done += ret;
+    pos += ret;
+  }
+
+  remaining_ -= to_read;
+  end_read_ = read_into + to_read;
+  overflow_size_ = 0;
+
+  return true;
+}
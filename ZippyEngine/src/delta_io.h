@@ -0,0 +1,90 @@
+#ifndef _DELTA_IO_H_
+#define _DELTA_IO_H_
+
+#include <string>
+#include <vector>
+
+#include "io.h"
+
+// Delta checkpoints.  Between nearby checkpoints of a long CFR run, large parts of the values
+// files don't change.  A values file written as a delta checkpoint is split into fixed-size
+// blocks.  Only the blocks that differ from the same block of the previous checkpoint are
+// written; the others refer back to the data written by an earlier checkpoint.  Each block is
+// hashed so that most changed blocks can be told apart without reading the previous checkpoint;
+// blocks whose hashes match are compared byte for byte.
+//
+// For a values file named F, two files are written instead of F itself:
+//   F.blocks    The blocks written by this checkpoint, one after another
+//   F.manifest  For every block of F, its hash and the location of its data (the blocks file
+//               that holds it and the offset within that file)
+// The blocks files referenced by a manifest are all in the manifest's directory.  Since a later
+// checkpoint may refer to the blocks of an earlier one, an earlier checkpoint's blocks files
+// must not be deleted (or moved) while later checkpoints are still wanted.
+
+// Size of the blocks that are compared.  A block is rewritten in full if any byte of it
+// changed, so smaller blocks save more space but make for bigger manifests.
+static const int kDeltaBlockSize = 1 << 16;
+
+struct DeltaManifest {
+  long long int file_size;
+  int block_size;
+  // Basenames of the blocks files
+  std::vector<std::string> sources;
+  // Indexed by block
+  std::vector<unsigned long long int> hashes;
+  std::vector<int> block_sources;
+  std::vector<long long int> offsets;
+};
+
+// Writes F as a delta against base_filename, the same values file for an earlier checkpoint.
+// If base_filename is nullptr or wasn't written as a delta checkpoint, every block is written.
+// Doesn't support SeekTo().
+class DeltaWriter : public Writer {
+public:
+  DeltaWriter(const char *filename, const char *base_filename);
+  ~DeltaWriter(void);
+  void Flush(void);
+  void SeekTo(long long int offset);
+  long long int Tell(void);
+  int NumBlocks(void) const {return manifest_.hashes.size();}
+  int NumBlocksWritten(void) const {return num_blocks_written_;}
+private:
+  bool SameAsBase(long long int b);
+  void WriteBlock(void);
+  void WriteManifest(void);
+
+  DeltaManifest manifest_;
+  DeltaManifest base_;
+  bool have_base_;
+  std::string base_dir_;
+  // File descriptors for the blocks files of the base manifest; -1 if not opened yet
+  std::vector<int> base_fds_;
+  std::unique_ptr<unsigned char []> base_block_;
+  // Maps sources of the base manifest to sources of our manifest; -1 if not referenced yet
+  std::vector<int> base_source_map_;
+  std::unique_ptr<unsigned char []> block_;
+  int block_len_;
+  // Offset of the next block to be written to our blocks file
+  long long int blocks_offset_;
+  int num_blocks_written_;
+};
+
+// Reads a values file written by DeltaWriter.  Supports SeekTo().
+class DeltaReader : public Reader {
+public:
+  DeltaReader(const char *filename);
+  ~DeltaReader(void);
+  void SeekTo(long long int offset);
+protected:
+  bool Refresh(void);
+private:
+  DeltaManifest manifest_;
+  std::vector<int> fds_;
+};
+
+// Returns true if filename was written as a delta checkpoint
+bool DeltaCheckpointExists(const char *filename);
+// Reads the manifest for filename.  Returns false if there is none.
+bool ReadDeltaManifest(const char *filename, DeltaManifest *manifest);
+
+#endif
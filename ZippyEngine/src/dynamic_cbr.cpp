@@ -9,6 +9,7 @@
 #include "buckets.h"
 #include "canonical_cards.h"
 #include "card_abstraction.h"
+#include "cbr_cache.h"
 #include "cards.h"
 #include "cfr_utils.h"
 #include "cfr_values.h"
@@ -45,6 +46,12 @@ shared_ptr<double []> DynamicCBR::Compute(Node *node, int p, const shared_ptr<do
   // time_t start_t = time(NULL);
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   const CanonicalCards *hands = hand_tree->Hands(st, gbd);
+  // The settings that affect the values
+  unsigned int seed = (cfrs_ ? 1 : 0) | (br_current_ ? 2 : 0) | ((int)prob_method_ << 2);
+  if (cache_) {
+    shared_ptr<double []> cached_vals = cache_->Lookup(node, gbd, p, opp_probs.get(), seed);
+    if (cached_vals) return cached_vals;
+  }
   // Should set this appropriately
   string action_sequence = "x";
   shared_ptr<double []> vals = ProcessSubgame(node, node, gbd, p, opp_probs, hand_tree,
@@ -74,6 +81,9 @@ shared_ptr<double []> DynamicCBR::Compute(Node *node, int p, const shared_ptr<do
 #endif
 
   FloorCVs(node, opp_probs.get(), hands, vals.get());
+  if (cache_) {
+    cache_->Insert(node, gbd, p, opp_probs.get(), seed, vals.get(), num_hole_card_pairs);
+  }
   return vals;
 }
 
@@ -6,6 +6,7 @@
 #include "vcfr.h"
 
 class Buckets;
+class CBRCache;
 class CanonicalCards;
 class CardAbstraction;
 class HandTree;
@@ -21,11 +22,14 @@ public:
   std::shared_ptr<double []> Compute(Node *node, const ReachProbs &reach_probs, int gbd,
 				     const HandTree *hand_tree, int target_p, bool cfrs,
 				     bool zero_sum, bool current, bool purify_opp);
+  // Optional.  See cbr_cache.h for the restrictions on sharing a cache.
+  void SetCache(std::shared_ptr<CBRCache> cache) {cache_ = cache;}
 private:
   std::shared_ptr<double []> Compute(Node *node, int p, const std::shared_ptr<double []> &opp_probs,
 				     int gbd, const HandTree *hand_tree);
 
   bool cfrs_;
+  std::shared_ptr<CBRCache> cache_;
 };
 
 #endif
@@ -342,6 +342,7 @@ void ECFR::Read(int batch_index) {
 	  betting_abstraction_.BettingAbstractionName().c_str(),
 	  cfr_config_.CFRConfigName().c_str());
   int num_players = Game::NumPlayers();
+  bool direct = cfr_config_.DirectIO();
   int max_street = Game::MaxStreet();
   int num_readers = num_players * (max_street + 1);
   
@@ -350,7 +351,7 @@ void ECFR::Read(int batch_index) {
     for (int st = 0; st <= max_street; ++st) {
       int index = p * (max_street + 1) + st;
       sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.d", dir, st, batch_index, p);
-      regret_readers[index].reset(new Reader(buf));
+      regret_readers[index].reset(new AsyncReader(buf, kAsyncBufSize, direct));
     }
   }
   ReadRegrets(root_.get(), regret_readers.get());
@@ -360,7 +361,7 @@ void ECFR::Read(int batch_index) {
     for (int st = 0; st <= max_street; ++st) {
       int index = p * (max_street + 1) + st;
       sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.i", dir, st, batch_index, p);
-      sumprob_readers[index].reset(new Reader(buf));
+      sumprob_readers[index].reset(new AsyncReader(buf, kAsyncBufSize, direct));
     }
   }
   ReadSumprobs(root_.get(), sumprob_readers.get());
@@ -413,6 +414,7 @@ void ECFR::Write(int batch_index) {
 	  cfr_config_.CFRConfigName().c_str());
   Mkdir(dir);
   int num_players = Game::NumPlayers();
+  bool direct = cfr_config_.DirectIO();
   int max_street = Game::MaxStreet();
   int num_writers = num_players * (max_street + 1);
   
@@ -421,7 +423,7 @@ void ECFR::Write(int batch_index) {
     for (int st = 0; st <= max_street; ++st) {
       int index = p * (max_street + 1) + st;
       sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.d", dir, st, batch_index, p);
-      regret_writers[index].reset(new Writer(buf));
+      regret_writers[index].reset(new AsyncWriter(buf, kAsyncBufSize, direct));
     }
   }
   WriteRegrets(root_.get(), regret_writers.get());
@@ -431,7 +433,7 @@ void ECFR::Write(int batch_index) {
     for (int st = 0; st <= max_street; ++st) {
       int index = p * (max_street + 1) + st;
       sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.i", dir, st, batch_index, p);
-      sumprob_writers[index].reset(new Writer(buf));
+      sumprob_writers[index].reset(new AsyncWriter(buf, kAsyncBufSize, direct));
     }
   }
   WriteSumprobs(root_.get(), sumprob_writers.get());
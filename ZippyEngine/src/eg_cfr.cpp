@@ -1,19 +1,35 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <math.h>
+
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "betting_tree.h"
 #include "betting_trees.h"
 #include "board_tree.h"
+#include "buckets.h"
+#include "canonical_cards.h"
+#include "cfr_config.h"
+#include "cfr_street_values.h"
+#include "cfr_utils.h"
+#include "cfr_values.h"
 #include "eg_cfr.h"
+#include "game.h"
+#include "hand_tree.h"
 #include "hand_value_tree.h"
+#include "leaf_value_table.h"
+#include "reach_probs.h"
 #include "resolving_method.h"
 #include "vcfr_state.h"
 #include "vcfr.h"
 
 using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
+using std::vector;
 
 // Can we skip this if no opp hands reach?
 // We assume a hand tree was created for this subgame.  (Note that we get the board, gbd, from
@@ -38,4 +54,257 @@ EGCFR::EGCFR(const CardAbstraction &ca, const CardAbstraction &base_ca,
   HandValueTree::Create();
   BoardTree::Create();
   it_ = 0;
+  warm_start_root_ = nullptr;
+  warm_start_buckets_ = nullptr;
+  leaf_st_ = Game::MaxStreet() + 1;
+}
+
+EGCFR::~EGCFR(void) {
+}
+
+void EGCFR::SetWarmStart(shared_ptr<CFRValues> base_values, Node *base_root,
+			 const Buckets *base_buckets) {
+  warm_start_values_ = base_values;
+  warm_start_root_ = base_root;
+  warm_start_buckets_ = base_buckets;
+}
+
+// Seed the regrets and sumprobs of the subgame with the base strategy.  The sumprobs get what
+// WarmStartIts iterations of the base strategy would have contributed: the reach prob of the
+// acting player times the base prob.  We don't have counterfactual values for the base strategy,
+// so the regrets are the base probs scaled by the pot size and the opponent's reach; enough that
+// the first iterations play the base strategy rather than uniform random.
+// Only handles streets that are unabstracted in the subgame.  Subgame actions not present in the
+// base tree get zero.
+void EGCFR::WarmStart(Node *node, Node *base_node, int gbd, const HandTree *hand_tree,
+		      int last_st, const ReachProbs &reach_probs) {
+  if (node->Terminal() || base_node->Terminal()) return;
+  int st = node->Street();
+  // No regrets or sumprobs past the depth limit
+  if (st >= leaf_st_) return;
+  if (st > last_st) {
+    int ngbd_begin = BoardTree::SuccBoardBegin(last_st, gbd, st);
+    int ngbd_end = BoardTree::SuccBoardEnd(last_st, gbd, st);
+    for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
+      WarmStart(node, base_node, ngbd, hand_tree, st, reach_probs);
+    }
+    return;
+  }
+  int num_succs = node->NumSuccs();
+  int base_num_succs = base_node->NumSuccs();
+  unique_ptr<int []> succ_map(new int[num_succs]);
+  for (int s = 0; s < num_succs; ++s) {
+    succ_map[s] = -1;
+    string action = node->ActionName(s);
+    for (int bs = 0; bs < base_num_succs; ++bs) {
+      if (base_node->ActionName(bs) == action) {
+	succ_map[s] = bs;
+	break;
+      }
+    }
+  }
+  AbstractCFRStreetValues *base_values = warm_start_values_->StreetValues(st);
+  int pa = node->PlayerActing();
+  shared_ptr<ReachProbs []> succ_reach_probs;
+  if (base_values && base_values->Players(pa)) {
+    int base_lbd = BoardTree::LocalIndex(warm_start_values_->RootSt(),
+					 warm_start_values_->RootBd(), st, gbd);
+    succ_reach_probs = ReachProbs::CreateSuccReachProbs(base_node, gbd, base_lbd,
+							hand_tree->Hands(st, gbd),
+							*warm_start_buckets_,
+							warm_start_values_.get(), reach_probs,
+							false);
+  }
+  if (num_succs > 1 && succ_reach_probs && buckets_.None(st)) {
+    int nt = node->NonterminalID();
+    CFRStreetValues<double> *regrets =
+      dynamic_cast<CFRStreetValues<double> *>(regrets_->StreetValues(st));
+    CFRStreetValues<double> *sumprobs =
+      dynamic_cast<CFRStreetValues<double> *>(sumprobs_->StreetValues(st));
+    double *all_regrets = regrets->AllValues(pa, nt);
+    double *all_sumprobs = sumprobs->Players(pa) ? sumprobs->AllValues(pa, nt) : nullptr;
+    int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+    int lbd = BoardTree::LocalIndex(regrets_->RootSt(), regrets_->RootBd(), st, gbd);
+    int max_card1 = Game::MaxCard() + 1;
+    const CanonicalCards *hands = hand_tree->Hands(st, gbd);
+    double sum_opp_probs = 0;
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      const Card *cards = hands->Cards(i);
+      sum_opp_probs += reach_probs.Get(pa^1, cards[0] * max_card1 + cards[1]);
+    }
+    double weight = cfr_config_.WarmStartIts();
+    double regret_scale = weight * node->LastBetTo() * sum_opp_probs;
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      const Card *cards = hands->Cards(i);
+      int enc = cards[0] * max_card1 + cards[1];
+      double reach = reach_probs.Get(pa, enc);
+      double *my_regrets = all_regrets + lbd * num_hole_card_pairs * num_succs + i * num_succs;
+      double *my_sumprobs = all_sumprobs ?
+	all_sumprobs + lbd * num_hole_card_pairs * num_succs + i * num_succs : nullptr;
+      for (int s = 0; s < num_succs; ++s) {
+	int bs = succ_map[s];
+	double succ_reach = bs >= 0 ? succ_reach_probs[bs].Get(pa, enc) : 0;
+	my_regrets[s] = reach > 0 ? regret_scale * succ_reach / reach : 0;
+	if (my_sumprobs) my_sumprobs[s] = weight * succ_reach;
+      }
+    }
+  }
+  for (int s = 0; s < num_succs; ++s) {
+    int bs = succ_map[s];
+    if (bs < 0) continue;
+    WarmStart(node->IthSucc(s), base_node->IthSucc(bs), gbd, hand_tree, st,
+	      succ_reach_probs ? succ_reach_probs[bs] : reach_probs);
+  }
+}
+
+// Collects the normalized average strategy at every node on the street of the subgame root.
+// Each prob is accompanied by the sumprob total for its holding, which is proportional to how
+// often the holding reaches the node.
+void EGCFR::RootStreetProbs(Node *node, vector<double> *probs, vector<double> *weights) {
+  if (node->Terminal()) return;
+  int st = node->Street();
+  if (st > sumprobs_->RootSt()) return;
+  int num_succs = node->NumSuccs();
+  int pa = node->PlayerActing();
+  if (num_succs > 1 && sumprobs_->StreetValues(st)->Players(pa)) {
+    CFRStreetValues<double> *street_values =
+      dynamic_cast<CFRStreetValues<double> *>(sumprobs_->StreetValues(st));
+    double *vals = street_values->AllValues(pa, node->NonterminalID());
+    int num_holdings = street_values->NumHoldings();
+    for (int h = 0; h < num_holdings; ++h) {
+      double *my_vals = vals + h * num_succs;
+      double sum = 0;
+      for (int s = 0; s < num_succs; ++s) sum += my_vals[s];
+      for (int s = 0; s < num_succs; ++s) {
+	probs->push_back(sum > 0 ? my_vals[s] / sum : 0);
+	weights->push_back(sum);
+      }
+    }
+  }
+  for (int s = 0; s < num_succs; ++s) {
+    RootStreetProbs(node->IthSucc(s), probs, weights);
+  }
+}
+
+// Every kConvergenceCheckInterval iterations, compare the average strategy on the root street to
+// what it was at the previous check.  We have converged when the reach-weighted mean change in
+// the probs is below ConvergenceThreshold.  Weighting keeps holdings that (almost) never reach a
+// node, whose probs can move a lot, from holding up the stop.  Only looks at the root street to
+// keep the check cheap.
+bool EGCFR::Converged(Node *subtree_root) {
+  double threshold = cfr_config_.ConvergenceThreshold();
+  if (threshold <= 0 || it_ % kConvergenceCheckInterval != 0) return false;
+  vector<double> probs, weights;
+  RootStreetProbs(subtree_root, &probs, &weights);
+  bool converged = false;
+  if (prev_root_probs_.size() == probs.size()) {
+    double sum_diffs = 0, sum_weights = 0;
+    int num = probs.size();
+    for (int i = 0; i < num; ++i) {
+      sum_diffs += weights[i] * fabs(probs[i] - prev_root_probs_[i]);
+      sum_weights += weights[i];
+    }
+    double mean_diff = sum_weights > 0 ? sum_diffs / sum_weights : 0;
+    converged = mean_diff < threshold;
+    if (converged) {
+      fprintf(stderr, "Converged at it %i: mean diff %f\n", it_, mean_diff);
+    }
+  }
+  prev_root_probs_.swap(probs);
+  return converged;
+}
+
+// Call after regrets_ and sumprobs_ have been allocated, before the first iteration.
+void EGCFR::PrepareSubgame(BettingTrees *subtrees, int solve_bd, const ReachProbs &reach_probs,
+			   const HandTree *hand_tree) {
+  prev_root_probs_.clear();
+  int max_street = Game::MaxStreet();
+  leaf_st_ = LeafStreet(subtrees->Root()->Street());
+  if (leaf_st_ <= max_street) {
+    const string &bucketing = cfr_config_.LeafValueBucketing();
+    if (bucketing != "") {
+      if (! leaf_table_ || leaf_table_->St() != leaf_st_ - 1) {
+	leaf_table_.reset(new LeafValueTable(bucketing, leaf_st_ - 1));
+      }
+    } else {
+      leaf_table_.reset();
+      if (hand_tree->FinalSt() < max_street) {
+	fprintf(stderr, "Rollout leaf values require a hand tree through the max street\n");
+	exit(-1);
+      }
+    }
+  }
+  if (warm_start_values_ && cfr_config_.WarmStartIts() > 0) {
+    Node *subtree_root = subtrees->Root();
+    WarmStart(subtree_root, warm_start_root_, solve_bd, hand_tree, subtree_root->Street(),
+	      reach_probs);
+  }
+}
+
+int EGCFR::LeafStreet(int st) const {
+  int depth_limit = cfr_config_.DepthLimit();
+  int max_street = Game::MaxStreet();
+  if (depth_limit <= 0 || st + depth_limit > max_street) return max_street + 1;
+  return st + depth_limit;
+}
+
+// Stop at the street-initial nodes of the leaf street instead of dealing out the next board.
+shared_ptr<VCFR_VALUE []> EGCFR::Process(Node *p0_node, Node *p1_node, int gbd,
+					 VCFRState *state, int last_st) {
+  int st = p0_node->Street();
+  if (st > last_st && st >= leaf_st_ && ! p0_node->Terminal()) {
+    return LeafValues(p0_node, gbd, state, last_st);
+  }
+  return VCFR::Process(p0_node, p1_node, gbd, state, last_st);
+}
+
+// Values for the hands on street pst (the street before the leaf) on board pgbd.
+shared_ptr<VCFR_VALUE []> EGCFR::LeafValues(Node *node, int pgbd, VCFRState *state, int pst) {
+  if (! leaf_table_) return Rollout(node, pgbd, state, pst);
+  const CanonicalCards *hands = state->Hands(pst, pgbd);
+  VCFR_VALUE *opp_probs = state->OppProbs().get();
+  int max_card1 = Game::MaxCard() + 1;
+  unique_ptr<double []> total_card_probs(new double[max_card1]);
+  double sum_opp_probs;
+  CommonBetResponseCalcs(pst, hands, opp_probs, &sum_opp_probs, total_card_probs.get());
+  int num_hole_card_pairs = Game::NumHoleCardPairs(pst);
+  int last_bet_to = node->LastBetTo();
+  shared_ptr<VCFR_VALUE []> vals(new VCFR_VALUE[num_hole_card_pairs]);
+  for (int i = 0; i < num_hole_card_pairs; ++i) {
+    const Card *cards = hands->Cards(i);
+    Card hi = cards[0];
+    Card lo = cards[1];
+    double opp_prob = opp_probs[i];
+    double opp_reach = sum_opp_probs + opp_prob - (total_card_probs[hi] + total_card_probs[lo]);
+    vals[i] = leaf_table_->Value(leaf_table_->Bucket(pgbd, i), last_bet_to) * opp_reach;
+  }
+  return vals;
+}
+
+// Deal out all the remaining boards and evaluate a showdown at the pot of the leaf; i.e., both
+// players check down from here.  Mirrors VCFR::StreetInitial() for the board enumeration.
+shared_ptr<VCFR_VALUE []> EGCFR::Rollout(Node *node, int gbd, VCFRState *state, int st) {
+  const CanonicalCards *hands = state->Hands(st, gbd);
+  VCFR_VALUE *opp_probs = state->OppProbs().get();
+  if (st == Game::MaxStreet()) {
+    unique_ptr<double []> total_card_probs(new double[Game::MaxCard() + 1]);
+    double sum_opp_probs;
+    CommonBetResponseCalcs(st, hands, opp_probs, &sum_opp_probs, total_card_probs.get());
+    return Showdown(node, hands, opp_probs, sum_opp_probs, total_card_probs.get());
+  }
+  int nst = st + 1;
+  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  const HandTree *hand_tree = state->GetHandTree();
+  const int *canons = hand_tree->CanonIndices(st, gbd);
+  shared_ptr<VCFR_VALUE []> vals(new VCFR_VALUE[num_hole_card_pairs]);
+  for (int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
+  int ngbd_begin = BoardTree::SuccBoardBegin(st, gbd, nst);
+  int ngbd_end = BoardTree::SuccBoardEnd(st, gbd, nst);
+  for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
+    VCFRState next_state(*state, nst, ngbd);
+    shared_ptr<VCFR_VALUE []> next_vals = Rollout(node, ngbd, &next_state, nst);
+    AddStreetInitialVals(hand_tree, nst, ngbd, canons, next_vals.get(), vals.get());
+  }
+  ScaleStreetInitialVals(nst, hands, canons, vals.get());
+  return vals;
 }
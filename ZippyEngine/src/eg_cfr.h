@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "resolving_method.h"
 #include "vcfr.h"
@@ -11,18 +12,46 @@ class BettingAbstraction;
 class BettingTrees;
 class CardAbstraction;
 class CFRConfig;
+class CFRValues;
 class HandTree;
+class LeafValueTable;
+class Node;
 class ReachProbs;
+class VCFRState;
 
 class EGCFR : public VCFR {
  public:
   EGCFR(const CardAbstraction &ca, const CardAbstraction &base_ca,
 	const BettingAbstraction &base_ba, const CFRConfig &cc, const CFRConfig &base_cc,
 	const Buckets &buckets, ResolvingMethod method, bool cfrs, bool zero_sum, int num_threads);
+  virtual ~EGCFR(void);
   virtual void SolveSubgame(BettingTrees *subtrees, int solve_bd, const ReachProbs &reach_probs,
 			    const std::string &action_sequence, const HandTree *hand_tree,
 			    double *opp_cvs, int target_p, bool both_players, int num_its) = 0;
+  // Initialize subsequent solves from the base strategy for the subgame.  base_values should be
+  // rooted at the same street and board as the subgame and base_root is the corresponding node
+  // in the base betting tree.  WarmStartIts in the CFR config determines how many iterations
+  // the base strategy is worth; zero disables warm starting.
+  void SetWarmStart(std::shared_ptr<CFRValues> base_values, Node *base_root,
+		    const Buckets *base_buckets);
+  // With a DepthLimit in the CFR config, a subgame rooted on street st is only solved through
+  // street st + DepthLimit - 1.  The street-initial nodes of the following street are leaves,
+  // valued either by a LeafValueTable (if LeafValueBucketing is set) or by rolling out the board
+  // and checking down.  Returns one past the max street when not depth limited.
+  int LeafStreet(int st) const;
  protected:
+  static const int kConvergenceCheckInterval = 10;
+  
+  void PrepareSubgame(BettingTrees *subtrees, int solve_bd, const ReachProbs &reach_probs,
+		      const HandTree *hand_tree);
+  void WarmStart(Node *node, Node *base_node, int gbd, const HandTree *hand_tree, int last_st,
+		 const ReachProbs &reach_probs);
+  bool Converged(Node *subtree_root);
+  std::shared_ptr<VCFR_VALUE []> Process(Node *p0_node, Node *p1_node, int gbd,
+					 VCFRState *state, int last_st);
+  std::shared_ptr<VCFR_VALUE []> LeafValues(Node *node, int pgbd, VCFRState *state, int pst);
+  std::shared_ptr<VCFR_VALUE []> Rollout(Node *node, int gbd, VCFRState *state, int st);
+  void RootStreetProbs(Node *node, std::vector<double> *probs, std::vector<double> *weights);
   virtual std::shared_ptr<double []> HalfIteration(BettingTrees *subtrees, int p,
 						   std::shared_ptr<double []> opp_probs,
 						   const HandTree *hand_tree,
@@ -31,6 +60,12 @@ class EGCFR : public VCFR {
   const CardAbstraction &base_card_abstraction_;
   const BettingAbstraction &base_betting_abstraction_;
   const CFRConfig &base_cfr_config_;
+  std::shared_ptr<CFRValues> warm_start_values_;
+  Node *warm_start_root_;
+  const Buckets *warm_start_buckets_;
+  std::vector<double> prev_root_probs_;
+  int leaf_st_;
+  std::unique_ptr<LeafValueTable> leaf_table_;
 };
 
 #endif
@@ -0,0 +1,411 @@
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "board_tree.h"
+#include "fast_hash.h"
+#include "feature_store.h"
+#include "files.h"
+#include "game.h"
+#include "io.h"
+#include "sparse_and_dense.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Hands are hashed a block at a time, in parallel, before the block's hashes are looked up in
+// order
+static const int kHashBlockHands = 1 << 20;
+
+FeatureFile::FeatureFile(const string &features, int st) {
+  char buf[500];
+  sprintf(buf, "%s/features.%s.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
+	  Game::NumRanks(), features.c_str(), st);
+  int fd = open(buf, O_RDONLY, 0);
+  if (fd == -1) {
+    fprintf(stderr, "Failed to open %s\n", buf);
+    exit(-1);
+  }
+  struct stat stbuf;
+  if (fstat(fd, &stbuf) == -1) {
+    fprintf(stderr, "Couldn't stat %s\n", buf);
+    exit(-1);
+  }
+  mapped_size_ = stbuf.st_size;
+  if (mapped_size_ < (long long int)sizeof(int)) {
+    fprintf(stderr, "%s is too small to be a features file\n", buf);
+    exit(-1);
+  }
+  mapped_ = mmap(NULL, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapped_ == MAP_FAILED) {
+    fprintf(stderr, "Failed to mmap %s\n", buf);
+    exit(-1);
+  }
+  close(fd);
+  memcpy(&num_features_, mapped_, sizeof(int));
+  vals_ = (const short *)((const unsigned char *)mapped_ + sizeof(int));
+  num_hands_ = ((unsigned int)BoardTree::NumBoards(st)) *
+    ((unsigned int)Game::NumHoleCardPairs(st));
+  long long int expected = sizeof(int) +
+    ((long long int)num_hands_) * num_features_ * (long long int)sizeof(short);
+  if (mapped_size_ != expected) {
+    fprintf(stderr, "%s has size %lli; expected %lli\n", buf, mapped_size_, expected);
+    exit(-1);
+  }
+}
+
+FeatureFile::~FeatureFile(void) {
+  munmap(mapped_, mapped_size_);
+}
+
+bool ParseFeatureEncoding(const string &s, FeatureEncoding *encoding) {
+  if (s == "float")      *encoding = FeatureEncoding::FLOAT;
+  else if (s == "short") *encoding = FeatureEncoding::SHORT;
+  else if (s == "half")  *encoding = FeatureEncoding::HALF;
+  else if (s == "byte")  *encoding = FeatureEncoding::BYTE;
+  else                   return false;
+  return true;
+}
+
+// Rounds to nearest even.  Values too large for a half become infinity.
+static unsigned short FloatToHalf(float f) {
+  unsigned int x;
+  memcpy(&x, &f, sizeof(x));
+  unsigned int sign = (x >> 16) & 0x8000;
+  unsigned int fexp = (x >> 23) & 0xff;
+  unsigned int mant = x & 0x7fffff;
+  if (fexp == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);
+  int exp = (int)fexp - 127 + 15;
+  if (exp >= 31) return sign | 0x7c00;
+  if (exp <= 0) {
+    // Subnormal half
+    if (exp < -10) return sign;
+    mant |= 0x800000;
+    int shift = 14 - exp;
+    unsigned int h = mant >> shift;
+    unsigned int rem = mant & ((1U << shift) - 1);
+    unsigned int halfway = 1U << (shift - 1);
+    if (rem > halfway || (rem == halfway && (h & 1))) ++h;
+    return sign | h;
+  }
+  unsigned int h = (((unsigned int)exp) << 10) | (mant >> 13);
+  unsigned int rem = mant & 0x1fff;
+  // A carry out of the mantissa correctly bumps the exponent
+  if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h;
+  return sign | h;
+}
+
+static float HalfToFloat(unsigned short h) {
+  unsigned int sign = ((unsigned int)(h & 0x8000)) << 16;
+  unsigned int exp = (h >> 10) & 0x1f;
+  unsigned int mant = h & 0x3ff;
+  unsigned int x;
+  if (exp == 0) {
+    if (mant == 0) {
+      x = sign;
+    } else {
+      // Subnormal half; normalize
+      int e = -1;
+      do {
+	++e;
+	mant <<= 1;
+      } while (! (mant & 0x400));
+      x = sign | (((unsigned int)(112 - e)) << 23) | ((mant & 0x3ff) << 13);
+    }
+  } else if (exp == 31) {
+    x = sign | 0x7f800000 | (mant << 13);
+  } else {
+    x = sign | ((exp + 112) << 23) | (mant << 13);
+  }
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+class FeatureThread {
+public:
+  FeatureThread(const FeatureFile &file, int thread_index, int num_threads);
+  ~FeatureThread(void) {}
+  void Hash(void);
+  void Range(void);
+  void RunHash(unsigned int begin, unsigned int end, unsigned long long int *hashes);
+  void RunRange(unsigned int begin, unsigned int end);
+  void SetBlock(unsigned int begin, unsigned int end, unsigned long long int *hashes);
+  void Join(void);
+  const short *Mins(void) const {return mins_.get();}
+  const short *Maxes(void) const {return maxes_.get();}
+private:
+  const FeatureFile &file_;
+  int num_features_;
+  int thread_index_;
+  int num_threads_;
+  unsigned int begin_;
+  unsigned int end_;
+  unsigned long long int *hashes_;
+  unique_ptr<short []> mins_;
+  unique_ptr<short []> maxes_;
+  pthread_t pthread_id_;
+};
+
+FeatureThread::FeatureThread(const FeatureFile &file, int thread_index, int num_threads) :
+  file_(file) {
+  num_features_ = file.NumFeatures();
+  thread_index_ = thread_index;
+  num_threads_ = num_threads;
+  hashes_ = nullptr;
+}
+
+void FeatureThread::SetBlock(unsigned int begin, unsigned int end,
+			     unsigned long long int *hashes) {
+  begin_ = begin;
+  end_ = end;
+  hashes_ = hashes;
+}
+
+// Each thread takes a contiguous slice of the block so that it reads a contiguous stretch of the
+// features file.
+void FeatureThread::Hash(void) {
+  unsigned int num = end_ - begin_;
+  unsigned int lo = begin_ + (unsigned int)(((unsigned long long int)num) * thread_index_ /
+					    num_threads_);
+  unsigned int hi = begin_ + (unsigned int)(((unsigned long long int)num) *
+					    (thread_index_ + 1) / num_threads_);
+  for (unsigned int h = lo; h < hi; ++h) {
+    hashes_[h - begin_] = fasthash64((void *)file_.Vals(h), num_features_ * sizeof(short), 0);
+  }
+}
+
+void FeatureThread::Range(void) {
+  mins_.reset(new short[num_features_]);
+  maxes_.reset(new short[num_features_]);
+  for (int f = 0; f < num_features_; ++f) {
+    mins_[f] = 32767;
+    maxes_[f] = -32768;
+  }
+  unsigned int num = end_ - begin_;
+  unsigned int lo = begin_ + (unsigned int)(((unsigned long long int)num) * thread_index_ /
+					    num_threads_);
+  unsigned int hi = begin_ + (unsigned int)(((unsigned long long int)num) *
+					    (thread_index_ + 1) / num_threads_);
+  for (unsigned int h = lo; h < hi; ++h) {
+    const short *vals = file_.Vals(h);
+    for (int f = 0; f < num_features_; ++f) {
+      if (vals[f] < mins_[f]) mins_[f] = vals[f];
+      if (vals[f] > maxes_[f]) maxes_[f] = vals[f];
+    }
+  }
+}
+
+static void *thread_run_hash(void *v_t) {
+  FeatureThread *t = (FeatureThread *)v_t;
+  t->Hash();
+  return NULL;
+}
+
+void FeatureThread::RunHash(unsigned int begin, unsigned int end,
+			    unsigned long long int *hashes) {
+  SetBlock(begin, end, hashes);
+  pthread_create(&pthread_id_, NULL, thread_run_hash, this);
+}
+
+static void *thread_run_range(void *v_t) {
+  FeatureThread *t = (FeatureThread *)v_t;
+  t->Range();
+  return NULL;
+}
+
+void FeatureThread::RunRange(unsigned int begin, unsigned int end) {
+  SetBlock(begin, end, nullptr);
+  pthread_create(&pthread_id_, NULL, thread_run_range, this);
+}
+
+void FeatureThread::Join(void) {
+  pthread_join(pthread_id_, NULL);
+}
+
+void FeatureFile::Ranges(int num_threads, short *mins, short *maxes) const {
+  vector<unique_ptr<FeatureThread>> threads(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    threads[t].reset(new FeatureThread(*this, t, num_threads));
+  }
+  for (int t = 1; t < num_threads; ++t) threads[t]->RunRange(0, num_hands_);
+  threads[0]->SetBlock(0, num_hands_, nullptr);
+  threads[0]->Range();
+  for (int t = 1; t < num_threads; ++t) threads[t]->Join();
+  for (int f = 0; f < num_features_; ++f) {
+    mins[f] = threads[0]->Mins()[f];
+    maxes[f] = threads[0]->Maxes()[f];
+    for (int t = 1; t < num_threads; ++t) {
+      if (threads[t]->Mins()[f] < mins[f]) mins[f] = threads[t]->Mins()[f];
+      if (threads[t]->Maxes()[f] > maxes[f]) maxes[f] = threads[t]->Maxes()[f];
+    }
+  }
+}
+
+FeatureStore::FeatureStore(int dim, FeatureEncoding encoding, const char *backing_filename) {
+  dim_ = dim;
+  encoding_ = encoding;
+  int value_bytes;
+  if (encoding == FeatureEncoding::FLOAT)     value_bytes = sizeof(float);
+  else if (encoding == FeatureEncoding::BYTE) value_bytes = 1;
+  else                                        value_bytes = 2;
+  object_bytes_ = dim * value_bytes;
+  // A multiple of the page size, since kFeatureChunkObjects is
+  chunk_bytes_ = ((long long int)kFeatureChunkObjects) * object_bytes_;
+  num_objects_ = 0;
+  done_adding_ = false;
+  fd_ = -1;
+  if (backing_filename) {
+    fd_ = open(backing_filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd_ == -1) {
+      fprintf(stderr, "Failed to open %s\n", backing_filename);
+      exit(-1);
+    }
+    UnlinkFile(backing_filename);
+  }
+}
+
+FeatureStore::~FeatureStore(void) {
+  int num_chunks = chunks_.size();
+  for (int c = 0; c < num_chunks; ++c) munmap(chunks_[c], chunk_bytes_);
+  if (fd_ >= 0) close(fd_);
+}
+
+void FeatureStore::SetRanges(const short *mins, const short *maxes) {
+  mins_.reset(new float[dim_]);
+  scales_.reset(new float[dim_]);
+  for (int f = 0; f < dim_; ++f) {
+    int mn = mins[f], mx = maxes[f];
+    if (mx < mn) mx = mn = 0;
+    mins_[f] = mn;
+    scales_[f] = (mx - mn) / 255.0;
+  }
+}
+
+void FeatureStore::AddUnique(const FeatureFile &file, unsigned int begin, unsigned int end,
+			     int num_threads, int *indices) {
+  if (file.NumFeatures() != dim_) {
+    fprintf(stderr, "Features file has %i features; store has %i\n", file.NumFeatures(), dim_);
+    exit(-1);
+  }
+  if (done_adding_) {
+    fprintf(stderr, "FeatureStore::AddUnique() called after DoneAdding()\n");
+    exit(-1);
+  }
+  // The ranges are needed for BYTE before the first object is encoded
+  if (encoding_ == FeatureEncoding::BYTE && ! mins_) {
+    unique_ptr<short []> mins(new short[dim_]), maxes(new short[dim_]);
+    file.Ranges(num_threads, mins.get(), maxes.get());
+    SetRanges(mins.get(), maxes.get());
+  }
+  if (! sad_) sad_.reset(new SparseAndDenseLong);
+  vector<unique_ptr<FeatureThread>> threads(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    threads[t].reset(new FeatureThread(file, t, num_threads));
+  }
+  unsigned int block_hands = end - begin;
+  if (block_hands > (unsigned int)kHashBlockHands) block_hands = kHashBlockHands;
+  unique_ptr<unsigned long long int []> hashes(new unsigned long long int[block_hands]);
+  SparseAndDenseLong *sad = sad_.get();
+  for (unsigned int b = begin; b < end; b += kHashBlockHands) {
+    unsigned int e = end - b > (unsigned int)kHashBlockHands ? b + kHashBlockHands : end;
+    for (int t = 1; t < num_threads; ++t) threads[t]->RunHash(b, e, hashes.get());
+    threads[0]->SetBlock(b, e, hashes.get());
+    threads[0]->Hash();
+    for (int t = 1; t < num_threads; ++t) threads[t]->Join();
+    for (unsigned int h = b; h < e; ++h) {
+      int old_num = sad->Num();
+      int index = sad->SparseToDense(hashes[h - b]);
+      indices[h - begin] = index;
+      if (sad->Num() > old_num) {
+	// Previously unseen feature value vector
+	Add(file.Vals(h));
+	if (sad->Num() % 1000000 == 0) {
+	  fprintf(stderr, "%i unique feature combos so far\n", sad->Num());
+	}
+      }
+    }
+    if (((b - begin) / kHashBlockHands) % 10 == 9) fprintf(stderr, "h %u\n", e);
+  }
+}
+
+void FeatureStore::DoneAdding(void) {
+  sad_.reset();
+  done_adding_ = true;
+}
+
+void FeatureStore::AddFloats(const float *vals) {
+  if (encoding_ != FeatureEncoding::FLOAT) {
+    fprintf(stderr, "FeatureStore::AddFloats() requires FLOAT encoding\n");
+    exit(-1);
+  }
+  memcpy(NextObject(), vals, dim_ * sizeof(float));
+  ++num_objects_;
+}
+
+// Returns where the next object goes, mapping a new chunk if necessary
+unsigned char *FeatureStore::NextObject(void) {
+  int c = num_objects_ >> kFeatureChunkBits;
+  if (c == (int)chunks_.size()) {
+    void *p;
+    if (fd_ >= 0) {
+      if (ftruncate(fd_, (c + 1) * chunk_bytes_) != 0) {
+	fprintf(stderr, "Couldn't grow feature store backing file\n");
+	exit(-1);
+      }
+      p = mmap(NULL, chunk_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, c * chunk_bytes_);
+    } else {
+      p = mmap(NULL, chunk_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (p == MAP_FAILED) {
+      fprintf(stderr, "Failed to map feature store chunk %i\n", c);
+      exit(-1);
+    }
+    chunks_.push_back((unsigned char *)p);
+  }
+  return chunks_[c] + ((long long int)(num_objects_ & kChunkMask)) * object_bytes_;
+}
+
+void FeatureStore::Add(const short *vals) {
+  unsigned char *p = NextObject();
+  if (encoding_ == FeatureEncoding::FLOAT) {
+    float *fp = (float *)p;
+    for (int f = 0; f < dim_; ++f) fp[f] = vals[f];
+  } else if (encoding_ == FeatureEncoding::SHORT) {
+    memcpy(p, vals, dim_ * sizeof(short));
+  } else if (encoding_ == FeatureEncoding::HALF) {
+    unsigned short *hp = (unsigned short *)p;
+    for (int f = 0; f < dim_; ++f) hp[f] = FloatToHalf(vals[f]);
+  } else {
+    for (int f = 0; f < dim_; ++f) {
+      int q = scales_[f] > 0 ? lrint((vals[f] - mins_[f]) / scales_[f]) : 0;
+      if (q < 0) q = 0;
+      else if (q > 255) q = 255;
+      p[f] = q;
+    }
+  }
+  ++num_objects_;
+}
+
+void FeatureStore::Decode(const unsigned char *p, float *buf) const {
+  if (encoding_ == FeatureEncoding::SHORT) {
+    const short *sp = (const short *)p;
+    for (int f = 0; f < dim_; ++f) buf[f] = sp[f];
+  } else if (encoding_ == FeatureEncoding::HALF) {
+    const unsigned short *hp = (const unsigned short *)p;
+    for (int f = 0; f < dim_; ++f) buf[f] = HalfToFloat(hp[f]);
+  } else {
+    for (int f = 0; f < dim_; ++f) buf[f] = mins_[f] + p[f] * scales_[f];
+  }
+}
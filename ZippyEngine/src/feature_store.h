@@ -0,0 +1,99 @@
+#ifndef _FEATURE_STORE_H_
+#define _FEATURE_STORE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class SparseAndDenseLong;
+
+// A features file holds the number of features (an int) followed by that many shorts for every
+// hand of a street, in hand order.  Written by build_rollout_features and combine_features.
+// FeatureFile maps one read-only, so that nothing is copied onto the heap and processes reading
+// the same features share the page cache.
+class FeatureFile {
+public:
+  FeatureFile(const std::string &features, int st);
+  ~FeatureFile(void);
+  int NumFeatures(void) const {return num_features_;}
+  unsigned int NumHands(void) const {return num_hands_;}
+  const short *Vals(unsigned int h) const {
+    return vals_ + ((unsigned long long int)h) * num_features_;
+  }
+  // Minimum and maximum value of each feature over all hands, computed by num_threads threads
+  void Ranges(int num_threads, short *mins, short *maxes) const;
+private:
+  void *mapped_;
+  long long int mapped_size_;
+  const short *vals_;
+  int num_features_;
+  unsigned int num_hands_;
+};
+
+// How FeatureStore holds feature values.  SHORT keeps the values of the features file as they
+// are.  HALF (IEEE half precision) is also two bytes per value; it is exact for values up to
+// 2048 in magnitude.  BYTE quantizes each feature linearly between its minimum and maximum
+// value over the street.
+enum class FeatureEncoding { FLOAT, SHORT, HALF, BYTE };
+bool ParseFeatureEncoding(const std::string &s, FeatureEncoding *encoding);
+
+// The distinct feature vectors (objects) of a street, as clustered by KMeans.  Objects are
+// stored back to back in chunks of kFeatureChunkObjects, each mapped separately, so that the
+// store can grow without copying and without one huge allocation.  If a backing file is given,
+// the chunks are mapped from it, and the kernel can write them out under memory pressure rather
+// than us running out of RAM.  The backing file is unlinked right away; it goes away with the
+// store.
+class FeatureStore {
+public:
+  FeatureStore(int dim, FeatureEncoding encoding, const char *backing_filename);
+  ~FeatureStore(void);
+  // Adds the feature vectors of hands [begin, end) of file that aren't in the store yet, in
+  // order of first appearance, and sets indices[h - begin] to the object holding the features
+  // of hand h.  Hashing is split among num_threads threads.  Can be called repeatedly to add the
+  // hands of several ranges.
+  void AddUnique(const FeatureFile &file, unsigned int begin, unsigned int end, int num_threads,
+		 int *indices);
+  // Adds one object regardless of duplicates.  Only for FLOAT, and not to be mixed with
+  // AddUnique().
+  void AddFloats(const float *vals);
+  // Frees the table used to find duplicates.  No more hands can be added afterwards.
+  void DoneAdding(void);
+  // For BYTE, the range that each feature is quantized over.  By default AddUnique() takes
+  // them from the whole features file.  Stores built from the same file can share ranges
+  // computed once.
+  void SetRanges(const short *mins, const short *maxes);
+  int Dim(void) const {return dim_;}
+  int NumObjects(void) const {return num_objects_;}
+  // Returns the features of object o.  Points into the store for FLOAT; otherwise the features
+  // are decoded into buf, which must have room for Dim() values.
+  const float *Object(int o, float *buf) const {
+    const unsigned char *p =
+      chunks_[o >> kFeatureChunkBits] + ((long long int)(o & kChunkMask)) * object_bytes_;
+    if (encoding_ == FeatureEncoding::FLOAT) return (const float *)p;
+    Decode(p, buf);
+    return buf;
+  }
+  static const int kFeatureChunkBits = 16;
+  static const int kFeatureChunkObjects = 1 << kFeatureChunkBits;
+private:
+  static const int kChunkMask = kFeatureChunkObjects - 1;
+
+  unsigned char *NextObject(void);
+  void Add(const short *vals);
+  void Decode(const unsigned char *p, float *buf) const;
+
+  int dim_;
+  FeatureEncoding encoding_;
+  int object_bytes_;
+  long long int chunk_bytes_;
+  int fd_;
+  std::vector<unsigned char *> chunks_;
+  int num_objects_;
+  std::unique_ptr<SparseAndDenseLong> sad_;
+  bool done_adding_;
+  // For BYTE: value = mins_[f] + q * scales_[f]
+  std::unique_ptr<float []> mins_;
+  std::unique_ptr<float []> scales_;
+};
+
+#endif
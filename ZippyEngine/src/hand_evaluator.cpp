@@ -5,6 +5,7 @@
 #include <string>
 
 #include "cards.h"
+#include "game.h"
 #include "hand_evaluator.h"
 
 using std::string;
@@ -49,17 +50,45 @@ int LeducHandEvaluator::Evaluate(Card *cards, int num_cards) {
 }
 
 HoldemHandEvaluator::HoldemHandEvaluator(void) : HandEvaluator() {
-  ranks_ = new int[7];
-  suits_ = new int[7];
-  rank_counts_ = new int[13];
-  suit_counts_ = new int[4];
+  int num_cards = Game::MaxCard() + 1;
+  card_suits_.reset(new int[num_cards]);
+  card_bits_.reset(new unsigned int[num_cards]);
+  for (Card c = 0; c < num_cards; ++c) {
+    card_suits_[c] = Suit(c);
+    card_bits_[c] = 1U << Rank(c);
+  }
+  // Straights are always found by looking for an ace (rank 12) below the deuce, even in games
+  // with fewer than 13 ranks, for consistency with existing hand value trees.
+  int num_masks = 1 << 13;
+  straights_.reset(new int[num_masks]);
+  top_fives_.reset(new int[num_masks]);
+  for (int m = 0; m < num_masks; ++m) {
+    unsigned int mask = m;
+    straights_[m] = -1;
+    for (int r = 12; r >= 3; --r) {
+      unsigned int low_bit = r == 3 ? (1U << 12) : (1U << (r - 4));
+      unsigned int needed = (0xfU << (r - 3)) | low_bit;
+      if ((mask & needed) == needed) {
+	straights_[m] = r;
+	break;
+      }
+    }
+    top_fives_[m] = __builtin_popcount(mask) >= 5 ? TopRanks(mask, 5) : -1;
+  }
 }
 
 HoldemHandEvaluator::~HoldemHandEvaluator(void) {
-  delete [] suits_;
-  delete [] ranks_;
-  delete [] rank_counts_;
-  delete [] suit_counts_;
+}
+
+// Encodes the num highest ranks in mask in base 13, highest rank first.
+int HoldemHandEvaluator::TopRanks(unsigned int mask, int num) {
+  int v = 0;
+  for (int i = 0; i < num; ++i) {
+    int r = 31 - __builtin_clz(mask);
+    v = v * 13 + r;
+    mask &= ~(1U << r);
+  }
+  return v;
 }
 
 // Return values between 0 and 90
@@ -151,24 +180,25 @@ int HoldemHandEvaluator::EvaluateThree(Card *cards) {
 // 0...28560:     no-pair
 // Next 715 (?) for no-pair
 int HoldemHandEvaluator::EvaluateFour(Card *cards) {
-  for (int r = 0; r <= 12; ++r) rank_counts_[r] = 0;
+  int rank_counts[13];
+  for (int r = 0; r <= 12; ++r) rank_counts[r] = 0;
   for (int i = 0; i < 4; ++i) {
-    ++rank_counts_[Rank(cards[i])];
+    ++rank_counts[Rank(cards[i])];
   }
   int pair_rank1 = -1, pair_rank2 = -1;
   for (int r = 12; r >= 0; --r) {
-    if (rank_counts_[r] == 4) {
+    if (rank_counts[r] == 4) {
       return kH4Quads + r;
-    } else if (rank_counts_[r] == 3) {
+    } else if (rank_counts[r] == 3) {
       int kicker = -1;
       for (int r = 12; r >= 0; --r) {
-	if (rank_counts_[r] == 1) {
+	if (rank_counts[r] == 1) {
 	  kicker = r;
 	  break;
 	}
       }
       return kH4ThreeOfAKind + 13 * r + kicker;
-    } else if (rank_counts_[r] == 2) {
+    } else if (rank_counts[r] == 2) {
       if (pair_rank1 == -1) {
 	pair_rank1 = r;
       } else {
@@ -183,7 +213,7 @@ int HoldemHandEvaluator::EvaluateFour(Card *cards) {
   if (pair_rank1 >= 0) {
     int kicker1 = -1, kicker2 = -1;
     for (int r = 12; r >= 0; --r) {
-      if (rank_counts_[r] == 1) {
+      if (rank_counts[r] == 1) {
 	if (kicker1 == -1) {
 	  kicker1 = r;
 	} else {
@@ -196,7 +226,7 @@ int HoldemHandEvaluator::EvaluateFour(Card *cards) {
   }
   int kicker1 = -1, kicker2 = -1, kicker3 = -1, kicker4 = -1;
   for (int r = 12; r >= 0; --r) {
-    if (rank_counts_[r] == 1) {
+    if (rank_counts[r] == 1) {
       if (kicker1 == -1)      kicker1 = r;
       else if (kicker2 == -1) kicker2 = r;
       else if (kicker3 == -1) kicker3 = r;
@@ -206,6 +236,8 @@ int HoldemHandEvaluator::EvaluateFour(Card *cards) {
   return kicker1 * 2197 + kicker2 * 169 + kicker3 * 13 + kicker4;
 }
 
+// For five or more cards, returns values between 0 and 775904 (inclusive).  Within each category,
+// ranks are encoded in base 13 from the most significant down.
 int HoldemHandEvaluator::Evaluate(Card *cards, int num_cards) {
   if (num_cards == 2) {
     return EvaluateTwo(cards);
@@ -214,211 +246,61 @@ int HoldemHandEvaluator::Evaluate(Card *cards, int num_cards) {
   } else if (num_cards == 4) {
     return EvaluateFour(cards);
   }
-  for (int r = 0; r <= 12; ++r) rank_counts_[r] = 0;
-  for (int s = 0; s < 4; ++s)   suit_counts_[s] = 0;
+  unsigned int suit_masks[4] = {0, 0, 0, 0};
   for (int i = 0; i < num_cards; ++i) {
     Card c = cards[i];
-    int r = Rank(c);
-    ranks_[i] = r;
-    ++rank_counts_[r];
-    int s = Suit(c);
-    suits_[i] = s;
-    ++suit_counts_[s];
+    suit_masks[card_suits_[c]] |= card_bits_[c];
   }
+  unsigned int s0 = suit_masks[0], s1 = suit_masks[1], s2 = suit_masks[2], s3 = suit_masks[3];
+  unsigned int any = s0 | s1 | s2 | s3;
   int flush_suit = -1;
   for (int s = 0; s < 4; ++s) {
-    if (suit_counts_[s] >= 5) {
+    if (__builtin_popcount(suit_masks[s]) >= 5) {
       flush_suit = s;
       break;
     }
   }
-  // Need to handle straights with ace as low
-  int r = 12;
-  int straight_rank = -1;
-  while (true) {
-    // See if there are 5 ranks (r, r-1, r-2, etc.) such that there is at
-    // least one card in each rank.  In other words, there is an r-high
-    // straight.
-    int r1 = r;
-    int end = r - 4;
-    while (r1 >= end &&
-	   ((r1 > -1 && rank_counts_[r1] > 0) ||
-	    (r1 == -1 && rank_counts_[12] > 0))) {
-      --r1;
-    }
-    if (r1 == end - 1) {
-      // We found a straight
-      if (flush_suit >= 0) {
-	// There is a flush on the board
-	if (straight_rank == -1) straight_rank = r;
-	// Need to check for straight flush.  Count how many cards between
-	// end and r are in the flush suit.
-	int num = 0;
-	for (int i = 0; i < num_cards; ++i) {
-	  if (suits_[i] == flush_suit &&
-	      ((ranks_[i] >= end && ranks_[i] <= r) ||
-	       (end == -1 && ranks_[i] == 12))) {
-	    // This assumes we have no duplicate cards in input
-	    ++num;
-	  }
-	}
-	if (num == 5) {
-	  return kStraightFlush + r;
-	}
-	// Can't break yet - there could be a straight flush at a lower rank
-	// Can only decrement r by 1.  (Suppose cards are:
-	// 4c5c6c7c8c9s.)
-	--r;
-	if (r < 3) break;
-      } else {
-	straight_rank = r;
-	break;
-      }
-    } else {
-      // If we get here, there was no straight ending at r.  We know there
-      // are no cards with rank r1.  Therefore r can jump to r1 - 1.
-      r = r1 - 1;
-      if (r < 3) break;
-    }
+  int straight_rank = straights_[any];
+  if (flush_suit >= 0 && straight_rank >= 0) {
+    int sf_rank = straights_[suit_masks[flush_suit]];
+    if (sf_rank >= 0) return kStraightFlush + sf_rank;
   }
-  int three_rank = -1;
-  int pair_rank = -1;
-  int pair2_rank = -1;
-  for (int r = 12; r >= 0; --r) {
-    int ct = rank_counts_[r];
-    if (ct == 4) {
-      int hr = -1;
-      for (int i = 0; i < num_cards; ++i) {
-	int r1 = ranks_[i];
-	if (r1 != r && r1 > hr) hr = r1;
-      }
-      return kQuads + r * 13 + hr;
-    } else if (ct == 3) {
-      if (three_rank == -1) {
-	three_rank = r;
-      } else if (pair_rank == -1) {
-	pair_rank = r;
-      }
-    } else if (ct == 2) {
-      if (pair_rank == -1) {
-	pair_rank = r;
-      } else if (pair2_rank == -1) {
-	pair2_rank = r;
-      }
-    }
+  unsigned int quads = s0 & s1 & s2 & s3;
+  if (quads) {
+    int r = 31 - __builtin_clz(quads);
+    return kQuads + r * 13 + TopRanks(any & ~(1U << r), 1);
   }
-  if (three_rank >= 0 && pair_rank >= 0) {
-    return kFullHouse + three_rank * 13 + pair_rank;
+  // Ranks with at least two and at least three cards
+  unsigned int two_plus = (s0 & s1) | (s0 & s2) | (s0 & s3) | (s1 & s2) | (s1 & s3) | (s2 & s3);
+  unsigned int three_plus = (s0 & s1 & s2) | (s0 & s1 & s3) | (s0 & s2 & s3) | (s1 & s2 & s3);
+  int three_rank = three_plus ? 31 - __builtin_clz(three_plus) : -1;
+  if (three_rank >= 0) {
+    // The pair may be a second three-of-a-kind
+    unsigned int others = two_plus & ~(1U << three_rank);
+    if (others) return kFullHouse + three_rank * 13 + TopRanks(others, 1);
   }
   if (flush_suit >= 0) {
-    int hr1 = -1, hr2 = -1, hr3 = -1, hr4 = -1, hr5 = -1;
-    for (int i = 0; i < num_cards; ++i) {
-      if (suits_[i] == flush_suit) {
-	int r = ranks_[i];
-	if (r > hr1) {
-	  hr5 = hr4; hr4 = hr3; hr3 = hr2; hr2 = hr1; hr1 = r;
-	} else if (r > hr2) {
-	  hr5 = hr4; hr4 = hr3; hr3 = hr2; hr2 = r;
-	} else if (r > hr3) {
-	  hr5 = hr4; hr4 = hr3; hr3 = r;
-	} else if (r > hr4) {
-	  hr5 = hr4; hr4 = r;
-	} else if (r > hr5) {
-	  hr5 = r;
-	}
-      }
-    }
-    return kFlush + hr1 * 28561 + hr2 * 2197 + hr3 * 169 + hr4 * 13 + hr5;
+    return kFlush + top_fives_[suit_masks[flush_suit]];
   }
   if (straight_rank >= 0) {
     return kStraight + straight_rank;
   }
   if (three_rank >= 0) {
-    int hr1 = -1, hr2 = -1;
-    for (int i = 0; i < num_cards; ++i) {
-      int r = ranks_[i];
-      if (r != three_rank) {
-	if (r > hr1) {
-	  hr2 = hr1; hr1 = r;
-	} else if (r > hr2) {
-	  hr2 = r;
-	}
-      }
-    }
-    if (num_cards == 3) {
-      // No kicker
-      return kThreeOfAKind + three_rank * 169;
-    } else if (num_cards == 4) {
-      // Only one kicker
-      return kThreeOfAKind + three_rank * 169 + hr1 * 13;
-    } else {
-      // Two kickers
-      return kThreeOfAKind + three_rank * 169 + hr1 * 13 + hr2;
-    }
+    // Two kickers
+    return kThreeOfAKind + three_rank * 169 + TopRanks(any & ~(1U << three_rank), 2);
   }
-  if (pair2_rank >= 0) {
-    int hr1 = -1;
-    for (int i = 0; i < num_cards; ++i) {
-      int r = ranks_[i];
-      if (r != pair_rank && r != pair2_rank && r > hr1) hr1 = r;
-    }
-    if (num_cards < 5) {
-      // No kicker
-      return kTwoPair + pair_rank * 169 + pair2_rank * 13;
-    } else {
+  if (two_plus) {
+    int pair_rank = 31 - __builtin_clz(two_plus);
+    unsigned int pairs = two_plus & ~(1U << pair_rank);
+    if (pairs) {
       // Encode two pair ranks plus kicker
-      return kTwoPair + pair_rank * 169 + pair2_rank * 13 + hr1;
-    }
-  }
-  if (pair_rank >= 0) {
-    int hr1 = -1, hr2 = -1, hr3 = -1;
-    for (int i = 0; i < num_cards; ++i) {
-      int r = ranks_[i];
-      if (r != pair_rank) {
-	if (r > hr1) {
-	  hr3 = hr2; hr2 = hr1; hr1 = r;
-	} else if (r > hr2) {
-	  hr3 = hr2; hr2 = r;
-	} else if (r > hr3) {
-	  hr3 = r;
-	}
-      }
-    }
-    if (num_cards == 3) {
-      // One kicker
-      return kPair + pair_rank * 2197 + hr1 * 169;
-    } else if (num_cards == 4) {
-      // Two kickers
-      return kPair + pair_rank * 2197 + hr1 * 169 + hr2 * 13;
-    } else {
-      // Three kickers
-      return kPair + pair_rank * 2197 + hr1 * 169 + hr2 * 13 + hr3;
+      int pair2_rank = 31 - __builtin_clz(pairs);
+      unsigned int kickers = any & ~((1U << pair_rank) | (1U << pair2_rank));
+      return kTwoPair + pair_rank * 169 + pair2_rank * 13 + TopRanks(kickers, 1);
     }
+    // Three kickers
+    return kPair + pair_rank * 2197 + TopRanks(any & ~(1U << pair_rank), 3);
   }
-
-  int hr1 = -1, hr2 = -1, hr3 = -1, hr4 = -1, hr5 = -1;
-  for (int i = 0; i < num_cards; ++i) {
-    int r = ranks_[i];
-    if (r > hr1) {
-      hr5 = hr4; hr4 = hr3; hr3 = hr2; hr2 = hr1; hr1 = r;
-    } else if (r > hr2) {
-      hr5 = hr4; hr4 = hr3; hr3 = hr2; hr2 = r;
-    } else if (r > hr3) {
-      hr5 = hr4; hr4 = hr3; hr3 = r;
-    } else if (r > hr4) {
-      hr5 = hr4; hr4 = r;
-    } else if (r > hr5) {
-      hr5 = r;
-    }
-  }
-  if (num_cards == 3) {
-    // Encode top three ranks
-    return kNoPair + hr1 * 28561 + hr2 * 2197 + hr3 * 169;
-  } else if (num_cards == 4) {
-    // Encode top four ranks
-    return kNoPair + hr1 * 28561 + hr2 * 2197 + hr3 * 169 + hr4 * 13;
-  } else {
-    // Encode top five ranks
-    return kNoPair + hr1 * 28561 + hr2 * 2197 + hr3 * 169 + hr4 * 13 + hr5;
-  }
+  // Encode top five ranks
+  return kNoPair + top_fives_[any];
 }
@@ -1,6 +1,7 @@
 #ifndef _HAND_EVALUATOR_H_
 #define _HAND_EVALUATOR_H_
 
+#include <memory>
 #include <string>
 
 #include "cards.h"
@@ -50,11 +51,17 @@ class HoldemHandEvaluator : public HandEvaluator {
   int EvaluateTwo(Card *cards);
   int EvaluateThree(Card *cards);
   int EvaluateFour(Card *cards);
+  static int TopRanks(unsigned int mask, int num);
 
-  int *ranks_;
-  int *suits_;
-  int *rank_counts_;
-  int *suit_counts_;
+  // Five or more cards are evaluated from one 13-bit rank mask per suit, so no state is
+  // modified and one evaluator can be shared by multiple threads.
+  // Indexed by card
+  std::unique_ptr<int []> card_suits_;
+  std::unique_ptr<unsigned int []> card_bits_;
+  // Indexed by rank mask.  The rank of the top card of the best straight or -1 if there is none.
+  std::unique_ptr<int []> straights_;
+  // Indexed by rank mask.  The top five ranks encoded in base 13.
+  std::unique_ptr<int []> top_fives_;
 };
 
 #endif
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <memory>
 #include <vector>
 
 #include "board_tree.h"
@@ -15,6 +16,7 @@
 #include "hand_tree.h"
 #include "hand_value_tree.h"
 
+using std::unique_ptr;
 using std::vector;
 
 HandTree::HandTree(int root_st, int root_bd, int final_st) {
@@ -50,6 +52,68 @@ HandTree::HandTree(int root_st, int root_bd, int final_st) {
       }
     }
   }
+  BuildIndices();
+}
+
+void HandTree::BuildIndices(void) {
+  canon_indices_ = new int **[final_st_ + 1];
+  canon_hands_ = new int **[final_st_ + 1];
+  prev_hands_ = new int **[final_st_ + 1];
+  for (int st = 0; st <= final_st_; ++st) {
+    if (st < root_st_) {
+      canon_indices_[st] = NULL;
+      canon_hands_[st] = NULL;
+      prev_hands_[st] = NULL;
+      continue;
+    }
+    int num_local_boards = BoardTree::NumLocalBoards(root_st_, root_bd_, st);
+    canon_indices_[st] = new int *[num_local_boards];
+    canon_hands_[st] = new int *[num_local_boards];
+    prev_hands_[st] = st > root_st_ ? new int *[num_local_boards] : NULL;
+  }
+  Card max_card1 = Game::MaxCard() + 1;
+  unique_ptr<int []> enc_to_index(new int[max_card1 * max_card1]);
+  for (int st = root_st_; st <= final_st_; ++st) {
+    int num_local_boards = BoardTree::NumLocalBoards(root_st_, root_bd_, st);
+    for (int lbd = 0; lbd < num_local_boards; ++lbd) {
+      const CanonicalCards *hands = hands_[st][lbd];
+      int num_hands = hands->NumRaw();
+      for (int i = 0; i < num_hands; ++i) {
+	const Card *cards = hands->Cards(i);
+	enc_to_index[cards[0] * max_card1 + cards[1]] = i;
+      }
+      int *canon_indices = new int[num_hands];
+      for (int i = 0; i < num_hands; ++i) {
+	canon_indices[i] = hands->NumVariants(i) > 0 ? i : enc_to_index[hands->Canon(i)];
+      }
+      canon_indices_[st][lbd] = canon_indices;
+      int *canon_hands = new int[num_hands];
+      int j = 0;
+      for (int i = 0; i < num_hands; ++i) {
+	if (hands->NumVariants(i) > 0) canon_hands[j++] = i;
+      }
+      for (int i = 0; i < num_hands; ++i) {
+	if (hands->NumVariants(i) == 0) canon_hands[j++] = i;
+      }
+      canon_hands_[st][lbd] = canon_hands;
+      if (st == final_st_) continue;
+      int nst = st + 1;
+      int gbd = BoardTree::GlobalIndex(root_st_, root_bd_, st, lbd);
+      int ngbd_begin = BoardTree::SuccBoardBegin(st, gbd, nst);
+      int ngbd_end = BoardTree::SuccBoardEnd(st, gbd, nst);
+      for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
+	int nlbd = LocalBoardIndex(nst, ngbd);
+	const CanonicalCards *next_hands = hands_[nst][nlbd];
+	int num_next_hands = next_hands->NumRaw();
+	int *prev_hands = new int[num_next_hands];
+	for (int nh = 0; nh < num_next_hands; ++nh) {
+	  const Card *cards = next_hands->Cards(nh);
+	  prev_hands[nh] = enc_to_index[cards[0] * max_card1 + cards[1]];
+	}
+	prev_hands_[nst][nlbd] = prev_hands;
+      }
+    }
+  }
 }
 
 HandTree::~HandTree(void) {
@@ -58,10 +122,19 @@ HandTree::~HandTree(void) {
       BoardTree::NumLocalBoards(root_st_, root_bd_, st);
     for (int lbd = 0; lbd < num_local_boards; ++lbd) {
       delete hands_[st][lbd];
+      delete [] canon_indices_[st][lbd];
+      delete [] canon_hands_[st][lbd];
+      if (st > root_st_) delete [] prev_hands_[st][lbd];
     }
     delete [] hands_[st];
+    delete [] canon_indices_[st];
+    delete [] canon_hands_[st];
+    delete [] prev_hands_[st];
   }
   delete [] hands_;
+  delete [] canon_indices_;
+  delete [] canon_hands_;
+  delete [] prev_hands_;
 }
 
 // Assumes hole cards are ordered
@@ -14,6 +14,25 @@ public:
     int lbd = LocalBoardIndex(st, gbd);
     return hands_[st][lbd];
   }
+  // The index of the canonical hand of each hand in Hands(st, gbd)
+  const int *CanonIndices(int st, int gbd) const {
+    int lbd = LocalBoardIndex(st, gbd);
+    return canon_indices_[st][lbd];
+  }
+  // The indices of the canonical hands in Hands(st, gbd), in increasing order.  There are
+  // Hands(st, gbd)->NumCanon() of them.  They are followed by the indices of the remaining hands,
+  // also in increasing order.
+  const int *CanonHands(int st, int gbd) const {
+    int lbd = LocalBoardIndex(st, gbd);
+    return canon_hands_[st][lbd];
+  }
+  // For st > RootSt(), the index of each hand in Hands(st, gbd) among the hands of the
+  // predecessor board on street st - 1.  Lets us carry values indexed by hand across street
+  // boundaries without going through the hole card encoding.
+  const int *PrevHands(int st, int gbd) const {
+    int lbd = LocalBoardIndex(st, gbd);
+    return prev_hands_[st][lbd];
+  }
   int FinalSt(void) const {return final_st_;}
   int RootSt(void) const {return root_st_;}
   int RootBd(void) const {return root_bd_;}
@@ -21,10 +40,15 @@ public:
     return BoardTree::LocalIndex(root_st_, root_bd_, st, gbd);
   }
 private:
+  void BuildIndices(void);
+
   int root_st_;
   int root_bd_;
   int final_st_;
   CanonicalCards ***hands_;
+  int ***canon_indices_;
+  int ***canon_hands_;
+  int ***prev_hands_;
 };
 
 int HCPIndex(int st, const Card *cards);
@@ -0,0 +1,96 @@
+// Precomputes the buckets of the hands of a HandTree.  VCFR needs the buckets of every hand of a
+// board each time it deals the board at a street-initial node, which happens once for every
+// betting sequence leading to the street on every iteration.  Looking the buckets up involves
+// undoing the hand strength sort on the final street, so we do it once per board up front and
+// hand out pointers afterwards.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <memory>
+
+#include "board_tree.h"
+#include "buckets.h"
+#include "canonical_cards.h"
+#include "cards.h"
+#include "game.h"
+#include "hand_tree.h"
+#include "hand_tree_buckets.h"
+
+using std::unique_ptr;
+
+HandTreeBuckets::HandTreeBuckets(const Buckets &buckets, const HandTree *hand_tree) {
+  struct timespec start, finish;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  root_st_ = hand_tree->RootSt();
+  root_bd_ = hand_tree->RootBd();
+  final_st_ = hand_tree->FinalSt();
+  num_boards_ = 0;
+  int max_street = Game::MaxStreet();
+  buckets_ = new int **[final_st_ + 1];
+  symmetric_.reset(new bool[final_st_ + 1]);
+  for (int st = 0; st <= final_st_; ++st) {
+    symmetric_[st] = true;
+    if (st < root_st_ || buckets.None(st)) {
+      buckets_[st] = nullptr;
+      continue;
+    }
+    int num_board_cards = Game::NumBoardCards(st);
+    int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+    int num_local_boards = BoardTree::NumLocalBoards(root_st_, root_bd_, st);
+    buckets_[st] = new int *[num_local_boards];
+    unique_ptr<int []> raw_buckets;
+    if (st == max_street) raw_buckets.reset(new int[num_hole_card_pairs]);
+    for (int lbd = 0; lbd < num_local_boards; ++lbd) {
+      int gbd = BoardTree::GlobalIndex(root_st_, root_bd_, st, lbd);
+      int *board_buckets = new int[num_hole_card_pairs];
+      unsigned int h0 = ((unsigned int)gbd) * ((unsigned int)num_hole_card_pairs);
+      if (st == max_street) {
+	// Hands on final street were reordered by hand strength, but bucket lookup requires
+	// the unordered hole card pair index
+	const Card *board = BoardTree::Board(st, gbd);
+	Card cards[7];
+	for (int i = 0; i < num_board_cards; ++i) {
+	  cards[i + 2] = board[i];
+	}
+	const CanonicalCards *hands = hand_tree->Hands(st, gbd);
+	buckets.Bucket(st, h0, num_hole_card_pairs, raw_buckets.get());
+	for (int i = 0; i < num_hole_card_pairs; ++i) {
+	  const Card *hole_cards = hands->Cards(i);
+	  cards[0] = hole_cards[0];
+	  cards[1] = hole_cards[1];
+	  board_buckets[i] = raw_buckets[HCPIndex(st, cards)];
+	}
+      } else {
+	buckets.Bucket(st, h0, num_hole_card_pairs, board_buckets);
+      }
+      buckets_[st][lbd] = board_buckets;
+      const int *canons = hand_tree->CanonIndices(st, gbd);
+      for (int i = 0; i < num_hole_card_pairs; ++i) {
+	if (board_buckets[i] != board_buckets[canons[i]]) symmetric_[st] = false;
+      }
+    }
+    num_boards_ += num_local_boards;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &finish);
+  build_secs_ = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+HandTreeBuckets::~HandTreeBuckets(void) {
+  for (int st = 0; st <= final_st_; ++st) {
+    if (buckets_[st] == nullptr) continue;
+    int num_local_boards = BoardTree::NumLocalBoards(root_st_, root_bd_, st);
+    for (int lbd = 0; lbd < num_local_boards; ++lbd) {
+      delete [] buckets_[st][lbd];
+    }
+    delete [] buckets_[st];
+  }
+  delete [] buckets_;
+}
+
+// Any hand tree with the same root and final street has the same hands in the same order.
+bool HandTreeBuckets::Matches(const HandTree *hand_tree) const {
+  return hand_tree->RootSt() == root_st_ && hand_tree->RootBd() == root_bd_ &&
+    hand_tree->FinalSt() == final_st_;
+}
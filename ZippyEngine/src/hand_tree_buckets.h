@@ -0,0 +1,43 @@
+#ifndef _HAND_TREE_BUCKETS_H_
+#define _HAND_TREE_BUCKETS_H_
+
+#include <memory>
+
+#include "board_tree.h"
+
+class Buckets;
+class HandTree;
+
+// The buckets of every hand of a HandTree, looked up once.  For each bucketed street and each
+// board, Buckets(st, gbd) is indexed like the hands of HandTree::Hands(st, gbd); on the final
+// street that means in hand strength order.  Streets that are not bucketed have no entries.
+//
+// Takes about as much memory as the HandTree's own hand indices, so we don't attempt to page it
+// in from disk.
+class HandTreeBuckets {
+public:
+  HandTreeBuckets(const Buckets &buckets, const HandTree *hand_tree);
+  ~HandTreeBuckets(void);
+  const int *StreetBuckets(int st, int gbd) const {
+    int lbd = BoardTree::LocalIndex(root_st_, root_bd_, st, gbd);
+    return buckets_[st][lbd];
+  }
+  // True if we can serve the boards of hand_tree
+  bool Matches(const HandTree *hand_tree) const;
+  // True if on every board of street st, each hand has the same bucket as its canonical hand
+  bool Symmetric(int st) const {return symmetric_[st];}
+  // Number of boards whose buckets were looked up, and how long that took.  Lets callers
+  // estimate the time saved by not looking them up again.
+  long long int NumBoards(void) const {return num_boards_;}
+  double BuildSecs(void) const {return build_secs_;}
+private:
+  int root_st_;
+  int root_bd_;
+  int final_st_;
+  int ***buckets_;
+  std::unique_ptr<bool []> symmetric_;
+  long long int num_boards_;
+  double build_secs_;
+};
+
+#endif
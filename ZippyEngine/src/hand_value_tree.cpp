@@ -1,4 +1,9 @@
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <vector>
@@ -13,567 +18,157 @@ using std::vector;
 
 int HandValueTree::num_board_cards_ = 0;
 int HandValueTree::num_cards_ = 0;
-int *HandValueTree::tree1_ = NULL;
-int **HandValueTree::tree2_ = NULL;
-int ***HandValueTree::tree3_ = NULL;
-int ****HandValueTree::tree4_ = NULL;
-int *****HandValueTree::tree5_ = NULL;
-int ******HandValueTree::tree6_ = NULL;
-int *******HandValueTree::tree7_ = NULL;
+unsigned int *HandValueTree::choose_ = NULL;
+const int *HandValueTree::vals_ = NULL;
+void *HandValueTree::mapped_ = NULL;
+size_t HandValueTree::mapped_size_ = 0;
 
 // Note: currently you need to make sure that this is called from only one thread.
 void HandValueTree::Create(void) {
   // Check if already created
   if (num_cards_ != 0) return;
-  tree1_ = NULL;
-  tree2_ = NULL;
-  tree3_ = NULL;
-  tree4_ = NULL;
-  tree5_ = NULL;
-  tree6_ = NULL;
-  tree7_ = NULL;
   int max_street = Game::MaxStreet();
-  num_board_cards_ = Game::NumBoardCards(max_street);
-  num_cards_ = num_board_cards_ + Game::NumCardsForStreet(0);
-  if (num_cards_ == 1)      ReadOne();
-  else if (num_cards_ == 2) ReadTwo();
-  else if (num_cards_ == 3) ReadThree();
-  else if (num_cards_ == 4) ReadFour();
-  else if (num_cards_ == 5) ReadFive();
-  else if (num_cards_ == 6) ReadSix();
-  else if (num_cards_ == 7) ReadSeven();
+  int num_board_cards = Game::NumBoardCards(max_street);
+  int num_cards = num_board_cards + Game::NumCardsForStreet(0);
+  if (num_cards < 1 || num_cards > kMaxCards) {
+    fprintf(stderr, "HandValueTree::Create: unexpected number of cards: %i\n", num_cards);
+    exit(-1);
+  }
+  // choose_[c][n] is the number of combinations of n cards from the cards 0...c-1.
+  int num_cards_in_deck = Game::MaxCard() + 1;
+  choose_ = new unsigned int[(num_cards_in_deck + 1) * (kMaxCards + 1)];
+  for (int c = 0; c <= num_cards_in_deck; ++c) {
+    unsigned int *row = choose_ + c * (kMaxCards + 1);
+    row[0] = 1;
+    for (int n = 1; n <= kMaxCards; ++n) {
+      if (c == 0) row[n] = 0;
+      else        row[n] = Choose(c - 1, n - 1) + Choose(c - 1, n);
+    }
+  }
+  num_board_cards_ = num_board_cards;
+  num_cards_ = num_cards;
+  MapFile();
 }
 
 bool HandValueTree::Created(void) {
   return num_cards_ != 0;
 }
 
-#if 0
-HandValueTree::HandValueTree(int st) {
-  tree1_ = NULL;
-  tree2_ = NULL;
-  tree5_ = NULL;
-  tree6_ = NULL;
-  tree7_ = NULL;
-  num_board_cards_ = Game::NumBoardCards(st);
-  num_cards_ = num_board_cards_ + Game::NumCardsForStreet(0);
-  if (num_cards_ == 1)      ReadOne();
-  else if (num_cards_ == 2) ReadTwo();
-  else if (num_cards_ == 3) ReadThree();
-  else if (num_cards_ == 5) ReadFive();
-  else if (num_cards_ == 6) ReadSix();
-  else if (num_cards_ == 7) ReadSeven();
-}
-#endif
-
-void HandValueTree::ReadOne(void) {
-  int max_card = Game::MaxCard();
+void HandValueTree::MapFile(void) {
   char buf[500];
   sprintf(buf, "%s/hand_value_tree.%s.%i.%i.%i", Files::StaticBase(),
 	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
 	  num_cards_);
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree1_ = new int[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree1_[i] = 0;
-  for (int i1 = 0; i1 < num_cards; ++i1) {
-    tree1_[i1] = reader.ReadIntOrDie();
-  }
-}
-
-void HandValueTree::ReadTwo(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.%i", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  num_cards_);
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree2_ = new int *[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree2_[i] = NULL;
-  for (int i1 = 1; i1 < num_cards; ++i1) {
-    int *tree1 = new int[i1];
-    tree2_[i1] = tree1;
-    for (int i2 = 0; i2 < i1; ++i2) {
-      tree1[i2] = reader.ReadIntOrDie();
-    }
-  }
-}
-
-void HandValueTree::ReadThree(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.3", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree3_ = new int **[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree3_[i] = NULL;
-  for (int i1 = 2; i1 < num_cards; ++i1) {
-    int **tree1 = new int *[i1];
-    tree3_[i1] = tree1;
-    for (int i2 = 1; i2 < i1; ++i2) {
-      int *tree2 = new int[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 0; i3 < i2; ++i3) {
-	tree2[i3] = reader.ReadIntOrDie();
-      }
-    }
-  }
-}
-
-void HandValueTree::ReadFour(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.4", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree4_ = new int ***[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree4_[i] = NULL;
-  for (int i1 = 3; i1 < num_cards; ++i1) {
-    int ***tree1 = new int **[i1];
-    tree4_[i1] = tree1;
-    for (int i2 = 2; i2 < i1; ++i2) {
-      int **tree2 = new int *[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 1; i3 < i2; ++i3) {
-	int *tree3 = new int[i3];
-	tree2[i3] = tree3;
-	for (int i4 = 0; i4 < i3; ++i4) {
-	  tree3[i4] = reader.ReadIntOrDie();
-	}
-      }
-    }
+  int fd = open(buf, O_RDONLY, 0);
+  if (fd == -1) {
+    fprintf(stderr, "Failed to open %s\n", buf);
+    exit(-1);
   }
-}
-
-void HandValueTree::ReadFive(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.5", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree5_ = new int ****[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree5_[i] = NULL;
-  for (int i1 = 4; i1 < num_cards; ++i1) {
-    int ****tree1 = new int ***[i1];
-    tree5_[i1] = tree1;
-    for (int i2 = 3; i2 < i1; ++i2) {
-      int ***tree2 = new int **[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 2; i3 < i2; ++i3) {
-	int **tree3 = new int *[i3];
-	tree2[i3] = tree3;
-	for (int i4 = 1; i4 < i3; ++i4) {
-	  int *tree4 = new int[i4];
-	  tree3[i4] = tree4;
-	  for (int i5 = 0; i5 < i4; ++i5) {
-	    tree4[i5] = reader.ReadIntOrDie();
-	  }
-	}
-      }
-    }
+  struct stat stbuf;
+  if (fstat(fd, &stbuf) == -1) {
+    fprintf(stderr, "Couldn't stat %s\n", buf);
+    exit(-1);
   }
-}
-
-void HandValueTree::ReadSix(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.6", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree6_ = new int *****[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree6_[i] = NULL;
-  for (int i1 = 5; i1 < num_cards; ++i1) {
-    int *****tree1 = new int ****[i1];
-    tree6_[i1] = tree1;
-    for (int i2 = 4; i2 < i1; ++i2) {
-      int ****tree2 = new int ***[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 3; i3 < i2; ++i3) {
-	int ***tree3 = new int **[i3];
-	tree2[i3] = tree3;
-	for (int i4 = 2; i4 < i3; ++i4) {
-	  int **tree4 = new int *[i4];
-	  tree3[i4] = tree4;
-	  for (int i5 = 1; i5 < i4; ++i5) {
-	    int *tree5 = new int[i5];
-	    tree4[i5] = tree5;
-	    for (int i6 = 0; i6 < i5; ++i6) {
-	      tree5[i6] = reader.ReadIntOrDie();
-	    }
-	  }
-	}
-      }
-    }
+  long long int num_vals = Choose(Game::MaxCard() + 1, num_cards_);
+  if (stbuf.st_size != num_vals * (long long int)sizeof(int)) {
+    fprintf(stderr, "HandValueTree: %s has size %lli; expected %lli\n", buf,
+	    (long long int)stbuf.st_size, num_vals * (long long int)sizeof(int));
+    exit(-1);
   }
-}
-
-void HandValueTree::ReadSeven(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.7", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree7_ = new int ******[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree7_[i] = NULL;
-  for (int i1 = 6; i1 < num_cards; ++i1) {
-    int ******tree1 = new int *****[i1];
-    tree7_[i1] = tree1;
-    for (int i2 = 5; i2 < i1; ++i2) {
-      int *****tree2 = new int ****[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 4; i3 < i2; ++i3) {
-	int ****tree3 = new int ***[i3];
-	tree2[i3] = tree3;
-	for (int i4 = 3; i4 < i3; ++i4) {
-	  int ***tree4 = new int **[i4];
-	  tree3[i4] = tree4;
-	  for (int i5 = 2; i5 < i4; ++i5) {
-	    int **tree5 = new int *[i5];
-	    tree4[i5] = tree5;
-	    for (int i6 = 1; i6 < i5; ++i6) {
-	      int *tree6 = new int[i6];
-	      tree5[i6] = tree6;
-	      for (int i7 = 0; i7 < i6; ++i7) {
-		tree6[i7] = reader.ReadIntOrDie();
-	      }
-	    }
-	  }
-	}
-      }
-    }
+  mapped_size_ = stbuf.st_size;
+  mapped_ = mmap(NULL, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapped_ == MAP_FAILED) {
+    fprintf(stderr, "Failed to mmap %s\n", buf);
+    exit(-1);
   }
+  // Lookups are random, so start reading the whole file in the background rather than faulting
+  // in one page at a time.
+  madvise(mapped_, mapped_size_, MADV_WILLNEED);
+  close(fd);
+  vals_ = (const int *)mapped_;
 }
 
 void HandValueTree::Delete(void) {
-  int max_card = Game::MaxCard();
-  if (num_cards_ == 1) {
-    delete [] tree1_;
-  } else if (num_cards_ == 2) {
-    for (int i1 = 1; i1 <= max_card; ++i1) {
-      delete [] tree2_[i1];
-    }
-    delete [] tree2_;
-  } else if (num_cards_ == 3) {
-    for (int i1 = 2; i1 <= max_card; ++i1) {
-      int **tree1 = tree3_[i1];
-      for (int i2 = 1; i2 < i1; ++i2) {
-	delete [] tree1[i2];
-      }
-      delete [] tree1;
-    }
-    delete [] tree3_;
-  } else if (num_cards_ == 4) {
-    for (int i1 = 3; i1 <= max_card; ++i1) {
-      int ***tree1 = tree4_[i1];
-      for (int i2 = 2; i2 < i1; ++i2) {
-	int **tree2 = tree1[i2];
-	for (int i3 = 1; i3 < i2; ++i3) {
-	  delete [] tree2[i3];
-	}
-	delete [] tree2;
-      }
-      delete [] tree1;
-    }
-    delete [] tree5_;
-  } else if (num_cards_ == 5) {
-    for (int i1 = 4; i1 <= max_card; ++i1) {
-      int ****tree1 = tree5_[i1];
-      for (int i2 = 3; i2 < i1; ++i2) {
-	int ***tree2 = tree1[i2];
-	for (int i3 = 2; i3 < i2; ++i3) {
-	  int **tree3 = tree2[i3];
-	  for (int i4 = 1; i4 < i3; ++i4) {
-	    delete [] tree3[i4];
-	  }
-	  delete [] tree3;
-	}
-	delete [] tree2;
-      }
-      delete [] tree1;
-    }
-    delete [] tree5_;
-  } else if (num_cards_ == 6) {
-    for (int i1 = 5; i1 <= max_card; ++i1) {
-      int *****tree1 = tree6_[i1];
-      for (int i2 = 4; i2 < i1; ++i2) {
-	int ****tree2 = tree1[i2];
-	for (int i3 = 3; i3 < i2; ++i3) {
-	  int ***tree3 = tree2[i3];
-	  for (int i4 = 2; i4 < i3; ++i4) {
-	    int **tree4 = tree3[i4];
-	    for (int i5 = 1; i5 < i4; ++i5) {
-	      delete [] tree4[i5];
-	    }
-	    delete [] tree4;
-	  }
-	  delete [] tree3;
-	}
-	delete [] tree2;
-      }
-      delete [] tree1;
-    }
-    delete [] tree5_;
-  } else if (num_cards_ == 7) {
-    for (int i1 = 6; i1 <= max_card; ++i1) {
-      int ******tree1 = tree7_[i1];
-      for (int i2 = 5; i2 < i1; ++i2) {
-	int *****tree2 = tree1[i2];
-	for (int i3 = 4; i3 < i2; ++i3) {
-	  int ****tree3 = tree2[i3];
-	  for (int i4 = 3; i4 < i3; ++i4) {
-	    int ***tree4 = tree3[i4];
-	    for (int i5 = 2; i5 < i4; ++i5) {
-	      int **tree5 = tree4[i5];
-	      for (int i6 = 1; i6 < i5; ++i6) {
-		delete [] tree5[i6];
-	      }
-	      delete [] tree5;
-	    }
-	    delete [] tree4;
-	  }
-	  delete [] tree3;
-	}
-	delete [] tree2;
-      }
-      delete [] tree1;
-    }
-    delete [] tree7_;
-  }
-  tree1_ = NULL;
-  tree2_ = NULL;
-  tree3_ = NULL;
-  tree4_ = NULL;
-  tree5_ = NULL;
-  tree6_ = NULL;
-  tree7_ = NULL;
+  if (mapped_) munmap(mapped_, mapped_size_);
+  delete [] choose_;
+  choose_ = NULL;
+  vals_ = NULL;
+  mapped_ = NULL;
+  mapped_size_ = 0;
   // So HandValueTree::Create() will do something on next call
   num_cards_ = 0;
 }
 
-#if 0
-// Just do a selection sort.  We assume num is small.
-static void SortCards(Card *cards, int num) {
-  if (num == 1) return;
-  for (int i = 0; i < num - 1; ++i) {
-    Card maxc = cards[i];
-    int maxi = i;
-    for (int j = i + 1; j < num; ++j) {
-      Card c = cards[j];
-      if (c > maxc) {
-	maxc = c;
-	maxi = j;
-      }
-    }
-    if (i != maxi) {
-      cards[maxi] = cards[i];
-      cards[i] = maxc;
-    }
+unsigned int HandValueTree::Index(const Card *cards, int num_cards) {
+  unsigned int index = 0;
+  for (int i = 0; i < num_cards; ++i) {
+    index += Choose(cards[i], num_cards - i);
   }
+  return index;
 }
-#endif
 
 int HandValueTree::Val(const Card *cards) {
-  if (num_cards_ == 1) {
-    return tree1_[(int)cards[0]];
-  } else if (num_cards_ == 2) {
-    vector<int> v(2);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    std::sort(v.begin(), v.end());
-    return tree2_[v[1]][v[0]];
-  } else if (num_cards_ == 3) {
-    vector<int> v(3);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    std::sort(v.begin(), v.end());
-    return tree3_[v[2]][v[1]][v[0]];
-  } else if (num_cards_ == 4) {
-    vector<int> v(4);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    v[3] = cards[3];
-    std::sort(v.begin(), v.end());
-    return tree4_[v[3]][v[2]][v[1]][v[0]];
-  } else if (num_cards_ == 5) {
-    vector<int> v(5);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    v[3] = cards[3];
-    v[4] = cards[4];
-    std::sort(v.begin(), v.end());
-    return tree5_[v[4]][v[3]][v[2]][v[1]][v[0]];
-  } else if (num_cards_ == 6) {
-    vector<int> v(6);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    v[3] = cards[3];
-    v[4] = cards[4];
-    v[5] = cards[5];
-    std::sort(v.begin(), v.end());
-    return tree6_[v[5]][v[4]][v[3]][v[2]][v[1]][v[0]];
-  } else if (num_cards_ == 7) {
-    vector<int> v(7);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    v[3] = cards[3];
-    v[4] = cards[4];
-    v[5] = cards[5];
-    v[6] = cards[6];
-    std::sort(v.begin(), v.end());
-    return tree7_[v[6]][v[5]][v[4]][v[3]][v[2]][v[1]][v[0]];
-#if 0
-    Card s[7];
-    s[0] = cards[0];
-    s[1] = cards[1];
-    s[2] = cards[2];
-    s[3] = cards[3];
-    s[4] = cards[4];
-    s[5] = cards[5];
-    s[6] = cards[6];
-    SortCards(s, 7);
-    return tree7_[s[0]][s[1]][s[2]][s[3]][s[4]][s[5]][s[6]];
-#endif
-  } else {
-    fprintf(stderr, "HandValueTree::Val: unexpected number of cards: %u\n",
-	    num_cards_);
-    exit(-1);
+  // Insertion sort from high to low.  We assume the number of cards is small.
+  Card s[kMaxCards];
+  for (int i = 0; i < num_cards_; ++i) {
+    Card c = cards[i];
+    int j = i;
+    while (j > 0 && s[j - 1] < c) {
+      s[j] = s[j - 1];
+      --j;
+    }
+    s[j] = c;
   }
-}
-
-// board and hole_cards should be sorted from high to low.
-int HandValueTree::Val(const int *board, const int *hole_cards) {
-  if (num_cards_ == 1) {
-    return tree1_[hole_cards[0]];
-  } else if (num_cards_ == 2 && num_board_cards_ == 1) {
-    int b = board[0];
-    int h = hole_cards[0];
-    if (b < h) {
-      return tree2_[h][b];
+  return vals_[Index(s, num_cards_)];
+}
+
+// Handles games with other than two hole cards.  board and hole_cards should be sorted from high
+// to low.
+int HandValueTree::SlowVal(const int *board, const int *hole_cards) {
+  int num_hole_cards = num_cards_ - num_board_cards_;
+  Card a[kMaxCards];
+  int i = 0, j = 0, k = 0;
+  while (i < num_board_cards_ || j < num_hole_cards) {
+    if (j == num_hole_cards || (i < num_board_cards_ && board[i] > hole_cards[j])) {
+      a[k++] = board[i++];
     } else {
-      return tree2_[b][h];
-    }
-  } else if (num_cards_ == 2 && num_board_cards_ == 0) {
-    int h0 = hole_cards[0];
-    int h1 = hole_cards[1];
-    if (h0 < h1) {
-      return tree2_[h1][h0];
-    } else {
-      return tree2_[h0][h1];
-    }
-  } else if (num_cards_ == 3) {
-    int a[3];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 1 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
+      a[k++] = hole_cards[j++];
     }
-    return tree3_[a[0]][a[1]][a[2]];
-  } else if (num_cards_ == 4) {
-    int a[4];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 2 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	if (i < 2) b = board[i];
-	else       b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
-    }
-    return tree4_[a[0]][a[1]][a[2]][a[3]];
-  } else if (num_cards_ == 5) {
-    int a[5];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 3 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	if (i < 3) b = board[i];
-	else       b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
-    }
-    return tree5_[a[0]][a[1]][a[2]][a[3]][a[4]];
-  } else if (num_cards_ == 6) {
-    int a[6];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 4 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	if (i < 4) b = board[i];
-	else       b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
+  }
+  return vals_[Index(a, num_cards_)];
+}
+
+void HandValueTree::Vals(const int *board, const Card *hole_cards, int num_hands, int *vals) {
+  int num_hole_cards = num_cards_ - num_board_cards_;
+  if (num_hole_cards != 2) {
+    for (int i = 0; i < num_hands; ++i) {
+      vals[i] = SlowVal(board, hole_cards + i * num_hole_cards);
     }
-    return tree6_[a[0]][a[1]][a[2]][a[3]][a[4]][a[5]];
-  } else if (num_cards_ == 7) {
-    int a[7];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 5 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	if (i < 5) b = board[i];
-	else       b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
+    return;
+  }
+  // If k hole cards are above board card i, it is at position i + k from the top and so
+  // contributes C(board[i], num_cards_ - i - k).  prefix[k][i] sums these contributions over the
+  // first i board cards.
+  int nb = num_board_cards_;
+  unsigned int prefix[3][kMaxCards + 1];
+  for (int k = 0; k < 3; ++k) {
+    prefix[k][0] = 0;
+    for (int i = 0; i < nb; ++i) {
+      prefix[k][i + 1] = prefix[k][i] + Choose(board[i], num_cards_ - i - k);
     }
-#if 0
-    printf("    %u %u %u %u %u %u %u\n", a[0], a[1], a[2], a[3], a[4], a[5],
-	   a[6]);
-    fflush(stdout);
-#endif
-    return tree7_[a[0]][a[1]][a[2]][a[3]][a[4]][a[5]][a[6]];
-  } else {
-    fprintf(stderr, "HandValueTree::Val: unexpected number of cards: %u\n",
-	    num_cards_);
-    exit(-1);
+  }
+  for (int h = 0; h < num_hands; ++h) {
+    int hi = hole_cards[2 * h];
+    int lo = hole_cards[2 * h + 1];
+    // m0 (m1) is the number of board cards above the high (low) hole card.
+    int m0 = 0;
+    while (m0 < nb && board[m0] > hi) ++m0;
+    int m1 = m0;
+    while (m1 < nb && board[m1] > lo) ++m1;
+    unsigned int index = prefix[0][m0] + (prefix[1][m1] - prefix[1][m0]) +
+      (prefix[2][nb] - prefix[2][m1]) + Choose(hi, num_cards_ - m0) +
+      Choose(lo, num_cards_ - m1 - 1);
+    vals[h] = vals_[index];
   }
 }
 
@@ -612,7 +207,7 @@ int HandValueTree::DiskRead(Card *cards) {
     num_cards += Game::NumCardsForStreet(s);
   }
   char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.%i", Files::StaticBase(), 
+  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.%i", Files::StaticBase(),
 	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
 	  num_cards);
   Reader reader(buf);
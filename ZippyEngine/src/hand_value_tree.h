@@ -1,8 +1,15 @@
 #ifndef _HAND_VALUE_TREE_H_
 #define _HAND_VALUE_TREE_H_
 
+#include <stddef.h>
+
 #include "cards.h"
 
+// Despite the name, the hand values are stored in a single flat table with one entry per
+// combination of num_cards_ distinct cards.  A combination with cards c1 > c2 > ... > cn is found
+// at index C(c1, n) + C(c2, n-1) + ... + C(cn, 1), which is also the order in which
+// build_hand_value_tree writes the file.  The file is mapped into memory rather than read, so
+// startup is nearly instant and processes on the same machine share the pages.
 class HandValueTree {
 public:
   // Note: currently you need to make sure that this is called from only one thread.
@@ -12,28 +19,48 @@ public:
   // Does *not* assume cards are sorted
   static int Val(const Card *cards);
   // board and hole_cards should be sorted from high to low.
-  static int Val(const int *board, const int *hole_cards);
+  static int Val(const int *board, const int *hole_cards) {
+    int num_hole_cards = num_cards_ - num_board_cards_;
+    if (num_hole_cards == 2) {
+      // Merge the two hole cards into the board.  The position of a card from the bottom
+      // determines which column of the choose table to use.
+      int h0 = hole_cards[0], h1 = hole_cards[1];
+      int i = 0, n = num_cards_;
+      unsigned int index = 0;
+      while (i < num_board_cards_ && board[i] > h0) index += Choose(board[i++], n--);
+      index += Choose(h0, n--);
+      while (i < num_board_cards_ && board[i] > h1) index += Choose(board[i++], n--);
+      index += Choose(h1, n--);
+      while (i < num_board_cards_) index += Choose(board[i++], n--);
+      return vals_[index];
+    } else {
+      return SlowVal(board, hole_cards);
+    }
+  }
+  // Computes the values of num_hands hands on one board.  board should be sorted from high to
+  // low, and hole_cards holds the hole cards of each hand in turn, sorted from high to low.  The
+  // contribution of the board cards only depends on where the hole cards fall among them, so it
+  // is tabulated once per board and each hand costs a few table lookups.
+  static void Vals(const int *board, const Card *hole_cards, int num_hands, int *vals);
+  // Index of the given combination in the table.  cards should be sorted from high to low.
+  static unsigned int Index(const Card *cards, int num_cards);
   static int DiskRead(Card *cards);
 private:
   HandValueTree(void) {}
 
-  static void ReadOne(void);
-  static void ReadTwo(void);
-  static void ReadThree(void);
-  static void ReadFour(void);
-  static void ReadFive(void);
-  static void ReadSix(void);
-  static void ReadSeven(void);
+  static const int kMaxCards = 7;
+
+  static unsigned int Choose(int c, int n) {return choose_[c * (kMaxCards + 1) + n];}
+  static int SlowVal(const int *board, const int *hole_cards);
+  static void MapFile(void);
 
   static int num_board_cards_;
   static int num_cards_;
-  static int *tree1_;
-  static int **tree2_;
-  static int ***tree3_;
-  static int ****tree4_;
-  static int *****tree5_;
-  static int ******tree6_;
-  static int *******tree7_;
+  // Indexed by c * (kMaxCards + 1) + n
+  static unsigned int *choose_;
+  static const int *vals_;
+  static void *mapped_;
+  static size_t mapped_size_;
 };
 
 #endif
@@ -115,7 +115,8 @@ private:
   int msbd_;
   int b_pos_;
   // shared_ptr<HandTree> hand_tree_;
-  shared_ptr<HandTree> resolve_hand_tree_;
+  // Indexed by the street of the resolve.  Only depth-limited resolving needs more than one.
+  unique_ptr<shared_ptr<HandTree> []> resolve_hand_trees_;
   unique_ptr<shared_ptr<CanonicalCards> []> street_hands_;
   double sum_b_outcomes_;
   double sum_p0_outcomes_;
@@ -176,6 +177,7 @@ Player::Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
   b_betting_trees_.reset(new BettingTrees(b_ba));
 
   street_hands_.reset(new shared_ptr<CanonicalCards>[max_street + 1]);
+  resolve_hand_trees_.reset(new shared_ptr<HandTree>[max_street + 1]);
   
   bool shared_probs = 
     (a_ca.CardAbstractionName().c_str() == b_ca.CardAbstractionName() &&
@@ -501,19 +503,42 @@ void Player::Nonterminal(Node *a_node, Node *b_node, const string &action_sequen
 void Player::Walk(Node *a_node, Node *b_node, const string &action_sequence,
 		  const ReachProbs &reach_probs, int last_st) {
   int st = a_node->Street();
-  if (st > last_st && st == resolve_st_) {
+  // A depth-limited resolve has no strategy past its leaf street.  When we get there, we resolve
+  // again, rooted at the start of the new street.
+  bool a_leaf = resolve_a_ && st > resolve_st_ && a_eg_cfr_->Sumprobs() &&
+    a_eg_cfr_->Sumprobs()->StreetValues(st) == nullptr;
+  bool b_leaf = resolve_b_ && st > resolve_st_ && b_eg_cfr_->Sumprobs() &&
+    b_eg_cfr_->Sumprobs()->StreetValues(st) == nullptr;
+  if (st > last_st && (st == resolve_st_ || a_leaf || b_leaf)) {
+    int max_street = Game::MaxStreet();
+    int root_bd;
+    if (st == max_street) root_bd = msbd_;
+    else                  root_bd = BoardTree::PredBoard(msbd_, st);
+    if ((resolve_a_ || resolve_b_) && ! resolve_hand_trees_[st]) {
+      resolve_hand_trees_[st].reset(new HandTree(st, root_bd, max_street));
+    }
+    // Save the state of any enclosing resolve so that we can restore it when we are done with
+    // this one.
+    shared_ptr<CFRValues> a_sumprobs, b_sumprobs;
+    if (resolve_a_) a_sumprobs = a_eg_cfr_->Sumprobs();
+    if (resolve_b_) b_sumprobs = b_eg_cfr_->Sumprobs();
+    unique_ptr<BettingTrees> a_subtrees(a_subtrees_.release());
+    unique_ptr<BettingTrees> b_subtrees(b_subtrees_.release());
+    unique_ptr<int []> a_lbds(new int[max_street + 1]);
+    unique_ptr<int []> b_lbds(new int[max_street + 1]);
+    for (int st1 = 0; st1 <= max_street; ++st1) {
+      a_lbds[st1] = a_lbds_[st1];
+      b_lbds[st1] = b_lbds_[st1];
+    }
     Node *next_a_node, *next_b_node;
-    if (resolve_a_ && a_node->LastBetTo() < a_betting_abstraction_.StackSize()) {
+    if (resolve_a_ && (st == resolve_st_ || a_leaf) &&
+	a_node->LastBetTo() < a_betting_abstraction_.StackSize()) {
       a_subtrees_.reset(CreateSubtrees(st, a_node->PlayerActing(), a_node->LastBetTo(), -1,
 				       a_subgame_betting_abstraction_));
-      int max_street = Game::MaxStreet();
-      int root_bd;
-      if (st == max_street) root_bd = msbd_;
-      else                  root_bd = BoardTree::PredBoard(msbd_, st);
       struct timespec start, finish;
       clock_gettime(CLOCK_MONOTONIC, &start);
       a_eg_cfr_->SolveSubgame(a_subtrees_.get(), root_bd, reach_probs, action_sequence,
-			      resolve_hand_tree_.get(), nullptr, -1, true, num_subgame_its_);
+			      resolve_hand_trees_[st].get(), nullptr, -1, true, num_subgame_its_);
       clock_gettime(CLOCK_MONOTONIC, &finish);
       resolving_secs_ += (finish.tv_sec - start.tv_sec);
       resolving_secs_ += (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
@@ -528,20 +553,17 @@ void Player::Walk(Node *a_node, Node *b_node, const string &action_sequence,
     } else {
       next_a_node = a_node;
     }
-    if (resolve_b_ && b_node->LastBetTo() < b_betting_abstraction_.StackSize()) {
+    if (resolve_b_ && (st == resolve_st_ || b_leaf) &&
+	b_node->LastBetTo() < b_betting_abstraction_.StackSize()) {
       b_subtrees_.reset(CreateSubtrees(st, b_node->PlayerActing(), b_node->LastBetTo(), -1,
 				       b_subgame_betting_abstraction_));
-      int max_street = Game::MaxStreet();
-      int root_bd;
-      if (st == max_street) root_bd = msbd_;
-      else                  root_bd = BoardTree::PredBoard(msbd_, st);
       printf("Resolving %s b_pos_ %i id %i lbt %i\n", action_sequence.c_str(), b_pos_,
 	     b_node->NonterminalID(), b_node->LastBetTo());
       fflush(stdout);
       struct timespec start, finish;
       clock_gettime(CLOCK_MONOTONIC, &start);
       b_eg_cfr_->SolveSubgame(b_subtrees_.get(), root_bd, reach_probs, action_sequence,
-			      resolve_hand_tree_.get(), nullptr, -1, true, num_subgame_its_);
+			      resolve_hand_trees_[st].get(), nullptr, -1, true, num_subgame_its_);
       clock_gettime(CLOCK_MONOTONIC, &finish);
       resolving_secs_ += (finish.tv_sec - start.tv_sec);
       resolving_secs_ += (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
@@ -557,12 +579,16 @@ void Player::Walk(Node *a_node, Node *b_node, const string &action_sequence,
       next_b_node = b_node;
     }
     Walk(next_a_node, next_b_node, action_sequence, reach_probs, st);
-    // Release the memory now.  And make sure stale sumprobs are not accidentally used later.
-    if (resolve_a_) {
-      a_eg_cfr_->ClearSumprobs();
-    }
-    if (resolve_b_) {
-      b_eg_cfr_->ClearSumprobs();
+    // Release the memory now and restore the enclosing resolve, if any.  When returning from the
+    // outermost resolve this clears the sumprobs, which makes sure stale sumprobs are not
+    // accidentally used later.
+    if (resolve_a_) a_eg_cfr_->SetSumprobs(a_sumprobs);
+    if (resolve_b_) b_eg_cfr_->SetSumprobs(b_sumprobs);
+    a_subtrees_.reset(a_subtrees.release());
+    b_subtrees_.reset(b_subtrees.release());
+    for (int st1 = 0; st1 <= max_street; ++st1) {
+      a_lbds_[st1] = a_lbds[st1];
+      b_lbds_[st1] = b_lbds[st1];
     }
     return;
   }
@@ -600,13 +626,9 @@ void Player::ProcessMaxStreetBoard(int msbd) {
     b_lbds_[st] = pbd;
   }
 
-  if (resolve_a_ || resolve_b_) {
-    if (resolve_st_ < max_street) {
-      resolve_hand_tree_.reset(new HandTree(resolve_st_, BoardTree::PredBoard(msbd_, resolve_st_),
-					    max_street));
-    } else {
-      resolve_hand_tree_.reset(new HandTree(max_street, msbd_, max_street));
-    }
+  // Hand trees for resolving are created as needed by Walk()
+  for (int st = 0; st <= max_street; ++st) {
+    resolve_hand_trees_[st].reset();
   }
   
   for (int st = 0; st <= max_street; ++st) {
@@ -133,7 +133,8 @@ Reader *NewReaderMaybe(const char *filename) {
 }
 
 Reader::~Reader(void) {
-  close(fd_);
+  // Subclasses that don't read through fd_ (e.g., DeltaReader) leave it at -1
+  if (fd_ != -1) close(fd_);
 }
 
 bool Reader::AtEnd(void) const {
@@ -856,6 +857,239 @@ int Writer::BufPos(void) {
   return (int)(buf_ptr_ - buf_.get());
 }
 
+static unsigned char *AllocateAligned(long long int size) {
+  void *p;
+  if (posix_memalign(&p, kDirectIOAlign, size) != 0) {
+    fprintf(stderr, "posix_memalign failed; size %lli\n", size);
+    exit(-1);
+  }
+  return (unsigned char *)p;
+}
+
+// Turns O_DIRECT on or off for an open file.  Returns false if the filesystem doesn't support it.
+static bool SetDirect(int fd, bool direct) {
+  int flags = fcntl(fd, F_GETFL);
+  if (direct) flags |= O_DIRECT;
+  else        flags &= ~O_DIRECT;
+  return fcntl(fd, F_SETFL, flags) == 0;
+}
+
+static void *async_reader_thread_run(void *v_r) {
+  AsyncReader *r = (AsyncReader *)v_r;
+  r->ReadChunk();
+  return NULL;
+}
+
+AsyncReader::AsyncReader(const char *filename, int buf_size, bool direct) {
+  OpenFile(filename);
+  direct_ = direct && SetDirect(fd_, true);
+  // No point in a buffer bigger than the file
+  if (buf_size > file_size_) buf_size = file_size_;
+  buf_size_ = ((buf_size + kDirectIOAlign - 1) / kDirectIOAlign) * kDirectIOAlign;
+  if (buf_size_ == 0) buf_size_ = kDirectIOAlign;
+  for (int i = 0; i < 2; ++i) {
+    bufs_[i] = AllocateAligned(kDirectIOAlign + buf_size_);
+  }
+  front_ = 0;
+  pending_ = false;
+  next_offset_ = 0;
+  skip_ = 0;
+  buf_ptr_ = bufs_[front_] + kDirectIOAlign;
+  end_read_ = buf_ptr_;
+  StartRead();
+  if (! Refresh()) {
+    fprintf(stderr, "Warning: empty file: %s\n", filename);
+  }
+}
+
+AsyncReader::~AsyncReader(void) {
+  WaitForRead();
+  free(bufs_[0]);
+  free(bufs_[1]);
+}
+
+void AsyncReader::ReadChunk(void) {
+  unsigned char *p = bufs_[front_ ^ 1] + kDirectIOAlign;
+  num_read_ = 0;
+  while (num_read_ < buf_size_) {
+    int ret = pread(fd_, p + num_read_, buf_size_ - num_read_, read_offset_ + num_read_);
+    if (ret < 0) {
+      fprintf(stderr, "pread failed; offset %lli, errno %i\n", read_offset_ + num_read_, errno);
+      fprintf(stderr, "File: %s\n", filename_.c_str());
+      exit(-1);
+    }
+    if (ret == 0) break;
+    num_read_ += ret;
+  }
+}
+
+// Starts reading the next chunk into the back buffer
+void AsyncReader::StartRead(void) {
+  if (remaining_ == 0) return;
+  read_offset_ = next_offset_;
+  next_offset_ += buf_size_;
+  pending_ = true;
+  pthread_create(&pthread_id_, NULL, async_reader_thread_run, this);
+}
+
+// Returns true if there was a read in progress
+bool AsyncReader::WaitForRead(void) {
+  if (! pending_) return false;
+  pthread_join(pthread_id_, NULL);
+  pending_ = false;
+  return true;
+}
+
+bool AsyncReader::Refresh(void) {
+  if (remaining_ == 0 && overflow_size_ == 0) return false;
+
+  unsigned char *data;
+  long long int n = 0;
+  if (WaitForRead()) {
+    front_ ^= 1;
+    data = bufs_[front_] + kDirectIOAlign + skip_;
+    n = num_read_ - skip_;
+    if (n > remaining_) n = remaining_;
+    if (n <= 0) {
+      fprintf(stderr, "AsyncReader: premature EOF; remaining_ %lli\n", remaining_);
+      fprintf(stderr, "File: %s\n", filename_.c_str());
+      exit(-1);
+    }
+    skip_ = 0;
+  } else {
+    data = bufs_[front_] + kDirectIOAlign;
+  }
+  if (overflow_size_ > 0) {
+    memcpy(data - overflow_size_, overflow_, overflow_size_);
+  }
+  buf_ptr_ = data - overflow_size_;
+  end_read_ = data + n;
+  remaining_ -= n;
+  overflow_size_ = 0;
+  // The back buffer is free now that the caller has moved on to the new front buffer
+  StartRead();
+
+  return true;
+}
+
+void AsyncReader::SeekTo(long long int offset) {
+  WaitForRead();
+  long long int start = offset;
+  if (direct_) start = (offset / kDirectIOAlign) * kDirectIOAlign;
+  next_offset_ = start;
+  skip_ = offset - start;
+  remaining_ = file_size_ - offset;
+  overflow_size_ = 0;
+  byte_pos_ = offset;
+  buf_ptr_ = bufs_[front_] + kDirectIOAlign;
+  end_read_ = buf_ptr_;
+  StartRead();
+  Refresh();
+}
+
+static void *async_writer_thread_run(void *v_w) {
+  AsyncWriter *w = (AsyncWriter *)v_w;
+  w->WriteChunk();
+  return NULL;
+}
+
+AsyncWriter::AsyncWriter(const char *filename, int buf_size, bool direct) {
+  Init(filename, false, buf_size);
+  direct_ = direct && SetDirect(fd_, true);
+  staging_capacity_ = buf_size_ + kDirectIOAlign;
+  staging_ = AllocateAligned(staging_capacity_);
+  staging_len_ = 0;
+  write_len_ = 0;
+  offset_ = 0;
+  pending_ = false;
+}
+
+AsyncWriter::~AsyncWriter(void) {
+  Flush();
+  Finish();
+  free(staging_);
+}
+
+void AsyncWriter::WriteChunk(void) {
+  int done = 0;
+  while (done < write_len_) {
+    int written = pwrite(fd_, staging_ + done, write_len_ - done, offset_ + done);
+    if (written < 0) {
+      fprintf(stderr, "pwrite failed: tried to write %i; errno %i\n", write_len_ - done, errno);
+      fprintf(stderr, "File: %s\n", filename_.c_str());
+      exit(-1);
+    }
+    done += written;
+  }
+}
+
+// Waits for the write in progress, if any, and moves any bytes that were held back to the front
+// of the staging buffer.
+void AsyncWriter::WaitForWrite(void) {
+  if (! pending_) return;
+  pthread_join(pthread_id_, NULL);
+  pending_ = false;
+  offset_ += write_len_;
+  staging_len_ -= write_len_;
+  if (staging_len_ > 0) memmove(staging_, staging_ + write_len_, staging_len_);
+  write_len_ = 0;
+}
+
+void AsyncWriter::Flush(void) {
+  if (buf_ptr_ == buf_.get()) return;
+  WaitForWrite();
+  int len = (int)(buf_ptr_ - buf_.get());
+  // WriteNBytes() may have grown the buffer
+  if (staging_len_ + len > staging_capacity_) {
+    unsigned char *new_staging = AllocateAligned(staging_len_ + len);
+    memcpy(new_staging, staging_, staging_len_);
+    free(staging_);
+    staging_ = new_staging;
+    staging_capacity_ = staging_len_ + len;
+  }
+  memcpy(staging_ + staging_len_, buf_.get(), len);
+  staging_len_ += len;
+  buf_ptr_ = buf_.get();
+  write_len_ = staging_len_;
+  if (direct_) write_len_ = (staging_len_ / kDirectIOAlign) * kDirectIOAlign;
+  if (write_len_ == 0) return;
+  pending_ = true;
+  pthread_create(&pthread_id_, NULL, async_writer_thread_run, this);
+}
+
+// Completes all writes, including the partial block held back when writing with O_DIRECT.  That
+// block can't be written with O_DIRECT, so we turn it off, and leave it off since the file
+// position will no longer be aligned.
+void AsyncWriter::Finish(void) {
+  WaitForWrite();
+  if (staging_len_ == 0) return;
+  if (direct_) {
+    SetDirect(fd_, false);
+    direct_ = false;
+  }
+  write_len_ = staging_len_;
+  WriteChunk();
+  offset_ += write_len_;
+  staging_len_ = 0;
+  write_len_ = 0;
+}
+
+void AsyncWriter::SeekTo(long long int offset) {
+  Flush();
+  Finish();
+  if (direct_ && offset % kDirectIOAlign != 0) {
+    SetDirect(fd_, false);
+    direct_ = false;
+  }
+  offset_ = offset;
+}
+
+long long int AsyncWriter::Tell(void) {
+  Flush();
+  Finish();
+  return offset_;
+}
+
 ReadWriter::ReadWriter(const char *filename) {
   filename_ = filename;
   fd_ = open(filename, O_RDWR, 0666);
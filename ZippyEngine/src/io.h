@@ -1,6 +1,8 @@
 #ifndef _IO_H_
 #define _IO_H_
 
+#include <pthread.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -13,7 +15,7 @@ public:
   Reader(const char *filename, long long int file_size);
   virtual ~Reader(void);
   bool AtEnd(void) const;
-  void SeekTo(long long int offset);
+  virtual void SeekTo(long long int offset);
   bool ReadInt(int *i);
   int ReadIntOrDie(void);
   bool ReadUnsignedInt(unsigned int *i);
@@ -103,8 +105,8 @@ class Writer {
   void WriteNBytes(unsigned char *bytes, unsigned int num_bytes);
   void WriteBytes(unsigned char *bytes, int num_bytes);
   void WriteText(const char *s);
-  void SeekTo(long long int offset);
-  long long int Tell(void);
+  virtual void SeekTo(long long int offset);
+  virtual long long int Tell(void);
   const std::string &Filename(void) const {return filename_;}
   int fd(void) const {return fd_;}
   virtual void Flush(void);
@@ -113,6 +115,8 @@ class Writer {
  protected:
   static const int kBufSize = 65536;
 
+  // For subclasses, which must call Init()
+  Writer(void) {}
   void Init(const char *filename, bool modify, int buf_size);
 
   int fd_;
@@ -123,6 +127,76 @@ class Writer {
   std::string filename_;
 };
 
+// Block size for O_DIRECT.  Buffers, file offsets and transfer sizes must all be multiples of it.
+static const int kDirectIOAlign = 4096;
+// Default buffer size for AsyncReader and AsyncWriter
+static const int kAsyncBufSize = 1 << 22;
+
+// Reads ahead in a background thread: while the caller consumes one buffer, the next chunk of the
+// file is read into the other.  Meant for streaming through large files, so the buffers are much
+// bigger than Reader's.  If direct is true, the file is read with O_DIRECT so that streaming
+// through it doesn't evict everything else from the page cache.  We silently fall back to
+// buffered reads on filesystems that don't support O_DIRECT.
+class AsyncReader : public Reader {
+public:
+  AsyncReader(const char *filename, int buf_size = kAsyncBufSize, bool direct = false);
+  ~AsyncReader(void);
+  void SeekTo(long long int offset);
+  // Executed in the read-ahead thread
+  void ReadChunk(void);
+protected:
+  bool Refresh(void);
+private:
+  void StartRead(void);
+  bool WaitForRead(void);
+
+  // Each buffer has kDirectIOAlign bytes of headroom in front of the data, so that leftover bytes
+  // from the previous buffer can be put just before the new data.
+  unsigned char *bufs_[2];
+  // The buffer the caller is consuming
+  int front_;
+  bool direct_;
+  bool pending_;
+  pthread_t pthread_id_;
+  // File offset of the next chunk to read; aligned if direct_ is true
+  long long int next_offset_;
+  long long int read_offset_;
+  // Bytes at the start of the pending chunk that precede the position we sought to
+  int skip_;
+  int num_read_;
+};
+
+// Writes in a background thread: Flush() hands the full buffer off to the writing thread and
+// returns, so that the caller can carry on filling the buffer while the write is in progress.
+// With direct true, the file is written with O_DIRECT; see AsyncReader.  Only the final partial
+// block of the file is written without O_DIRECT.
+class AsyncWriter : public Writer {
+public:
+  AsyncWriter(const char *filename, int buf_size = kAsyncBufSize, bool direct = false);
+  ~AsyncWriter(void);
+  void Flush(void);
+  void SeekTo(long long int offset);
+  long long int Tell(void);
+  // Executed in the writing thread
+  void WriteChunk(void);
+private:
+  void WaitForWrite(void);
+  void Finish(void);
+
+  // Data handed off by Flush().  Aligned, as O_DIRECT requires.  When writing with O_DIRECT, the
+  // bytes beyond the last whole block are held back until the next Flush().
+  unsigned char *staging_;
+  int staging_capacity_;
+  int staging_len_;
+  // Number of bytes at the start of staging_ being written by the writing thread
+  int write_len_;
+  // File offset of staging_[0]
+  long long int offset_;
+  bool direct_;
+  bool pending_;
+  pthread_t pthread_id_;
+};
+
 class ReadWriter {
 public:
   ReadWriter(const char *filename);
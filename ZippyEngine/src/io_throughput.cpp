@@ -0,0 +1,119 @@
+// Measures the throughput of Reader and Writer against AsyncReader and AsyncWriter on a large
+// file.  We write and then read back <size in MB> of ints, doing a little work per value as CFR
+// does when reading and writing its values.  Writes are followed by an fsync(), and the file is
+// dropped from the page cache before each read, so that we time the disk and not the cache.
+//
+// Use a file on the filesystem that holds your CFR output; /tmp may be memory backed.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "io.h"
+
+using std::string;
+using std::unique_ptr;
+
+static double Secs(const struct timespec &start) {
+  struct timespec finish;
+  clock_gettime(CLOCK_MONOTONIC, &finish);
+  return (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void DropFromCache(const char *filename) {
+  int fd = open(filename, O_RDONLY, 0);
+  if (fd == -1) {
+    fprintf(stderr, "Failed to open %s\n", filename);
+    exit(-1);
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+static void TimeWrite(Writer *writer, long long int num_ints, const char *label) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  unsigned int x = 1;
+  for (long long int i = 0; i < num_ints; ++i) {
+    x = x * 1103515245 + 12345;
+    writer->WriteInt(x >> 1);
+  }
+  // Tell() completes all outstanding writes
+  writer->Tell();
+  fsync(writer->fd());
+  double secs = Secs(start);
+  fprintf(stderr, "%-24s %8.1f MB/sec\n", label, num_ints * sizeof(int) / secs / 1e6);
+}
+
+static void TimeRead(Reader *reader, long long int num_ints, const char *label) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  unsigned int x = 1;
+  for (long long int i = 0; i < num_ints; ++i) {
+    x = x * 1103515245 + 12345;
+    if (reader->ReadIntOrDie() != (int)(x >> 1)) {
+      fprintf(stderr, "%s: mismatch at int %lli\n", label, i);
+      exit(-1);
+    }
+  }
+  if (! reader->AtEnd()) {
+    fprintf(stderr, "%s: didn't get to end\n", label);
+    exit(-1);
+  }
+  double secs = Secs(start);
+  fprintf(stderr, "%-24s %8.1f MB/sec\n", label, num_ints * sizeof(int) / secs / 1e6);
+}
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <file> <size in MB> (<buf size in KB>)\n", prog_name);
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3 && argc != 4) Usage(argv[0]);
+  const char *filename = argv[1];
+  int mb;
+  if (sscanf(argv[2], "%i", &mb) != 1 || mb < 1) Usage(argv[0]);
+  int buf_size = kAsyncBufSize;
+  if (argc == 4) {
+    int kb;
+    if (sscanf(argv[3], "%i", &kb) != 1 || kb < 4) Usage(argv[0]);
+    buf_size = kb * 1024;
+  }
+  long long int num_ints = ((long long int)mb) * 1024 * 1024 / sizeof(int);
+
+  for (int t = 0; t < 3; ++t) {
+    string label;
+    unique_ptr<Writer> writer;
+    if (t == 0) {
+      label = "Writer";
+      writer.reset(new Writer(filename));
+    } else {
+      bool direct = (t == 2);
+      label = direct ? "AsyncWriter (direct)" : "AsyncWriter";
+      writer.reset(new AsyncWriter(filename, buf_size, direct));
+    }
+    TimeWrite(writer.get(), num_ints, label.c_str());
+  }
+  for (int t = 0; t < 3; ++t) {
+    DropFromCache(filename);
+    string label;
+    unique_ptr<Reader> reader;
+    if (t == 0) {
+      label = "Reader";
+      reader.reset(new Reader(filename));
+    } else {
+      bool direct = (t == 2);
+      label = direct ? "AsyncReader (direct)" : "AsyncReader";
+      reader.reset(new AsyncReader(filename, buf_size, direct));
+    }
+    TimeRead(reader.get(), num_ints, label.c_str());
+  }
+  RemoveFile(filename);
+}
@@ -5,12 +5,15 @@
 #include <unistd.h>   // vfork
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "delta_io.h"
 #include "io.h"
 #include "split.h"
 
 using std::string;
+using std::unordered_map;
 using std::vector;
 
 // 2019-06-13 16:31:28    1187056 regrets.x.0.0.0.0.p0.i
@@ -61,36 +64,73 @@ static long long int TargetSize(int st, bool regrets, int p) {
   }
 }
 
-static bool Ready(int it) {
+static string ValuesFilename(int st, bool regrets, int p, int it) {
   char buf[500];
+  if (regrets) {
+    sprintf(buf, "%s/regrets.x.0.0.%i.%i.p%i.%c", kDir, st, it, p,
+	    st == 1 ? 'c' : (st >= 2 ? 's' : 'i'));
+  } else {
+    sprintf(buf, "%s/sumprobs.x.0.0.%i.%i.p%i.i", kDir, st, it, p);
+  }
+  return buf;
+}
+
+// A values file written as a delta checkpoint (see delta_io.h) is its manifest plus the blocks
+// files the manifest refers to.  Some of those may have been written by earlier checkpoints;
+// all of them are needed to restore the values.
+static bool Ready(int it, vector<string> *files) {
+  files->clear();
   for (int st = 0; st <= 3; ++st) {
     for (int r = 0; r <= 1; ++r) {
       for (int p = 0; p <= 1; ++p) {
-	if (r) {
-	  sprintf(buf, "%s/regrets.x.0.0.%i.%i.p%i.%c", kDir, st, it, p,
-		  st == 1 ? 'c' : (st >= 2 ? 's' : 'i'));
+	string filename = ValuesFilename(st, r, p, it);
+	long long int target_size = TargetSize(st, r, p);
+	DeltaManifest manifest;
+	if (ReadDeltaManifest(filename.c_str(), &manifest)) {
+	  if (manifest.file_size != target_size) return false;
+	  files->push_back(filename + ".manifest");
+	  int num_sources = manifest.sources.size();
+	  for (int i = 0; i < num_sources; ++i) {
+	    string source = string(kDir) + "/" + manifest.sources[i];
+	    if (! FileExists(source.c_str())) return false;
+	    files->push_back(source);
+	  }
 	} else {
-	  sprintf(buf, "%s/sumprobs.x.0.0.%i.%i.p%i.i", kDir, st, it, p);
+	  if (! FileExists(filename.c_str())) return false;
+	  if (FileSize(filename.c_str()) != target_size) return false;
+	  files->push_back(filename);
 	}
-	if (! FileExists(buf)) return false;
-	long long int target_size = TargetSize(st, r, p);
-	if (FileSize(buf) != target_size) return false;
       }
     }
   }
   return true;
 }
 
+static string Basename(const string &filename) {
+  size_t slash = filename.rfind('/');
+  if (slash == string::npos) return filename;
+  return filename.substr(slash + 1);
+}
+
 // Uses vfork() and execvp() to fork off a child process to copy the files to S3.
 // Unfortunate that we have to hard code the location of aws (/usr/bin).
-static void Backup(void) {
+// The argument list is built before forking; the child of vfork() shouldn't allocate.
+static void Backup(const vector<string> &files) {
+  vector<string> basenames;
+  int num_files = files.size();
+  for (int i = 0; i < num_files; ++i) basenames.push_back(Basename(files[i]));
+  char const *binary = "/usr/bin/aws";
+  vector<const char *> newargv = { binary, "s3", "cp", kDir, "s3://slumbot2019cfr",
+				   "--recursive", "--quiet", "--exclude", "*" };
+  for (int i = 0; i < num_files; ++i) {
+    newargv.push_back("--include");
+    newargv.push_back(basenames[i].c_str());
+  }
+  newargv.push_back(NULL);
   int pid = vfork();
   if (pid == 0) {
     // Child
-    char const *binary = "/usr/bin/aws";
-    char const * newargv[] = { binary, "s3", "cp", kDir, "s3://slumbot2019cfr", "--recursive",
-			       "--quiet", NULL };
-    execvp(binary, (char * const *)newargv);
+    execvp(binary, (char * const *)newargv.data());
     fprintf(stderr, "Failed to execvp aws s3 cp process\n");
     exit(-1);
   }
@@ -102,69 +142,35 @@ static void Backup(void) {
   }
 }
 
-static bool BackupDone(int target_it) {
+// Returns true if every one of files is in S3 with the same size as our copy
+static bool BackupDone(const vector<string> &files) {
   char cmd[500], output[500];
   strcpy(cmd, "/usr/bin/aws s3 ls s3://slumbot2019cfr");
   FILE *fp = popen(cmd, "r");
-  vector<string> lines;
+  unordered_map<string, long long int> sizes;
+  vector<string> comps;
   while (fgets(output, sizeof(output), fp)) {
-    string line = output;
-    lines.push_back(line);
-  }
-  int num_lines = lines.size();
-  int num_done = 0;
-  vector<string> comps1, comps2;
-  for (int i = 0; i < num_lines; ++i) {
-    const string &line = lines[i];
-    Split(line.c_str(), ' ', false, &comps1);
-    if (comps1.size() != 4) {
-      fprintf(stderr, "Not 4 components in %s\n", line.c_str());
+    Split(output, ' ', false, &comps);
+    if (comps.size() != 4) {
+      fprintf(stderr, "Not 4 components in %s\n", output);
       exit(-1);
     }
-    const string &sz_str = comps1[2];
-    const string &fn = comps1[3];
     long long int file_size;
-    if (sscanf(sz_str.c_str(), "%lli", &file_size) != 1) {
-      fprintf(stderr, "Couldn't parse file size: %s\n", line.c_str());
+    if (sscanf(comps[2].c_str(), "%lli", &file_size) != 1) {
+      fprintf(stderr, "Couldn't parse file size: %s\n", output);
       exit(-1);
     }
-    Split(fn.c_str(), '.', false, &comps2);
-    if (comps2.size() != 8) {
-      fprintf(stderr, "Not 8 components in file name in %s\n", line.c_str());
-      exit(-1);
-    }
-    int it, st, p;
-    bool regrets;
-    if (sscanf(comps2[5].c_str(), "%i", &it) != 1) {
-      fprintf(stderr, "Couldn't parse iteration from file name in %s\n", line.c_str());
-      exit(-1);
-    }
-    if (target_it == it) {
-      if (sscanf(comps2[4].c_str(), "%i", &st) != 1) {
-	fprintf(stderr, "Couldn't parse street from file name in %s\n", line.c_str());
-	exit(-1);
-      }
-      if (comps2[0] == "regrets") {
-	regrets = true;
-      } else if (comps2[0] == "sumprobs") {
-	regrets = false;
-      } else {
-	fprintf(stderr, "Not regrets or sumprobs?!?  %s\n", line.c_str());
-	exit(-1);
-      }
-      if (comps2[6] == "p0") {
-	p = 0;
-      } else if (comps2[6] == "p1") {
-	p = 1;
-      } else {
-	fprintf(stderr, "Not p0 or p1?!?  %s\n", line.c_str());
-	exit(-1);
-      }
-      long long int target_size = TargetSize(st, regrets, p);
-      if (target_size == file_size) ++num_done;
-    }
+    string fn = comps[3];
+    while (fn.size() > 0 && (fn.back() == '\n' || fn.back() == '\r')) fn.pop_back();
+    sizes[fn] = file_size;
   }
-  return num_done == 16;
+  pclose(fp);
+  int num_files = files.size();
+  for (int i = 0; i < num_files; ++i) {
+    unordered_map<string, long long int>::const_iterator it = sizes.find(Basename(files[i]));
+    if (it == sizes.end() || it->second != FileSize(files[i].c_str())) return false;
+  }
+  return true;
 }
 
 static void EmptyDirectory(void) {
@@ -172,7 +178,8 @@ static void EmptyDirectory(void) {
   if (pid == 0) {
     // Child
     // We delete the directory as well as the contents.  run_tcfr will recreate it when it
-    // checkpoints the next iteration.
+    // checkpoints the next iteration.  With delta checkpoints, that checkpoint finds no base
+    // manifest and is written in full, so nothing refers to the blocks files deleted here.
     char const *binary = "/usr/bin/rm";
     char const * newargv[] = { binary, "-rf", kDir, NULL };
     execvp(binary, (char * const *)newargv);
@@ -196,11 +203,12 @@ int main(int argc, char *argv[]) {
   if (argc != 2) Usage(argv[0]);
   int it;
   if (sscanf(argv[1], "%i", &it) != 1) Usage(argv[0]);
+  vector<string> files;
   while (true) {
-    if (Ready(it)) {
-      Backup();
+    if (Ready(it, &files)) {
+      Backup(files);
       while (true) {
-	if (BackupDone(it)) {
+	if (BackupDone(files)) {
 	  EmptyDirectory();
 	  ++it;
 	  break;
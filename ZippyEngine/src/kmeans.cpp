@@ -12,22 +12,25 @@
 #include <stdlib.h>
 
 #include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "constants.h"
+#include "feature_store.h"
 #include "kmeans.h"
 #include "rand.h"
 #include "sorting.h"
 
+using std::unique_ptr;
 using std::vector;
 
-static int g_it = 0;
-
 class KMeansThread {
 public:
-  KMeansThread(int num_objects, int num_clusters, float **objects, int dim, double neighbor_thresh,
+  KMeansThread(int num_objects, int num_clusters, const FeatureStore *objects, int dim,
+	       double neighbor_thresh,
 	       int *cluster_sizes, float **means, int *assignments,
-	       vector< pair<float, int> > *neighbor_vectors, int thread_index, int num_threads);
+	       vector< pair<float, int> > *neighbor_vectors, const int *it, int thread_index,
+	       int num_threads);
   ~KMeansThread(void) {}
   void Assign(void);
   void ComputeIntraCentroidDistances(void);
@@ -39,19 +42,23 @@ public:
   int NumChanged(void) const {return num_changed_;}
   double SumDists(void) const {return sum_dists_;}
 private:
-  int ExhaustiveNearest(int o, float *obj, int guess_c, double guess_min_dist,
+  int ExhaustiveNearest(int o, const float *obj, int guess_c, double guess_min_dist,
 			double *ret_min_dist);
-  int Nearest(int o, float *obj, double *ret_min_dist);
+  int Nearest(int o, const float *obj, double *ret_min_dist);
 
   int num_objects_;
   int num_clusters_;
-  float **objects_;
+  const FeatureStore *objects_;
   int dim_;
   double neighbor_thresh_;
   int *cluster_sizes_;
   float **means_;
   int *assignments_;
   vector< pair<float, int> > *neighbor_vectors_;
+  // Objects not stored as floats are decoded here
+  unique_ptr<float []> obj_buf_;
+  // The KMeans object's iteration number
+  const int *it_;
   int thread_index_;
   int num_threads_;
   int num_changed_;
@@ -62,10 +69,10 @@ private:
   pthread_t pthread_id_;
 };
 
-KMeansThread::KMeansThread(int num_objects, int num_clusters, float **objects, int dim,
-			   double neighbor_thresh, int *cluster_sizes, float **means,
+KMeansThread::KMeansThread(int num_objects, int num_clusters, const FeatureStore *objects,
+			   int dim, double neighbor_thresh, int *cluster_sizes, float **means,
 			   int *assignments, vector< pair<float, int> > *neighbor_vectors,
-			   int thread_index, int num_threads) {
+			   const int *it, int thread_index, int num_threads) {
   num_objects_ = num_objects;
   num_clusters_ = num_clusters;
   objects_ = objects;
@@ -75,6 +82,8 @@ KMeansThread::KMeansThread(int num_objects, int num_clusters, float **objects, i
   means_ = means;
   assignments_ = assignments;
   neighbor_vectors_ = neighbor_vectors;
+  obj_buf_.reset(new float[dim]);
+  it_ = it;
   thread_index_ = thread_index;
   num_threads_ = num_threads;
   num_changed_ = 0;
@@ -142,7 +151,7 @@ unsigned int KMeansThread::Nearest(unsigned int o, float *obj,
 }
 #endif
 
-int KMeansThread::ExhaustiveNearest(int o, float *obj, int guess_c, double guess_min_dist,
+int KMeansThread::ExhaustiveNearest(int o, const float *obj, int guess_c, double guess_min_dist,
 				    double *ret_min_dist) {
   float min_dist = guess_min_dist;
   int best_c = guess_c;
@@ -185,7 +194,7 @@ int KMeansThread::ExhaustiveNearest(int o, float *obj, int guess_c, double guess
 // with ExhaustiveNearest().  Hopefully this doesn't happen too often.  In
 // case (1) we can instead repeat the process we just followed, this time
 // using the neighbors list of the new best candidate.
-int KMeansThread::Nearest(int o, float *obj, double *ret_min_dist) {
+int KMeansThread::Nearest(int o, const float *obj, double *ret_min_dist) {
   // Initialize orig_best_c to the current assignment.  This will make the
   // triangle inequality based optimization work better.
   int orig_best_c = assignments_[o];
@@ -282,10 +291,10 @@ void KMeansThread::Assign(void) {
   double dist;
   sum_dists_ = 0;
   for (int o = thread_index_; o < num_objects_; o += num_threads_) {
-    if (g_it == 0 && thread_index_ == 0 && (o / num_threads_) % 10000 == 0) {
-      fprintf(stderr, "It %i o %i/%i\n", g_it, o, num_objects_);
+    if (*it_ == 0 && thread_index_ == 0 && (o / num_threads_) % 10000 == 0) {
+      fprintf(stderr, "It %i o %i/%i\n", *it_, o, num_objects_);
     }
-    float *obj = objects_[o];
+    const float *obj = objects_->Object(o, obj_buf_.get());
     int nearest = Nearest(o, obj, &dist);
     sum_dists_ += dist;
     if (nearest != assignments_[o]) ++num_changed_;
@@ -437,10 +446,11 @@ void KMeans::SeedPlusPlus(void) {
   bool *used = new bool[num_objects_];
   for (int o = 0; o < num_objects_; ++o) used[o] = false;
   // For the first centroid, choose one of the input objects at random
-  int o = RandBetween(0, num_objects_ - 1);
+  int o = RandInt(0, num_objects_ - 1);
   used[o] = true;
+  const float *seed = objects_->Object(o, obj_buf_.get());
   for (int f = 0; f < dim_; ++f) {
-    means_[0][f] = objects_[o][f];
+    means_[0][f] = seed[f];
   }
   double *sq_distance_to_nearest = new double[num_objects_];
   double *cum_sq_distance_to_nearest = new double[num_objects_];
@@ -452,7 +462,7 @@ void KMeans::SeedPlusPlus(void) {
       continue;
     }
     double sq_dist = 0;
-    float *obj = objects_[o];
+    const float *obj = objects_->Object(o, obj_buf_.get());
     for (int d = 0; d < dim_; ++d) {
       double ov = obj[d];
       double cm = means_[0][d];
@@ -468,7 +478,7 @@ void KMeans::SeedPlusPlus(void) {
     if (c % 1000 == 0) {
       fprintf(stderr, "SeedPlusPlus: c %i/%i\n", c, num_clusters_);
     }
-    double x = RandZeroToOne() * sum_min_sq_dist;
+    double x = RandFrac() * sum_min_sq_dist;
     int o;
 #if 1
     o = BinarySearch(x, 0, num_objects_, cum_sq_distance_to_nearest, used);
@@ -483,8 +493,9 @@ void KMeans::SeedPlusPlus(void) {
     used[o] = true;
     // Helps with old version of search
     sq_distance_to_nearest[o] = 0;
+    const float *seed = objects_->Object(o, obj_buf_.get());
     for (int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects_[o][f];
+      means_[c][f] = seed[f];
     }
     sum_min_sq_dist = 0;
     double cum_sq_dist = 0;
@@ -493,7 +504,7 @@ void KMeans::SeedPlusPlus(void) {
 	cum_sq_distance_to_nearest[o] = cum_sq_dist;
 	continue;
       }
-      float *obj = objects_[o];
+      const float *obj = objects_->Object(o, obj_buf_.get());
       double sq_dist = 0;
       for (int d = 0; d < dim_; ++d) {
 	double ov = obj[d];
@@ -521,11 +532,12 @@ void KMeans::Seed1(void) {
   for (int c = 0; c < num_clusters_; ++c) {
     int o;
     do {
-      o = RandBetween(0, num_objects_ - 1);
+      o = RandInt(0, num_objects_ - 1);
     } while (used[o]);
     used[o] = true;
+    const float *seed = objects_->Object(o, obj_buf_.get());
     for (int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects_[o][f];
+      means_[c][f] = seed[f];
     }
   }
   delete [] used;
@@ -540,9 +552,10 @@ void KMeans::Seed2(void) {
   for (int c = 0; c < num_clusters_; ++c) {
     for (int f = 0; f < dim_; ++f) sums[f] = 0;
     for (int i = 0; i < num_sample; ++i) {
-      int o = RandBetween(0, num_objects_ - 1);
+      int o = RandInt(0, num_objects_ - 1);
+      const float *obj = objects_->Object(o, obj_buf_.get());
       for (int f = 0; f < dim_; ++f) {
-	sums[f] += objects_[o][f];
+	sums[f] += obj[f];
       }
     }
     for (int f = 0; f < dim_; ++f) {
@@ -553,22 +566,24 @@ void KMeans::Seed2(void) {
 }
 
 // Should I assume dups have been removed?
-void KMeans::SingleObjectClusters(int num_clusters, int dim, int num_objects, float **objects) {
-  num_clusters_ = num_objects;
-  dim_ = dim;
-  num_objects_ = num_objects;
+void KMeans::SingleObjectClusters(const FeatureStore *objects) {
+  num_clusters_ = objects->NumObjects();
+  dim_ = objects->Dim();
+  num_objects_ = objects->NumObjects();
   objects_ = objects;
+  obj_buf_.reset(new float[dim_]);
   cluster_sizes_ = new int[num_clusters_];
   means_ = new float *[num_clusters_];
   for (int c = 0; c < num_clusters_; ++c) {
-    means_[c] = new float[dim];
+    means_[c] = new float[dim_];
   }
   assignments_ = new int[num_objects_];
   for (int o = 0; o < num_objects_; ++o) {
     int c = o;
     assignments_[o] = c;
+    const float *obj = objects_->Object(o, obj_buf_.get());
     for (int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects[o][f];
+      means_[c][f] = obj[f];
     }
     cluster_sizes_[c] = 1;
   }
@@ -576,16 +591,39 @@ void KMeans::SingleObjectClusters(int num_clusters, int dim, int num_objects, fl
   num_threads_ = 0;
 }
 
-KMeans::KMeans(int num_clusters, int dim, int num_objects, float **objects, double neighbor_thresh,
-	       int num_threads) {
+int KMeans::RandInt(int lower, int upper) {
+  if (seed_ == -1) return RandBetween(lower, upper);
+  double r;
+  drand48_r(&rand_buf_, &r);
+  return lower + (int)(r * ((double)(upper + 1 - lower)));
+}
+
+double KMeans::RandFrac(void) {
+  if (seed_ == -1) return RandZeroToOne();
+  double r;
+  drand48_r(&rand_buf_, &r);
+  return r;
+}
+
+KMeans::KMeans(int num_clusters, const FeatureStore *objects, double neighbor_thresh,
+	       int num_threads, int seed) {
+  seed_ = seed;
+  if (seed_ != -1) srand48_r(seed_, &rand_buf_);
+  it_ = 0;
   neighbor_vectors_ = NULL;
   cluster_sizes_ = NULL;
   means_ = NULL;
   assignments_ = NULL;
   threads_ = NULL;
+  int dim = objects->Dim();
+  int num_objects = objects->NumObjects();
+  if (num_clusters < 1) {
+    fprintf(stderr, "Number of clusters must be positive: %i\n", num_clusters);
+    exit(-1);
+  }
   if (num_clusters >= num_objects) {
     fprintf(stderr, "Assigning every object to its own cluster\n");
-    SingleObjectClusters(num_clusters, dim, num_objects, objects);
+    SingleObjectClusters(objects);
     return;
   }
   num_clusters_ = num_clusters;
@@ -594,6 +632,7 @@ KMeans::KMeans(int num_clusters, int dim, int num_objects, float **objects, doub
   dim_ = dim;
   num_objects_ = num_objects;
   objects_ = objects;
+  obj_buf_.reset(new float[dim]);
   neighbor_thresh_ = neighbor_thresh;
   cluster_sizes_ = new int[num_clusters_];
   means_ = new float *[num_clusters_];
@@ -626,7 +665,7 @@ KMeans::KMeans(int num_clusters, int dim, int num_objects, float **objects, doub
 
   // If neighbor_thresh_ is zero, don't compute neighbors lists.
   if (neighbor_thresh_ > 0) {
-    neighbor_vectors_ = new vector< pair<float, int> >[num_clusters_];
+    neighbor_vectors_ = new vector< pair<float, int> >[num_clusters];
   } else {
     neighbor_vectors_ = NULL;
   }
@@ -636,7 +675,7 @@ KMeans::KMeans(int num_clusters, int dim, int num_objects, float **objects, doub
   for (int t = 0; t < num_threads_; ++t) {
     threads_[t] = new KMeansThread(num_objects_, num_clusters_, objects_, dim_, neighbor_thresh_,
 				   cluster_sizes_, means_, assignments_, neighbor_vectors_,
-				   t, num_threads_);
+				   &it_, t, num_threads_);
   }
 
   // Normally we call this at the end of each iteration.  Call it once now
@@ -757,7 +796,7 @@ void KMeans::Update(void) {
     // During initialization we will assign some objects to cluster -1
     // meaning they are unassigned
     if (c == -1) continue;
-    float *obj = objects_[o];
+    const float *obj = objects_->Object(o, obj_buf_.get());
     for (int d = 0; d < dim_; ++d) {
       sums[c][d] += obj[d];
     }
@@ -807,7 +846,7 @@ void KMeans::Cluster(int num_its) {
   }
   int it = 0;
   while (true) {
-    g_it = it;
+    it_ = it;
     double avg_dist;
     int num_changed = Assign(&avg_dist);
     fprintf(stderr, "It %i num_changed %i avg dist %f\n", it, num_changed, avg_dist);
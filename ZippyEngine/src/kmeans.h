@@ -1,29 +1,35 @@
 #ifndef _KMEANS_H_
 #define _KMEANS_H_
 
+#include <stdlib.h> // struct drand48_data
+
+#include <memory>
 #include <vector>
 
 using namespace std;
 
+class FeatureStore;
 class KMeansThread;
 
 class KMeans {
 public:
-  KMeans(int num_clusters, int dim, int num_objects, float **objects, double neighbor_thresh,
-	 int num_threads);
+  // If seed is -1, seeding draws from the global generator of rand.h.  Otherwise the KMeans
+  // object has its own generator, seeded with seed, so that several can run in parallel
+  // reproducibly.
+  KMeans(int num_clusters, const FeatureStore *objects, double neighbor_thresh, int num_threads,
+	 int seed);
   ~KMeans(void);
   void Cluster(int num_its);
   int Assignment(int o) const {return assignments_[o];}
   int NumClusters(void) const {return num_clusters_;}
   int ClusterSize(int c) const {return cluster_sizes_[c];}
-  void SingleObjectClusters(int num_clusters, int dim, int num_objects, float **objects);
+  void SingleObjectClusters(const FeatureStore *objects);
 
   static const int kMaxNeighbors = 10000;
 
 
  protected:
   void ComputeIntraCentroidDistances(void);
-  int Nearest(int o, float *obj) const;
   int Assign(double *avg_dist);
   void Update(void);
   void EliminateEmpty(void);
@@ -31,10 +37,14 @@ public:
   void SeedPlusPlus(void);
   void Seed1();
   void Seed2();
+  int RandInt(int lower, int upper);
+  double RandFrac(void);
 
   int num_objects_;
   int num_clusters_;
-  float **objects_;
+  const FeatureStore *objects_;
+  // Objects not stored as floats are decoded here
+  unique_ptr<float []> obj_buf_;
   int dim_;
   double neighbor_thresh_;
   int *cluster_sizes_;
@@ -45,6 +55,9 @@ public:
   double assign_time_;
   int num_threads_;
   KMeansThread **threads_;
+  int it_;
+  int seed_;
+  struct drand48_data rand_buf_;
 };
 
 #endif
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "files.h"
+#include "game.h"
+#include "io.h"
+#include "leaf_value_table.h"
+
+using std::string;
+using std::vector;
+
+string LeafValueTable::Filename(const string &bucketing, int st) {
+  char buf[500];
+  sprintf(buf, "%s/leaf_values.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
+	  Game::NumRanks(), Game::NumSuits(), Game::MaxStreet(), bucketing.c_str(), st);
+  return buf;
+}
+
+LeafValueTable::LeafValueTable(const string &bucketing, int st) :
+  bucketing_(bucketing), st_(st), buckets_(st, bucketing) {
+  num_hole_card_pairs_ = Game::NumHoleCardPairs(st);
+  string filename = Filename(bucketing, st);
+  Reader reader(filename.c_str());
+  num_buckets_ = reader.ReadIntOrDie();
+  int num_pots = reader.ReadIntOrDie();
+  pots_.resize(num_pots);
+  for (int i = 0; i < num_pots; ++i) pots_[i] = reader.ReadIntOrDie();
+  int num_vals = num_buckets_ * num_pots;
+  vals_.reset(new double[num_vals]);
+  for (int i = 0; i < num_vals; ++i) vals_[i] = reader.ReadDoubleOrDie();
+
+  if (buckets_.NumBuckets(st) != num_buckets_) {
+    fprintf(stderr, "LeafValueTable: %s has %i buckets; bucketing %s has %i\n", filename.c_str(),
+	    num_buckets_, bucketing.c_str(), buckets_.NumBuckets(st));
+    exit(-1);
+  }
+}
+
+double LeafValueTable::Value(int b, int last_bet_to) const {
+  int num_pots = pots_.size();
+  const double *my_vals = vals_.get() + b * num_pots;
+  if (last_bet_to <= pots_[0]) {
+    return my_vals[0] * last_bet_to / pots_[0];
+  }
+  if (last_bet_to >= pots_[num_pots - 1]) {
+    return my_vals[num_pots - 1] * last_bet_to / pots_[num_pots - 1];
+  }
+  int i = 1;
+  while (pots_[i] < last_bet_to) ++i;
+  double w = (last_bet_to - pots_[i - 1]) / (double)(pots_[i] - pots_[i - 1]);
+  return (1.0 - w) * my_vals[i - 1] + w * my_vals[i];
+}
+
+// pots must be sorted in ascending order.  vals is indexed by b * num_pots + pot index.
+void LeafValueTable::Write(const string &bucketing, int st, int num_buckets,
+			   const vector<int> &pots, const double *vals) {
+  string filename = Filename(bucketing, st);
+  Writer writer(filename.c_str());
+  int num_pots = pots.size();
+  writer.WriteInt(num_buckets);
+  writer.WriteInt(num_pots);
+  for (int i = 0; i < num_pots; ++i) writer.WriteInt(pots[i]);
+  int num_vals = num_buckets * num_pots;
+  for (int i = 0; i < num_vals; ++i) writer.WriteDouble(vals[i]);
+}
@@ -0,0 +1,46 @@
+#ifndef _LEAF_VALUE_TABLE_H_
+#define _LEAF_VALUE_TABLE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buckets.h"
+
+// Precomputed values for the leaves of depth-limited subgames.  A leaf is a street-initial node
+// that we don't recurse into; we value it using the hands on the preceding street.  Values are
+// keyed by the bucket of the hand on that street and by the pot size (LastBetTo() of the leaf).
+// A value is the expected payoff per unit of opponent reach, so the counterfactual value of a
+// hand is the table value times the (card-removal adjusted) sum of the opponent's reach probs.
+//
+// The table for street st is read from
+//   static/leaf_values.{game_name}.{num_ranks}.{num_suits}.{max_street}.{bucketing}.{st}
+// and the buckets by a Buckets object for the same bucketing and street.  Pots in between
+// the tabulated pots are interpolated; pots outside of the range are scaled from the nearest one.
+class LeafValueTable {
+public:
+  LeafValueTable(const std::string &bucketing, int st);
+  ~LeafValueTable(void) {}
+  // Bucket of the given hole card pair index on the given global board of street st.
+  int Bucket(int gbd, int hcp) const {
+    return buckets_.Bucket(st_, ((unsigned int)gbd) * ((unsigned int)num_hole_card_pairs_) + hcp);
+  }
+  double Value(int b, int last_bet_to) const;
+  int St(void) const {return st_;}
+  const std::string &Bucketing(void) const {return bucketing_;}
+  static void Write(const std::string &bucketing, int st, int num_buckets,
+		    const std::vector<int> &pots, const double *vals);
+private:
+  static std::string Filename(const std::string &bucketing, int st);
+
+  std::string bucketing_;
+  int st_;
+  int num_hole_card_pairs_;
+  int num_buckets_;
+  std::vector<int> pots_;
+  // Indexed by b * num_pots + pot index
+  std::unique_ptr<double []> vals_;
+  Buckets buckets_;
+};
+
+#endif
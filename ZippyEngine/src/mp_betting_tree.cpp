@@ -2,8 +2,6 @@
 #include <stdlib.h>
 
 #include <memory>
-#include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "betting_abstraction.h"
@@ -13,40 +11,138 @@
 #include "game.h"
 
 using std::shared_ptr;
-using std::string;
 using std::unique_ptr;
-using std::unordered_map;
 using std::vector;
 
-static void AddStringToKey(const string &s, string *key) {
-  *key += s;
+ReentrantNodeMap::ReentrantNodeMap(void) {
+  capacity_ = 1024;
+  size_ = 0;
+  keys_.resize(capacity_);
+  nodes_.resize(capacity_);
 }
 
-static void AddIntToKey(int i, string *key) {
-  char buf[10];
-  sprintf(buf, "%i", i);
-  *key += buf;
+unsigned long long int ReentrantNodeMap::Hash(const ReentrantKey &key) {
+  return fasthash64((void *)&key, sizeof(ReentrantKey), 0);
 }
 
-static unsigned long long int HashKey(const string &key) {
-  return fasthash64((void *)key.c_str(), key.size(), 0);
+static bool KeysEqual(const ReentrantKey &k1, const ReentrantKey &k2) {
+  return k1.history == k2.history && k1.st == k2.st && k1.player_acting == k2.player_acting &&
+    k1.num_street_bets == k2.num_street_bets && k1.bet_to == k2.bet_to &&
+    k1.last_bet_size == k2.last_bet_size && k1.num_remaining == k2.num_remaining &&
+    k1.num_players_to_act == k2.num_players_to_act;
 }
 
-bool BettingTreeBuilder::FindReentrantNode(const string &key, shared_ptr<Node> *node) {
-  unordered_map< unsigned long long int, shared_ptr<Node> >::iterator it;
-  unsigned long long int h = HashKey(key);
-  it = node_map_->find(h);
-  if (it != node_map_->end()) {
-    *node = it->second;
-    return true;
-  } else {
-    return false;
+bool ReentrantNodeMap::Find(const ReentrantKey &key, shared_ptr<Node> *node) const {
+  int mask = capacity_ - 1;
+  int i = Hash(key) & mask;
+  while (nodes_[i]) {
+    if (KeysEqual(keys_[i], key)) {
+      *node = nodes_[i];
+      return true;
+    }
+    i = (i + 1) & mask;
   }
+  return false;
 }
 
-void BettingTreeBuilder::AddReentrantNode(const string &key, shared_ptr<Node> node) {
-  unsigned long long int h = HashKey(key);
-  (*node_map_)[h] = node;
+void ReentrantNodeMap::Insert(const ReentrantKey &key, const shared_ptr<Node> &node) {
+  if (2 * (size_ + 1) > capacity_) Grow();
+  int mask = capacity_ - 1;
+  int i = Hash(key) & mask;
+  while (nodes_[i]) {
+    if (KeysEqual(keys_[i], key)) {
+      nodes_[i] = node;
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+  keys_[i] = key;
+  nodes_[i] = node;
+  ++size_;
+}
+
+void ReentrantNodeMap::Grow(void) {
+  vector<ReentrantKey> old_keys;
+  vector< shared_ptr<Node> > old_nodes;
+  old_keys.swap(keys_);
+  old_nodes.swap(nodes_);
+  capacity_ *= 2;
+  size_ = 0;
+  keys_.resize(capacity_);
+  nodes_.resize(capacity_);
+  int old_capacity = old_nodes.size();
+  for (int i = 0; i < old_capacity; ++i) {
+    if (old_nodes[i]) Insert(old_keys[i], old_nodes[i]);
+  }
+}
+
+HistoryMap::HistoryMap(void) {
+  capacity_ = 1024;
+  size_ = 0;
+  entries_.resize(capacity_);
+  ids_.resize(capacity_);
+}
+
+unsigned long long int HistoryMap::Hash(const Entry &e) {
+  unsigned long long int buf[2];
+  buf[0] = e.prefix;
+  buf[1] = (((unsigned long long int)e.action) << 32) | (unsigned int)e.bet_size;
+  return fasthash64((void *)buf, sizeof(buf), 0);
+}
+
+// Returns the ID of history extended by one more action, assigning a new ID the first time
+// the extended history is seen.
+unsigned long long int HistoryMap::Extend(unsigned long long int history, char action,
+					  int bet_size) {
+  Entry e;
+  e.prefix = history;
+  e.action = action;
+  e.bet_size = bet_size;
+  int mask = capacity_ - 1;
+  int i = Hash(e) & mask;
+  while (ids_[i]) {
+    const Entry &e2 = entries_[i];
+    if (e2.prefix == e.prefix && e2.action == e.action && e2.bet_size == e.bet_size) {
+      return ids_[i];
+    }
+    i = (i + 1) & mask;
+  }
+  unsigned long long int id = size_ + 1;
+  Insert(e, id);
+  return id;
+}
+
+void HistoryMap::Insert(const Entry &e, unsigned long long int id) {
+  if (2 * (size_ + 1) > capacity_) Grow();
+  int mask = capacity_ - 1;
+  int i = Hash(e) & mask;
+  while (ids_[i]) i = (i + 1) & mask;
+  entries_[i] = e;
+  ids_[i] = id;
+  ++size_;
+}
+
+void HistoryMap::Grow(void) {
+  vector<Entry> old_entries;
+  vector<unsigned long long int> old_ids;
+  old_entries.swap(entries_);
+  old_ids.swap(ids_);
+  capacity_ *= 2;
+  size_ = 0;
+  entries_.resize(capacity_);
+  ids_.resize(capacity_);
+  int old_capacity = old_ids.size();
+  for (int i = 0; i < old_capacity; ++i) {
+    if (old_ids[i]) Insert(old_entries[i], old_ids[i]);
+  }
+}
+
+bool BettingTreeBuilder::FindReentrantNode(const ReentrantKey &key, shared_ptr<Node> *node) {
+  return node_map_.Find(key, node);
+}
+
+void BettingTreeBuilder::AddReentrantNode(const ReentrantKey &key, shared_ptr<Node> node) {
+  node_map_.Insert(key, node);
 }
 
 // Determine the next player to act, taking into account who has folded.
@@ -62,7 +158,7 @@ static int NextPlayerToAct(int p, bool *folded) {
 shared_ptr<Node>
 BettingTreeBuilder::CreateMPFoldSucc(int street, int last_bet_size, int bet_to, int num_street_bets,
 				     int num_bets, int player_acting, int num_players_to_act,
-				     bool *folded, int target_player, string *key,
+				     bool *folded, int target_player, unsigned long long int *key,
 				     int *terminal_id) {
   shared_ptr<Node> fold_succ;
   int max_street = Game::MaxStreet();
@@ -75,9 +171,9 @@ BettingTreeBuilder::CreateMPFoldSucc(int street, int last_bet_size, int bet_to,
     fprintf(stderr, "CreateMPFoldSucc npr %u?!?\n", num_players_remaining);
     exit(-1);
   }
-  string new_key = *key;
+  unsigned long long int new_key = *key;
   if (betting_abstraction_.BettingKey(street)) {
-    AddStringToKey("f", &new_key);
+    new_key = history_map_.Extend(new_key, 'f', 0);
   }
   if (num_players_remaining == 2) {
     // This fold completes the hand
@@ -130,7 +226,7 @@ shared_ptr<Node> BettingTreeBuilder::CreateMPCallSucc(int street, int last_bet_s
 						      int num_street_bets, int num_bets,
 						      int player_acting, int num_players_to_act,
 						      bool *folded, int target_player,
-						      string *key, int *terminal_id) {
+						      unsigned long long int *key, int *terminal_id) {
   bool advance_street = (num_players_to_act == 1);
   shared_ptr<Node> call_succ;
   int max_street = Game::MaxStreet();
@@ -146,9 +242,9 @@ shared_ptr<Node> BettingTreeBuilder::CreateMPCallSucc(int street, int last_bet_s
   if (num_players_to_act == 0) exit(-1);
   if (num_players_to_act > 1000000) exit(-1);
   if (num_players_to_act > num_players_remaining) exit(-1);
-  string new_key = *key;
+  unsigned long long int new_key = *key;
   if (betting_abstraction_.BettingKey(street)) {
-    AddStringToKey("c", &new_key);
+    new_key = history_map_.Extend(new_key, 'c', 0);
   }
   if (street < max_street && advance_street) {
     // Call completes action on current street.
@@ -176,7 +272,7 @@ shared_ptr<Node> BettingTreeBuilder::CreateMPCallSucc(int street, int last_bet_s
 void BettingTreeBuilder::MPHandleBet(int street, int last_bet_size, int last_bet_to, int new_bet_to,
 				     int num_street_bets, int num_bets, int player_acting,
 				     int num_players_to_act, bool *folded, int target_player,
-				     string *key, int *terminal_id,
+				     unsigned long long int *key, int *terminal_id,
 				     vector< shared_ptr<Node> > *bet_succs) {
   // New bet must be of size greater than zero
   if (new_bet_to <= last_bet_to) return;
@@ -204,10 +300,9 @@ void BettingTreeBuilder::MPHandleBet(int street, int last_bet_size, int last_bet
     return;
   }
   
-  string new_key = *key;
+  unsigned long long int new_key = *key;
   if (betting_abstraction_.BettingKey(street)) {
-    AddStringToKey("b", &new_key);
-    AddIntToKey(new_bet_size, &new_key);
+    new_key = history_map_.Extend(new_key, 'b', new_bet_size);
   }
   
   int num_players = Game::NumPlayers();
@@ -236,7 +331,7 @@ void BettingTreeBuilder::MPHandleBet(int street, int last_bet_size, int last_bet
 void BettingTreeBuilder::CreateMPSuccs(int street, int last_bet_size, int bet_to,
 				       int num_street_bets, int num_bets, int player_acting,
 				       int num_players_to_act, bool *folded, int target_player,
-				       string *key, int *terminal_id, shared_ptr<Node> *call_succ,
+				       unsigned long long int *key, int *terminal_id, shared_ptr<Node> *call_succ,
 				       shared_ptr<Node> *fold_succ,
 				       vector< shared_ptr<Node> > *bet_succs) {
   if (folded[player_acting]) {
@@ -335,13 +430,13 @@ void BettingTreeBuilder::CreateMPSuccs(int street, int last_bet_size, int bet_to
 shared_ptr<Node>
 BettingTreeBuilder::CreateMPSubtree(int st, int last_bet_size, int bet_to, int num_street_bets,
 				    int num_bets, int player_acting, int num_players_to_act,
-				    bool *folded, int target_player, string *key,
+				    bool *folded, int target_player, unsigned long long int *key,
 				    int *terminal_id) {
   if (folded[player_acting]) {
     fprintf(stderr, "CreateMPSubtree: Player already folded\n");
     exit(-1);
   }
-  string final_key;
+  ReentrantKey final_key;
   bool merge = false;
   // As it stands, we don't encode which players have folded.  But we do
   // encode num_players_to_act.
@@ -354,22 +449,15 @@ BettingTreeBuilder::CreateMPSubtree(int st, int last_bet_size, int bet_to, int n
       2 * bet_to >= betting_abstraction_.MinReentrantPot() &&
       num_bets >= betting_abstraction_.MinReentrantBets(st, num_rem)) {
     merge = true;
-    final_key = *key;
-    AddStringToKey(":", &final_key);
-    AddIntToKey(st, &final_key);
-    AddStringToKey(":", &final_key);
-    AddIntToKey(player_acting, &final_key);
-    AddStringToKey(":", &final_key);
-    AddIntToKey(num_street_bets, &final_key);
-    AddStringToKey(":", &final_key);
-    AddIntToKey(bet_to, &final_key);
-    AddStringToKey(":", &final_key);
-    AddIntToKey(last_bet_size, &final_key);
-    AddStringToKey(":", &final_key);
-    AddIntToKey(num_rem, &final_key);
-    AddStringToKey(":", &final_key);
-    AddIntToKey(num_players_to_act, &final_key);
-    // fprintf(stderr, "Key: %s\n", final_key.c_str());
+    final_key.history = *key;
+    final_key.st = st;
+    final_key.player_acting = player_acting;
+    final_key.num_street_bets = num_street_bets;
+    final_key.bet_to = bet_to;
+    final_key.last_bet_size = last_bet_size;
+    final_key.num_remaining = num_rem;
+    final_key.num_players_to_act = num_players_to_act;
+    final_key.unused = 0;
     shared_ptr<Node> node;
     if (FindReentrantNode(final_key, &node)) {
       return node;
@@ -397,12 +485,25 @@ BettingTreeBuilder::CreateMPSubtree(int st, int last_bet_size, int bet_to, int n
 
 shared_ptr<Node>
 BettingTreeBuilder::CreateMPStreet(int street, int bet_to, int num_bets, bool *folded,
-				   int target_player, string *key, int *terminal_id) {
+				   int target_player, unsigned long long int *key, int *terminal_id) {
   int num_players = Game::NumPlayers();
   int num_players_remaining = 0;
   for (int p = 0; p < num_players; ++p) {
     if (! folded[p]) ++num_players_remaining;
   }
+  if (street == parallel_street_) {
+    // Build this subtree later.  See BuildStreetsInParallel().
+    StreetTask *task = new StreetTask;
+    task->street = street;
+    task->bet_to = bet_to;
+    task->num_bets = num_bets;
+    task->folded.reset(new bool[num_players]);
+    for (int p = 0; p < num_players; ++p) task->folded[p] = folded[p];
+    task->target_player = target_player;
+    task->placeholder.reset(new Node(-1, bet_to, 0, 0, 0, 0));
+    tasks_.push_back(unique_ptr<StreetTask>(task));
+    return task->placeholder;
+  }
   int next_player_to_act =
     NextPlayerToAct(Game::FirstToAct(street + 1), folded);
   shared_ptr<Node> node =
@@ -423,7 +524,7 @@ BettingTreeBuilder::CreateMPTree(int target_player, int *terminal_id) {
   for (int p = 0; p < num_players; ++p) {
     folded[p] = false;
   }
-  string key;
+  unsigned long long int key = 0;
   return CreateMPSubtree(initial_street, last_bet_size, initial_bet_to, 0, 0, player_acting,
 			 Game::NumPlayers(), folded.get(), target_player, &key, terminal_id);
 }
@@ -253,6 +253,7 @@ double *MPVCFR::OppChoice(Node *node, int lbd, const VCFRState &state) {
     int dsi = node->DefaultSuccIndex();
     bool bucketed = ! buckets_.None(st) &&
       node->LastBetTo() < card_abstraction_.BucketThreshold(st);
+    double sumprob_weight = SumprobWeight(it_, soft_warmup_, hard_warmup_, 0);
     
     if (bucketed && ! value_calculation_) {
       // This is true when we are running CFR+ on a bucketed system.  We
@@ -293,13 +294,13 @@ double *MPVCFR::OppChoice(Node *node, int lbd, const VCFRState &state) {
 	   dynamic_cast<CFRStreetValues<double> *>(cs_values))) {
 	if (d_sumprob_values) {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets,
-			  opp_probs, succ_opp_probs, *d_cs_values, dsi, it_,
-			  soft_warmup_, hard_warmup_, sumprob_scaling_[st],
+			  opp_probs, succ_opp_probs, *d_cs_values, dsi,
+			  sumprob_weight, sumprob_scaling_[st],
 			  d_sumprob_values);
 	} else {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets,
-			  opp_probs, succ_opp_probs, *d_cs_values, dsi, it_,
-			  soft_warmup_, hard_warmup_, sumprob_scaling_[st],
+			  opp_probs, succ_opp_probs, *d_cs_values, dsi,
+			  sumprob_weight, sumprob_scaling_[st],
 			  i_sumprob_values);
 	}
       } else {
@@ -310,13 +311,13 @@ double *MPVCFR::OppChoice(Node *node, int lbd, const VCFRState &state) {
 	}
 	if (d_sumprob_values) {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets,
-			  opp_probs, succ_opp_probs, *i_cs_values, dsi, it_,
-			  soft_warmup_, hard_warmup_, sumprob_scaling_[st],
+			  opp_probs, succ_opp_probs, *i_cs_values, dsi,
+			  sumprob_weight, sumprob_scaling_[st],
 			  d_sumprob_values);
 	} else {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets,
-			  opp_probs, succ_opp_probs, *i_cs_values, dsi, it_,
-			  soft_warmup_, hard_warmup_, sumprob_scaling_[st],
+			  opp_probs, succ_opp_probs, *i_cs_values, dsi,
+			  sumprob_weight, sumprob_scaling_[st],
 			  i_sumprob_values);
 	}
       }
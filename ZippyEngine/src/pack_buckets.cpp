@@ -0,0 +1,127 @@
+// Writes a packed copy of the bucket files of a card abstraction; see buckets.h for the format.
+// The original files are left in place because some tools (prify, crossproduct) still read
+// them directly.  Once a packed file exists, the Buckets class maps it instead of reading the
+// original, as long as the original hasn't changed since.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <memory>
+#include <string>
+
+#include "board_tree.h"
+#include "buckets.h"
+#include "card_abstraction.h"
+#include "card_abstraction_params.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "io.h"
+#include "params.h"
+
+using std::string;
+using std::unique_ptr;
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <card params>\n", prog_name);
+  exit(-1);
+}
+
+static void Pack(int st, const string &bucketing) {
+  int max_street = Game::MaxStreet();
+  char buf[500], packed_buf[510], tmp_buf[520];
+  sprintf(buf, "%s/num_buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
+	  Game::NumRanks(), Game::NumSuits(), max_street, bucketing.c_str(), st);
+  int num_buckets;
+  {
+    Reader reader(buf);
+    num_buckets = reader.ReadIntOrDie();
+  }
+  unsigned int num_hands =
+    ((unsigned int)BoardTree::NumBoards(st)) * ((unsigned int)Game::NumHoleCardPairs(st));
+  long long int lli_num_hands = num_hands;
+  sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
+	  Game::NumRanks(), Game::NumSuits(), max_street, bucketing.c_str(), st);
+  // Recorded in the header so that Buckets can tell if the packed file is out of date
+  struct stat stbuf;
+  if (stat(buf, &stbuf) == -1) {
+    fprintf(stderr, "Couldn't stat %s\n", buf);
+    exit(-1);
+  }
+  Reader reader(buf);
+  long long int file_size = reader.FileSize();
+  bool short_buckets;
+  if (file_size == lli_num_hands * 2) {
+    short_buckets = true;
+  } else if (file_size == lli_num_hands * 4) {
+    short_buckets = false;
+  } else {
+    fprintf(stderr, "%s: unexpected file size %lli\n", buf, file_size);
+    exit(-1);
+  }
+  int bits = PackedBucketBits(num_buckets);
+  sprintf(packed_buf, "%s.packed", buf);
+  sprintf(tmp_buf, "%s.tmp", packed_buf);
+  {
+    Writer writer(tmp_buf);
+    writer.WriteUnsignedInt(kPackedBucketsMagic);
+    writer.WriteInt(kPackedBucketsVersion);
+    writer.WriteInt(bits);
+    writer.WriteInt(0);
+    writer.WriteUnsignedLong(num_hands);
+    writer.WriteLong(stbuf.st_size);
+    writer.WriteLong(stbuf.st_mtime);
+    // Buckets are appended to the low end of word; bits that don't fit spill over into the
+    // next word.
+    unsigned long long int word = 0;
+    int word_bits = 0;
+    for (unsigned int h = 0; h < num_hands; ++h) {
+      int b = short_buckets ? reader.ReadUnsignedShortOrDie() : reader.ReadIntOrDie();
+      if (b < 0 || b >= num_buckets) {
+	fprintf(stderr, "%s: hand %u has bucket %i; only %i buckets\n", buf, h, b, num_buckets);
+	exit(-1);
+      }
+      unsigned long long int ub = b;
+      word |= ub << word_bits;
+      word_bits += bits;
+      if (word_bits >= 64) {
+	writer.WriteUnsignedLong(word);
+	word_bits -= 64;
+	word = word_bits > 0 ? ub >> (bits - word_bits) : 0;
+      }
+    }
+    if (word_bits > 0) writer.WriteUnsignedLong(word);
+    // Padding so that the last bucket can be read with an eight-byte load
+    writer.WriteUnsignedLong(0);
+  }
+  if (FileSize(tmp_buf) != PackedBucketsFileSize(num_hands, bits)) {
+    fprintf(stderr, "%s has unexpected size %lli\n", tmp_buf, FileSize(tmp_buf));
+    exit(-1);
+  }
+  if (rename(tmp_buf, packed_buf) != 0) {
+    fprintf(stderr, "Couldn't rename %s; errno %i\n", tmp_buf, errno);
+    exit(-1);
+  }
+  printf("St %i: %i buckets, %i bits per hand; %lli bytes -> %lli bytes\n", st, num_buckets,
+	 bits, file_size, PackedBucketsFileSize(num_hands, bits));
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unique_ptr<Params> card_params = CreateCardAbstractionParams();
+  card_params->ReadFromFile(argv[2]);
+  unique_ptr<CardAbstraction> card_abstraction(new CardAbstraction(*card_params));
+  BoardTree::Create();
+  int max_street = Game::MaxStreet();
+  for (int st = 0; st <= max_street; ++st) {
+    const string &bucketing = card_abstraction->Bucketing(st);
+    if (bucketing == "none") continue;
+    Pack(st, bucketing);
+  }
+}
@@ -9,6 +9,7 @@
 #include <string>
 
 #include "board_tree.h"
+#include "buckets.h" // RemovePackedBuckets()
 #include "constants.h"
 #include "fast_hash.h"
 #include "files.h"
@@ -137,6 +138,7 @@ int main(int argc, char *argv[]) {
 
   sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
 	  Game::NumRanks(), Game::NumSuits(), Game::MaxStreet(), new_bucketing.c_str(), st);
+  RemovePackedBuckets(buf);
   Writer writer(buf);
   if (short_buckets) {
     for (long long int h = 0; h < num_hands; ++h) {
@@ -30,6 +30,7 @@
 #include "buckets.h"
 #include "canonical_cards.h"
 #include "card_abstraction.h"
+#include "cbr_cache.h"
 #include "card_abstraction_params.h"
 #include "cfr_config.h"
 #include "cfr_params.h"
@@ -257,6 +258,8 @@ shared_ptr<CFRValues> Resolver::ResolveCombined(Node *node, shared_ptr<CFRValues
 
   DynamicCBR dynamic_cbr(base_card_abstraction_, base_cfr_config_, base_buckets_, 1);
   dynamic_cbr.SetSumprobs(prior_sumprobs);
+  // The first (zero-sum) Compute() produces the CBRs for both players; the second is a lookup.
+  dynamic_cbr.SetCache(shared_ptr<CBRCache>(new CBRCache(2)));
 
   shared_ptr<CFRValues> p0_sumprobs, p1_sumprobs;
   for (int solve_p = 0; solve_p < 2; ++solve_p) {
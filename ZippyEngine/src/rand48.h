@@ -1,6 +1,12 @@
 #ifndef _RAND48_H_
 #define _RAND48_H_
 
+#include <stdlib.h>
+
+// glibc declares all of this in stdlib.h.  Elsewhere the reentrant generators come from
+// rand48.cpp.
+#ifndef __GLIBC__
+
 struct drand48_data
   {
     unsigned short int __x[3];        /* Current state.  */
@@ -24,4 +30,6 @@ extern int erand48_r (
 
 extern int drand48_r (struct drand48_data *buffer, double *result);
 
+#endif
+
 #endif
\ No newline at end of file
@@ -73,6 +73,15 @@ ReachProbs *ReachProbs::CreateRoot(void) {
   return reach_probs;
 }
 
+ReachProbs *ReachProbs::Share(void) const {
+  ReachProbs *reach_probs = new ReachProbs();
+  int num_players = Game::NumPlayers();
+  for (int p = 0; p < num_players; ++p) {
+    reach_probs->probs_[p] = probs_[p];
+  }
+  return reach_probs;
+}
+
 void AddHandsToReachProb(ReachProbs *reach_probs, string &hands, double prob, int p) {
   std::vector<string> v1;
   int max_card1 = Game::MaxCard() + 1;
@@ -13,6 +13,9 @@ public:
   ~ReachProbs(void) {}
   static ReachProbs *CreateRoot(void);
   static ReachProbs *Load(void);
+  // Returns a new object that shares the underlying probability arrays with this one.  Cheap, but
+  // note that Set() on either object is visible through the other.
+  ReachProbs *Share(void) const;
   static std::shared_ptr<ReachProbs []> CreateSuccReachProbs(Node *node, int gbd, int lbd,
 							     const CanonicalCards *hands,
 							     const Buckets &buckets,
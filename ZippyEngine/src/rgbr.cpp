@@ -37,6 +37,8 @@ RGBR::RGBR(const CardAbstraction &ca, const CFRConfig &cc, const Buckets &bucket
   br_current_ = current;
   quantize_ = quantize;
   value_calculation_ = true;
+  // Go() reports the node visits
+  collect_stats_ = true;
 
   int max_street = Game::MaxStreet();
   if (streets) {
@@ -137,7 +139,10 @@ double RGBR::Go(int it, int p, const BettingAbstraction &ba) {
 #endif
 
   // if (subgame_street_ >= 0 && subgame_street_ <= max_street) pre_phase_ = true;
+  stats_.Clear();
   shared_ptr<double []> vals = ProcessRoot(betting_trees_.get(), p, hand_tree_.get());
+  fprintf(stderr, "P%u: %lli node visits; %lli nodes not reached by the opponent pruned\n", p,
+	  stats_.num_node_visits, stats_.num_zero_reach_pruned);
 #if 0
   if (subgame_street_ >= 0 && subgame_street_ <= max_street) {
     WaitForFinalSubgames();
@@ -39,20 +39,27 @@ static short *RiverHandStrength(const Card *board, bool wins) {
   int num_hole_card_pairs = Game::NumHoleCardPairs(max_street);
   vector< pair<int, int> > v(num_hole_card_pairs);
   int max_card = Game::MaxCard();
-  int hole_cards[2];
+  int *hole_cards = new int[num_hole_card_pairs * 2];
   int hcp = 0;
   for (int hi = 1; hi <= max_card; ++hi) {
     if (InCards(hi, board, num_board_cards)) continue;
-    hole_cards[0] = hi;
     for (int lo = 0; lo < hi; ++lo) {
       if (InCards(lo, board, num_board_cards)) continue;
-      hole_cards[1] = lo;
-      int hv = HandValueTree::Val(sorted_board, hole_cards);
-      int enc = hi * (max_card + 1) + lo;
-      v[hcp] = std::make_pair(hv, enc);
+      hole_cards[2 * hcp] = hi;
+      hole_cards[2 * hcp + 1] = lo;
       ++hcp;
     }
   }
+  int *hvs = new int[num_hole_card_pairs];
+  HandValueTree::Vals(sorted_board, hole_cards, num_hole_card_pairs, hvs);
+  for (hcp = 0; hcp < num_hole_card_pairs; ++hcp) {
+    int hi = hole_cards[2 * hcp];
+    int lo = hole_cards[2 * hcp + 1];
+    int enc = hi * (max_card + 1) + lo;
+    v[hcp] = std::make_pair(hvs[hcp], enc);
+  }
+  delete [] hvs;
+  delete [] hole_cards;
   delete [] sorted_board;
   sort(v.begin(), v.end(), g_pii_lower_compare);
 
@@ -377,3 +384,45 @@ short *ComputeRollout(unsigned int st, double *percentiles, unsigned int num_per
   }
   return pct_vals;
 }
+
+// For every hand on street st, the average WML over all possible rollouts of the board,
+// normalized by the number of opponent hole card pairs.  This is the expected payoff per unit of
+// opponent reach (win minus lose) if the hand is checked down against a uniform range.  Values
+// are indexed by bd * num_hole_card_pairs + hcp.
+double *ComputeRolloutEquities(unsigned int st) {
+  if (st == 0) {
+    fprintf(stderr, "ComputeRolloutEquities() does not support the preflop\n");
+    exit(-1);
+  }
+  unsigned int max_street = Game::MaxStreet();
+  unsigned int num_boards = BoardTree::NumBoards(st);
+  unsigned int num_board_cards = Game::NumBoardCards(st);
+  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  unsigned int num_remaining = Game::NumCardsInDeck() - Game::NumBoardCards(max_street) -
+    Game::NumCardsForStreet(0);
+  double max_wml = num_remaining * (num_remaining - 1) / 2;
+  double *equities = new double[num_boards * num_hole_card_pairs];
+  unsigned int max_card = Game::MaxCard();
+  unsigned int num_enc = (max_card + 1) * (max_card + 1);
+  Card board[5];
+  for (unsigned int bd = 0; bd < num_boards; ++bd) {
+    if (bd % 100 == 0) fprintf(stderr, "bd %u/%u\n", bd, num_boards);
+    const Card *st_board = BoardTree::Board(st, bd);
+    for (unsigned int i = 0; i < num_board_cards; ++i) {
+      board[i] = st_board[i];
+    }
+    unsigned int h = bd * num_hole_card_pairs;
+    vector<short> *wmls = ComputeRollout(board, false, st);
+    for (unsigned int i = 0; i < num_enc; ++i) {
+      vector<short> &v = wmls[i];
+      unsigned int num = v.size();
+      if (num == 0) continue;
+      double sum = 0;
+      for (unsigned int j = 0; j < num; ++j) sum += v[j];
+      equities[h] = sum / (num * max_wml);
+      ++h;
+    }
+    delete [] wmls;
+  }
+  return equities;
+}
@@ -6,5 +6,6 @@
 short *ComputeRollout(unsigned int st, double *percentiles,
 		      unsigned int num_percentiles,
 		      double squashing, bool wins);
+double *ComputeRolloutEquities(unsigned int st);
 
 #endif
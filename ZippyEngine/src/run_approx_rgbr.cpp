@@ -95,7 +95,7 @@ public:
   double ResolvingSecs(void) const {return resolving_secs_;}
 private:
   void SetStreetBuckets(int st, int gbd);
-  void Resolve(int gbd, const ReachProbs &reach_probs, const string &action_sequence,
+  void Resolve(Node *node, int gbd, const ReachProbs &reach_probs, const string &action_sequence,
 	       const HandTree *hand_tree);
   shared_ptr<double []> Transition(Node *p0_node, Node *p1_node, const ReachProbs &reach_probs,
 				   int gbd, const string &action_sequence);
@@ -357,10 +357,14 @@ static int *CreatePredCanons(HandTree *hand_tree, int pst, int pbd) {
   return pred_canons;
 }
 
-void PreResponder::Resolve(int gbd, const ReachProbs &reach_probs,
+void PreResponder::Resolve(Node *node, int gbd, const ReachProbs &reach_probs,
 			   const string &action_sequence, const HandTree *hand_tree) {
   struct timespec start, finish;
   clock_gettime(CLOCK_MONOTONIC, &start);
+  if (subgame_cfr_config_.WarmStartIts() > 0) {
+    // sumprobs_ covers all streets in this case; see Initialize().
+    eg_cfr_->SetWarmStart(sumprobs_, node, &buckets_);
+  }
   eg_cfr_->SolveSubgame(subtrees_.get(), gbd, reach_probs, action_sequence, hand_tree, nullptr, -1,
 			true, num_resolve_its_);
   clock_gettime(CLOCK_MONOTONIC, &finish);
@@ -412,7 +416,7 @@ shared_ptr<double []> PreResponder::Transition(Node *p0_node, Node *p1_node,
       if (node->LastBetTo() < betting_abstraction_.StackSize()) {
 	fprintf(stderr, "Resolving P%i %s pbd %i ngbd %i\n", responder_p_, action_sequence.c_str(),
 		pbd, ngbd);
-	Resolve(ngbd, reach_probs, action_sequence, next_hand_tree);
+	Resolve(node, ngbd, reach_probs, action_sequence, next_hand_tree);
       }
       eg_cfr_->SetValueCalculation(true);
       int max_street = Game::MaxStreet();
@@ -630,10 +634,11 @@ shared_ptr<double []> PreResponder::Process(Node *p0_node, Node *p1_node,
     double sum_opp_probs;
     unique_ptr<double []> total_card_probs(new double[Game::MaxCard() + 1]);
     const CanonicalCards *hands = trunk_hand_tree_->Hands(st, gbd);
-    CommonBetResponseCalcs(st, hands, reach_probs.Get(responder_p_^1).get(), &sum_opp_probs,
-			   total_card_probs.get());
-    return Fold(p0_node, responder_p_, hands, reach_probs.Get(responder_p_^1).get(), sum_opp_probs,
-		total_card_probs.get());
+    shared_ptr<VCFR_VALUE []> opp_probs =
+      DenseOppProbs(hands, reach_probs.Get(responder_p_^1).get());
+    CommonBetResponseCalcs(st, hands, opp_probs.get(), &sum_opp_probs, total_card_probs.get());
+    return WideVals(Fold(p0_node, responder_p_, hands, opp_probs.get(), sum_opp_probs,
+			 total_card_probs.get()), Game::NumHoleCardPairs(st));
   }
   int pa = p0_node->PlayerActing();
   Node *node = pa == 0 ? p0_node : p1_node;
@@ -695,7 +700,8 @@ void PreResponder::Initialize(void) {
 
   int max_street = Game::MaxStreet();
   unique_ptr<bool []> streets(new bool[max_street + 1]);
-  if (resolve_) {
+  if (resolve_ && subgame_cfr_config_.WarmStartIts() == 0) {
+    // Base strategy is only needed for the trunk, unless we warm start the resolves from it.
     for (int st = 0; st <= max_street; ++st) streets[st] = st < street_;
   } else {
     for (int st = 0; st <= max_street; ++st) streets[st] = true;
@@ -830,6 +836,11 @@ int main(int argc, char *argv[]) {
     fprintf(stderr, "Cannot resolve if street is 0\n");
     exit(-1);
   }
+  if (resolve && subgame_cfr_config->DepthLimit() > 0) {
+    // The best response needs the resolved strategy all the way to the end of the hand
+    fprintf(stderr, "Depth-limited resolving not supported\n");
+    exit(-1);
+  }
   
   BoardTree::Create();
   BoardTree::CreateLookup();
@@ -6,15 +6,28 @@
 // should not assume we can load the trunk sumprobs in memory.  Can I assume a hand tree for the
 // trunk in memory?
 //
-// With base_mem false, solve_all_subgames is pretty slow because we repeatedly read the entire base
-// strategy in (inside ReadBaseSubgameStrategy()).
+// With base_mem false, we read only the subtree and board range of the base strategy that each
+// subgame needs (inside ReadBaseSubgameStrategy()).  The offset of each node's values within the
+// files is computed by walking the full base tree.
 //
 // Should allow trunk sumprobs to be quantized.
-
+//
+// Subgames are not solved as soon as the trunk walk reaches them.  Instead we enumerate a batch of
+// (action sequence, board) subgames along with their reach probs, and then hand the subgames out
+// dynamically to a pool of <num outer threads> workers.  Solve times vary enormously across
+// boards and action sequences, so a static split of boards to threads leaves threads idle at the
+// tail.  The total thread budget is <num inner threads> * <num outer threads>; as the queue drains,
+// the budget of idle workers is handed to the remaining subgames as extra inner threads.  If the
+// observed subgames are cheap, we use a single inner thread because spawning VCFR workers is not
+// worth it.
+
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h> // clock_gettime()
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -29,6 +42,7 @@
 #include "canonical_cards.h"
 #include "card_abstraction.h"
 #include "card_abstraction_params.h"
+#include "cbr_cache.h"
 #include "cfr_config.h"
 #include "cfr_params.h"
 #include "cfr_utils.h"
@@ -54,6 +68,22 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+class SubgameJob {
+public:
+  SubgameJob(Node *node, const string &action_sequence, int gbd, const ReachProbs &reach_probs) :
+    node_(node), action_sequence_(action_sequence), gbd_(gbd), reach_probs_(reach_probs.Share()) {}
+  ~SubgameJob(void) {}
+  Node *GetNode(void) const {return node_;}
+  const string &ActionSequence(void) const {return action_sequence_;}
+  int GBD(void) const {return gbd_;}
+  const ReachProbs &GetReachProbs(void) const {return *reach_probs_;}
+private:
+  Node *node_;
+  string action_sequence_;
+  int gbd_;
+  unique_ptr<ReachProbs> reach_probs_;
+};
+
 class SubgameSolver {
 public:
   SubgameSolver(const CardAbstraction &base_card_abstraction,
@@ -70,14 +100,26 @@ public:
 	    int last_bet_size, int num_street_bets, int num_bets, int num_players_to_act,
 	    int last_st);
   void Walk(void);
+  const SubgameJob *NextJob(int *num_inner_threads);
+  void FinishJob(const SubgameJob *job, double secs, int num_inner_threads);
+  void AddVisits(const VCFR &vcfr);
+  void Solve(const SubgameJob *job, int num_inner_threads);
 private:
+  static constexpr double kMinSecsForInnerThreads = 1.0;
+  // Each entry is one vector of CBRs.  We get hits from the second solve of a subgame (when
+  // computing zero-sum CBRs, both players' vectors come out of the first), so this only needs to
+  // cover the subgames in progress.
+  static const int kCBRCacheSize = 1000;
+  // Each job holds on to the reach probs of its subgame, so we solve the subgames in batches of
+  // this many as the trunk is walked rather than enumerating all of them up front.
+  static const size_t kJobBatchSize = 1000;
+
   BettingTrees *CreateSubtrees(Node *node, int target_p, bool base);
-  void Split(Node *node, const string &action_sequence, int pgbd, const ReachProbs &reach_probs,
-	     int num_bets);
+  void SolveAll(void);
   void StreetInitial(Node *node, const string &action_sequence, int pgbd,
 		     const ReachProbs &reach_probs, int num_bets);
   void ResolveUnsafe(Node *node, int gbd, const string &action_sequence,
-		     const ReachProbs &reach_probs);
+		     const ReachProbs &reach_probs, int num_inner_threads);
   void ResolveSafe(Node *node, int gbd, const string &action_sequence,
 		   const ReachProbs &reach_probs);
 
@@ -93,6 +135,7 @@ private:
   unique_ptr<HandTree> trunk_hand_tree_;
   shared_ptr<CFRValues> trunk_sumprobs_;
   unique_ptr<DynamicCBR> dynamic_cbr_;
+  shared_ptr<CBRCache> cbr_cache_;
   int solve_st_;
   ResolvingMethod method_;
   bool cfrs_;
@@ -105,6 +148,18 @@ private:
   int num_subgame_its_;
   int num_inner_threads_;
   int num_outer_threads_;
+  vector< unique_ptr<SubgameJob> > jobs_;
+  pthread_mutex_t jobs_mutex_;
+  size_t next_job_;
+  int num_jobs_;
+  int num_active_;
+  int num_finished_;
+  double sum_secs_;
+  // Wall clock time spent in SolveAll()
+  double wall_secs_;
+  // Totals over the subgame solves, and the CBR calculations done for them
+  long long int num_node_visits_;
+  long long int num_zero_reach_pruned_;
 };
 
 SubgameSolver::SubgameSolver(const CardAbstraction &base_card_abstraction,
@@ -135,6 +190,14 @@ SubgameSolver::SubgameSolver(const CardAbstraction &base_card_abstraction,
   num_subgame_its_ = num_subgame_its;
   num_inner_threads_ = num_inner_threads;
   num_outer_threads_ = num_outer_threads;
+  next_job_ = 0;
+  num_jobs_ = 0;
+  num_active_ = 0;
+  num_finished_ = 0;
+  sum_secs_ = 0;
+  wall_secs_ = 0;
+  num_node_visits_ = 0;
+  num_zero_reach_pruned_ = 0;
 
   base_betting_trees_.reset(new BettingTrees(base_betting_abstraction_));
 
@@ -143,8 +206,10 @@ SubgameSolver::SubgameSolver(const CardAbstraction &base_card_abstraction,
   unique_ptr<bool []> trunk_streets(new bool[max_street + 1]);
   for (int st = 0; st <= max_street; ++st) {
     if (method == ResolvingMethod::UNSAFE) {
-      // For unsafe method, don't need base probs outside trunk.
-      trunk_streets[st] = st < solve_st_;
+      // For unsafe method, don't need base probs outside trunk, unless we are warm starting
+      // from the in-memory base strategy.
+      trunk_streets[st] = st < solve_st_ ||
+	(base_mem_ && ! current_ && subgame_cfr_config_.WarmStartIts() > 0);
     } else {
       trunk_streets[st] = (base_mem_ && ! current_) || st < solve_st_;
     }
@@ -185,6 +250,9 @@ SubgameSolver::SubgameSolver(const CardAbstraction &base_card_abstraction,
     // We are calculating CBRs from the *base* strategy, not the resolved
     // endgame strategy.  So pass in base_card_abstraction_, etc.
     dynamic_cbr_.reset(new DynamicCBR(base_card_abstraction_, base_cfr_config_, base_buckets_, 1));
+    cbr_cache_.reset(new CBRCache(kCBRCacheSize));
+    dynamic_cbr_->SetCache(cbr_cache_);
+    dynamic_cbr_->SetCollectStats(true);
     if (current_) {
       unique_ptr<bool []> subgame_streets(new bool[max_street + 1]);
       for (int st = 0; st <= max_street; ++st) {
@@ -235,42 +303,100 @@ BettingTrees *SubgameSolver::CreateSubtrees(Node *node, int target_p, bool base)
   return new BettingTrees(subtree_root.get());
 }
 
+void SubgameSolver::StreetInitial(Node *node, const string &action_sequence, int pgbd,
+				  const ReachProbs &reach_probs, int num_bets) {
+  int nst = node->Street();
+  int pst = node->Street() - 1;
+  int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
+  int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
+  for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
+    Walk(node, action_sequence, ngbd, reach_probs, 0, 0, num_bets, 2, nst);
+  }
+}
+
+// Hands out the next unsolved subgame, or returns nullptr if there are none left.  Also decides
+// how many inner (VCFR) threads the subgame should be solved with.
+const SubgameJob *SubgameSolver::NextJob(int *num_inner_threads) {
+  pthread_mutex_lock(&jobs_mutex_);
+  if (next_job_ == jobs_.size()) {
+    pthread_mutex_unlock(&jobs_mutex_);
+    return nullptr;
+  }
+  const SubgameJob *job = jobs_[next_job_++].get();
+  ++num_active_;
+  int num_remaining = jobs_.size() - next_job_;
+  int nt = num_inner_threads_;
+  if (solve_st_ == Game::MaxStreet() || method_ != ResolvingMethod::UNSAFE) {
+    // Inner threads split on the street after the solve street, so there is nothing to split
+    // when solving on the max street.  The safe methods are always solved single-threaded.
+    nt = 1;
+  } else if (num_finished_ > 0 && sum_secs_ / num_finished_ < kMinSecsForInnerThreads) {
+    // Subgames are cheap; the overhead of spawning inner threads isn't worth it.
+    nt = 1;
+  } else {
+    // At the tail there are fewer subgames than outer threads.  Give each remaining subgame a
+    // share of the thread budget of the workers that have gone idle.
+    int num_busy = num_active_ + num_remaining;
+    if (num_busy < num_outer_threads_) {
+      nt = std::max(nt, (num_inner_threads_ * num_outer_threads_) / num_busy);
+    }
+  }
+  pthread_mutex_unlock(&jobs_mutex_);
+  *num_inner_threads = nt;
+  return job;
+}
+
+void SubgameSolver::FinishJob(const SubgameJob *job, double secs, int num_inner_threads) {
+  pthread_mutex_lock(&jobs_mutex_);
+  --num_active_;
+  ++num_finished_;
+  sum_secs_ += secs;
+  int num_finished = num_finished_;
+  pthread_mutex_unlock(&jobs_mutex_);
+  fprintf(stderr, "Subgame %s gbd %i: %.2f secs, %i inner threads (%i/%i done)\n",
+	  job->ActionSequence().c_str(), job->GBD(), secs, num_inner_threads, num_finished,
+	  num_jobs_);
+}
+
+// Called once a VCFR object local to a subgame is done with
+void SubgameSolver::AddVisits(const VCFR &vcfr) {
+  pthread_mutex_lock(&jobs_mutex_);
+  num_node_visits_ += vcfr.NumNodeVisits();
+  num_zero_reach_pruned_ += vcfr.NumZeroReachPruned();
+  pthread_mutex_unlock(&jobs_mutex_);
+}
+
+void SubgameSolver::Solve(const SubgameJob *job, int num_inner_threads) {
+  if (method_ == ResolvingMethod::UNSAFE) {
+    ResolveUnsafe(job->GetNode(), job->GBD(), job->ActionSequence(), job->GetReachProbs(),
+		  num_inner_threads);
+  } else {
+    ResolveSafe(job->GetNode(), job->GBD(), job->ActionSequence(), job->GetReachProbs());
+  }
+}
+
 class SSThread {
 public:
-  SSThread(Node *node, const string &action_sequence, int pgbd, const ReachProbs &reach_probs,
-	   int num_bets, SubgameSolver *solver, int thread_index, int num_threads);
+  SSThread(SubgameSolver *solver) : solver_(solver) {}
   ~SSThread(void) {}
   void Run(void);
   void Join(void);
   void Go(void);
 private:
-  Node *node_;
-  string action_sequence_;
-  int pgbd_;
-  const ReachProbs &reach_probs_;
-  int num_bets_;
   SubgameSolver *solver_;
-  int thread_index_;
-  int num_threads_;
   pthread_t pthread_id_;
 };
 
-SSThread::SSThread(Node *node, const string &action_sequence, int pgbd,
-		   const ReachProbs &reach_probs, int num_bets, SubgameSolver *solver,
-		   int thread_index, int num_threads) :
-  node_(node), action_sequence_(action_sequence), pgbd_(pgbd), reach_probs_(reach_probs),
-  num_bets_(num_bets), solver_(solver), thread_index_(thread_index), num_threads_(num_threads) {
-}
-
 void SSThread::Go(void) {
-  int nst = node_->Street();
-  int pst = nst - 1;
-  int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd_, nst);
-  int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd_, nst);
-  for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
-    if (ngbd % num_threads_ != thread_index_) continue;
-    // Street initial
-    solver_->Walk(node_, action_sequence_, ngbd, reach_probs_, 0, 0, num_bets_, 2, nst);
+  int num_inner_threads;
+  const SubgameJob *job;
+  while ((job = solver_->NextJob(&num_inner_threads)) != nullptr) {
+    struct timespec start, finish;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    solver_->Solve(job, num_inner_threads);
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    double secs = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
+    solver_->FinishJob(job, secs, num_inner_threads);
   }
 }
 
@@ -288,40 +414,39 @@ void SSThread::Join(void) {
   pthread_join(pthread_id_, NULL); 
 }
 
-void SubgameSolver::Split(Node *node, const string &action_sequence, int pgbd,
-			  const ReachProbs &reach_probs, int num_bets) {
-  unique_ptr<SSThread * []> threads(new SSThread *[num_outer_threads_]);
-  for (int t = 0; t < num_outer_threads_; ++t) {
-    threads[t] = new SSThread(node, action_sequence, pgbd, reach_probs, num_bets, this, t,
-			      num_outer_threads_);
-  }
+// Solves the subgames enumerated so far and then discards them.
+void SubgameSolver::SolveAll(void) {
+  if (jobs_.empty()) return;
+  // Subgames with lower bet-to have larger subtrees.  Start those first so that the expensive
+  // subgames don't end up at the tail.  stable_sort keeps the boards of one action sequence
+  // together.
+  std::stable_sort(jobs_.begin(), jobs_.end(),
+		   [](const unique_ptr<SubgameJob> &j1, const unique_ptr<SubgameJob> &j2) {
+		     return j1->GetNode()->LastBetTo() < j2->GetNode()->LastBetTo();
+		   });
+  fprintf(stderr, "%i subgames\n", (int)jobs_.size());
+  pthread_mutex_init(&jobs_mutex_, NULL);
+  struct timespec start, finish;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  vector< unique_ptr<SSThread> > threads(num_outer_threads_);
+  for (int t = 0; t < num_outer_threads_; ++t) threads[t].reset(new SSThread(this));
   for (int t = 1; t < num_outer_threads_; ++t) threads[t]->Run();
   // Do first thread in main thread
   threads[0]->Go();
   for (int t = 1; t < num_outer_threads_; ++t) threads[t]->Join();
-  for (int t = 0; t < num_outer_threads_; ++t) delete threads[t];
-}
-
-void SubgameSolver::StreetInitial(Node *node, const string &action_sequence, int pgbd,
-				  const ReachProbs &reach_probs, int num_bets) {
-  int nst = node->Street();
-  if (nst == 1 && num_outer_threads_ > 1) {
-    Split(node, action_sequence, pgbd, reach_probs, num_bets);
-  } else {
-    int pst = node->Street() - 1;
-    int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
-    int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
-    for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
-      Walk(node, action_sequence, ngbd, reach_probs, 0, 0, num_bets, 2, nst);
-    }
-  }
+  clock_gettime(CLOCK_MONOTONIC, &finish);
+  pthread_mutex_destroy(&jobs_mutex_);
+  wall_secs_ +=
+    (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
+  jobs_.clear();
+  next_job_ = 0;
 }
 
 // Currently assume that this is a street-initial node.
 // Might need to do up to four solves.  Imagine we have an asymmetric base
 // betting tree, and an asymmetric solving method.
 void SubgameSolver::ResolveUnsafe(Node *node, int gbd, const string &action_sequence,
-				  const ReachProbs &reach_probs) {
+				  const ReachProbs &reach_probs, int num_inner_threads) {
   int st = node->Street();
   fprintf(stderr, "ResolveUnsafe %s st %i nt %i gbd %i\n", action_sequence.c_str(), st,
 	  node->NonterminalID(), gbd);
@@ -331,7 +456,7 @@ void SubgameSolver::ResolveUnsafe(Node *node, int gbd, const string &action_sequ
   if (method_ == ResolvingMethod::UNSAFE) {
     eg_cfr.reset(new UnsafeEGCFR(subgame_card_abstraction_, base_card_abstraction_,
 				 base_betting_abstraction_, subgame_cfr_config_, base_cfr_config_,
-				 subgame_buckets_, num_inner_threads_));
+				 subgame_buckets_, num_inner_threads));
     if (st < Game::MaxStreet()) {
       eg_cfr->SetSplitStreet(st + 1);
     }
@@ -339,31 +464,27 @@ void SubgameSolver::ResolveUnsafe(Node *node, int gbd, const string &action_sequ
     fprintf(stderr, "Method not supported yet\n");
     exit(-1);
   }
+  // Counted by AddVisits()
+  eg_cfr->SetCollectStats(true);
   
   int num_asym_players = base_betting_abstraction_.Asymmetric() ? num_players : 1;
   for (int asym_p = 0; asym_p < num_asym_players; ++asym_p) {
-    BettingTrees *base_subtrees = nullptr;
+    // Unsafe resolving doesn't need the base strategy below the trunk, so there is nothing to
+    // read when base_mem_ is false, unless we are warm starting from it.
     BettingTrees *subgame_subtrees = CreateSubtrees(node, asym_p, false);
-    if (! base_mem_) {
-      fprintf(stderr, "base_mem_ false not supported currently\n");
-      exit(-1);
-#if 0
-      base_subtrees = CreateSubtrees(node, asym_p, true);
-      // The action sequence passed in should specify the root of the system
-      // we are reading (the base system).
-      // We never finished implementing this function.
-      unique_ptr<CFRValues> base_subgame_strategy =
-	    ReadBaseSubgameStrategy(base_card_abstraction_, base_betting_abstraction_,
-				    base_cfr_config_, base_betting_trees_.get(), base_buckets_,
-				    subgame_buckets_, base_it_, node,  gbd, "x", reach_probs,
-				    base_subtrees, current_, asym_p);
-      // We are calculating CBRs from the *base* strategy, not the resolved
-      // endgame strategy.  So pass in base_card_abstraction_, etc.
-      dynamic_cbr_.reset(new DynamicCBR2(base_card_abstraction_, base_betting_abstraction_,
-					 base_cfr_config_, base_buckets_, 1));
-      if (current_) dynamic_cbr_->MoveRegrets(base_subgame_strategy);
-      else          dynamic_cbr_->MoveSumprobs(base_subgame_strategy);
-#endif
+    unique_ptr<BettingTrees> base_subtrees;
+    if (subgame_cfr_config_.WarmStartIts() > 0 && base_mem_) {
+      // The global base strategy is rooted at the root of the full tree.
+      eg_cfr->SetWarmStart(current_ ? dynamic_cbr_->Regrets() : dynamic_cbr_->Sumprobs(), node,
+			   &base_buckets_);
+    } else if (subgame_cfr_config_.WarmStartIts() > 0) {
+      base_subtrees.reset(CreateSubtrees(node, asym_p, true));
+      shared_ptr<CFRValues> base_subgame_strategy(
+	      ReadBaseSubgameStrategy(base_card_abstraction_, base_betting_abstraction_,
+				      base_cfr_config_, base_betting_trees_.get(), base_buckets_,
+				      subgame_buckets_, base_it_, node, gbd, "x",
+				      base_subtrees.get(), current_, asym_p));
+      eg_cfr->SetWarmStart(base_subgame_strategy, base_subtrees->Root(), &base_buckets_);
     }
 
     if (method_ == ResolvingMethod::UNSAFE) {
@@ -387,19 +508,10 @@ void SubgameSolver::ResolveUnsafe(Node *node, int gbd, const string &action_sequ
 	}
 	shared_ptr<double []> t_vals;
 	if (method_ != ResolvingMethod::UNSAFE) {
-	  if (base_mem_) {
-	    // When base_mem_ is true, we use a global betting tree, a global
-	    // hand tree and have a global base strategy.
-	    // We assume that pure_streets_[st] tells us whether to purify
-	    // for the entire endgame.
-	    t_vals = dynamic_cbr_->Compute(node, reach_probs, gbd, trunk_hand_tree_.get(),
-					   solve_p^1, cfrs_, zero_sum_, current_,
-					   pure_streets_[st]);
-	  } else {
-	    t_vals = dynamic_cbr_->Compute(base_subtrees->Root(), reach_probs, gbd, &hand_tree,
-					   solve_p^1, cfrs_, zero_sum_, current_,
-					   pure_streets_[st]);
-	  }
+	  // We use a global betting tree, a global hand tree and have a global base strategy.
+	  // We assume that pure_streets_[st] tells us whether to purify for the entire endgame.
+	  t_vals = dynamic_cbr_->Compute(node, reach_probs, gbd, trunk_hand_tree_.get(),
+					 solve_p^1, cfrs_, zero_sum_, current_, pure_streets_[st]);
 	}
 
 	// Pass in false for both_players.  I am doing separate solves for
@@ -414,9 +526,9 @@ void SubgameSolver::ResolveUnsafe(Node *node, int gbd, const string &action_sequ
       }
     }
   
-    delete base_subtrees;
     delete subgame_subtrees;
   }
+  AddVisits(*eg_cfr);
 }
 
 void SubgameSolver::ResolveSafe(Node *node, int gbd, const string &action_sequence,
@@ -439,8 +551,37 @@ void SubgameSolver::ResolveSafe(Node *node, int gbd, const string &action_sequen
     fprintf(stderr, "ResolveSafe unsupported method\n");
     exit(-1);
   }
+  // Counted by AddVisits()
+  eg_cfr->SetCollectStats(true);
   // Don't support asymmetric yet
   unique_ptr<BettingTrees> subgame_subtrees(CreateSubtrees(node, 0, false));
+  unique_ptr<BettingTrees> base_subtrees;
+  unique_ptr<DynamicCBR> subgame_dynamic_cbr;
+  if (! base_mem_) {
+    // Read just this subgame's portion of the base strategy from disk.
+    base_subtrees.reset(CreateSubtrees(node, 0, true));
+    shared_ptr<CFRValues> base_subgame_strategy(
+	    ReadBaseSubgameStrategy(base_card_abstraction_, base_betting_abstraction_,
+				    base_cfr_config_, base_betting_trees_.get(), base_buckets_,
+				    subgame_buckets_, base_it_, node, gbd, "x",
+				    base_subtrees.get(), current_, 0));
+    // We are calculating CBRs from the *base* strategy, not the resolved
+    // endgame strategy.  So pass in base_card_abstraction_, etc.
+    subgame_dynamic_cbr.reset(new DynamicCBR(base_card_abstraction_, base_cfr_config_,
+					     base_buckets_, 1));
+    if (current_) subgame_dynamic_cbr->SetRegrets(base_subgame_strategy);
+    else          subgame_dynamic_cbr->SetSumprobs(base_subgame_strategy);
+    // The base subtree is specific to this subgame, so a shared cache would be of no use.  This
+    // one holds the CBRs for both players.
+    subgame_dynamic_cbr->SetCache(shared_ptr<CBRCache>(new CBRCache(2)));
+    if (subgame_cfr_config_.WarmStartIts() > 0) {
+      eg_cfr->SetWarmStart(base_subgame_strategy, base_subtrees->Root(), &base_buckets_);
+    }
+  } else if (subgame_cfr_config_.WarmStartIts() > 0) {
+    // The global base strategy is rooted at the root of the full tree.
+    eg_cfr->SetWarmStart(current_ ? dynamic_cbr_->Regrets() : dynamic_cbr_->Sumprobs(), node,
+			 &base_buckets_);
+  }
   for (int solve_p = 0; solve_p < num_players; ++solve_p) {
     if (! card_level_) {
       fprintf(stderr, "DynamicCBR cannot compute bucket-level CVs\n");
@@ -457,13 +598,9 @@ void SubgameSolver::ResolveSafe(Node *node, int gbd, const string &action_sequen
       // fprintf(stderr, "solve_p %i t_vals[0] %f\n", solve_p, t_vals[0]);
       // exit(-1);
     } else {
-      fprintf(stderr, "base_mem_ false not supported yet\n");
-      exit(-1);
-#if 0
-      t_vals = dynamic_cbr_->Compute(base_subtree->Root(), reach_probs, gbd, &hand_tree,
-				     solve_p^1, cfrs_, zero_sum_, current_,
-				     pure_streets_[st]);
-#endif
+      t_vals = subgame_dynamic_cbr->Compute(base_subtrees->Root(), reach_probs, gbd, &hand_tree,
+					    solve_p^1, cfrs_, zero_sum_, current_,
+					    pure_streets_[st]);
     }
     // Pass in false for both_players.  I am doing separate solves for
     // each player.
@@ -475,6 +612,8 @@ void SubgameSolver::ResolveSafe(Node *node, int gbd, const string &action_sequen
 		 subgame_betting_abstraction_, base_cfr_config_, subgame_cfr_config_, method_,
 		 eg_cfr->Sumprobs().get(), st, gbd, 0, solve_p, st);
   }
+  AddVisits(*eg_cfr);
+  if (subgame_dynamic_cbr) AddVisits(*subgame_dynamic_cbr);
 }
 
 void SubgameSolver::Walk(Node *node, const string &action_sequence, int gbd,
@@ -494,11 +633,10 @@ void SubgameSolver::Walk(Node *node, const string &action_sequence, int gbd,
     // Do we assume that this is a street-initial node?
     // We do assume no bet pending
     // Skip if we are already all in?
-    if (method_ == ResolvingMethod::UNSAFE) {
-      ResolveUnsafe(node, gbd, action_sequence, reach_probs);
-    } else {
-      ResolveSafe(node, gbd, action_sequence, reach_probs);
-    }
+    // Just enumerate the subgame here; it gets solved later in SolveAll().
+    jobs_.emplace_back(new SubgameJob(node, action_sequence, gbd, reach_probs));
+    ++num_jobs_;
+    if (jobs_.size() == kJobBatchSize) SolveAll();
     return;
   }
 
@@ -530,6 +668,16 @@ void SubgameSolver::Walk(void) {
   int last_bet_size = Game::BigBlind() - Game::SmallBlind();
   unique_ptr<ReachProbs> reach_probs(ReachProbs::CreateRoot());
   Walk(base_betting_trees_->Root(), "x", 0, *reach_probs, last_bet_size, 0, 0, 2, 0);
+  SolveAll();
+  fprintf(stderr, "Solved %i subgames; %.2f subgame secs; %.2f wall secs\n", num_finished_,
+	  sum_secs_, wall_secs_);
+  if (dynamic_cbr_) {
+    num_node_visits_ += dynamic_cbr_->NumNodeVisits();
+    num_zero_reach_pruned_ += dynamic_cbr_->NumZeroReachPruned();
+  }
+  fprintf(stderr, "%lli node visits; %lli nodes not reached by the opponent pruned\n",
+	  num_node_visits_, num_zero_reach_pruned_);
+  if (cbr_cache_) cbr_cache_->Report();
 }
 
 static void Usage(const char *prog_name) {
@@ -556,7 +704,9 @@ static void Usage(const char *prog_name) {
   fprintf(stderr, "We support two different methods of multithreading.  The first type is the "
 	  "multithreading inside of VCFR.  The second type is the multithreading inside of "
 	  "solve_all_subgames.  <num inner threads> controls the first type; <num outer threads> "
-	  "controls the second type.\n");
+	  "controls the second type.  Subgames are handed out dynamically to the outer threads, "
+	  "and the inner thread count of each subgame is adjusted based on observed subgame "
+	  "solve times.\n");
   exit(-1);
 }
 
@@ -639,6 +789,7 @@ int main(int argc, char *argv[]) {
   int num_inner_threads, num_outer_threads;
   if (sscanf(argv[18], "%i", &num_inner_threads) != 1) Usage(argv[0]);
   if (sscanf(argv[19], "%i", &num_outer_threads) != 1) Usage(argv[0]);
+  if (num_inner_threads < 1 || num_outer_threads < 1) Usage(argv[0]);
 
   if (num_inner_threads > 1 && solve_st == max_street) {
     fprintf(stderr, "Can't have num_inner_threads > 1 if solve_st == max_street\n");
@@ -17,6 +17,7 @@
 #include "buckets.h"
 #include "canonical_cards.h"
 #include "card_abstraction.h"
+#include "cbr_cache.h"
 #include "card_abstraction_params.h"
 #include "cfr_config.h"
 #include "cfr_params.h"
@@ -210,6 +211,9 @@ SubgameSolver::SubgameSolver(const CardAbstraction &base_card_abstraction,
     // We are calculating CBRs from the *base* strategy, not the resolved
     // endgame strategy.  So pass in base_card_abstraction_, etc.
     dynamic_cbr_.reset(new DynamicCBR(base_card_abstraction_, base_cfr_config_, base_buckets_, 1));
+    // With zero-sum CBRs, the first Compute() produces the CBRs for both players.  Cache them
+    // so that the solve for the second player doesn't redo the traversal.
+    dynamic_cbr_->SetCache(shared_ptr<CBRCache>(new CBRCache(2)));
     if (current_) {
       unique_ptr<bool []> subgame_streets(new bool[max_street + 1]);
       for (int st = 0; st <= max_street; ++st) {
@@ -0,0 +1,426 @@
+// Long-running process that answers strategy queries against a solved system.  The betting
+// tree, buckets and sumprobs are loaded once at startup, after which each query is a few table
+// lookups.
+//
+// Queries are read from stdin, or from connections to a Unix socket if a socket path is given.
+// Connections are served one at a time.  The protocol is line based:
+//
+//   <action sequence> <hole cards> [<board>]
+//     Returns the action probabilities at the node reached by the action sequence for the given
+//     cards, as "ok <action>:<prob> ..." or "error <reason>".  The action sequence uses the
+//     action names from Node::ActionName() with no separators between streets (e.g., "b200cc"),
+//     or "x" for the root.  Cards are written without spaces (e.g., "AsKd" and "7h2c9dTs").  The
+//     board should include all the cards dealt so far; extra cards are ignored.
+//   batch <n>
+//     The next n lines are queries.  The n responses are written together once all the queries
+//     have been answered.
+//   stats
+//     Reports the number of queries answered and percentiles of the per-query latency.
+//   quit
+//     Closes the connection (or exits, when reading from stdin).
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "betting_abstraction.h"
+#include "betting_abstraction_params.h"
+#include "betting_tree.h"
+#include "board_tree.h"
+#include "buckets.h"
+#include "canonical.h"
+#include "canonical_cards.h"
+#include "card_abstraction.h"
+#include "card_abstraction_params.h"
+#include "cards.h"
+#include "cfr_config.h"
+#include "cfr_params.h"
+#include "cfr_values.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "hand_tree.h"
+#include "hand_value_tree.h"
+#include "params.h"
+#include "sorting.h"
+
+using std::string;
+using std::unique_ptr;
+
+static const char kSuits[] = "cdhs";
+
+// Latencies are counted in a fixed number of buckets whose widths grow geometrically, so that
+// memory doesn't grow with the number of queries served.  Bucket 0 holds latencies below
+// kMinLatency; bucket b > 0 holds latencies below kMinLatency * kLatencyRatio^b.  Percentiles
+// are reported as the upper bound of their bucket, so they are accurate to within 2%.
+static const int kNumLatencyBuckets = 1000;
+static const double kMinLatency = 0.1; // Microseconds
+static const double kLatencyRatio = 1.02;
+
+class StrategyServer {
+public:
+  StrategyServer(const CardAbstraction &ca, const BettingAbstraction &ba, const CFRConfig &cc,
+		 int it);
+  ~StrategyServer(void);
+  void Serve(FILE *in, FILE *out);
+private:
+  Node *FindNode(const char *action_sequence) const;
+  bool ParseCards(const char *str, int num_cards, Card *cards) const;
+  void Query(const char *line, string *response);
+  void RecordLatency(double latency);
+  double LatencyPercentile(double p) const;
+  void Stats(FILE *out) const;
+
+  unique_ptr<Buckets> buckets_;
+  unique_ptr<BettingTree> betting_tree_;
+  unique_ptr<CFRValues> sumprobs_;
+  // Maps raw hcps on the final street to the hand strength order used to index unbucketed
+  // values.  Only created if the final street is unbucketed.
+  unsigned short **sorted_hcps_;
+  unique_ptr<long long int []> latency_counts_;
+  long long int num_queries_;
+  double sum_latency_;
+  double max_latency_;
+};
+
+StrategyServer::StrategyServer(const CardAbstraction &ca, const BettingAbstraction &ba,
+			       const CFRConfig &cc, int it) {
+  BoardTree::Create();
+  BoardTree::CreateLookup();
+  buckets_.reset(new Buckets(ca, false));
+  betting_tree_.reset(new BettingTree(ba));
+  sumprobs_.reset(new CFRValues(nullptr, nullptr, 0, 0, *buckets_, betting_tree_.get()));
+  char dir[500];
+  sprintf(dir, "%s/%s.%u.%s.%u.%u.%u.%s.%s", Files::OldCFRBase(),
+	  Game::GameName().c_str(), Game::NumPlayers(),
+	  ca.CardAbstractionName().c_str(), Game::NumRanks(), Game::NumSuits(),
+	  Game::MaxStreet(), ba.BettingAbstractionName().c_str(),
+	  cc.CFRConfigName().c_str());
+  sumprobs_->Read(dir, it, betting_tree_.get(), "x", -1, true, false);
+
+  int max_street = Game::MaxStreet();
+  if (buckets_->None(max_street)) {
+    HandValueTree::Create();
+    int num_hole_card_pairs = Game::NumHoleCardPairs(max_street);
+    int num_boards = BoardTree::NumBoards(max_street);
+    sorted_hcps_ = new unsigned short *[num_boards];
+    Card cards[7];
+    int num_hole_cards = Game::NumCardsForStreet(0);
+    int num_board_cards = Game::NumBoardCards(max_street);
+    for (int bd = 0; bd < num_boards; ++bd) {
+      const Card *board = BoardTree::Board(max_street, bd);
+      for (int i = 0; i < num_board_cards; ++i) {
+	cards[i + num_hole_cards] = board[i];
+      }
+      int sg = BoardTree::SuitGroups(max_street, bd);
+      CanonicalCards hands(2, board, num_board_cards, sg, false);
+      hands.SortByHandStrength(board);
+      sorted_hcps_[bd] = new unsigned short[num_hole_card_pairs];
+      for (int shcp = 0; shcp < num_hole_card_pairs; ++shcp) {
+	const Card *hole_cards = hands.Cards(shcp);
+	for (int i = 0; i < num_hole_cards; ++i) {
+	  cards[i] = hole_cards[i];
+	}
+	int rhcp = HCPIndex(max_street, cards);
+	sorted_hcps_[bd][rhcp] = shcp;
+      }
+    }
+  } else {
+    sorted_hcps_ = nullptr;
+  }
+
+  latency_counts_.reset(new long long int[kNumLatencyBuckets]);
+  for (int b = 0; b < kNumLatencyBuckets; ++b) latency_counts_[b] = 0;
+  num_queries_ = 0;
+  sum_latency_ = 0;
+  max_latency_ = 0;
+}
+
+StrategyServer::~StrategyServer(void) {
+  if (sorted_hcps_) {
+    int num_boards = BoardTree::NumBoards(Game::MaxStreet());
+    for (int bd = 0; bd < num_boards; ++bd) {
+      delete [] sorted_hcps_[bd];
+    }
+    delete [] sorted_hcps_;
+  }
+}
+
+// Follows the named actions from the root.  Returns nullptr if the sequence doesn't name a
+// node in the tree.
+Node *StrategyServer::FindNode(const char *action_sequence) const {
+  Node *node = betting_tree_->Root();
+  if (! strcmp(action_sequence, "x")) return node;
+  const char *str = action_sequence;
+  while (*str) {
+    if (node->Terminal()) return nullptr;
+    int num_succs = node->NumSuccs();
+    int s;
+    for (s = 0; s < num_succs; ++s) {
+      string action = node->ActionName(s);
+      int len = action.size();
+      // Don't let "b5" match the start of "b50"
+      if (! strncmp(str, action.c_str(), len) && ! (str[len] >= '0' && str[len] <= '9')) {
+	str += len;
+	break;
+      }
+    }
+    if (s == num_succs) return nullptr;
+    node = node->IthSucc(s);
+  }
+  return node;
+}
+
+bool StrategyServer::ParseCards(const char *str, int num_cards, Card *cards) const {
+  if ((int)strlen(str) < 2 * num_cards) return false;
+  for (int i = 0; i < num_cards; ++i) {
+    const char *s = str + 2 * i;
+    const char *rank = s[0] ? strchr("23456789TJQKA", s[0]) : nullptr;
+    const char *suit = s[1] ? strchr(kSuits, s[1]) : nullptr;
+    if (rank == nullptr || suit == nullptr) return false;
+    if (suit - kSuits >= Game::NumSuits()) return false;
+    cards[i] = ParseCard(s);
+    if (cards[i] > Game::MaxCard()) return false;
+    for (int j = 0; j < i; ++j) {
+      if (cards[j] == cards[i]) return false;
+    }
+  }
+  return true;
+}
+
+void StrategyServer::Query(const char *line, string *response) {
+  char action_sequence[500], hole_str[100], board_str[100];
+  board_str[0] = 0;
+  int num_fields = sscanf(line, "%499s %99s %99s", action_sequence, hole_str, board_str);
+  if (num_fields < 2) {
+    *response = "error expected <action sequence> <hole cards> [<board>]";
+    return;
+  }
+  Node *node = FindNode(action_sequence);
+  if (node == nullptr) {
+    *response = "error no node with action sequence ";
+    *response += action_sequence;
+    return;
+  }
+  if (node->Terminal()) {
+    *response = "error terminal node";
+    return;
+  }
+  int st = node->Street();
+  int num_hole_cards = Game::NumCardsForStreet(0);
+  int num_board_cards = Game::NumBoardCards(st);
+  Card hole_cards[2], board[5], cards[7];
+  if (! ParseCards(hole_str, num_hole_cards, hole_cards)) {
+    *response = "error bad hole cards";
+    return;
+  }
+  if (! ParseCards(board_str, num_board_cards, board)) {
+    *response = "error bad board";
+    return;
+  }
+  for (int i = 0; i < num_board_cards; ++i) {
+    for (int j = 0; j < num_hole_cards; ++j) {
+      if (board[i] == hole_cards[j]) {
+	*response = "error board and hole cards overlap";
+	return;
+      }
+    }
+  }
+  int bd = 0;
+  if (st == 0) {
+    SortCards(hole_cards, num_hole_cards);
+    for (int i = 0; i < num_hole_cards; ++i) cards[i] = hole_cards[i];
+  } else {
+    Card canon_board[5], canon_hole_cards[2];
+    CanonicalizeCards(board, hole_cards, st, canon_board, canon_hole_cards);
+    bd = BoardTree::LookupBoard(canon_board, st);
+    for (int i = 0; i < num_hole_cards; ++i) cards[i] = canon_hole_cards[i];
+    for (int i = 0; i < num_board_cards; ++i) cards[num_hole_cards + i] = canon_board[i];
+  }
+  int hcp = HCPIndex(st, cards);
+  int num_succs = node->NumSuccs();
+  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  int offset;
+  if (buckets_->None(st)) {
+    if (st == Game::MaxStreet()) hcp = sorted_hcps_[bd][hcp];
+    offset = bd * num_hole_card_pairs * num_succs + hcp * num_succs;
+  } else {
+    unsigned int h = ((unsigned int)bd) * ((unsigned int)num_hole_card_pairs) + hcp;
+    offset = buckets_->Bucket(st, h) * num_succs;
+  }
+  unique_ptr<double []> probs(new double[num_succs]);
+  if (num_succs == 1) {
+    probs[0] = 1.0;
+  } else {
+    sumprobs_->RMProbs(st, node->PlayerActing(), node->NonterminalID(), offset, num_succs,
+		       node->DefaultSuccIndex(), probs.get());
+  }
+  *response = "ok";
+  for (int s = 0; s < num_succs; ++s) {
+    char buf[100];
+    sprintf(buf, " %s:%f", node->ActionName(s).c_str(), probs[s]);
+    *response += buf;
+  }
+}
+
+// latency is in microseconds
+void StrategyServer::RecordLatency(double latency) {
+  int b = 0;
+  if (latency >= kMinLatency) {
+    b = 1 + (int)(log(latency / kMinLatency) / log(kLatencyRatio));
+    if (b >= kNumLatencyBuckets) b = kNumLatencyBuckets - 1;
+  }
+  ++latency_counts_[b];
+  ++num_queries_;
+  sum_latency_ += latency;
+  if (latency > max_latency_) max_latency_ = latency;
+}
+
+double StrategyServer::LatencyPercentile(double p) const {
+  long long int rank = (long long int)(num_queries_ * p) + 1;
+  if (rank > num_queries_) rank = num_queries_;
+  long long int cum = 0;
+  for (int b = 0; b < kNumLatencyBuckets; ++b) {
+    cum += latency_counts_[b];
+    if (cum >= rank) {
+      double upper = kMinLatency * pow(kLatencyRatio, b);
+      return upper < max_latency_ ? upper : max_latency_;
+    }
+  }
+  return max_latency_;
+}
+
+void StrategyServer::Stats(FILE *out) const {
+  if (num_queries_ == 0) {
+    fprintf(out, "ok 0 queries\n");
+    return;
+  }
+  fprintf(out, "ok %lli queries mean %.2fus p50 %.2fus p90 %.2fus p99 %.2fus p99.9 %.2fus "
+	  "max %.2fus\n", num_queries_, sum_latency_ / num_queries_, LatencyPercentile(0.5),
+	  LatencyPercentile(0.9), LatencyPercentile(0.99), LatencyPercentile(0.999),
+	  max_latency_);
+}
+
+void StrategyServer::Serve(FILE *in, FILE *out) {
+  char line[1000];
+  string response;
+  while (fgets(line, sizeof(line), in)) {
+    int len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = 0;
+    if (len == 0) continue;
+    if (! strcmp(line, "quit")) break;
+    if (! strcmp(line, "stats")) {
+      Stats(out);
+      fflush(out);
+      continue;
+    }
+    int num_queries = 1;
+    bool batch = ! strncmp(line, "batch ", 6);
+    if (batch) {
+      if (sscanf(line + 6, "%i", &num_queries) != 1 || num_queries < 1) {
+	fprintf(out, "error bad batch size\n");
+	fflush(out);
+	continue;
+      }
+    }
+    string responses;
+    for (int i = 0; i < num_queries; ++i) {
+      if (batch) {
+	if (! fgets(line, sizeof(line), in)) return;
+	len = strlen(line);
+	while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = 0;
+      }
+      struct timespec start, finish;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      Query(line, &response);
+      clock_gettime(CLOCK_MONOTONIC, &finish);
+      RecordLatency((finish.tv_sec - start.tv_sec) * 1e6 +
+		    (finish.tv_nsec - start.tv_nsec) / 1e3);
+      responses += response;
+      responses += '\n';
+    }
+    fputs(responses.c_str(), out);
+    fflush(out);
+  }
+}
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <card params> <betting params> <CFR params> <it> "
+	  "(<socket path>)\n", prog_name);
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 6 && argc != 7) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unique_ptr<Params> card_params = CreateCardAbstractionParams();
+  card_params->ReadFromFile(argv[2]);
+  unique_ptr<CardAbstraction>
+    card_abstraction(new CardAbstraction(*card_params));
+  unique_ptr<Params> betting_params = CreateBettingAbstractionParams();
+  betting_params->ReadFromFile(argv[3]);
+  unique_ptr<BettingAbstraction>
+    betting_abstraction(new BettingAbstraction(*betting_params));
+  unique_ptr<Params> cfr_params = CreateCFRParams();
+  cfr_params->ReadFromFile(argv[4]);
+  unique_ptr<CFRConfig>
+    cfr_config(new CFRConfig(*cfr_params));
+  int it;
+  if (sscanf(argv[5], "%i", &it) != 1) Usage(argv[0]);
+  if (betting_abstraction->Asymmetric()) {
+    fprintf(stderr, "Asymmetric systems not supported\n");
+    exit(-1);
+  }
+  if (Game::NumCardsForStreet(0) != 2) {
+    fprintf(stderr, "Only games with two hole cards supported\n");
+    exit(-1);
+  }
+
+  StrategyServer server(*card_abstraction, *betting_abstraction, *cfr_config, it);
+  fprintf(stderr, "Ready\n");
+  if (argc == 6) {
+    server.Serve(stdin, stdout);
+    return 0;
+  }
+
+  const char *path = argv[6];
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd == -1) {
+    fprintf(stderr, "Failed to create socket\n");
+    exit(-1);
+  }
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    exit(-1);
+  }
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+      listen(listen_fd, 16) == -1) {
+    fprintf(stderr, "Failed to listen on %s\n", path);
+    exit(-1);
+  }
+  while (true) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd == -1) continue;
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    server.Serve(in, out);
+    fclose(in);
+    fclose(out);
+  }
+}
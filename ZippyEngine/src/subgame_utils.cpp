@@ -49,7 +49,7 @@ BettingTrees *CreateSubtrees(int st, int player_acting, int last_bet_to, int tar
   int num_street_bets = 0;
   int num_bets = 0;  
   BettingTreeBuilder betting_tree_builder(betting_abstraction, target_p);
-  string key;  
+  unsigned long long int key = 0;
   int num_terminals = 0;
   int num_players_to_act = 2;
   unique_ptr<bool []> folded(new bool[num_players]);
@@ -76,7 +76,7 @@ BettingTrees *CreateSubtrees(int st, int last_bet_size, int last_bet_to, int num
   int num_players = Game::NumPlayers();
   unique_ptr<bool []> folded(new bool[num_players]);
   for (int p = 0; p < num_players; ++p) folded[p] = false;
-  string key;
+  unsigned long long int key = 0;
   int num_terminals = 0;
   BettingTreeBuilder betting_tree_builder(betting_abstraction, target_player);
   shared_ptr<Node> subtree_root =
@@ -110,7 +110,7 @@ BettingTrees *BuildHybridTree(const BettingAbstraction &betting_abstraction, int
   unique_ptr<bool []> folded(new bool[num_players]);
   for (int p = 0; p < num_players; ++p) folded[p] = false;
   int num_terminals = 0;
-  string key;
+  unsigned long long int key = 0;
   shared_ptr<Node> fold_succ, call_succ;
   vector< shared_ptr<Node> > bet_succs;
   if (has_call) {
@@ -184,7 +184,7 @@ BettingTrees *BuildHybridTreeBackup(const BettingAbstraction &betting_abstractio
     exit(-1);
   }
   unique_ptr<bool []> folded(new bool[2]);
-  string key;
+  unsigned long long int key = 0;
   for (int p = 0; p < 2; ++p) folded[p] = false;
   int num_terminals = 0, last_bet_size = 0, num_street_bets = 0, num_players_to_act = 2;
   int last_st = backup_st;
@@ -257,6 +257,9 @@ BettingTrees *BuildHybridTreeBackup(const BettingAbstraction &betting_abstractio
 // CBR computation.
 // Actually: for normal subgame solving, I think I only need both players'
 // strategies if we are zero-summing.
+// Only the subtree below base_node, and only the boards below gbd, are read from disk.  The
+// returned values are indexed by the nonterminal IDs of subtrees, which must have been built with
+// the base betting abstraction so that it mirrors the base tree below base_node.
 unique_ptr<CFRValues> ReadBaseSubgameStrategy(const CardAbstraction &base_card_abstraction,
 					      const BettingAbstraction &base_betting_abstraction,
 					      const CFRConfig &base_cfr_config,
@@ -264,8 +267,9 @@ unique_ptr<CFRValues> ReadBaseSubgameStrategy(const CardAbstraction &base_card_a
 					      const Buckets &base_buckets,
 					      const Buckets &subgame_buckets, int base_it,
 					      Node *base_node, int gbd,
-					      const string &action_sequence, double **reach_probs,
-					      BettingTree *subtree, bool current, int asym_p) {
+					      const string &action_sequence,
+					      const BettingTrees *subtrees, bool current,
+					      int asym_p) {
 
   // We need probs for subgame streets only
   int max_street = Game::MaxStreet();
@@ -275,7 +279,7 @@ unique_ptr<CFRValues> ReadBaseSubgameStrategy(const CardAbstraction &base_card_a
   }
   unique_ptr<CFRValues> strategy(new CFRValues(nullptr, subgame_streets.get(),
 					       gbd, base_node->Street(), base_buckets,
-					       base_betting_trees->GetBettingTree()));
+					       subtrees->GetBettingTree()));
 
   char dir[500];
   sprintf(dir, "%s/%s.%u.%s.%i.%i.%i.%s.%s", Files::OldCFRBase(),
@@ -291,23 +295,9 @@ unique_ptr<CFRValues> ReadBaseSubgameStrategy(const CardAbstraction &base_card_a
     strcat(dir, buf);
   }
 
-  unique_ptr<int []> num_full_holdings(new int[max_street + 1]);
-  for (int st = 0; st <= max_street; ++st) {
-    if (subgame_buckets.None(st)) {
-      num_full_holdings[st] =
-	BoardTree::NumBoards(st) * Game::NumHoleCardPairs(st);
-    } else {
-      num_full_holdings[st] = subgame_buckets.NumBuckets(st);
-    }
-  }
-
-  fprintf(stderr, "Need to implement ReadSubtreeFromFull()\n");
-  exit(-1);
-#if 0
-  strategy->ReadSubtreeFromFull(dir, base_it, base_betting_trees->Root(),
-				base_node, subtree->Root(), action_sequence,
-				num_full_holdings.get(), -1);
-#endif
+  // action_sequence names the root of the base system we are reading from.
+  strategy->ReadSubtree(dir, base_it, base_betting_trees->Root(), base_node, subtrees->Root(),
+			action_sequence, base_buckets, -1, ! current);
   
   return strategy;
 }
@@ -323,6 +313,8 @@ void WriteSubgame(Node *node, const string &action_sequence, const string &below
 		  int asym_p, int target_pa, int last_st) {
   if (node->Terminal()) return;
   int st = node->Street();
+  // Depth-limited resolves have no strategy past the leaf street
+  if (sumprobs->StreetValues(st) == nullptr) return;
   if (st > last_st) {
     int ngbd_begin = BoardTree::SuccBoardBegin(last_st, gbd, st);
     int ngbd_end = BoardTree::SuccBoardEnd(last_st, gbd, st);
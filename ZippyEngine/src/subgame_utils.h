@@ -31,8 +31,8 @@ ReadBaseSubgameStrategy(const CardAbstraction &base_card_abstraction,
 			const BettingTrees *base_betting_trees,
 			const Buckets &base_buckets, const Buckets &subgame_buckets,
 			int base_it, Node *base_node, int gbd,
-			const std::string &action_sequence, double **reach_probs,
-			BettingTree *subtree, bool current, int target_p);
+			const std::string &action_sequence, const BettingTrees *subtrees,
+			bool current, int target_p);
 void WriteSubgame(Node *node, const std::string &action_sequence,
 		  const std::string &below_action_sequence, int gbd,
 		  const CardAbstraction &base_card_abstraction,
@@ -19,6 +19,7 @@
 #include "card_abstraction.h"
 #include "cfr_config.h"
 #include "constants.h"
+#include "delta_io.h"
 #include "files.h"
 #include "game.h"
 #include "hand_tree.h"
@@ -1314,6 +1315,7 @@ void TCFR::Read(int batch_index) {
     strcat(dir, buf2);
   }
   int num_players = Game::NumPlayers();
+  bool direct = cfr_config_.DirectIO();
   Reader ***regret_readers = new Reader **[num_players];
   for (int p = 0; p < num_players; ++p) {
     regret_readers[p] = new Reader *[max_street_ + 1];
@@ -1327,7 +1329,11 @@ void TCFR::Read(int batch_index) {
 	suffix = 'i';
       }
       sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.%c", dir, st, batch_index, p, suffix);
-      regret_readers[p][st] = new Reader(buf);
+      if (DeltaCheckpointExists(buf)) {
+	regret_readers[p][st] = new DeltaReader(buf);
+      } else {
+	regret_readers[p][st] = new AsyncReader(buf, kAsyncBufSize, direct);
+      }
     }
   }
   Reader ***sum_prob_readers = new Reader **[num_players];
@@ -1339,7 +1345,11 @@ void TCFR::Read(int batch_index) {
 	continue;
       }
       sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.i", dir, st, batch_index, p);
-      sum_prob_readers[p][st] = new Reader(buf);
+      if (DeltaCheckpointExists(buf)) {
+	sum_prob_readers[p][st] = new DeltaReader(buf);
+      } else {
+	sum_prob_readers[p][st] = new AsyncReader(buf, kAsyncBufSize, direct);
+      }
     }
   }
   bool ***seen = new bool **[max_street_ + 1];
@@ -1397,7 +1407,7 @@ void TCFR::Read(int batch_index) {
 }
 
 void TCFR::Write(int batch_index) {
-  char dir[500], buf[500];
+  char dir[500], buf[500], base_buf[500];
   sprintf(dir, "%s/%s.%u.%s.%i.%i.%i.%s.%s", Files::NewCFRBase(), Game::GameName().c_str(),
 	  Game::NumPlayers(), card_abstraction_.CardAbstractionName().c_str(), Game::NumRanks(),
 	  Game::NumSuits(), Game::MaxStreet(),
@@ -1410,6 +1420,10 @@ void TCFR::Write(int batch_index) {
   }
   Mkdir(dir);
   int num_players = Game::NumPlayers();
+  bool direct = cfr_config_.DirectIO();
+  // With delta checkpoints, we compare against the last checkpoint
+  bool delta = cfr_config_.DeltaCheckpoints();
+  int base = last_checkpoint_batch_index_;
   Writer ***regret_writers = new Writer **[num_players];
   for (int p = 0; p < num_players; ++p) {
     regret_writers[p] = new Writer *[max_street_ + 1];
@@ -1423,7 +1437,12 @@ void TCFR::Write(int batch_index) {
 	suffix = 'i';
       }
       sprintf(buf, "%s/regrets.x.0.0.%u.%u.p%u.%c", dir, st, batch_index, p, suffix);
-      regret_writers[p][st] = new Writer(buf);
+      if (delta) {
+	sprintf(base_buf, "%s/regrets.x.0.0.%u.%i.p%u.%c", dir, st, base, p, suffix);
+	regret_writers[p][st] = new DeltaWriter(buf, base >= 0 ? base_buf : nullptr);
+      } else {
+	regret_writers[p][st] = new AsyncWriter(buf, kAsyncBufSize, direct);
+      }
     }
   }
   bool ***seen = new bool **[max_street_ + 1];
@@ -1455,7 +1474,12 @@ void TCFR::Write(int batch_index) {
 	continue;
       }
       sprintf(buf, "%s/sumprobs.x.0.0.%u.%u.p%u.i", dir, st, batch_index, p);
-      sum_prob_writers[p][st] = new Writer(buf);
+      if (delta) {
+	sprintf(base_buf, "%s/sumprobs.x.0.0.%u.%i.p%u.i", dir, st, base, p);
+	sum_prob_writers[p][st] = new DeltaWriter(buf, base >= 0 ? base_buf : nullptr);
+      } else {
+	sum_prob_writers[p][st] = new AsyncWriter(buf, kAsyncBufSize, direct);
+      }
     }
   }
   for (int st = 0; st <= max_street_; ++st) {
@@ -1482,6 +1506,7 @@ void TCFR::Write(int batch_index) {
     delete [] sum_prob_writers[p];
   }
   delete [] sum_prob_writers;
+  last_checkpoint_batch_index_ = batch_index;
 }
 
 void TCFR::Run(void) {
@@ -1590,7 +1615,11 @@ void TCFR::Run(int start_batch_index, int end_batch_index, int batch_size, int s
     fprintf(stderr, "Batches to execute should be multiple of save interval\n");
     exit(-1);
   }
-  if (start_batch_index > 0) Read(start_batch_index - 1);
+  last_checkpoint_batch_index_ = -1;
+  if (start_batch_index > 0) {
+    Read(start_batch_index - 1);
+    last_checkpoint_batch_index_ = start_batch_index - 1;
+  }
 
   bool some_frozen = false;
   for (int p = 0; p < num_players_; ++p) {
@@ -1861,6 +1890,7 @@ TCFR::TCFR(const CardAbstraction &ca, const BettingAbstraction &ba, const CFRCon
   card_abstraction_(ca), betting_abstraction_(ba), cfr_config_(cc),
   buckets_(buckets) {
   max_street_ = Game::MaxStreet();
+  last_checkpoint_batch_index_ = -1;
 #ifdef BC
   fprintf(stderr, "Sampling canonical boards; scaling updates by board count\n");
 #else
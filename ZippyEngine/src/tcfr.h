@@ -150,6 +150,8 @@ private:
   int target_player_;
   unsigned char *data_;
   int batch_index_;
+  // Batch index of the last checkpoint written or read; -1 if none
+  int last_checkpoint_batch_index_;
   int num_cfr_threads_;
   TCFRThread **cfr_threads_;
   float *rngs_;
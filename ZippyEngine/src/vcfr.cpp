@@ -1,7 +1,6 @@
 #include <math.h> // lrint()
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h> // usleep()
 
 #include <memory>
 #include <string>
@@ -18,6 +17,7 @@
 #include "cfr_utils.h"
 #include "cfr_values.h"
 #include "hand_tree.h"
+#include "hand_tree_buckets.h"
 #include "vcfr_state.h"
 #include "vcfr.h"
 
@@ -26,20 +26,72 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+// Regret update for DCFR.  Discounting multiplies all the positive regrets by one factor and all
+// the negative regrets by another.  Rather than rewrite every regret at the end of each
+// iteration, we keep the accumulated factors in pos_regret_scale_ and neg_regret_scale_, and store
+// each regret divided by the factor for its sign.  The positive regrets of a holding all share a
+// factor, so regret matching can use the stored values directly.
+//
+// Like the other double implementations, this doesn't do scaling.
+void VCFR::UpdateDiscountedRegrets(int st, int i, int num_succs, VCFR_VALUE *vals,
+				   shared_ptr<VCFR_VALUE []> *succ_vals, double *my_regrets) {
+  for (int s = 0; s < num_succs; ++s) {
+    double v = my_regrets[s];
+    double r = v > 0 ? v * pos_regret_scale_ : v * neg_regret_scale_;
+    r += (double)succ_vals[s][i] - vals[i];
+    if (nn_regrets_ && r < regret_floors_[st]) r = regret_floors_[st];
+    double nv = r > 0 ? r / pos_regret_scale_ : r / neg_regret_scale_;
+    if (nn_regrets_ && nv > regret_ceilings_[st]) nv = regret_ceilings_[st];
+    my_regrets[s] = nv;
+  }
+}
+
+void VCFR::UpdateDiscountedRegrets(int st, int i, int num_succs, VCFR_VALUE *vals,
+				   shared_ptr<VCFR_VALUE []> *succ_vals, int *my_regrets) {
+  bool overflow = false;
+  for (int s = 0; s < num_succs; ++s) {
+    int v = my_regrets[s];
+    double r = v > 0 ? v * pos_regret_scale_ : v * neg_regret_scale_;
+    r += ((double)succ_vals[s][i] - vals[i]) * regret_scaling_[st];
+    if (nn_regrets_ && r < regret_floors_[st]) r = regret_floors_[st];
+    double nv = r > 0 ? r / pos_regret_scale_ : r / neg_regret_scale_;
+    if (nn_regrets_ && nv > regret_ceilings_[st]) nv = regret_ceilings_[st];
+    if (nv < -2000000000 || nv > 2000000000) {
+      nv = nv < 0 ? -2000000000 : 2000000000;
+      overflow = true;
+    }
+    my_regrets[s] = lrint(nv);
+  }
+  if (overflow) {
+    for (int s = 0; s < num_succs; ++s) {
+      my_regrets[s] /= 2;
+    }
+  }
+}
+
 template <>
-void VCFR::UpdateRegrets<int>(Node *node, double *vals, shared_ptr<double []> *succ_vals,
-			      int *regrets) {
+void VCFR::UpdateRegrets<int>(Node *node, VCFR_VALUE *vals,
+			      shared_ptr<VCFR_VALUE []> *succ_vals, int *regrets,
+			      const int *canon_hands, int num_canon_hands) {
   int st = node->Street();
   int num_succs = node->NumSuccs();
-  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+
+  if (discounted_) {
+    for (int j = 0; j < num_canon_hands; ++j) {
+      int i = canon_hands ? canon_hands[j] : j;
+      UpdateDiscountedRegrets(st, i, num_succs, vals, succ_vals, regrets + i * num_succs);
+    }
+    return;
+  }
 
   int floor = regret_floors_[st];
   int ceiling = regret_ceilings_[st];
   if (nn_regrets_) {
-    for (int i = 0; i < num_hole_card_pairs; ++i) {
+    for (int j = 0; j < num_canon_hands; ++j) {
+      int i = canon_hands ? canon_hands[j] : j;
       int *my_regrets = regrets + i * num_succs;
       for (int s = 0; s < num_succs; ++s) {
-	double d = succ_vals[s][i] - vals[i];
+	double d = (double)succ_vals[s][i] - vals[i];
 	// Need different implementation for doubles
 	int di = lrint(d * regret_scaling_[st]);
 	int ri = my_regrets[s] + di;
@@ -53,11 +105,12 @@ void VCFR::UpdateRegrets<int>(Node *node, double *vals, shared_ptr<double []> *s
       }
     }
   } else {
-    for (int i = 0; i < num_hole_card_pairs; ++i) {
+    for (int j = 0; j < num_canon_hands; ++j) {
+      int i = canon_hands ? canon_hands[j] : j;
       int *my_regrets = regrets + i * num_succs;
       bool overflow = false;
       for (int s = 0; s < num_succs; ++s) {
-	double d = succ_vals[s][i] - vals[i];
+	double d = (double)succ_vals[s][i] - vals[i];
 	my_regrets[s] += lrint(d * regret_scaling_[st]);
 	if (my_regrets[s] < -2000000000 || my_regrets[s] > 2000000000) {
 	  overflow = true;
@@ -74,16 +127,24 @@ void VCFR::UpdateRegrets<int>(Node *node, double *vals, shared_ptr<double []> *s
 
 // This implementation does not round regrets to ints, nor do scaling.
 template <>
-void VCFR::UpdateRegrets<double>(Node *node, double *vals, shared_ptr<double []> *succ_vals,
-				 double *regrets) {
+void VCFR::UpdateRegrets<double>(Node *node, VCFR_VALUE *vals,
+				 shared_ptr<VCFR_VALUE []> *succ_vals, double *regrets,
+				 const int *canon_hands, int num_canon_hands) {
   int st = node->Street();
   int num_succs = node->NumSuccs();
-  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  if (discounted_) {
+    for (int j = 0; j < num_canon_hands; ++j) {
+      int i = canon_hands ? canon_hands[j] : j;
+      UpdateDiscountedRegrets(st, i, num_succs, vals, succ_vals, regrets + i * num_succs);
+    }
+    return;
+  }
   
   double floor = regret_floors_[st];
   double ceiling = regret_ceilings_[st];
   if (nn_regrets_) {
-    for (int i = 0; i < num_hole_card_pairs; ++i) {
+    for (int j = 0; j < num_canon_hands; ++j) {
+      int i = canon_hands ? canon_hands[j] : j;
       double *my_regrets = regrets + i * num_succs;
       for (int s = 0; s < num_succs; ++s) {
 	double newr = my_regrets[s] + succ_vals[s][i] - vals[i];
@@ -97,43 +158,81 @@ void VCFR::UpdateRegrets<double>(Node *node, double *vals, shared_ptr<double []>
       }
     }
   } else {
-    for (int i = 0; i < num_hole_card_pairs; ++i) {
+    for (int j = 0; j < num_canon_hands; ++j) {
+      int i = canon_hands ? canon_hands[j] : j;
       double *my_regrets = regrets + i * num_succs;
       for (int s = 0; s < num_succs; ++s) {
-	my_regrets[s] += succ_vals[s][i] - vals[i];
+	my_regrets[s] += (double)succ_vals[s][i] - vals[i];
       }
     }
   }
 }
 
-// This is ugly, but I can't figure out a better way.
-void VCFR::UpdateRegrets(Node *node, int lbd, double *vals, shared_ptr<double []> *succ_vals) {
+// Gives each non-canonical hand on a board the value of its canonical hand.  canon_hands lists
+// the canonical hands followed by the others (see HandTree::CanonHands()).
+static void CopyCanonVals(const int *canons, const int *canon_hands, int num_canon_hands,
+			  int num_hole_card_pairs, VCFR_VALUE *vals) {
+  for (int j = num_canon_hands; j < num_hole_card_pairs; ++j) {
+    int i = canon_hands[j];
+    vals[i] = vals[canons[i]];
+  }
+}
+
+// Likewise, but for the values (e.g., the regrets) of each succ.  board_values holds num_succs
+// values for each hand on the board.
+template <typename T>
+static void CopyCanonRows(const int *canons, const int *canon_hands, int num_canon_hands,
+			  int num_hole_card_pairs, int num_succs, T *board_values) {
+  for (int j = num_canon_hands; j < num_hole_card_pairs; ++j) {
+    int i = canon_hands[j];
+    T *my_values = board_values + i * num_succs;
+    const T *canon_values = board_values + canons[i] * num_succs;
+    for (int s = 0; s < num_succs; ++s) my_values[s] = canon_values[s];
+  }
+}
+
+// Unabstracted hands have regrets of their own.  If only the canonical hands were updated, the
+// other hands get copies of their rows, so that checkpoints (and anything else that looks up the
+// regrets of a non-canonical hand) are the same as if every hand had been updated.
+void VCFR::UpdateRegrets(Node *node, int lbd, VCFR_VALUE *vals,
+			 shared_ptr<VCFR_VALUE []> *succ_vals, const int *canons,
+			 const int *canon_hands, int num_canon_hands) {
   int pa = node->PlayerActing();
   int st = node->Street();
   int nt = node->NonterminalID();
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   int num_succs = node->NumSuccs();
-  CFRStreetValues<double> *d_street_values;
-  CFRStreetValues<int> *i_street_values;
-  AbstractCFRStreetValues *street_values = regrets_->StreetValues(st);
-  if ((d_street_values =
-       dynamic_cast<CFRStreetValues<double> *>(street_values))) {
-    double *board_regrets = d_street_values->AllValues(pa, nt) +
+  if (d_regrets_[st]) {
+    double *board_regrets = d_regrets_[st]->AllValues(pa, nt) +
       lbd * num_hole_card_pairs * num_succs;
-    UpdateRegrets(node, vals, succ_vals, board_regrets);
-  } else if ((i_street_values =
-	      dynamic_cast<CFRStreetValues<int> *>(street_values))) {
-    int *board_regrets = i_street_values->AllValues(pa, nt) +
+    UpdateRegrets(node, vals, succ_vals, board_regrets, canon_hands, num_canon_hands);
+    if (canon_hands) {
+      CopyCanonRows(canons, canon_hands, num_canon_hands, num_hole_card_pairs, num_succs,
+		    board_regrets);
+    }
+  } else if (i_regrets_[st]) {
+    int *board_regrets = i_regrets_[st]->AllValues(pa, nt) +
       lbd * num_hole_card_pairs * num_succs;
-    UpdateRegrets(node, vals, succ_vals, board_regrets);
+    UpdateRegrets(node, vals, succ_vals, board_regrets, canon_hands, num_canon_hands);
+    if (canon_hands) {
+      CopyCanonRows(canons, canon_hands, num_canon_hands, num_hole_card_pairs, num_succs,
+		    board_regrets);
+    }
   }
 }
 
-void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				 shared_ptr<double []> *succ_vals, int *regrets) {
+void VCFR::UpdateRegretsBucketed(Node *node, const int *street_buckets, VCFR_VALUE *vals,
+				 shared_ptr<VCFR_VALUE []> *succ_vals, int *regrets) {
   int st = node->Street();
   int num_succs = node->NumSuccs();
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  if (discounted_) {
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      UpdateDiscountedRegrets(st, i, num_succs, vals, succ_vals,
+			      regrets + street_buckets[i] * num_succs);
+    }
+    return;
+  }
 
   int floor = regret_floors_[st];
   int ceiling = regret_ceilings_[st];
@@ -142,7 +241,7 @@ void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
       int b = street_buckets[i];
       int *my_regrets = regrets + b * num_succs;
       for (int s = 0; s < num_succs; ++s) {
-	double d = succ_vals[s][i] - vals[i];
+	double d = (double)succ_vals[s][i] - vals[i];
 	// Need different implementation for doubles
 	int di = lrint(d * regret_scaling_[st]);
 	int ri = my_regrets[s] + di;
@@ -161,7 +260,7 @@ void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
       int *my_regrets = regrets + b * num_succs;
       bool overflow = false;
       for (int s = 0; s < num_succs; ++s) {
-	double d = succ_vals[s][i] - vals[i];
+	double d = (double)succ_vals[s][i] - vals[i];
 	my_regrets[s] += lrint(d * regret_scaling_[st]);
 	if (my_regrets[s] < -2000000000 || my_regrets[s] > 2000000000) {
 	  overflow = true;
@@ -177,11 +276,18 @@ void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
 }
 
 // This implementation does not round regrets to ints, nor do scaling.
-void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				 shared_ptr<double []> *succ_vals, double *regrets) {
+void VCFR::UpdateRegretsBucketed(Node *node, const int *street_buckets, VCFR_VALUE *vals,
+				 shared_ptr<VCFR_VALUE []> *succ_vals, double *regrets) {
   int st = node->Street();
   int num_succs = node->NumSuccs();
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  if (discounted_) {
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      UpdateDiscountedRegrets(st, i, num_succs, vals, succ_vals,
+			      regrets + street_buckets[i] * num_succs);
+    }
+    return;
+  }
   
   double floor = regret_floors_[st];
   double ceiling = regret_ceilings_[st];
@@ -205,32 +311,62 @@ void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
       int b = street_buckets[i];
       double *my_regrets = regrets + b * num_succs;
       for (int s = 0; s < num_succs; ++s) {
-	my_regrets[s] += succ_vals[s][i] - vals[i];
+	my_regrets[s] += (double)succ_vals[s][i] - vals[i];
       }
     }
   }
 }
 
-void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				 shared_ptr<double []> *succ_vals) {
+void VCFR::UpdateRegretsBucketed(Node *node, const int *street_buckets, VCFR_VALUE *vals,
+				 shared_ptr<VCFR_VALUE []> *succ_vals) {
   int pa = node->PlayerActing();
   int st = node->Street();
   int nt = node->NonterminalID();
-  CFRStreetValues<double> *d_street_values;
-  CFRStreetValues<int> *i_street_values;
-  AbstractCFRStreetValues *street_values = regrets_->StreetValues(st);
-  if ((d_street_values =
-       dynamic_cast<CFRStreetValues<double> *>(street_values))) {
-    double *d_regrets = d_street_values->AllValues(pa, nt);
+  if (d_regrets_[st]) {
+    double *d_regrets = d_regrets_[st]->AllValues(pa, nt);
     UpdateRegretsBucketed(node, street_buckets, vals, succ_vals, d_regrets);
-  } else if ((i_street_values =
-	      dynamic_cast<CFRStreetValues<int> *>(street_values))) {
-    int *i_regrets = i_street_values->AllValues(pa, nt);
+  } else if (i_regrets_[st]) {
+    int *i_regrets = i_regrets_[st]->AllValues(pa, nt);
     UpdateRegretsBucketed(node, street_buckets, vals, succ_vals, i_regrets);
   }
 }
 
-shared_ptr<double []> VCFR::OurChoice(Node *p0_node, Node *p1_node, int gbd, VCFRState *state) {
+// Regret-based pruning.  A succ that the current strategy plays with probability zero for every
+// hand on this board contributes nothing to our values, so we can skip traversing it.  Its
+// regrets don't get updated, nor do the opponent's sumprobs below it; the periodic full
+// iterations take care of that.  Returns true if any succ is prunable.
+bool VCFR::SetPrunableSuccs(Node *node, int lbd, const int *street_buckets, bool bucketed,
+			    bool *prunable) {
+  int pa = node->PlayerActing();
+  int st = node->Street();
+  int nt = node->NonterminalID();
+  int num_succs = node->NumSuccs();
+  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  if (bucketed) {
+    // current_strategy_ was computed from the regrets at the beginning of the iteration
+    double *all_cs_probs = current_strategy_values_[st]->AllValues(pa, nt);
+    int dsi = node->DefaultSuccIndex();
+    // As in the unbucketed case, the default succ is never pruned
+    for (int s = 0; s < num_succs; ++s) prunable[s] = s != dsi;
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      double *current_probs = all_cs_probs + street_buckets[i] * num_succs;
+      for (int s = 0; s < num_succs; ++s) {
+	if (current_probs[s] > 0) prunable[s] = false;
+      }
+    }
+  } else {
+    int offset = lbd * num_hole_card_pairs * num_succs;
+    regrets_->StreetValues(st)->PrunableSuccs(pa, nt, offset, num_hole_card_pairs, num_succs,
+					       node->DefaultSuccIndex(), prunable);
+  }
+  for (int s = 0; s < num_succs; ++s) {
+    if (prunable[s]) return true;
+  }
+  return false;
+}
+
+shared_ptr<VCFR_VALUE []> VCFR::OurChoice(Node *p0_node, Node *p1_node, int gbd,
+					  VCFRState *state) {
   int pa = p0_node->PlayerActing();
   Node *node = pa == 0 ? p0_node : p1_node;
   Node *responding_node = pa == 0 ? p1_node : p0_node;
@@ -240,9 +376,31 @@ shared_ptr<double []> VCFR::OurChoice(Node *p0_node, Node *p1_node, int gbd, VCF
   int nt = node->NonterminalID();
   int lbd = state->LocalBoardIndex(st, gbd);
   unique_ptr<int []> succ_mapping = GetSuccMapping(node, responding_node);
-  shared_ptr<double []> vals;
-  unique_ptr< shared_ptr<double []> []> succ_vals(new shared_ptr<double []> [num_succs]);
+  shared_ptr<VCFR_VALUE []> vals;
+  unique_ptr<shared_ptr<VCFR_VALUE []> []> succ_vals(new shared_ptr<VCFR_VALUE []> [num_succs]);
+  unique_ptr<bool []> prunable;
+  bool any_prunable = false;
+  if (regret_pruning_ && num_succs > 1 && ! value_calculation_ && ! pre_phase_ &&
+      ! best_response_streets_[st]) {
+    bool bucketed = ! buckets_.None(st) &&
+      node->LastBetTo() < card_abstraction_.BucketThreshold(st);
+    prunable.reset(new bool[num_succs]);
+    any_prunable = SetPrunableSuccs(node, lbd, state->StreetBuckets(st), bucketed,
+				    prunable.get());
+  }
+  // Pruned succs get values of zero for now; they are multiplied by a probability of zero.
+  shared_ptr<VCFR_VALUE []> zero_vals;
+  int num_pruned = 0;
   for (int s = 0; s < num_succs; ++s) {
+    if (any_prunable && prunable[s]) {
+      if (zero_vals == nullptr) {
+	zero_vals.reset(new VCFR_VALUE[num_hole_card_pairs]);
+	for (int i = 0; i < num_hole_card_pairs; ++i) zero_vals[i] = 0;
+      }
+      succ_vals[s] = zero_vals;
+      ++num_pruned;
+      continue;
+    }
     int p0_s = pa == 0 ? s : succ_mapping[s];
     int p1_s = pa == 0 ? succ_mapping[s] : s;
     VCFRState succ_state(*state, node, s);
@@ -251,36 +409,40 @@ shared_ptr<double []> VCFR::OurChoice(Node *p0_node, Node *p1_node, int gbd, VCF
   if (num_succs == 1) {
     vals = succ_vals[0];
   } else {
-    int *street_buckets = state->StreetBuckets(st);
-    vals.reset(new double[num_hole_card_pairs]);
-    for (int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
+    const int *street_buckets = state->StreetBuckets(st);
+    vals.reset(new VCFR_VALUE[num_hole_card_pairs]);
+    VCFR_VALUE *my_vals = vals.get();
+    for (int i = 0; i < num_hole_card_pairs; ++i) my_vals[i] = 0;
     if (best_response_streets_[st]) {
-      for (int i = 0; i < num_hole_card_pairs; ++i) {
-	double max_val = succ_vals[0][i];
-	for (int s = 1; s < num_succs; ++s) {
-	  double sv = succ_vals[s][i];
-	  if (sv > max_val) {max_val = sv;}
+      // One succ at a time, so that the inner loop runs over contiguous values and vectorizes
+      const VCFR_VALUE *first_succ_vals = succ_vals[0].get();
+      for (int i = 0; i < num_hole_card_pairs; ++i) my_vals[i] = first_succ_vals[i];
+      for (int s = 1; s < num_succs; ++s) {
+	const VCFR_VALUE *my_succ_vals = succ_vals[s].get();
+	for (int i = 0; i < num_hole_card_pairs; ++i) {
+	  if (my_succ_vals[i] > my_vals[i]) my_vals[i] = my_succ_vals[i];
 	}
-	vals[i] = max_val;
       }
     } else {
       int dsi = node->DefaultSuccIndex();
       bool bucketed = ! buckets_.None(st) &&
 	node->LastBetTo() < card_abstraction_.BucketThreshold(st);
+      int num_canon_hands;
+      const int *canon_hands = CanonHands(st, gbd, *state, &num_canon_hands);
+      const int *canons = state->GetHandTree()->CanonIndices(st, gbd);
       if (bucketed && ! value_calculation_) {
 	// This is true when we are running CFR+ on a bucketed system.  We don't want to get the
 	// current strategy from the regrets during the iteration, because the regrets for each
 	// bucket are in an intermediate state.  Instead we compute the current strategy once at the
 	// beginning of each iteration.  current_strategy_ always contains doubles.
-	CFRStreetValues<double> *street_values =
-	  dynamic_cast< CFRStreetValues<double> *>(
-			current_strategy_->StreetValues(st));
-	for (int i = 0; i < num_hole_card_pairs; ++i) {
-	  int b = street_buckets[i];
-	  double *current_probs =
-	    street_values->AllValues(pa, nt) + b * num_succs;
-	  for (int s = 0; s < num_succs; ++s) {
-	    vals[i] += succ_vals[s][i] * current_probs[s];
+	// As above, we go one succ at a time; each hand still sums its succs in order.
+	double *all_cs_probs = current_strategy_values_[st]->AllValues(pa, nt);
+	for (int s = 0; s < num_succs; ++s) {
+	  const VCFR_VALUE *my_succ_vals = succ_vals[s].get();
+	  const double *succ_cs_probs = all_cs_probs + s;
+	  for (int j = 0; j < num_canon_hands; ++j) {
+	    int i = canon_hands ? canon_hands[j] : j;
+	    my_vals[i] += my_succ_vals[i] * succ_cs_probs[street_buckets[i] * num_succs];
 	  }
 	}
       } else {
@@ -293,10 +455,11 @@ shared_ptr<double []> VCFR::OurChoice(Node *p0_node, Node *p1_node, int gbd, VCF
 	unique_ptr<double []> current_probs(new double[num_succs]);
 	if (bucketed) {
 	  street_values->ComputeOurValsBucketed(pa, nt, num_hole_card_pairs, num_succs, dsi,
-						succ_vals.get(), street_buckets, vals);
+						succ_vals.get(), street_buckets, vals,
+						canon_hands, num_canon_hands);
 	} else {
 	  street_values->ComputeOurVals(pa, nt, num_hole_card_pairs, num_succs, dsi,
-					succ_vals.get(), lbd, vals);
+					succ_vals.get(), lbd, vals, canon_hands, num_canon_hands);
 #if 0
 	  for (int i = 0; i < num_hole_card_pairs; ++i) {
 	    int offset = lbd * num_hole_card_pairs * num_succs + i * num_succs;
@@ -308,21 +471,35 @@ shared_ptr<double []> VCFR::OurChoice(Node *p0_node, Node *p1_node, int gbd, VCF
 #endif
 	}
       }
+      if (canon_hands) {
+	CopyCanonVals(canons, canon_hands, num_canon_hands, num_hole_card_pairs, my_vals);
+      }
       if (! value_calculation_ && ! pre_phase_) {
+	if (num_pruned > 0) {
+	  // Giving a pruned succ the same value as the node leaves its regrets unchanged
+	  for (int s = 0; s < num_succs; ++s) {
+	    if (prunable[s]) succ_vals[s] = vals;
+	  }
+	}
 	if (bucketed) {
+	  // Every hand updates its bucket in turn, folded or not, so that the rounding and the
+	  // order of the updates don't depend on the folding
 	  UpdateRegretsBucketed(node, state->StreetBuckets(st), vals.get(), succ_vals.get());
 	} else {
 	  // Need values for current board if this is unabstracted system
-	  UpdateRegrets(node, lbd, vals.get(), succ_vals.get());
+	  UpdateRegrets(node, lbd, vals.get(), succ_vals.get(), canons, canon_hands,
+			num_canon_hands);
 	}
       }
     }
   }
+  if (state->Stats()) state->Stats()->num_pruned_succs += num_pruned;
 
   return vals;
 }
 
-shared_ptr<double []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCFRState *state) {
+shared_ptr<VCFR_VALUE []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd,
+					  VCFRState *state) {
   int pa = p0_node->PlayerActing();
   Node *node = pa == 0 ? p0_node : p1_node;
   Node *responding_node = pa == 0 ? p1_node : p0_node;
@@ -331,57 +508,51 @@ shared_ptr<double []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCF
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
   const CanonicalCards *hands = state->Hands(st, gbd);
   int lbd = state->LocalBoardIndex(st, gbd);
-  int num_hole_cards = Game::NumCardsForStreet(0);
-  int max_card1 = Game::MaxCard() + 1;
-  int num_enc;
-  if (num_hole_cards == 1) num_enc = max_card1;
-  else                     num_enc = max_card1 * max_card1;
-
-  const shared_ptr<double []> &opp_probs = state->OppProbs();
-  unique_ptr<shared_ptr<double []> []> succ_opp_probs(new shared_ptr<double []> [num_succs]);
+
+  const shared_ptr<VCFR_VALUE []> &opp_probs = state->OppProbs();
+  unique_ptr<shared_ptr<VCFR_VALUE []> []>
+    succ_opp_probs(new shared_ptr<VCFR_VALUE []> [num_succs]);
   if (num_succs == 1) {
-    succ_opp_probs[0].reset(new double[num_enc]);
-    for (int i = 0; i < num_enc; ++i) {
-      succ_opp_probs[0][i] = opp_probs[i];
-    }
+    // Nothing modifies reach probabilities in place, so the successor can share ours
+    succ_opp_probs[0] = opp_probs;
   } else {
-    int *street_buckets = state->StreetBuckets(st);
+    const int *street_buckets = state->StreetBuckets(st);
+    // ProcessOppProbs() sets every entry it processes; the rest are copied below
     for (int s = 0; s < num_succs; ++s) {
-      succ_opp_probs[s].reset(new double[num_enc]);
-      for (int i = 0; i < num_enc; ++i) succ_opp_probs[s][i] = 0;
+      succ_opp_probs[s].reset(new VCFR_VALUE[num_hole_card_pairs]);
     }
 
     int dsi = node->DefaultSuccIndex();
     bool bucketed = ! buckets_.None(st) &&
       node->LastBetTo() < card_abstraction_.BucketThreshold(st);
+    double sumprob_weight = SumprobWeight(it_, soft_warmup_, hard_warmup_, sumprob_gamma_);
 
     // At most one of d_sumprob_values, i_sumprob_vals and c_sumprob_vals is non-null.
     // All may be null.
     CFRStreetValues<double> *d_sumprob_values = nullptr;
     CFRStreetValues<int> *i_sumprob_values = nullptr;
     CFRStreetValues<unsigned char> *c_sumprob_values = nullptr;
-    AbstractCFRStreetValues *sumprob_values = nullptr;
     if (sumprobs_ && sumprob_streets_[st]) {
-      sumprob_values = sumprobs_->StreetValues(st);
-      if (sumprob_values == nullptr) {
+      if (sumprobs_->StreetValues(st) == nullptr) {
 	fprintf(stderr, "No sumprobs values for street %u?!?\n", st);
 	exit(-1);
       }
-      if ((d_sumprob_values =
-	   dynamic_cast<CFRStreetValues<double> *>(sumprob_values)) ==
-	  nullptr) {
-	if ((i_sumprob_values =
-	     dynamic_cast<CFRStreetValues<int> *>(sumprob_values)) ==
-	    nullptr) {
-	  if ((c_sumprob_values =
-	       dynamic_cast<CFRStreetValues<unsigned char> *>(sumprob_values)) ==
-	      nullptr) {
-	    fprintf(stderr, "sumprobs not doubles, ints or chars?!?\n");
-	    exit(-1);
-	  }
-	}
+      d_sumprob_values = d_sumprobs_[st];
+      i_sumprob_values = i_sumprobs_[st];
+      c_sumprob_values = c_sumprobs_[st];
+      if (! d_sumprob_values && ! i_sumprob_values && ! c_sumprob_values) {
+	fprintf(stderr, "sumprobs not doubles, ints or chars?!?\n");
+	exit(-1);
       }
     }
+    int num_canon_hands;
+    const int *canon_hands = CanonHands(st, gbd, *state, &num_canon_hands);
+    if (bucketed && ! value_calculation_ && (d_sumprob_values || i_sumprob_values)) {
+      // Every hand adds to the sumprobs of its bucket in turn, so that the rounding and the
+      // order of the additions don't depend on the folding
+      canon_hands = nullptr;
+      num_canon_hands = num_hole_card_pairs;
+    }
 
     if (value_calculation_) {
       // For example, RGBR calculation
@@ -391,16 +562,19 @@ shared_ptr<double []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCF
       } else {
 	if (d_sumprob_values) {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *d_sumprob_values, dsi, it_, soft_warmup_,
-			  hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
+			  succ_opp_probs.get(), *d_sumprob_values, dsi, sumprob_weight,
+			  sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr, canon_hands,
+			  num_canon_hands);
 	} else if (i_sumprob_values) {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *i_sumprob_values, dsi, it_, soft_warmup_,
-			  hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
+			  succ_opp_probs.get(), *i_sumprob_values, dsi, sumprob_weight,
+			  sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr, canon_hands,
+			  num_canon_hands);
 	} else if (c_sumprob_values) {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *c_sumprob_values, dsi, it_, soft_warmup_,
-			  hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
+			  succ_opp_probs.get(), *c_sumprob_values, dsi, sumprob_weight,
+			  sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr, canon_hands,
+			  num_canon_hands);
 	} else {
 	  fprintf(stderr, "value_calculation_ and ! br_current_ requires sumprobs\n");
 	  exit(-1);
@@ -413,90 +587,89 @@ shared_ptr<double []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCF
       // state.  Instead we compute the current strategy once at the
       // beginning of each iteration.
       // current_strategy_ always contains doubles
-      CFRStreetValues<double> *street_values =
-	dynamic_cast< CFRStreetValues<double> *>(current_strategy_->StreetValues(st));
       int nt = node->NonterminalID();
-      double *current_probs = street_values->AllValues(pa, nt);
+      double *current_probs = current_strategy_values_[st]->AllValues(pa, nt);
       if (d_sumprob_values) {
 	ProcessOppProbs(node, hands, street_buckets, opp_probs.get(), succ_opp_probs.get(),
-			current_probs, it_, soft_warmup_, hard_warmup_, sumprob_scaling_[st],
-			d_sumprob_values);
+			current_probs, sumprob_weight, sumprob_scaling_[st], d_sumprob_values,
+			canon_hands, num_canon_hands);
       } else {
 	ProcessOppProbs(node, hands, street_buckets, opp_probs.get(), succ_opp_probs.get(),
-			current_probs, it_, soft_warmup_, hard_warmup_, sumprob_scaling_[st],
-			i_sumprob_values);
+			current_probs, sumprob_weight, sumprob_scaling_[st], i_sumprob_values,
+			canon_hands, num_canon_hands);
       }
     } else {
-      // Such a mess!
-      AbstractCFRStreetValues *cs_values;
-      if (value_calculation_ && ! br_current_) {
-	if (sumprobs_.get() == nullptr) {
-	  fprintf(stderr, "VCFR::OppChoice() null sumprobs?!?\n");
-	  exit(-1);
-	}
-	// value_calculation_ now handled above
-	cs_values = sumprobs_->StreetValues(st);
-      } else {
-	if (sumprobs_.get() == nullptr) {
-	  fprintf(stderr, "VCFR::OppChoice() null regrets?!?\n");
-	  exit(-1);
-	}
-	cs_values = regrets_->StreetValues(st);
+      // value_calculation_ is handled above, so the current strategy comes from the regrets
+      if (regrets_.get() == nullptr) {
+	fprintf(stderr, "VCFR::OppChoice() null regrets?!?\n");
+	exit(-1);
       }
-      CFRStreetValues<double> *d_cs_values;
-      CFRStreetValues<int> *i_cs_values;
-      if ((d_cs_values =
-	   dynamic_cast<CFRStreetValues<double> *>(cs_values))) {
+      CFRStreetValues<double> *d_cs_values = d_regrets_[st];
+      CFRStreetValues<int> *i_cs_values = i_regrets_[st];
+      if (d_cs_values) {
 	if (d_sumprob_values) {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *d_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
-			  sumprob_scaling_[st], d_sumprob_values);
+			  succ_opp_probs.get(), *d_cs_values, dsi, sumprob_weight,
+			  sumprob_scaling_[st], d_sumprob_values, canon_hands, num_canon_hands);
 	} else {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *d_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
-			  sumprob_scaling_[st], i_sumprob_values);
+			  succ_opp_probs.get(), *d_cs_values, dsi, sumprob_weight,
+			  sumprob_scaling_[st], i_sumprob_values, canon_hands, num_canon_hands);
 	}
       } else {
-	i_cs_values = dynamic_cast<CFRStreetValues<int> *>(cs_values);
 	if (i_cs_values == nullptr) {
 	  fprintf(stderr, "Neither int nor double cs values?!?\n");
 	  exit(-1);
 	}
 	if (d_sumprob_values) {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *i_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
-			  sumprob_scaling_[st], d_sumprob_values);
+			  succ_opp_probs.get(), *i_cs_values, dsi, sumprob_weight,
+			  sumprob_scaling_[st], d_sumprob_values, canon_hands, num_canon_hands);
 	} else {
 	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *i_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
-			  sumprob_scaling_[st], i_sumprob_values);
+			  succ_opp_probs.get(), *i_cs_values, dsi, sumprob_weight,
+			  sumprob_scaling_[st], i_sumprob_values, canon_hands, num_canon_hands);
+	}
+      }
+    }
+    if (canon_hands) {
+      const int *canons = state->GetHandTree()->CanonIndices(st, gbd);
+      for (int s = 0; s < num_succs; ++s) {
+	CopyCanonVals(canons, canon_hands, num_canon_hands, num_hole_card_pairs,
+		      succ_opp_probs[s].get());
+      }
+      if (! value_calculation_ && ! bucketed) {
+	// Unabstracted hands have sumprobs of their own.  Some solvers only keep sumprobs for one
+	// player, so the acting player may have none.
+	int nt = node->NonterminalID();
+	int offset = lbd * num_hole_card_pairs * num_succs;
+	if (d_sumprob_values && d_sumprob_values->AllValues(pa, nt)) {
+	  CopyCanonRows(canons, canon_hands, num_canon_hands, num_hole_card_pairs, num_succs,
+			d_sumprob_values->AllValues(pa, nt) + offset);
+	} else if (i_sumprob_values && i_sumprob_values->AllValues(pa, nt)) {
+	  CopyCanonRows(canons, canon_hands, num_canon_hands, num_hole_card_pairs, num_succs,
+			i_sumprob_values->AllValues(pa, nt) + offset);
 	}
       }
     }
   }
 
   unique_ptr<int []> succ_mapping = GetSuccMapping(node, responding_node);
-  shared_ptr<double []> vals;
+  shared_ptr<VCFR_VALUE []> vals;
   for (int s = 0; s < num_succs; ++s) {
-    // We can't prune now.  Is that a big problem?
-#if 0
-    shared_ptr<double []> succ_total_card_probs(new double[max_card1]);
-    CommonBetResponseCalcs(st, hands, succ_opp_probs[s].get(), &succ_sum_opp_probs,
-			   succ_total_card_probs.get());
-    if (prune_ && succ_sum_opp_probs == 0) {
-      continue;
-    }
-#endif
+    // Succs that the opponent never takes are pruned in Process()
     int p0_s = pa == 0 ? s : succ_mapping[s];
     int p1_s = pa == 0 ? succ_mapping[s] : s;
     VCFRState succ_state(*state, node, s, succ_opp_probs[s]);
-    shared_ptr<double []> succ_vals = Process(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), gbd,
-					      &succ_state, st);
+    shared_ptr<VCFR_VALUE []> succ_vals = Process(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s),
+						  gbd, &succ_state, st);
     if (vals == nullptr) {
       vals = succ_vals;
     } else {
+      VCFR_VALUE *my_vals = vals.get();
+      const VCFR_VALUE *my_succ_vals = succ_vals.get();
       for (int i = 0; i < num_hole_card_pairs; ++i) {
-	vals[i] += succ_vals[i];
+	my_vals[i] += my_succ_vals[i];
       }
     }
   }
@@ -504,7 +677,7 @@ shared_ptr<double []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCF
     // This can happen if there were non-zero opp probs on the prior street,
     // but the board cards just dealt blocked all the opponent hands with
     // non-zero probability.
-    vals.reset(new double[num_hole_card_pairs]);
+    vals.reset(new VCFR_VALUE[num_hole_card_pairs]);
     for (int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
   }
 
@@ -516,8 +689,9 @@ using std::shared_ptr;
 using std::unique_ptr;
 
 Request::Request(RequestType t, Node *p0_node, Node *p1_node, int gbd, const VCFRState *pred_state,
-		 int *prev_canons) : request_type_(t), p0_node_(p0_node), p1_node_(p1_node),
-				     gbd_(gbd), pred_state_(pred_state), prev_canons_(prev_canons) {
+		 const int *pred_canons) : request_type_(t), p0_node_(p0_node), p1_node_(p1_node),
+					   gbd_(gbd), pred_state_(pred_state),
+					   pred_canons_(pred_canons) {
 }
 
 VCFRWorker::VCFRWorker(VCFR *vcfr) : vcfr_(vcfr) {
@@ -526,8 +700,9 @@ VCFRWorker::VCFRWorker(VCFR *vcfr) : vcfr_(vcfr) {
 // Should be sure to call this while the worker is idle
 void VCFRWorker::Reset(int pst) {
   int num_prev_hole_card_pairs = Game::NumHoleCardPairs(pst);
-  vals_.reset(new double[num_prev_hole_card_pairs]);
+  vals_.reset(new VCFR_VALUE[num_prev_hole_card_pairs]);
   for (int i = 0; i < num_prev_hole_card_pairs; ++i) vals_[i] = 0;
+  stats_.Clear();
 }
 
 void VCFRWorker::HandleRequest(const Request &request) {
@@ -535,25 +710,18 @@ void VCFRWorker::HandleRequest(const Request &request) {
   Node *p1_node = request.P1Node();
   int ngbd = request.GBD();
   const VCFRState &pred_state = request.PredState();
-  int *prev_canons = request.PrevCanons();
+  const int *pred_canons = request.PredCanons();
   int nst = p0_node->Street();
   if (vals_.get() == nullptr) {
     fprintf(stderr, "vals_ uninitialized\n");
     exit(-1);
   }
-  shared_ptr<double []> bd_vals = vcfr_->ProcessSubgame(p0_node, p1_node, ngbd, pred_state);
-  const CanonicalCards *hands = pred_state.Hands(nst, ngbd);
-  int board_variants = BoardTree::NumVariants(nst, ngbd);
-  int num_hands = hands->NumRaw();
-  int max_card1 = Game::MaxCard() + 1;
-  for (int nhcp = 0; nhcp < num_hands; ++nhcp) {
-    const Card *cards = hands->Cards(nhcp);
-    Card hi = cards[0];
-    Card lo = cards[1];
-    int enc = hi * max_card1 + lo;
-    int prev_canon = prev_canons[enc];
-    vals_[prev_canon] += board_variants * bd_vals[nhcp];
-  }
+  // Count if the traversal that made the request is counting
+  shared_ptr<VCFR_VALUE []> bd_vals =
+    vcfr_->ProcessSubgame(p0_node, p1_node, ngbd, pred_state,
+			  pred_state.Stats() ? &stats_ : nullptr);
+  VCFR::AddStreetInitialVals(pred_state.GetHandTree(), nst, ngbd, pred_canons, bd_vals.get(),
+			     vals_.get());
 }
 
 void VCFRWorker::MainLoop(void) {
@@ -575,10 +743,7 @@ void VCFRWorker::MainLoop(void) {
 
     pthread_cond_signal(queue_not_full);
     pthread_mutex_unlock(queue_mutex);
-    if (request.GetRequestType() == RequestType::QUIT) {
-      vcfr_->IncrementNumDone();
-      break;
-    }
+    if (request.GetRequestType() == RequestType::QUIT) break;
 
     HandleRequest(request);
     vcfr_->IncrementNumDone();
@@ -609,12 +774,31 @@ void VCFR::SpawnWorkers(void) {
 
 void VCFR::IncrementNumDone(void) {
   pthread_mutex_lock(&num_done_mutex_);
-  ++num_done_;
+  if (++num_done_ == num_requests_) pthread_cond_signal(&all_done_);
   pthread_mutex_unlock(&num_done_mutex_);
 }
 
-void VCFR::Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state, int *prev_canons,
-		 double *vals) {
+// Processes one board of the current split in the calling thread.  Unlike the workers, the
+// calling thread accumulates straight into the vals that Split() returns, and counts into its
+// own stats.
+void VCFR::HandleSplitRequest(const Request &request, VCFR_VALUE *vals, VCFRStats *stats) {
+  Node *p0_node = request.P0Node();
+  int ngbd = request.GBD();
+  const VCFRState &pred_state = request.PredState();
+  shared_ptr<VCFR_VALUE []> bd_vals = ProcessSubgame(p0_node, request.P1Node(), ngbd, pred_state,
+						     stats);
+  AddStreetInitialVals(pred_state.GetHandTree(), p0_node->Street(), ngbd,
+		       request.PredCanons(), bd_vals.get(), vals);
+  IncrementNumDone();
+}
+
+// Hands the boards of a street-initial node to the workers.  The calling thread doesn't sit
+// idle meanwhile: whenever the queue is full it takes the request at the front for itself, and
+// once every board has been queued it works off whatever is left.  It then waits on all_done_
+// for the boards still in progress on the workers, and sums the workers' values into vals and
+// their counts into the stats of state.
+void VCFR::Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state,
+		 const int *pred_canons, VCFR_VALUE *vals) {
   int nst = p0_node->Street();
   int pst = nst - 1;
 
@@ -624,71 +808,68 @@ void VCFR::Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state, int *
     workers_[t]->Reset(pst);
   }
   
-  num_done_ = 0;
   int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
   int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
+  pthread_mutex_lock(&num_done_mutex_);
+  num_done_ = 0;
+  num_requests_ = ngbd_end - ngbd_begin;
+  pthread_mutex_unlock(&num_done_mutex_);
   for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
     // Push onto the queue under mutex protection
     pthread_mutex_lock(&queue_mutex_);
-    // Wait until there’s room in the queue.
-    while (request_queue_.size() == kRequestQueueMaxSize) {
-      pthread_cond_wait(&queue_not_full_, &queue_mutex_);
+    if (request_queue_.size() == kRequestQueueMaxSize) {
+      // Make room by processing the oldest request ourselves
+      Request request = request_queue_.front();
+      request_queue_.pop();
+      pthread_mutex_unlock(&queue_mutex_);
+      HandleSplitRequest(request, vals, state->Stats());
+      pthread_mutex_lock(&queue_mutex_);
     }
-    Request request(RequestType::PROCESS, p0_node, p1_node, ngbd, state, prev_canons);
+    Request request(RequestType::PROCESS, p0_node, p1_node, ngbd, state, pred_canons);
     request_queue_.push(request);
     // Inform waiting threads that queue has a request
     pthread_cond_signal(&queue_not_empty_);
     pthread_mutex_unlock(&queue_mutex_);
   }
 
-  // There should be a better way to do this without a busy loop
-  int num_requests = ngbd_end - ngbd_begin;
   while (true) {
-    // No mutex needed, right?
-    if (num_done_ == num_requests) break;
-    usleep(1);
+    pthread_mutex_lock(&queue_mutex_);
+    if (request_queue_.empty()) {
+      pthread_mutex_unlock(&queue_mutex_);
+      break;
+    }
+    Request request = request_queue_.front();
+    request_queue_.pop();
+    pthread_mutex_unlock(&queue_mutex_);
+    HandleSplitRequest(request, vals, state->Stats());
+  }
+
+  pthread_mutex_lock(&num_done_mutex_);
+  while (num_done_ < num_requests_) {
+    pthread_cond_wait(&all_done_, &num_done_mutex_);
   }
+  pthread_mutex_unlock(&num_done_mutex_);
 
   int num_prev_hole_card_pairs = Game::NumHoleCardPairs(pst);
   for (int t = 0; t < num_threads_; ++t) {
-    double *t_vals = workers_[t]->Vals();
+    VCFR_VALUE *t_vals = workers_[t]->Vals();
     for (int i = 0; i < num_prev_hole_card_pairs; ++i) {
       vals[i] += t_vals[i];
     }
+    if (state->Stats()) state->Stats()->Add(workers_[t]->Stats());
   }
 }
 
+// The buckets come from hand_tree_buckets_, which must have been prepared for the hand tree of
+// the current traversal.
 void VCFR::SetStreetBuckets(int st, int gbd, VCFRState *state) {
   if (buckets_.None(st)) return;
-  int num_board_cards = Game::NumBoardCards(st);
-  const Card *board = BoardTree::Board(st, gbd);
-  Card cards[7];
-  for (int i = 0; i < num_board_cards; ++i) {
-    cards[i + 2] = board[i];
-  }
-  const CanonicalCards *hands = state->Hands(st, gbd);
-  int max_street = Game::MaxStreet();
-  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-  int *street_buckets = state->StreetBuckets(st);
-  for (int i = 0; i < num_hole_card_pairs; ++i) {
-    unsigned int h;
-    if (st == max_street) {
-      // Hands on final street were reordered by hand strength, but
-      // bucket lookup requires the unordered hole card pair index
-      const Card *hole_cards = hands->Cards(i);
-      cards[0] = hole_cards[0];
-      cards[1] = hole_cards[1];
-      int hcp = HCPIndex(st, cards);
-      h = ((unsigned int)gbd) * ((unsigned int)num_hole_card_pairs) + hcp;
-    } else {
-      h = ((unsigned int)gbd) * ((unsigned int)num_hole_card_pairs) + i;
-    }
-    street_buckets[i] = buckets_.Bucket(st, h);
-  }
+  state->SetStreetBuckets(st, hand_tree_buckets_->StreetBuckets(st, gbd));
+  if (state->Stats()) ++state->Stats()->num_bucket_lookups;
 }
 
-shared_ptr<double []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd,
-					  VCFRState *state) {
+shared_ptr<VCFR_VALUE []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd,
+					      VCFRState *state) {
   int nst = p0_node->Street();
   int pst = nst - 1;
   int prev_num_hole_card_pairs = Game::NumHoleCardPairs(pst);
@@ -698,7 +879,7 @@ shared_ptr<double []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd
     if (pre_phase_) {
       SpawnSubgame(p0_node, p1_node, plbd, state->ActionSequence(), state->OppProbs());
       // Code expects values to be returned so we return all zeroes
-      shared_ptr<double []> vals(new double[prev_num_hole_card_pairs]);
+      shared_ptr<VCFR_VALUE []> vals(new VCFR_VALUE[prev_num_hole_card_pairs]);
       for (int i = 0; i < prev_num_hole_card_pairs; ++i) vals[i] = 0;
       return vals;
     } else {
@@ -715,56 +896,52 @@ shared_ptr<double []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd
   }
 #endif
   const CanonicalCards *pred_hands = state->Hands(pst, pgbd);
-  Card max_card = Game::MaxCard();
-  int num_encodings = (max_card + 1) * (max_card + 1);
-  unique_ptr<int []> prev_canons(new int[num_encodings]);
-  shared_ptr<double []> vals(new double[prev_num_hole_card_pairs]);
+  const HandTree *hand_tree = state->GetHandTree();
+  const int *pred_canons = hand_tree->CanonIndices(pst, pgbd);
+  shared_ptr<VCFR_VALUE []> vals(new VCFR_VALUE[prev_num_hole_card_pairs]);
   for (int i = 0; i < prev_num_hole_card_pairs; ++i) vals[i] = 0;
-  for (int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
-    if (pred_hands->NumVariants(ph) > 0) {
-      const Card *prev_cards = pred_hands->Cards(ph);
-      int prev_encoding = prev_cards[0] * (max_card + 1) +
-	prev_cards[1];
-      prev_canons[prev_encoding] = ph;
-    }
-  }
-  for (int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
-    if (pred_hands->NumVariants(ph) == 0) {
-      const Card *prev_cards = pred_hands->Cards(ph);
-      int prev_encoding = prev_cards[0] * (max_card + 1) +
-	prev_cards[1];
-      int pc = prev_canons[pred_hands->Canon(ph)];
-      prev_canons[prev_encoding] = pc;
-    }
-  }
 
   if (nst == split_street_ && subgame_street_ == -1 && num_threads_ > 1) {
     // By default, split on the flop.
-    Split(p0_node, p1_node, pgbd, state, prev_canons.get(), vals.get());
+    Split(p0_node, p1_node, pgbd, state, pred_canons, vals.get());
   } else {
     int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
     int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
     for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
-      const CanonicalCards *hands = state->Hands(nst, ngbd);
-      SetStreetBuckets(nst, ngbd, state);
+      VCFRState next_state(*state, nst, ngbd);
+      SetStreetBuckets(nst, ngbd, &next_state);
       // I can pass unset values for sum_opp_probs and total_card_probs.  I
       // know I will come across an opp choice node before getting to a terminal
       // node.
-      shared_ptr<double []> next_vals = Process(p0_node, p1_node, ngbd, state, nst);
-
-      int board_variants = BoardTree::NumVariants(nst, ngbd);
-      int num_next_hands = hands->NumRaw();
-      for (int nh = 0; nh < num_next_hands; ++nh) {
-	const Card *cards = hands->Cards(nh);
-	Card hi = cards[0];
-	Card lo = cards[1];
-	int enc = hi * (max_card + 1) + lo;
-	int prev_canon = prev_canons[enc];
-	vals[prev_canon] += board_variants * next_vals[nh];
-      }
+      shared_ptr<VCFR_VALUE []> next_vals = Process(p0_node, p1_node, ngbd, &next_state, nst);
+      AddStreetInitialVals(hand_tree, nst, ngbd, pred_canons, next_vals.get(), vals.get());
     }
   }
   
+  ScaleStreetInitialVals(nst, pred_hands, pred_canons, vals.get());
+
+  return vals;
+}
+
+// Adds the values of the hands on board ngbd, weighted by the number of variants of the board,
+// into the values of the canonical hands of the previous street.  pred_canons are the canonical
+// hand indices of the predecessor board.
+void VCFR::AddStreetInitialVals(const HandTree *hand_tree, int nst, int ngbd,
+				const int *pred_canons, const VCFR_VALUE *next_vals,
+				VCFR_VALUE *vals) {
+  const int *prev_hands = hand_tree->PrevHands(nst, ngbd);
+  int board_variants = BoardTree::NumVariants(nst, ngbd);
+  int num_next_hands = Game::NumHoleCardPairs(nst);
+  for (int nh = 0; nh < num_next_hands; ++nh) {
+    vals[pred_canons[prev_hands[nh]]] += board_variants * next_vals[nh];
+  }
+}
+
+// vals holds the sum over next-street boards of the board variants times the values of the
+// next-street hands, accumulated in the canonical previous-street hands.
+void VCFR::ScaleStreetInitialVals(int nst, const CanonicalCards *pred_hands,
+				  const int *pred_canons, VCFR_VALUE *vals) {
+  int prev_num_hole_card_pairs = Game::NumHoleCardPairs(nst - 1);
   // Scale down the values of the previous-street canonical hands
   double scale_down = Game::StreetPermutations(nst);
   for (int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
@@ -777,11 +954,9 @@ shared_ptr<double []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd
   // Copy the canonical hand values to the non-canonical
   for (int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
     if (pred_hands->NumVariants(ph) == 0) {
-      vals[ph] = vals[prev_canons[pred_hands->Canon(ph)]];
+      vals[ph] = vals[pred_canons[ph]];
     }
   }
-
-  return vals;
 }
 
 void VCFR::InitializeOppData(VCFRState *state, int st, int gbd) {
@@ -794,9 +969,21 @@ void VCFR::InitializeOppData(VCFRState *state, int st, int gbd) {
   state->SetSumOppProbs(sum_opp_probs);
 }
 
-shared_ptr<double []> VCFR::Process(Node *p0_node, Node *p1_node, int gbd, VCFRState *state,
-				    int last_st) {
+shared_ptr<VCFR_VALUE []> VCFR::Process(Node *p0_node, Node *p1_node, int gbd,
+					VCFRState *state, int last_st) {
+  if (state->Stats()) ++state->Stats()->num_node_visits;
   int st = p0_node->Street();
+  // If no opponent hand reaches this node, every value below it is zero, and there is nothing
+  // to update either: the regret deltas of our choices are zero, and the increments to the
+  // opponent's sumprobs are weighted by the opponent's reach.
+  int opp_st = st > last_st ? last_st : st;
+  if (prune_ && state->OppReachZero(opp_st)) {
+    if (state->Stats()) ++state->Stats()->num_zero_reach_pruned;
+    int num_hole_card_pairs = Game::NumHoleCardPairs(opp_st);
+    shared_ptr<VCFR_VALUE []> vals(new VCFR_VALUE[num_hole_card_pairs]);
+    for (int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
+    return vals;
+  }
   if (p0_node->Terminal()) {
     InitializeOppData(state, st, gbd);
     if (p0_node->NumRemaining() == 1) {
@@ -810,7 +997,7 @@ shared_ptr<double []> VCFR::Process(Node *p0_node, Node *p1_node, int gbd, VCFRS
   if (st > last_st) {
     return StreetInitial(p0_node, p1_node, gbd, state);
   }
-  shared_ptr<double []> vals;
+  shared_ptr<VCFR_VALUE []> vals;
   if (p0_node->PlayerActing() == state->P()) {
     vals = OurChoice(p0_node, p1_node, gbd, state);
   } else {
@@ -819,23 +1006,130 @@ shared_ptr<double []> VCFR::Process(Node *p0_node, Node *p1_node, int gbd, VCFRS
   return vals;
 }
 
+// Looks up the concrete types of the street values.  The values objects can be replaced between
+// traversals (e.g., when a checkpoint is read, or a subgame is set up), so this is redone at
+// the start of each traversal.  The Split() workers rely on it having been done by the thread
+// that started the traversal.
+void VCFR::ResolveStreetValues(void) {
+  int max_street = Game::MaxStreet();
+  for (int st = 0; st <= max_street; ++st) {
+    AbstractCFRStreetValues *regret_values = regrets_ ? regrets_->StreetValues(st) : nullptr;
+    d_regrets_[st] = dynamic_cast<CFRStreetValues<double> *>(regret_values);
+    i_regrets_[st] = dynamic_cast<CFRStreetValues<int> *>(regret_values);
+    AbstractCFRStreetValues *sumprob_values = sumprobs_ ? sumprobs_->StreetValues(st) : nullptr;
+    d_sumprobs_[st] = dynamic_cast<CFRStreetValues<double> *>(sumprob_values);
+    i_sumprobs_[st] = dynamic_cast<CFRStreetValues<int> *>(sumprob_values);
+    c_sumprobs_[st] = dynamic_cast<CFRStreetValues<unsigned char> *>(sumprob_values);
+    AbstractCFRStreetValues *cs_values =
+      current_strategy_ ? current_strategy_->StreetValues(st) : nullptr;
+    current_strategy_values_[st] = dynamic_cast<CFRStreetValues<double> *>(cs_values);
+  }
+}
+
+// Builds hand_tree_buckets_ unless we already have them for hand_tree.  Like
+// ResolveStreetValues(), called at the start of each traversal.
+void VCFR::PrepareHandTreeBuckets(const HandTree *hand_tree) {
+  int max_street = Game::MaxStreet();
+  bool bucketed = false;
+  for (int st = 0; st <= max_street; ++st) {
+    if (! buckets_.None(st)) bucketed = true;
+  }
+  if (! bucketed) return;
+  if (hand_tree_buckets_ && hand_tree_buckets_->Matches(hand_tree)) return;
+  hand_tree_buckets_.reset(new HandTreeBuckets(buckets_, hand_tree));
+}
+
+// Hands that are isomorphic on a board (see CanonicalCards) get the same values and the same
+// regret and sumprob updates, as long as nothing tells them apart.  That requires that they have
+// the same opponent reach probabilities at the root of the traversal and the same bucket at
+// every bucketed street from the root down.  On the streets where that holds, we only process
+// the canonical hands at each choice node, and the other hands get copies.  The hand tree gives
+// isomorphic hands on later streets isomorphic predecessors, so once the condition fails on a
+// street it fails on all later streets too.  opp_probs are the opponent's reach probabilities at
+// the root, indexed like the hands of the root board; nullptr means they are all one.
+//
+// When calculating values (e.g., in run_rgbr), the strategies come from sumprobs that we didn't
+// produce ourselves.  On an unbucketed street nothing makes those symmetric under suit
+// isomorphism, and an asymmetry on a later street reaches the values of the earlier streets, so
+// we don't fold at all if any street of the traversal is unbucketed.
+void VCFR::SetCanonStreets(int root_st, int root_gbd, const HandTree *hand_tree,
+			   const VCFR_VALUE *opp_probs) {
+  int max_street = Game::MaxStreet();
+  bool canon = true;
+  if (value_calculation_) {
+    for (int st = root_st; st <= hand_tree->FinalSt(); ++st) {
+      if (buckets_.None(st)) canon = false;
+    }
+  }
+  if (canon && opp_probs) {
+    const int *canons = hand_tree->CanonIndices(root_st, root_gbd);
+    int num_hole_card_pairs = Game::NumHoleCardPairs(root_st);
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      if (opp_probs[i] != opp_probs[canons[i]]) {
+	canon = false;
+	break;
+      }
+    }
+  }
+  for (int st = 0; st <= max_street; ++st) {
+    if (st < root_st || st > hand_tree->FinalSt()) {
+      canon_streets_[st] = false;
+      continue;
+    }
+    if (! buckets_.None(st) && ! hand_tree_buckets_->Symmetric(st)) canon = false;
+    canon_streets_[st] = canon;
+  }
+}
+
+// The hands of board gbd that OurChoice() and OppChoice() need to process at street st.  Returns
+// the canonical hands if we process only those (see SetCanonStreets()) and some hands are not
+// canonical; otherwise returns nullptr, meaning all hands.  Either way sets *num_canon_hands to
+// the number of hands to process.
+const int *VCFR::CanonHands(int st, int gbd, const VCFRState &state,
+			    int *num_canon_hands) const {
+  const CanonicalCards *hands = state.Hands(st, gbd);
+  if (canon_streets_[st] && hands->NumCanon() < hands->NumRaw()) {
+    *num_canon_hands = hands->NumCanon();
+    return state.GetHandTree()->CanonHands(st, gbd);
+  }
+  *num_canon_hands = Game::NumHoleCardPairs(st);
+  return nullptr;
+}
+
+void VCFR::AddStats(const VCFRStats &stats) {
+  pthread_mutex_lock(&stats_mutex_);
+  stats_.Add(stats);
+  pthread_mutex_unlock(&stats_mutex_);
+}
+
 // Must be called on the root of the entire tree
 shared_ptr<double []> VCFR::ProcessRoot(const BettingTrees *betting_trees, int p,
 					HandTree *hand_tree) {
+  ResolveStreetValues();
+  PrepareHandTreeBuckets(hand_tree);
+  // Every opponent hand reaches the root with probability one
+  SetCanonStreets(0, 0, hand_tree, nullptr);
   VCFRState state(p, hand_tree);
+  VCFRStats stats;
+  if (collect_stats_) state.SetStats(&stats);
   SetStreetBuckets(0, 0, &state);
-  return Process(betting_trees->Root(), betting_trees->Root(), 0, &state, 0);
+  shared_ptr<VCFR_VALUE []> vals = Process(betting_trees->Root(), betting_trees->Root(), 0,
+					   &state, 0);
+  if (collect_stats_) AddStats(stats);
+  return WideVals(vals, Game::NumHoleCardPairs(0));
 }
 
 // Two implementations of ProcessSubgame().  One if you have a VCFRState object to work from,
 // one if you don't.
-shared_ptr<double []> VCFR::ProcessSubgame(Node *p0_node, Node *p1_node, int gbd, 
-					   const VCFRState &pred_state) {
+shared_ptr<VCFR_VALUE []> VCFR::ProcessSubgame(Node *p0_node, Node *p1_node, int gbd,
+					       const VCFRState &pred_state, VCFRStats *stats) {
   // It's important to create a new state object, I think.  In the case of multithreading, we don't
-  // want multiple threads modifying the same state object.
-  VCFRState state(pred_state.P(), pred_state.OppProbs(), pred_state.GetHandTree(),
-		  pred_state.ActionSequence());
+  // want multiple threads modifying the same state object.  pred_state is for the predecessor
+  // board on the previous street.
   int st = p0_node->Street();
+  VCFRState state(pred_state.P(), pred_state.NextStreetOppProbs(st, gbd),
+		  pred_state.GetHandTree(), pred_state.ActionSequence());
+  state.SetStats(stats);
   SetStreetBuckets(st, gbd, &state);
   return Process(p0_node, p1_node, gbd, &state, st);
 }
@@ -844,10 +1138,19 @@ shared_ptr<double []> VCFR::ProcessSubgame(Node *p0_node, Node *p1_node, int gbd
 					   shared_ptr<double []> opp_probs,
 					   const HandTree *hand_tree,
 					   const string &action_sequence) {
-  VCFRState state(p, opp_probs, hand_tree, action_sequence);
+  ResolveStreetValues();
+  PrepareHandTreeBuckets(hand_tree);
+  // opp_probs are indexed by hole card encoding
   int st = p0_node->Street();
+  VCFRState state(p, DenseOppProbs(hand_tree->Hands(st, gbd), opp_probs.get()), hand_tree,
+		  action_sequence);
+  SetCanonStreets(st, gbd, hand_tree, state.OppProbs().get());
+  VCFRStats stats;
+  if (collect_stats_) state.SetStats(&stats);
   SetStreetBuckets(st, gbd, &state);
-  return Process(p0_node, p1_node, gbd, &state, st);
+  shared_ptr<VCFR_VALUE []> vals = Process(p0_node, p1_node, gbd, &state, st);
+  if (collect_stats_) AddStats(stats);
+  return WideVals(vals, Game::NumHoleCardPairs(st));
 }
 
 void VCFR::SetCurrentStrategy(Node *node) {
@@ -914,14 +1217,33 @@ VCFR::VCFR(const CardAbstraction &ca, const CFRConfig &cc, const Buckets &bucket
   // Whether we prune branches if no opponent hand reaches.  Normally true,
   // but false when calculating CBRs.
   prune_ = true;
+  regret_pruning_ = false;
   pre_phase_ = false;
+  collect_stats_ = false;
 
   int max_street = Game::MaxStreet();
   best_response_streets_.reset(new bool[max_street + 1]);
+  canon_streets_.reset(new bool[max_street + 1]);
   for (int st = 0; st <= max_street; ++st) {
     best_response_streets_[st] = false;
+    canon_streets_[st] = false;
   }
   
+  d_regrets_.reset(new CFRStreetValues<double> *[max_street + 1]);
+  i_regrets_.reset(new CFRStreetValues<int> *[max_street + 1]);
+  d_sumprobs_.reset(new CFRStreetValues<double> *[max_street + 1]);
+  i_sumprobs_.reset(new CFRStreetValues<int> *[max_street + 1]);
+  c_sumprobs_.reset(new CFRStreetValues<unsigned char> *[max_street + 1]);
+  current_strategy_values_.reset(new CFRStreetValues<double> *[max_street + 1]);
+  for (int st = 0; st <= max_street; ++st) {
+    d_regrets_[st] = nullptr;
+    i_regrets_[st] = nullptr;
+    d_sumprobs_[st] = nullptr;
+    i_sumprobs_[st] = nullptr;
+    c_sumprobs_[st] = nullptr;
+    current_strategy_values_[st] = nullptr;
+  }
+
   sumprob_streets_.reset(new bool[max_street + 1]);
   const vector<int> &ssv = cfr_config_.SumprobStreets();
   int num_ssv = ssv.size();
@@ -1004,15 +1326,32 @@ VCFR::VCFR(const CardAbstraction &ca, const CFRConfig &cc, const Buckets &bucket
     }
   }
 
+  const vector<double> &dv = cfr_config_.DCFRParams();
+  discounted_ = dv.size() > 0;
+  if (discounted_) {
+    regret_alpha_ = dv[0];
+    regret_beta_ = dv[1];
+    sumprob_gamma_ = dv[2];
+  } else {
+    regret_alpha_ = 0;
+    regret_beta_ = 0;
+    sumprob_gamma_ = 0;
+  }
+  pos_regret_scale_ = 1.0;
+  neg_regret_scale_ = 1.0;
+
   pthread_mutex_init(&queue_mutex_, NULL);
   pthread_mutex_init(&num_done_mutex_, NULL);
+  pthread_mutex_init(&stats_mutex_, NULL);
   pthread_cond_init(&queue_not_empty_, NULL);
   pthread_cond_init(&queue_not_full_, NULL);
+  pthread_cond_init(&all_done_, NULL);
+  num_done_ = 0;
+  num_requests_ = 0;
   SpawnWorkers();
 }
 
 VCFR::~VCFR(void) {
-  num_done_ = 0;
   // Add num_threads_ quit requests to the queue
   for (int t = 0; t < num_threads_; ++t) {
     pthread_mutex_lock(&queue_mutex_);
@@ -1026,18 +1365,14 @@ VCFR::~VCFR(void) {
     pthread_cond_signal(&queue_not_empty_);
     pthread_mutex_unlock(&queue_mutex_);
   }
-  // There should be a better way to do this without a busy loop
-  while (true) {
-    // No mutex needed, right?
-    if (num_done_ == num_threads_) break;
-    usleep(1);
-  }
   for (int t = 0; t < num_threads_; ++t) {
     workers_[t]->Join();
   }
   pthread_mutex_destroy(&queue_mutex_);
   pthread_mutex_destroy(&num_done_mutex_);
+  pthread_mutex_destroy(&stats_mutex_);
   pthread_cond_destroy(&queue_not_empty_);
   pthread_cond_destroy(&queue_not_full_);
+  pthread_cond_destroy(&all_done_);
 }
 
@@ -7,14 +7,16 @@
 
 #include "cfr_values.h"
 #include "prob_method.h"
+#include "vcfr_state.h"
 
 class BettingAbstraction;
 class BettingTrees;
 class Buckets;
+class CanonicalCards;
 class CardAbstraction;
 class CFRConfig;
 class HandTree;
-class VCFRState;
+class HandTreeBuckets;
 class VCFRWorker;
 
 enum class RequestType {
@@ -25,21 +27,21 @@ enum class RequestType {
 class Request {
 public:
   Request(RequestType t, Node *p0_node, Node *p1_node, int gbd, const VCFRState *pred_state,
-	  int *prev_canons);
+	  const int *pred_canons);
   ~Request(void) {}
   RequestType GetRequestType(void) const {return request_type_;}
   Node *P0Node(void) const {return p0_node_;}
   Node *P1Node(void) const {return p1_node_;}
   int GBD(void) const {return gbd_;}
   const VCFRState &PredState(void) const {return *pred_state_;}
-  int *PrevCanons(void) const {return prev_canons_;}
+  const int *PredCanons(void) const {return pred_canons_;}
 private:
   RequestType request_type_;
   Node *p0_node_;
   Node *p1_node_;
   int gbd_;
   const VCFRState *pred_state_;
-  int *prev_canons_;
+  const int *pred_canons_;
 };
 
 class VCFR {
@@ -48,8 +50,9 @@ class VCFR {
   virtual ~VCFR(void);
   virtual std::shared_ptr<double []> ProcessRoot(const BettingTrees *betting_trees, int p,
 						 HandTree *hand_tree);
-  virtual std::shared_ptr<double []> ProcessSubgame(Node *p0_node, Node *p1_node, int gbd,
-						    const VCFRState &pred_state);
+  virtual std::shared_ptr<VCFR_VALUE []> ProcessSubgame(Node *p0_node, Node *p1_node, int gbd,
+							const VCFRState &pred_state,
+							VCFRStats *stats);
   virtual std::shared_ptr<double []> ProcessSubgame(Node *p0_node, Node *p1_node, int gbd,
 						    int p, std::shared_ptr<double []> opp_probs,
 						    const HandTree *hand_tree,
@@ -60,10 +63,17 @@ class VCFR {
   void SetRegrets(std::shared_ptr<CFRValues> &src) {regrets_ = src;}
   void ClearSumprobs(void) {sumprobs_.reset();}
   virtual void SetStreetBuckets(int st, int gbd, VCFRState *state);
+  static void AddStreetInitialVals(const HandTree *hand_tree, int nst, int ngbd,
+				   const int *pred_canons, const VCFR_VALUE *next_vals,
+				   VCFR_VALUE *vals);
   virtual void SetValueCalculation(bool b) {value_calculation_ = b;}
   virtual void SetBestResponseStreet(int st, bool b) {best_response_streets_[st] = b;}
   virtual void SetSplitStreet(int st) {split_street_ = st;}
   int It(void) const {return it_;}
+  // Whether traversals count into stats_.  Off by default.
+  void SetCollectStats(bool b) {collect_stats_ = b;}
+  long long int NumNodeVisits(void) const {return stats_.num_node_visits;}
+  long long int NumZeroReachPruned(void) const {return stats_.num_zero_reach_pruned;}
   void SpawnWorkers(void);
   void IncrementNumDone(void);
   std::queue<Request> *GetRequestQueue(void) {return &request_queue_;}
@@ -75,27 +85,44 @@ class VCFR {
   static const int kRequestQueueMaxSize = 100;
   
   template <typename T>
-    void UpdateRegrets(Node *node, double *vals, std::shared_ptr<double []> *succ_vals, T *regrets);
-  virtual void UpdateRegrets(Node *node, int lbd, double *vals,
-			     std::shared_ptr<double []> *succ_vals);
-  virtual void UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				     std::shared_ptr<double []> *succ_vals, int *regrets);
-  virtual void UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				     std::shared_ptr<double []> *succ_vals, double *regrets);
-  virtual void UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				     std::shared_ptr<double []> *succ_vals);
-  virtual std::shared_ptr<double []> OurChoice(Node *p0_node, Node *p1_node, int gbd,
-					       VCFRState *state);
-  virtual std::shared_ptr<double []> OppChoice(Node *p0_node, Node *p1_node, int gbd,
-					       VCFRState *state);
-  virtual void Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state,
-		     int *prev_canons, double *vals);
-  virtual std::shared_ptr<double []> StreetInitial(Node *p0_node, Node *p1_node, int pgbd,
+    void UpdateRegrets(Node *node, VCFR_VALUE *vals, std::shared_ptr<VCFR_VALUE []> *succ_vals,
+		       T *regrets, const int *canon_hands, int num_canon_hands);
+  virtual void UpdateRegrets(Node *node, int lbd, VCFR_VALUE *vals,
+			     std::shared_ptr<VCFR_VALUE []> *succ_vals, const int *canons,
+			     const int *canon_hands, int num_canon_hands);
+  virtual void UpdateRegretsBucketed(Node *node, const int *street_buckets, VCFR_VALUE *vals,
+				     std::shared_ptr<VCFR_VALUE []> *succ_vals, int *regrets);
+  virtual void UpdateRegretsBucketed(Node *node, const int *street_buckets, VCFR_VALUE *vals,
+				     std::shared_ptr<VCFR_VALUE []> *succ_vals, double *regrets);
+  virtual void UpdateRegretsBucketed(Node *node, const int *street_buckets, VCFR_VALUE *vals,
+				     std::shared_ptr<VCFR_VALUE []> *succ_vals);
+  void UpdateDiscountedRegrets(int st, int i, int num_succs, VCFR_VALUE *vals,
+			       std::shared_ptr<VCFR_VALUE []> *succ_vals, int *my_regrets);
+  void UpdateDiscountedRegrets(int st, int i, int num_succs, VCFR_VALUE *vals,
+			       std::shared_ptr<VCFR_VALUE []> *succ_vals, double *my_regrets);
+  virtual std::shared_ptr<VCFR_VALUE []> OurChoice(Node *p0_node, Node *p1_node, int gbd,
 						   VCFRState *state);
+  virtual std::shared_ptr<VCFR_VALUE []> OppChoice(Node *p0_node, Node *p1_node, int gbd,
+						   VCFRState *state);
+  virtual void Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state,
+		     const int *pred_canons, VCFR_VALUE *vals);
+  void HandleSplitRequest(const Request &request, VCFR_VALUE *vals, VCFRStats *stats);
+  virtual std::shared_ptr<VCFR_VALUE []> StreetInitial(Node *p0_node, Node *p1_node, int pgbd,
+						       VCFRState *state);
+  static void ScaleStreetInitialVals(int nst, const CanonicalCards *pred_hands,
+				     const int *pred_canons, VCFR_VALUE *vals);
+  void AddStats(const VCFRStats &stats);
+  void ResolveStreetValues(void);
+  void PrepareHandTreeBuckets(const HandTree *hand_tree);
+  void SetCanonStreets(int root_st, int root_gbd, const HandTree *hand_tree,
+		       const VCFR_VALUE *opp_probs);
+  const int *CanonHands(int st, int gbd, const VCFRState &state, int *num_canon_hands) const;
   virtual void InitializeOppData(VCFRState *state, int st, int gbd);
-  virtual std::shared_ptr<double []> Process(Node *p0_node, Node *p1_node, int gbd,
-					     VCFRState *state, int last_st);
+  virtual std::shared_ptr<VCFR_VALUE []> Process(Node *p0_node, Node *p1_node, int gbd,
+						 VCFRState *state, int last_st);
   virtual void SetCurrentStrategy(Node *node);
+  virtual bool SetPrunableSuccs(Node *node, int lbd, const int *street_buckets, bool bucketed,
+				bool *prunable);
   
   const CardAbstraction &card_abstraction_;
   const CFRConfig &cfr_config_;
@@ -104,6 +131,22 @@ class VCFR {
   std::shared_ptr<CFRValues> regrets_;
   std::shared_ptr<CFRValues> sumprobs_;
   std::unique_ptr<CFRValues> current_strategy_;
+  // The street values of regrets_, sumprobs_ and current_strategy_ cast to their concrete types.
+  // Set by ResolveStreetValues() at the start of each traversal so that we don't need to
+  // dynamic_cast at every node.  For each street, at most one of the regrets pointers and at
+  // most one of the sumprobs pointers is non-null.
+  std::unique_ptr<CFRStreetValues<double> *[]> d_regrets_;
+  std::unique_ptr<CFRStreetValues<int> *[]> i_regrets_;
+  std::unique_ptr<CFRStreetValues<double> *[]> d_sumprobs_;
+  std::unique_ptr<CFRStreetValues<int> *[]> i_sumprobs_;
+  std::unique_ptr<CFRStreetValues<unsigned char> *[]> c_sumprobs_;
+  std::unique_ptr<CFRStreetValues<double> *[]> current_strategy_values_;
+  // The buckets of the hands of the hand tree we are traversing.  Built the first time we see a
+  // hand tree and kept as long as we are handed the same one.
+  std::unique_ptr<HandTreeBuckets> hand_tree_buckets_;
+  // Streets on which OurChoice() and OppChoice() only process the canonical hands of each board.
+  // Set by SetCanonStreets() at the start of each traversal.
+  std::unique_ptr<bool []> canon_streets_;
   // best_response_streets_ are set to true in run_rgbr, for example.
   // Whenever some streets are best-response streets, value_calculation_ is true.
   std::unique_ptr<bool []> best_response_streets_;
@@ -112,6 +155,8 @@ class VCFR {
   // value_calculation_ is true in, e.g., run_rgbr
   bool value_calculation_;
   bool prune_;
+  // Whether to skip succs that no hand plays under the current strategy.  Set per iteration.
+  bool regret_pruning_;
   int split_street_;
   int subgame_street_;
   bool nn_regrets_;
@@ -122,6 +167,14 @@ class VCFR {
   std::unique_ptr<int []> regret_ceilings_;
   std::unique_ptr<double []> regret_scaling_;
   std::unique_ptr<double []> sumprob_scaling_;
+  // DCFR.  When discounted_ is true, a stored regret is the true regret divided by
+  // pos_regret_scale_ if positive and by neg_regret_scale_ if negative.
+  bool discounted_;
+  double regret_alpha_;
+  double regret_beta_;
+  double sumprob_gamma_;
+  double pos_regret_scale_;
+  double neg_regret_scale_;
   int it_;
   bool pre_phase_;
   std::unique_ptr<std::unique_ptr<VCFRWorker> []> workers_;
@@ -130,7 +183,17 @@ class VCFR {
   pthread_mutex_t num_done_mutex_;
   pthread_cond_t queue_not_empty_;
   pthread_cond_t queue_not_full_;
+  // Signalled when num_done_ reaches num_requests_, the number of boards of the current split.
+  // Both are protected by num_done_mutex_.
+  pthread_cond_t all_done_;
   int num_done_;
+  int num_requests_;
+  bool collect_stats_;
+  // The counts of all traversals since stats_ was last cleared.  A traversal counts into a
+  // VCFRStats of its own and adds it in at the end under stats_mutex_, since some callers (e.g.,
+  // solve_all_subgames) run traversals of one solver in several threads.
+  VCFRStats stats_;
+  pthread_mutex_t stats_mutex_;
 };
 
 class VCFRWorker {
@@ -142,10 +205,12 @@ public:
   void MainLoop(void);
   void Run(void);
   void Join(void);
-  double *Vals(void) const {return vals_.get();}
+  VCFR_VALUE *Vals(void) const {return vals_.get();}
+  const VCFRStats &Stats(void) const {return stats_;}
 private:
   VCFR *vcfr_;
-  std::unique_ptr<double []> vals_;
+  std::unique_ptr<VCFR_VALUE []> vals_;
+  VCFRStats stats_;
   pthread_t pthread_id_;
 };
 
@@ -20,25 +20,34 @@
 using std::shared_ptr;
 using std::string;
 
-static shared_ptr<int []> AllocateStreetBuckets(void) {
-  int max_num_hole_card_pairs = Game::NumHoleCardPairs(0);
+static shared_ptr<const int *[]> AllocateStreetBuckets(void) {
   int max_street = Game::MaxStreet();
-  int num = (max_street + 1) * max_num_hole_card_pairs;
-  shared_ptr<int []> street_buckets(new int[num]);
+  shared_ptr<const int *[]> street_buckets(new const int *[max_street + 1]);
+  for (int st = 0; st <= max_street; ++st) street_buckets[st] = nullptr;
   return street_buckets;
 }
 
-static shared_ptr<double []> AllocateOppProbs(void) {
-  int num_hole_cards = Game::NumCardsForStreet(0);
-  int max_card1 = Game::MaxCard() + 1;
-  int num_enc;
-  if (num_hole_cards == 1) num_enc = max_card1;
-  else                     num_enc = max_card1 * max_card1;
-  shared_ptr<double []> opp_probs(new double[num_enc]);
-  for (int i = 0; i < num_enc; ++i) opp_probs[i] = 1.0;
+static shared_ptr<VCFR_VALUE []> AllocateOppProbs(int st) {
+  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  shared_ptr<VCFR_VALUE []> opp_probs(new VCFR_VALUE[num_hole_card_pairs]);
+  for (int i = 0; i < num_hole_card_pairs; ++i) opp_probs[i] = 1.0;
   return opp_probs;
 }
 
+void VCFRStats::Clear(void) {
+  num_node_visits = 0;
+  num_pruned_succs = 0;
+  num_zero_reach_pruned = 0;
+  num_bucket_lookups = 0;
+}
+
+void VCFRStats::Add(const VCFRStats &stats) {
+  num_node_visits += stats.num_node_visits;
+  num_pruned_succs += stats.num_pruned_succs;
+  num_zero_reach_pruned += stats.num_zero_reach_pruned;
+  num_bucket_lookups += stats.num_bucket_lookups;
+}
+
 void VCFRState::AllocateTotalCardProbs(void) {
   int max_card1 = Game::MaxCard() + 1;
   total_card_probs_.reset(new double[max_card1]);
@@ -47,13 +56,15 @@ void VCFRState::AllocateTotalCardProbs(void) {
 // Called at the root of the tree.
 VCFRState::VCFRState(int p, const HandTree *hand_tree) {
   p_ = p;
-  opp_probs_ = AllocateOppProbs();
+  opp_probs_ = AllocateOppProbs(hand_tree->RootSt());
+  opp_reach_zero_ = 0;
   street_buckets_ = AllocateStreetBuckets();
   action_sequence_ = "x";
   hand_tree_ = hand_tree;
   total_card_probs_ = nullptr;
   // Signifies opp data is uninitialized
   sum_opp_probs_ = -1;
+  stats_ = nullptr;
 #if 0
   const CanonicalCards *hands = hand_tree_->Hands(0, 0);
   // We need to initialize total_card_probs_ and sum_opp_probs_ because an open fold is allowed.
@@ -64,43 +75,90 @@ VCFRState::VCFRState(int p, const HandTree *hand_tree) {
 // Called at an internal street-initial node.  We do not initialize total_card_probs_ (and set
 // sum_opp_probs_ to zero) because we know we will come across an opp-choice node before we need
 // those members.
-VCFRState::VCFRState(int p, const shared_ptr<double []> &opp_probs, const HandTree *hand_tree,
+VCFRState::VCFRState(int p, const shared_ptr<VCFR_VALUE []> &opp_probs, const HandTree *hand_tree,
 		     const string &action_sequence) {
   p_ = p;
   opp_probs_ = opp_probs;
+  opp_reach_zero_ = -1;
   total_card_probs_ = nullptr;
   // Signifies opp data is uninitialized
   sum_opp_probs_ = -1;
   hand_tree_ = hand_tree;
   action_sequence_ = action_sequence;
   street_buckets_ = AllocateStreetBuckets();
+  stats_ = nullptr;
+}
+
+// Called for each of the boards ngbd dealt at a street-initial node on street nst.  The opponent
+// reach probabilities are carried over from the predecessor board.  The street buckets are shared
+// with pred so this is only suitable when the boards are processed one at a time.
+VCFRState::VCFRState(const VCFRState &pred, int nst, int ngbd) {
+  p_ = pred.P();
+  opp_probs_ = pred.NextStreetOppProbs(nst, ngbd);
+  // Dealing a board can't make any opponent hand more likely
+  opp_reach_zero_ = pred.opp_reach_zero_ == 1 ? 1 : -1;
+  hand_tree_ = pred.GetHandTree();
+  action_sequence_ = pred.ActionSequence();
+  street_buckets_ = pred.AllStreetBuckets();
+  stats_ = pred.Stats();
+  // Signifies opp data is uninitialized
+  sum_opp_probs_ = -1;
+  total_card_probs_ = nullptr;
 }
 
 // Create a new VCFRState corresponding to taking an action of ours.
 VCFRState::VCFRState(const VCFRState &pred, Node *node, int s) {
   p_ = pred.P();
   opp_probs_ = pred.OppProbs();
+  opp_reach_zero_ = pred.opp_reach_zero_;
   hand_tree_ = pred.GetHandTree();
   action_sequence_ = pred.ActionSequence() + node->ActionName(s);
   street_buckets_ = pred.AllStreetBuckets();
+  stats_ = pred.Stats();
   total_card_probs_ = pred.TotalCardProbs();
   sum_opp_probs_ = pred.SumOppProbs();
 }
 
 // Create a new VCFRState corresponding to taking an opponent action.
 VCFRState::VCFRState(const VCFRState &pred, Node *node, int s,
-		     const shared_ptr<double []> &opp_probs) {
+		     const shared_ptr<VCFR_VALUE []> &opp_probs) {
   p_ = pred.P();
   opp_probs_ = opp_probs;
+  opp_reach_zero_ = pred.opp_reach_zero_ == 1 ? 1 : -1;
   hand_tree_ = pred.GetHandTree();
   action_sequence_ = pred.ActionSequence() + node->ActionName(s);
   street_buckets_ = pred.AllStreetBuckets();
+  stats_ = pred.Stats();
   // Signifies opp data is uninitialized
   sum_opp_probs_ = -1;
   total_card_probs_ = nullptr;
 }
 
-int *VCFRState::StreetBuckets(int st) const {
-  int max_num_hole_card_pairs = Game::NumHoleCardPairs(0);
-  return street_buckets_.get() + st * max_num_hole_card_pairs;
+// Returns true if no opponent hand reaches the current state.  st is the street of the board
+// that opp_probs_ are for.  Worked out the first time it is asked for; states that share
+// opp_probs_ with us inherit the answer.
+bool VCFRState::OppReachZero(int st) {
+  if (opp_reach_zero_ == -1) {
+    int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+    opp_reach_zero_ = 1;
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      if (opp_probs_[i] != 0) {
+	opp_reach_zero_ = 0;
+	break;
+      }
+    }
+  }
+  return opp_reach_zero_ == 1;
+}
+
+// The opponent reach probabilities for the hands of board ngbd on street nst, which must be a
+// successor of our board.
+shared_ptr<VCFR_VALUE []> VCFRState::NextStreetOppProbs(int nst, int ngbd) const {
+  const int *prev_hands = hand_tree_->PrevHands(nst, ngbd);
+  int num_hole_card_pairs = Game::NumHoleCardPairs(nst);
+  shared_ptr<VCFR_VALUE []> next_opp_probs(new VCFR_VALUE[num_hole_card_pairs]);
+  for (int i = 0; i < num_hole_card_pairs; ++i) {
+    next_opp_probs[i] = opp_probs_[prev_hands[i]];
+  }
+  return next_opp_probs;
 }
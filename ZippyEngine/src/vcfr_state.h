@@ -4,26 +4,48 @@
 #include <memory>
 #include <string>
 
+#include "cfr_value_type.h"
 #include "hand_tree.h"
 
 class CanonicalCards;
 
+// Counts kept during a traversal when the solver asks for them.  Each thread counts into its own
+// VCFRStats, so no locking is needed; the solver sums them once the threads are done.
+struct VCFRStats {
+  VCFRStats(void) {Clear();}
+  void Clear(void);
+  void Add(const VCFRStats &stats);
+  // Calls to Process()
+  long long int num_node_visits;
+  // Succs skipped by regret pruning
+  long long int num_pruned_succs;
+  // Nodes at which Process() returned without descending because the opponent doesn't reach them
+  long long int num_zero_reach_pruned;
+  // Boards whose buckets SetStreetBuckets() got from the solver's HandTreeBuckets
+  long long int num_bucket_lookups;
+};
+
 class VCFRState {
  public:
   VCFRState(int p, const HandTree *hand_tree);
-  VCFRState(int p, const std::shared_ptr<double []> &opp_probs, const HandTree *hand_tree, 
+  VCFRState(int p, const std::shared_ptr<VCFR_VALUE []> &opp_probs, const HandTree *hand_tree,
 	    const std::string &action_sequence);
+  VCFRState(const VCFRState &pred, int nst, int ngbd);
   VCFRState(const VCFRState &pred, Node *node, int s);
-  VCFRState(const VCFRState &pred, Node *node, int s, const std::shared_ptr<double []> &opp_probs);
+  VCFRState(const VCFRState &pred, Node *node, int s,
+	    const std::shared_ptr<VCFR_VALUE []> &opp_probs);
   virtual ~VCFRState(void) {}
   int P(void) const {return p_;}
-  std::shared_ptr<double []> OppProbs(void) const {return opp_probs_;}
+  std::shared_ptr<VCFR_VALUE []> OppProbs(void) const {return opp_probs_;}
+  std::shared_ptr<VCFR_VALUE []> NextStreetOppProbs(int nst, int ngbd) const;
+  bool OppReachZero(int st);
   double SumOppProbs(void) const {return sum_opp_probs_;}
   void SetSumOppProbs(double s) {sum_opp_probs_ = s;}
   void AllocateTotalCardProbs(void);
   std::shared_ptr<double []> TotalCardProbs(void) const {return total_card_probs_;}
-  int *StreetBuckets(int st) const;
-  const std::shared_ptr<int []> AllStreetBuckets(void) const {return street_buckets_;}
+  const int *StreetBuckets(int st) const {return street_buckets_[st];}
+  void SetStreetBuckets(int st, const int *buckets) {street_buckets_[st] = buckets;}
+  const std::shared_ptr<const int *[]> AllStreetBuckets(void) const {return street_buckets_;}
   const std::string &ActionSequence(void) const {return action_sequence_;}
   const HandTree *GetHandTree(void) const {return hand_tree_;}
   int RootSt(void) const {return hand_tree_->RootSt();}
@@ -32,15 +54,27 @@ class VCFRState {
   const CanonicalCards *Hands(int st, int gbd) const {
     return hand_tree_->Hands(st, gbd);
   }
-  void SetOppProbs(const std::shared_ptr<double []> &opp_probs) {opp_probs_ = opp_probs;}
+  void SetOppProbs(const std::shared_ptr<VCFR_VALUE []> &opp_probs) {
+    opp_probs_ = opp_probs;
+    opp_reach_zero_ = -1;
+  }
+  VCFRStats *Stats(void) const {return stats_;}
+  void SetStats(VCFRStats *stats) {stats_ = stats;}
  protected:
   int p_;
-  std::shared_ptr<double []> opp_probs_;
+  // Indexed like the hands of the current board (see HandTree)
+  std::shared_ptr<VCFR_VALUE []> opp_probs_;
+  // 1 if every entry of opp_probs_ is zero, 0 if not, -1 if not computed yet
+  int opp_reach_zero_;
   double sum_opp_probs_;
   std::shared_ptr<double []> total_card_probs_;
-  std::shared_ptr<int []> street_buckets_;
+  // For each street, the buckets of the hands of the current board on that street.  Point into
+  // a HandTreeBuckets object owned by the solver.
+  std::shared_ptr<const int *[]> street_buckets_;
   std::string action_sequence_;
   const HandTree *hand_tree_;
+  // Where to count, or nullptr if not counting.  Shared with the successor states.
+  VCFRStats *stats_;
 };
 
 #endif